@@ -1,10 +1,21 @@
 import {BleManager, Device, Characteristic} from 'react-native-ble-plx';
-import {LORA_BLE_CONFIG, LoRaDevice, ChatMessage} from '../types';
+import {LORA_BLE_CONFIG, BLE_SEGMENT, BLE_RECEIPT, BLE_BATCH, BLE_BULK, STATUS_FORMAT, LoRaDevice, ChatMessage, StationStatus, BulkProgress} from '../types';
 
 export class BLEService {
   private manager: BleManager;
   private connectedDevice: Device | null = null;
   private messageCallback: ((message: ChatMessage) => void) | null = null;
+  private mtu: number = BLE_SEGMENT.defaultMtu;
+  private reassembly: string | null = null;
+  private expectedSegment: number = 0;
+  private receiptCallback: ((messageId: string, delivered: boolean) => void) | null = null;
+  private sentMessages: Map<number, string> = new Map();
+  private messageNo: number = 0;
+  private outgoingObjects: Map<number, Uint8Array> = new Map();   // Until SENT
+  private incomingObjects: Map<number, Uint8Array> = new Map();   // Until COMPLETE
+  private bulkWrites: Promise<void> = Promise.resolve();
+  private bulkProgressCallback: ((progress: BulkProgress) => void) | null = null;
+  private objectCallback: ((objectId: number, data: Uint8Array) => void) | null = null;
 
   constructor() {
     this.manager = new BleManager();
@@ -217,7 +228,13 @@ export class BLEService {
       // Connect with timeout
       this.connectedDevice = await this.manager.connectToDevice(deviceId, {
         timeout: 10000,
+        requestMTU: BLE_SEGMENT.preferredMtu,
       });
+      this.mtu = this.connectedDevice.mtu || BLE_SEGMENT.defaultMtu;
+      this.reassembly = null;
+      this.sentMessages.clear();
+      this.messageNo = 0; // The station numbers our writes from 1 per connection
+      console.log(' Negotiated BLE MTU:', this.mtu);
 
       console.log(' Discovering services and characteristics...');
       await this.connectedDevice.discoverAllServicesAndCharacteristics();
@@ -227,6 +244,12 @@ export class BLEService {
       // Set up notifications for incoming messages
       await this.setupNotifications();
       
+      // Objects a dropped connection interrupted: the station answers
+      // with the blocks it still needs
+      for (const [objectId, data] of this.outgoingObjects) {
+        this.writeBulk(BLE_BULK.offer, objectId, this.u32(data.length));
+      }
+      
       return true;
     } catch (error) {
       console.error(' Connection failed:', error);
@@ -256,7 +279,17 @@ export class BLEService {
           if (characteristic?.value) {
             try {
               // Decode base64 to string - your firmware sends plain text
-              const message = atob(characteristic.value);
+              const raw = atob(characteristic.value);
+              if (this.handleReceipt(raw) || this.handleBatch(raw)) {
+                return;
+              }
+              const message = this.reassemble(raw);
+              if (message === null) {
+                return; // Waiting for more segments
+              }
+              if (this.handleBulk(message)) {
+                return;
+              }
               console.log(' Received raw message from ESP32:', message);
               
               this.handleIncomingMessage(message);
@@ -274,6 +307,205 @@ export class BLEService {
     }
   }
 
+  // Long messages arrive as segments: [0xF8|FIRST|LAST][index][data...]
+  private reassemble(chunk: string): string | null {
+    const marker = chunk.charCodeAt(0);
+    if (chunk.length === 0 || (marker & BLE_SEGMENT.markerMask) !== BLE_SEGMENT.marker) {
+      this.reassembly = null;
+      return chunk;
+    }
+
+    const index = chunk.charCodeAt(1);
+    if (marker & BLE_SEGMENT.first) {
+      this.reassembly = '';
+      this.expectedSegment = 0;
+    }
+    if (this.reassembly === null || index !== this.expectedSegment) {
+      console.error(' Out-of-order BLE segment, dropping message');
+      this.reassembly = null;
+      return null;
+    }
+
+    this.reassembly += chunk.substring(BLE_SEGMENT.headerSize);
+    this.expectedSegment++;
+    if (marker & BLE_SEGMENT.last) {
+      const message = this.reassembly;
+      this.reassembly = null;
+      return message;
+    }
+    return null;
+  }
+
+  // Delivery receipt: [0xFD delivered | 0xFE failed][message number LE]
+  private handleReceipt(chunk: string): boolean {
+    const marker = chunk.charCodeAt(0);
+    if (chunk.length !== BLE_RECEIPT.size ||
+        (marker !== BLE_RECEIPT.delivered && marker !== BLE_RECEIPT.failed)) {
+      return false;
+    }
+
+    const messageNo = chunk.charCodeAt(1) | (chunk.charCodeAt(2) << 8);
+    const messageId = this.sentMessages.get(messageNo);
+    this.sentMessages.delete(messageNo);
+    console.log(' Delivery receipt for message', messageNo, marker === BLE_RECEIPT.delivered ? 'delivered' : 'failed');
+    if (messageId !== undefined && this.receiptCallback) {
+      this.receiptCallback(messageId, marker === BLE_RECEIPT.delivered);
+    }
+    return true;
+  }
+
+  // Messages the station stored while we were away: [0xFC]([length][message])*
+  private handleBatch(chunk: string): boolean {
+    if (chunk.length === 0 || chunk.charCodeAt(0) !== BLE_BATCH.marker) {
+      return false;
+    }
+
+    let offset = 1;
+    while (offset < chunk.length) {
+      const length = chunk.charCodeAt(offset);
+      const message = chunk.substring(offset + 1, offset + 1 + length);
+      offset += 1 + length;
+      if (this.handleBulk(message)) {
+        continue;
+      }
+      console.log(' Replayed stored message from ESP32:', message);
+      this.handleIncomingMessage(message);
+    }
+    return true;
+  }
+
+  // Bulk transfer notes: [0xF7][op][object ID LE][...]
+  private handleBulk(message: string): boolean {
+    if (message.length < BLE_BULK.headerSize || message.charCodeAt(0) !== BLE_BULK.marker) {
+      return false;
+    }
+
+    const u16 = (offset: number) => message.charCodeAt(offset) | (message.charCodeAt(offset + 1) << 8);
+    const u32 = (offset: number) => (u16(offset) | (u16(offset + 2) << 16)) >>> 0;
+    const op = message.charCodeAt(1);
+    const objectId = u32(2);
+    const outgoing = this.outgoingObjects.get(objectId);
+    const incoming = this.incomingObjects.get(objectId);
+
+    switch (op) {
+      case BLE_BULK.need: {
+        if (!outgoing) {
+          this.writeBulk(BLE_BULK.cancel, objectId, '');
+          break;
+        }
+        // Exactly the blocks asked for, in order
+        const blockSize = message.charCodeAt(6);
+        const first = u16(7);
+        const count = message.charCodeAt(9);
+        for (let index = first; index < first + count; index++) {
+          const block = outgoing.subarray(index * blockSize, (index + 1) * blockSize);
+          this.writeBulk(BLE_BULK.block, objectId, String.fromCharCode(index & 0xff, index >> 8) + this.binary(block));
+        }
+        break;
+      }
+      case BLE_BULK.progress:
+        this.bulkProgressCallback?.({objectId, delivered: u16(6), blocks: u16(8), state: 'sending'});
+        break;
+      case BLE_BULK.sent:
+        this.outgoingObjects.delete(objectId);
+        this.bulkProgressCallback?.({objectId, delivered: 0, blocks: 0, state: 'sent'});
+        break;
+      case BLE_BULK.stalled:
+        // Kept: offering it again resumes from the missing blocks
+        console.log(' Object transfer stalled:', objectId.toString(16), 'reason', message.charCodeAt(6));
+        this.bulkProgressCallback?.({objectId, delivered: 0, blocks: 0, state: 'stalled', reason: message.charCodeAt(6)});
+        break;
+      case BLE_BULK.incoming:
+        if (!incoming || incoming.length !== u32(6)) {
+          this.incomingObjects.set(objectId, new Uint8Array(u32(6)));
+        }
+        break;
+      case BLE_BULK.data: {
+        // Blocks may come twice after a station reboot; the offset makes that harmless
+        const offset = u32(6);
+        for (let i = 10; incoming && i < message.length && offset + i - 10 < incoming.length; i++) {
+          incoming[offset + i - 10] = message.charCodeAt(i);
+        }
+        break;
+      }
+      case BLE_BULK.complete:
+        if (incoming) {
+          this.incomingObjects.delete(objectId);
+          this.objectCallback?.(objectId, incoming);
+        }
+        break;
+    }
+    return true;
+  }
+
+  private u32(value: number): string {
+    return String.fromCharCode(value & 0xff, (value >> 8) & 0xff, (value >> 16) & 0xff, (value >>> 24) & 0xff);
+  }
+
+  private binary(data: Uint8Array): string {
+    let out = '';
+    for (let i = 0; i < data.length; i++) {
+      out += String.fromCharCode(data[i]);
+    }
+    return out;
+  }
+
+  // Bulk writes go out one after another, each segmented to the MTU
+  private writeBulk(op: number, objectId: number, body: string): void {
+    const message = String.fromCharCode(BLE_BULK.marker, op) + this.u32(objectId) + body;
+    this.bulkWrites = this.bulkWrites.then(async () => {
+      if (!this.connectedDevice) {
+        return;
+      }
+      try {
+        for (const segment of this.segment(message)) {
+          await this.connectedDevice.writeCharacteristicWithResponseForService(
+            LORA_BLE_CONFIG.serviceUUID,
+            LORA_BLE_CONFIG.txCharacteristicUUID,
+            btoa(segment)
+          );
+        }
+      } catch (error) {
+        console.error(' Failed to write bulk message:', error);
+      }
+    });
+  }
+
+  // Sends a binary object (photo, file) to the other station's phone. The
+  // station asks for its blocks as the link takes them; the object is kept
+  // until delivered, so a dropped connection resumes where it stopped.
+  sendObject(objectId: number, data: Uint8Array): boolean {
+    if (!this.connectedDevice) {
+      return false;
+    }
+    this.outgoingObjects.set(objectId >>> 0, data);
+    this.writeBulk(BLE_BULK.offer, objectId >>> 0, this.u32(data.length));
+    return true;
+  }
+
+  cancelObject(objectId: number): void {
+    if (this.outgoingObjects.delete(objectId >>> 0)) {
+      this.writeBulk(BLE_BULK.cancel, objectId >>> 0, '');
+    }
+  }
+
+  private segment(message: string): string[] {
+    const chunk = this.mtu - BLE_SEGMENT.attOverhead;
+    if (message.length <= chunk) {
+      return [message];
+    }
+
+    const room = chunk - BLE_SEGMENT.headerSize;
+    const segments: string[] = [];
+    for (let offset = 0, index = 0; offset < message.length; offset += room, index++) {
+      let flags = BLE_SEGMENT.marker;
+      if (offset === 0) flags |= BLE_SEGMENT.first;
+      if (offset + room >= message.length) flags |= BLE_SEGMENT.last;
+      segments.push(String.fromCharCode(flags, index) + message.substring(offset, offset + room));
+    }
+    return segments;
+  }
+
   private handleIncomingMessage(rawMessage: string): void {
     try {
       console.log(' Processing incoming LoRa message:', rawMessage);
@@ -321,16 +553,20 @@ export class BLEService {
       const messageText = text.trim();
       console.log(' Sending plain text:', messageText);
 
-      // Convert string to base64 for BLE transmission
-      const base64Message = btoa(messageText);
-
-      // Send to ESP32 RX characteristic (where ESP32 receives data)
-      await this.connectedDevice.writeCharacteristicWithResponseForService(
-        LORA_BLE_CONFIG.serviceUUID,
-        LORA_BLE_CONFIG.txCharacteristicUUID,
-        base64Message
-      );
+      // Split to the negotiated MTU, convert to base64 for BLE transmission
+      for (const segment of this.segment(messageText)) {
+        // Send to ESP32 RX characteristic (where ESP32 receives data)
+        await this.connectedDevice.writeCharacteristicWithResponseForService(
+          LORA_BLE_CONFIG.serviceUUID,
+          LORA_BLE_CONFIG.txCharacteristicUUID,
+          btoa(segment)
+        );
+      }
 
+      this.messageNo = (this.messageNo + 1) & 0xffff || 1;
+      if (messageId) {
+        this.sentMessages.set(this.messageNo, messageId);
+      }
       console.log(' Message sent successfully to ESP32');
       return true;
     } catch (error) {
@@ -339,10 +575,84 @@ export class BLEService {
     }
   }
 
+  // Latency histograms and counters, read on demand from the status characteristic
+  async readStatus(): Promise<StationStatus | null> {
+    if (!this.connectedDevice) {
+      return null;
+    }
+
+    try {
+      const characteristic = await this.connectedDevice.readCharacteristicForService(
+        LORA_BLE_CONFIG.serviceUUID,
+        LORA_BLE_CONFIG.statusCharacteristicUUID
+      );
+      return characteristic.value ? this.parseStatus(atob(characteristic.value)) : null;
+    } catch (error) {
+      console.error(' Failed to read station status:', error);
+      return null;
+    }
+  }
+
+  // [version][station][stages][buckets][counters][0][uptime][counters...][stages...], LE
+  private parseStatus(raw: string): StationStatus | null {
+    const u32 = (offset: number) =>
+      (raw.charCodeAt(offset) | (raw.charCodeAt(offset + 1) << 8) |
+       (raw.charCodeAt(offset + 2) << 16) | (raw.charCodeAt(offset + 3) << 24)) >>> 0;
+
+    if (raw.length < STATUS_FORMAT.headerSize || raw.charCodeAt(0) !== STATUS_FORMAT.version) {
+      return null;
+    }
+    const stageCount = raw.charCodeAt(2);
+    const bucketCount = raw.charCodeAt(3);
+    const counterCount = raw.charCodeAt(4);
+    const stageSize = 12 + 4 * bucketCount;
+    if (raw.length < STATUS_FORMAT.headerSize + 4 * counterCount + stageCount * stageSize) {
+      return null;
+    }
+
+    const status: StationStatus = {
+      stationId: raw.charCodeAt(1),
+      uptimeMs: u32(6),
+      counters: {},
+      stages: {},
+    };
+    let offset = STATUS_FORMAT.headerSize;
+    for (let i = 0; i < counterCount; i++, offset += 4) {
+      status.counters[STATUS_FORMAT.counters[i] ?? `counter${i}`] = u32(offset);
+    }
+    for (let s = 0; s < stageCount; s++, offset += stageSize) {
+      const buckets: number[] = [];
+      for (let b = 0; b < bucketCount; b++) {
+        buckets.push(u32(offset + 12 + 4 * b));
+      }
+      status.stages[STATUS_FORMAT.stages[s] ?? `stage${s}`] = {
+        count: u32(offset),
+        maxUs: u32(offset + 4),
+        averageUs: u32(offset + 8),
+        buckets,
+      };
+    }
+    return status;
+  }
+
   setMessageCallback(callback: (message: ChatMessage) => void): void {
     this.messageCallback = callback;
   }
 
+  setBulkProgressCallback(callback: (progress: BulkProgress) => void): void {
+    this.bulkProgressCallback = callback;
+  }
+
+  // Called with each object received from the other station
+  setObjectCallback(callback: (objectId: number, data: Uint8Array) => void): void {
+    this.objectCallback = callback;
+  }
+
+  // Called when the other station acknowledges (or gives up on) a message
+  setReceiptCallback(callback: (messageId: string, delivered: boolean) => void): void {
+    this.receiptCallback = callback;
+  }
+
   async disconnect(): Promise<void> {
     try {
       if (this.connectedDevice) {
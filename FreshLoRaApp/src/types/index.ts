@@ -35,5 +35,84 @@ export const LORA_BLE_CONFIG: BLECharacteristics = {
   serviceUUID: '6E400001-B5A3-F393-E0A9-E50E24DCCA9E',           // Nordic UART Service
   rxCharacteristicUUID: '6E400003-B5A3-F393-E0A9-E50E24DCCA9E',  // Phone receives from ESP32 TX
   txCharacteristicUUID: '6E400002-B5A3-F393-E0A9-E50E24DCCA9E',  // Phone sends to ESP32 RX
-  statusCharacteristicUUID: '6E400001-B5A3-F393-E0A9-E50E24DCCA9E', // Status updates
+  statusCharacteristicUUID: '6E400004-B5A3-F393-E0A9-E50E24DCCA9E', // Binary status snapshot (read)
 };
+
+// BLE segmentation header shared with the firmware (include/ble_segment.h)
+export const BLE_SEGMENT = {
+  defaultMtu: 23,
+  preferredMtu: 517,
+  attOverhead: 3,
+  headerSize: 2,
+  marker: 0xf8,
+  markerMask: 0xfc,
+  first: 0x01,
+  last: 0x02,
+};
+
+// Status snapshot layout shared with the firmware (include/station_status.h)
+export const STATUS_FORMAT = {
+  version: 1,
+  headerSize: 10,
+  stages: ['bleIngest', 'queueWait', 'airtime', 'rxDecode', 'rxDeliver', 'rxTotal'],
+  counters: [
+    'phoneMessages', 'bleNotifications', 'framesQueued', 'framesSent', 'framesReceived',
+    'txFailures', 'rxFailures', 'crcErrors', 'queueFull', 'cadBusy', 'backoffs',
+    'arqRetransmissions', 'arqAcked', 'arqFailed', 'duplicates', 'relayed',
+    'poolFailures', 'poolHighWater',
+  ],
+  // Upper bound of each histogram bucket in us; the last bucket is open
+  bucketLimitsUs: [100, 250, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000],
+};
+
+export interface StageLatency {
+  count: number;
+  maxUs: number;
+  averageUs: number;
+  buckets: number[];
+}
+
+export interface StationStatus {
+  stationId: number;
+  uptimeMs: number;
+  counters: Record<string, number>;
+  stages: Record<string, StageLatency>;
+}
+
+// Delivery receipts for our own messages (include/ble_segment.h)
+export const BLE_RECEIPT = {
+  delivered: 0xfd,
+  failed: 0xfe,
+  size: 3,
+};
+
+// Stored messages replayed after a reconnect, several per notification:
+// [0xFC][length][message][length][message]...
+export const BLE_BATCH = {
+  marker: 0xfc,
+};
+
+// Bulk transfers of binary objects (include/lora_bulk.h). Every message
+// starts with [0xF7][op][object ID, 32 bits LE].
+export const BLE_BULK = {
+  marker: 0xf7,
+  headerSize: 6,
+  offer: 0x01,      // [size, 32]
+  block: 0x02,      // [block, 16][data]
+  cancel: 0x03,
+  need: 0x11,       // [block size][first block, 16][count]
+  progress: 0x12,   // [blocks delivered, 16][blocks, 16]
+  sent: 0x13,
+  stalled: 0x14,    // [reason]
+  incoming: 0x21,   // [size, 32]
+  data: 0x22,       // [offset, 32][data]
+  complete: 0x23,   // [size, 32]
+};
+
+export interface BulkProgress {
+  objectId: number;
+  delivered: number;
+  blocks: number;
+  state: 'sending' | 'sent' | 'stalled';
+  reason?: number;
+}
@@ -0,0 +1,104 @@
+/*
+ * BLE Segmentation and Reassembly
+ *
+ * A notification or write carries at most (ATT MTU - 3) bytes. Messages
+ * that fit are sent unchanged, so plain-text clients keep working.
+ * Longer messages are split into segments, each prefixed with a 2-byte
+ * continuation header:
+ *
+ *   byte 0   0xF8 | FIRST (0x01) | LAST (0x02)
+ *   byte 1   segment index, starting at 0
+ *
+ * 0xF8-0xFF never start a UTF-8 character, so a segment can always be
+ * told apart from a whole text message. The phone uses the same header
+ * for long writes.
+ *
+ * Delivery receipts for the phone's own messages use the same trick:
+ *
+ *   [0xFD delivered | 0xFE failed][message number, 16 bits LE]
+ *
+ * Messages are numbered from 1 in the order the phone writes them,
+ * restarting on every connection.
+ *
+ * Short messages replayed from the store-and-forward log (msg_store.h)
+ * are packed several to a notification:
+ *
+ *   [0xFC][length][message][length][message]...
+ *
+ * Bulk transfers of binary objects start with 0xF7, which is not a UTF-8
+ * lead byte either (lora_bulk.h).
+ */
+
+#ifndef BLE_SEGMENT_H
+#define BLE_SEGMENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "lora_fragment.h"
+
+// ===== SEGMENT CONFIGURATION =====
+#define BLE_DEFAULT_MTU         23
+#define BLE_PREFERRED_MTU       517     // Largest ATT MTU we ask for
+#define BLE_ATT_OVERHEAD        3
+#define BLE_SEG_HEADER_SIZE     2
+#define BLE_SEG_MARKER          0xF8
+#define BLE_SEG_MARKER_MASK     0xFC
+#define BLE_SEG_FIRST           0x01
+#define BLE_SEG_LAST            0x02
+#define BLE_MESSAGE_MAX         LORA_FRAG_MAX_MESSAGE
+#define BLE_RECEIPT_DELIVERED   0xFD
+#define BLE_RECEIPT_FAILED      0xFE
+#define BLE_RECEIPT_SIZE        3
+#define BLE_BATCH_MARKER        0xFC
+#define BLE_BATCH_MAX_MESSAGE   255     // One length byte
+#define BLE_BULK_MARKER         0xF7
+
+// Splits one message into notification-sized chunks
+struct BleSegmenter {
+  const uint8_t* msg;
+  size_t len;
+  size_t offset;
+  size_t chunk;       // Max bytes per notification (MTU - 3)
+  uint8_t index;
+
+  void begin(const uint8_t* message, size_t length, uint16_t mtu);
+
+  // Writes the next segment into out (at least chunk bytes); returns its
+  // length, or 0 when the whole message has been emitted.
+  size_t next(uint8_t* out);
+};
+
+// Packs short messages into one notification
+struct BleBatch {
+  uint8_t buf[BLE_PREFERRED_MTU - BLE_ATT_OVERHEAD];
+  size_t len;
+  size_t cap;
+  uint8_t count;
+
+  void begin(uint16_t mtu);
+
+  // Appends a message; false if it does not fit in what is left
+  bool add(const uint8_t* msg, size_t msgLen);
+};
+
+enum BleReassemblyResult : uint8_t {
+  BLE_REASM_PENDING = 0,    // Segment accepted, message not complete
+  BLE_REASM_COMPLETE,       // message()/length() hold a whole message
+  BLE_REASM_ERROR           // Out-of-order segment or overflow; dropped
+};
+
+// Rebuilds messages from consecutive writes into a fixed buffer
+struct BleReassembler {
+  uint8_t buf[BLE_MESSAGE_MAX];
+  size_t len;
+  uint8_t expected;
+  bool active;
+
+  void reset();
+  BleReassemblyResult push(const uint8_t* data, size_t dataLen);
+
+  const uint8_t* message() const { return buf; }
+  size_t length() const { return len; }
+};
+
+#endif // BLE_SEGMENT_H
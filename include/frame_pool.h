@@ -0,0 +1,91 @@
+/*
+ * Static Frame Buffer Pool
+ *
+ * A fixed number of LoRa-frame-sized buffers carved out of .bss at link
+ * time. Buffers are owned through move-only FrameHandle objects which
+ * return the buffer to the pool when they go out of scope, so a message
+ * can flow BLE -> radio or radio -> BLE without malloc and without being
+ * copied between stages. Only the handle's one-byte index travels through
+ * FreeRTOS queues.
+ *
+ * Allocation and release take a short spinlock and are safe from any
+ * task on either core.
+ */
+
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "lora_frame.h"
+
+// ===== POOL CONFIGURATION =====
+#define FRAME_POOL_SIZE       24
+#define FRAME_POOL_INVALID    0xFF
+
+struct FrameBuffer {
+  uint32_t stampUs;     // Enqueue time (TX) or DIO1 interrupt time (RX)
+  int16_t rssi;         // RX only: packet RSSI in dBm
+  int8_t snrQ;          // RX only: packet SNR in 0.25 dB steps
+  uint16_t config;      // RX only: generation of the radio settings it arrived with
+  uint16_t preamble;    // TX only: preamble symbols, 0 = LORA_PREAMBLE_SYMBOLS
+  uint8_t channels;     // TX only: plan channels to send on (bit mask), 0 = RX channel
+  uint8_t priority;     // TX only: duty-cycle class (AirtimePriority), 0 = data
+  uint8_t len;
+  uint8_t data[LORA_FRAME_MAX_SIZE];
+};
+
+struct FramePoolStats {
+  uint32_t allocations;
+  uint32_t allocFailures;   // Pool exhausted
+  uint32_t inUse;
+  uint32_t highWater;       // Most buffers ever in use at once
+};
+
+class FrameHandle {
+ public:
+  FrameHandle() : index(FRAME_POOL_INVALID) {}
+  FrameHandle(FrameHandle&& other) : index(other.index) {
+    other.index = FRAME_POOL_INVALID;
+  }
+  FrameHandle& operator=(FrameHandle&& other) {
+    if (this != &other) {
+      reset();
+      index = other.index;
+      other.index = FRAME_POOL_INVALID;
+    }
+    return *this;
+  }
+  FrameHandle(const FrameHandle&) = delete;
+  FrameHandle& operator=(const FrameHandle&) = delete;
+  ~FrameHandle() { reset(); }
+
+  bool valid() const { return index != FRAME_POOL_INVALID; }
+  FrameBuffer* operator->() const;
+  FrameBuffer& operator*() const;
+
+  // Returns the buffer to the pool now
+  void reset();
+
+  // Gives up ownership and returns the raw index, for passing through a
+  // queue. The receiver takes ownership again with adopt().
+  uint8_t release() {
+    uint8_t i = index;
+    index = FRAME_POOL_INVALID;
+    return i;
+  }
+  static FrameHandle adopt(uint8_t index) { return FrameHandle(index); }
+
+ private:
+  explicit FrameHandle(uint8_t i) : index(i) {}
+  friend FrameHandle framePoolAlloc();
+
+  uint8_t index;
+};
+
+// Takes a free buffer; the handle is invalid if the pool is exhausted.
+FrameHandle framePoolAlloc();
+
+const FramePoolStats& framePoolGetStats();
+
+#endif // FRAME_POOL_H
@@ -0,0 +1,62 @@
+/*
+ * Fixed-Bucket Latency Histogram
+ *
+ * Cheap enough to update on the hot path: one compare loop over a short
+ * table of bucket upper bounds and two counter increments. Bounds are in
+ * microseconds and roughly logarithmic, covering SPI-read latency up to
+ * the old 100 ms polling period and beyond.
+ */
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+
+#define LATENCY_BUCKETS 12
+
+// Upper bound (exclusive) of each bucket in us; the last bucket is open
+static const uint32_t LATENCY_BUCKET_LIMITS_US[LATENCY_BUCKETS - 1] = {
+  100, 250, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000
+};
+
+struct LatencyHistogram {
+  uint32_t buckets[LATENCY_BUCKETS];
+  uint32_t count;
+  uint32_t maxUs;
+  uint64_t totalUs;
+
+  void record(uint32_t us) {
+    uint8_t i = 0;
+    while (i < LATENCY_BUCKETS - 1 && us >= LATENCY_BUCKET_LIMITS_US[i]) {
+      i++;
+    }
+    buckets[i]++;
+    count++;
+    totalUs += us;
+    if (us > maxUs) {
+      maxUs = us;
+    }
+  }
+
+  uint32_t averageUs() const {
+    return count ? (uint32_t)(totalUs / count) : 0;
+  }
+
+  // Smallest bucket bound below which at least pct% of samples fall
+  uint32_t percentileUs(uint8_t pct) const {
+    if (count == 0) {
+      return 0;
+    }
+    uint64_t target = ((uint64_t)count * pct + 99) / 100;
+    uint64_t seen = 0;
+    for (uint8_t i = 0; i < LATENCY_BUCKETS - 1; i++) {
+      seen += buckets[i];
+      if (seen >= target) {
+        return LATENCY_BUCKET_LIMITS_US[i];
+      }
+    }
+    return maxUs;
+  }
+};
+
+#endif // LATENCY_HISTOGRAM_H
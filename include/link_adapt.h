@@ -0,0 +1,134 @@
+/*
+ * Adaptive Data Rate and Transmit Power Control
+ *
+ * Both stations measure SNR/RSSI on every frame they receive from the
+ * peer, and loss on the link itself: each station counts the frames it
+ * sends straight to the peer, reports that count in every control
+ * frame, and the peer compares it with what it heard. The frame sequence
+ * number is no use here, since it also counts frames to other stations,
+ * relayed traffic and other channels. When there is enough SNR margin they agree
+ * on a faster profile (lower SF or wider BW); when margin or delivery
+ * drops they step back to a slower one. Stepping up takes
+ * LINK_UP_HYSTERESIS_DB more margin than staying, so a link near the
+ * boundary (or one whose power was just trimmed) does not flip between two. Output power is trimmed
+ * separately from the SNR the peer reports back about our own frames.
+ *
+ * Profile changes use a small control handshake (FRAME_TYPE_CTRL):
+ *
+ *   A: PROPOSE(p)  ->  B             (on the current profile)
+ *   B: ACCEPT(q)   ->  A             q = min(p, what B can support)
+ *   A: PROBE(q)    ->  B             twice, still on the current profile,
+ *                                    then A switches; B switches on receipt
+ *   both send PROBE on the new profile, every LINK_PROBE_MS, and answer
+ *   the peer's with a REPORT. Each must hear the peer on the new profile
+ *   within LINK_VERIFY_MS, otherwise it reverts to the previous one.
+ *
+ * A lost ACCEPT, or both first PROBEs lost, leaves B where it was and A
+ * reverting to it. Only frames received once the radio has applied the new settings
+ * (by their config generation, see lora_radio.h) count as hearing the
+ * peer on them.
+ *
+ * A committed non-default profile is kept alive by periodic REPORT
+ * frames. If nothing is heard from the peer for LINK_SILENCE_MS both
+ * sides independently fall back to the boot profile, so a lost
+ * handshake message can never strand the link.
+ *
+ * Control payload: [opcode][profile][switch ID][reported SNR, 0.25 dB]
+ *                  [frames sent to the peer, 16 bits LE, this one included]
+ */
+
+#ifndef LINK_ADAPT_H
+#define LINK_ADAPT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== ADAPTATION CONFIGURATION =====
+#ifndef LINK_ADAPT_ENABLED
+#define LINK_ADAPT_ENABLED      1       // 0 keeps the boot profile; power control stays on
+#endif
+#define LINK_PROFILE_COUNT      6
+#define LINK_DEFAULT_PROFILE    3       // SF7 / 125 kHz, the boot profile
+#define LINK_DEFAULT_POWER      14      // dBm
+#define LINK_MIN_POWER          2
+#define LINK_MAX_POWER          20
+#define LINK_POWER_STEP         2
+#define LINK_MARGIN_DB          5       // Headroom kept above demod floor
+#define LINK_UP_HYSTERESIS_DB   3       // More headroom to step up than to stay
+#define LINK_LOSS_FALLBACK_PCT  25
+#define LINK_MIN_SAMPLES        8       // Frames heard before deciding
+#define LINK_DECIDE_MS          10000
+#define LINK_PROPOSE_TIMEOUT_MS 3000
+#define LINK_VERIFY_MS          5000
+#define LINK_PROBE_MS           1000    // PROBE repeat while verifying
+#define LINK_REPORT_MS          30000   // Keepalive on the boot profile
+#define LINK_REPORT_FAST_MS     10000   // Keepalive on any other profile
+#define LINK_SILENCE_MS         35000
+#define LINK_CTRL_SIZE          6
+
+struct LoRaProfile {
+  uint8_t sf;
+  float bwKHz;
+  int8_t requiredSnrDb;     // Demodulation floor for this SF/BW
+};
+
+extern const LoRaProfile LINK_PROFILES[LINK_PROFILE_COUNT];
+
+enum LinkCtrlOpcode : uint8_t {
+  LINK_OP_PROPOSE = 1,
+  LINK_OP_ACCEPT,
+  LINK_OP_PROBE,
+  LINK_OP_REPORT
+};
+
+enum LinkState : uint8_t {
+  LINK_STABLE = 0,
+  LINK_PROPOSED,        // Waiting for ACCEPT
+  LINK_ACCEPTED,        // Waiting for the proposer's PROBE
+  LINK_VERIFYING        // Switched, waiting to hear the peer
+};
+
+struct LinkAdaptStats {
+  uint32_t switches;
+  uint32_t reverts;           // Verify window expired
+  uint32_t silenceFallbacks;
+  uint32_t powerChanges;
+  float snrAvg;               // EWMA of received SNR, dB
+  float rssiAvg;              // EWMA of received RSSI, dBm
+  uint8_t lossPct;            // Loss of frames sent to us, over the last window
+  float peerSnr;              // What the peer reports hearing from us
+};
+
+// Sends a control payload to the peer; returns false if it was dropped
+typedef bool (*LinkSendFn)(const uint8_t* ctrl, size_t len);
+// Reconfigures the radio (applied once the TX queue has drained).
+// Returns the generation of the new settings, 0 if they were not queued.
+typedef uint16_t (*LinkApplyFn)(const LoRaProfile& profile, int8_t powerDbm);
+
+void linkAdaptBegin(uint8_t stationId, LinkSendFn send, LinkApplyFn apply, uint32_t nowMs);
+
+// Starts from settings restored at boot instead of the defaults; the
+// radio must already be configured for them
+void linkAdaptRestore(uint8_t profile, int8_t powerDbm);
+
+// Every frame received from the peer, with its link metrics. addressed:
+// the peer sent it to this station directly, so it counted it for us.
+// config: generation of the radio settings it arrived with.
+void linkAdaptOnFrame(uint8_t src, bool addressed, float rssi, float snr, uint16_t config, uint32_t nowMs);
+
+// A frame for the peer went on the queue, unicast and straight to it.
+// Safe from any task, including from inside the LinkSendFn.
+void linkAdaptCountSent();
+
+// A FRAME_TYPE_CTRL payload from the peer
+void linkAdaptOnControl(uint8_t src, const uint8_t* ctrl, size_t len, uint32_t nowMs);
+
+// Timeouts, keepalives and rate/power decisions; call periodically
+void linkAdaptPoll(uint32_t nowMs);
+
+uint8_t linkAdaptProfileIndex();
+int8_t linkAdaptPower();
+LinkState linkAdaptState();
+const LinkAdaptStats& linkAdaptGetStats();
+
+#endif // LINK_ADAPT_H
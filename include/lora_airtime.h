@@ -0,0 +1,181 @@
+/*
+ * Time on Air and Duty-Cycle Budget
+ *
+ * loraTimeOnAirUs() is the Semtech AN1200.13 formula for an explicit
+ * header LoRa packet. It is constexpr, so airtime for fixed settings can
+ * be worked out at compile time:
+ *
+ *   T = (preamble + 4.25 + 8 + max(ceil((8L - 4SF + 28 + 16CRC)
+ *        / (4(SF - 2DE))) * CR, 0)) * 2^SF / BW
+ *
+ * where DE (low data rate optimisation) is on once a symbol lasts 16 ms
+ * or more and CR is the coding rate denominator (5 for 4/5).
+ *
+ * Regional rules cap each transmitter to a share of a sliding window
+ * (ETSI EN 300 220: 1% per hour in most EU868 sub-bands). The airtime
+ * ledger keeps the measured time on air in LORA_DUTY_BUCKETS buckets
+ * spanning LORA_DUTY_WINDOW_MS. A bucket only expires as a whole, so
+ * the window is at most one bucket longer than configured. That errs on
+ * the safe side.
+ *
+ * Before each transmission the radio driver asks airtimeAdmit() whether
+ * the frame's calculated airtime still fits. What happens when it does
+ * not depends on the frame's priority:
+ *
+ *   CONTROL  ACKs and link control. They may use the whole budget and
+ *            otherwise wait.
+ *   DATA     Our own messages. They may use LORA_DUTY_DATA_PCT of the
+ *            budget, so a station that fills it can still acknowledge.
+ *            A frame waits while the wait is under LORA_DUTY_MAX_WAIT_MS
+ *            and is shed otherwise (ARQ sends it again later).
+ *   BULK     Bulk transfers. They may use LORA_DUTY_BULK_PCT of the
+ *            budget and are shed as soon as they do not fit.
+ *
+ * A relayed frame keeps the class of the frame it carries, so a relayed
+ * ACK is still CONTROL. While a frame waits, the driver lets one frame of
+ * a class with a larger share go past it.
+ *
+ * The limit only applies where the band has one: LORA_DUTY_CYCLE_ENABLED
+ * defaults on with LORA_REGION_EU868 and off otherwise (the default
+ * channel plan is at 915 MHz). Off, everything is sent right away, but
+ * the ledger still reports the utilization.
+ *
+ * The listen-before-talk backoff (lora_radio.h) is worked out here too:
+ * slots of LORA_LBT_SLOT_SYMBOLS symbols, drawn from a window of
+ * LORA_LBT_CW_MIN slots that doubles with every busy scan up to
+ * LORA_LBT_CW_MAX.
+ */
+
+#ifndef LORA_AIRTIME_H
+#define LORA_AIRTIME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== DUTY CYCLE CONFIGURATION =====
+#ifndef LORA_DUTY_CYCLE_ENABLED
+#ifdef LORA_REGION_EU868
+#define LORA_DUTY_CYCLE_ENABLED   1
+#else
+#define LORA_DUTY_CYCLE_ENABLED   0
+#endif
+#endif
+#ifndef LORA_DUTY_CYCLE_PERMILLE
+#define LORA_DUTY_CYCLE_PERMILLE  10      // 1%; bands without a limit can use 1000
+#endif
+#define LORA_DUTY_WINDOW_MS       3600000UL
+#define LORA_DUTY_BUCKETS         60
+#define LORA_DUTY_BUCKET_MS       (LORA_DUTY_WINDOW_MS / LORA_DUTY_BUCKETS)
+#define LORA_DUTY_BUDGET_US       ((uint64_t)LORA_DUTY_WINDOW_MS * LORA_DUTY_CYCLE_PERMILLE)
+#define LORA_DUTY_DATA_PCT        90      // The rest is kept for ACKs and link control
+#define LORA_DUTY_BULK_PCT        70
+#define LORA_DUTY_MAX_WAIT_MS     30000
+#define LORA_CODING_RATE          5       // 4/5, as passed to radio.begin()
+
+// ===== LISTEN BEFORE TALK =====
+#ifndef LORA_LBT_ENABLED
+#define LORA_LBT_ENABLED      1
+#endif
+#ifndef LORA_LBT_PERSISTENCE_PCT
+#define LORA_LBT_PERSISTENCE_PCT 100  // Chance to send on a free channel, else wait a slot
+#endif
+#define LORA_LBT_SLOT_SYMBOLS 4     // Backoff slot: CAD plus RX/TX turnaround
+#define LORA_LBT_CW_MIN       8     // Contention window, slots
+#define LORA_LBT_CW_MAX       128
+#define LORA_LBT_MAX_BUSY     7     // Busy scans before sending regardless
+
+enum AirtimePriority : uint8_t {
+  AIRTIME_PRIO_DATA = 0,
+  AIRTIME_PRIO_CONTROL,
+  AIRTIME_PRIO_BULK,
+  AIRTIME_PRIO_COUNT
+};
+
+enum AirtimeVerdict : uint8_t {
+  AIRTIME_SEND = 0,
+  AIRTIME_WAIT,       // Fits once older airtime leaves the window
+  AIRTIME_SHED        // Drop the frame
+};
+
+// ===== TIME ON AIR =====
+constexpr bool loraLowDataRate(uint8_t sf, float bwKHz) {
+  return (float)(1UL << sf) / bwKHz >= 16.0f;
+}
+
+constexpr int32_t loraCeilPositive(int32_t num, int32_t den) {
+  return num > 0 ? (num + den - 1) / den : 0;
+}
+
+constexpr uint32_t loraPayloadSymbols(uint8_t sf, float bwKHz, size_t len,
+                                      uint8_t cr = LORA_CODING_RATE, bool crc = true) {
+  return 8 + (uint32_t)loraCeilPositive(8 * (int32_t)len - 4 * sf + 28 + (crc ? 16 : 0),
+                                        4 * (sf - (loraLowDataRate(sf, bwKHz) ? 2 : 0))) * cr;
+}
+
+constexpr uint32_t loraTimeOnAirUs(uint8_t sf, float bwKHz, size_t len, uint16_t preamble,
+                                   uint8_t cr = LORA_CODING_RATE, bool crc = true) {
+  return (uint32_t)(((float)preamble + 4.25f + (float)loraPayloadSymbols(sf, bwKHz, len, cr, crc)) *
+                    (float)(1UL << sf) * 1000.0f / bwKHz);
+}
+
+// ===== BACKOFF =====
+constexpr uint32_t loraLbtSlotUs(uint8_t sf, float bwKHz) {
+  return (uint32_t)(LORA_LBT_SLOT_SYMBOLS * (float)(1UL << sf) * 1000.0f / bwKHz);
+}
+
+// Contention window after exp busy scans, in slots
+constexpr uint32_t loraLbtWindow(uint8_t exp) {
+  return (exp >= 16 || ((uint32_t)LORA_LBT_CW_MIN << exp) > LORA_LBT_CW_MAX) ? LORA_LBT_CW_MAX
+                                                                             : (uint32_t)LORA_LBT_CW_MIN << exp;
+}
+
+// Backoff for a random draw: whole slots, less than the window
+constexpr uint32_t loraLbtBackoffUs(uint8_t exp, uint32_t random, uint32_t slotUs) {
+  return (random % loraLbtWindow(exp)) * slotUs;
+}
+
+// ===== AIRTIME LEDGER =====
+struct AirtimeLedger {
+  uint32_t bucket[LORA_DUTY_BUCKETS];   // Bucket number (ms / LORA_DUTY_BUCKET_MS) held by each entry
+  uint32_t airUs[LORA_DUTY_BUCKETS];
+
+  void record(uint32_t nowMs, uint32_t us);
+
+  // Airtime inside the window ending at nowMs
+  uint64_t usedUs(uint32_t nowMs) const;
+
+  // Time until needUs more fits under limitUs. Returns 0 if it fits now
+  // and UINT32_MAX if it never will.
+  uint32_t waitMs(uint32_t nowMs, uint64_t needUs, uint64_t limitUs) const;
+};
+
+// ===== SCHEDULER =====
+struct AirtimeStats {
+  uint32_t admitted;
+  uint32_t waits;                       // Holds on a frame that did not fit yet
+  uint32_t maxWaitMs;
+  uint32_t shed[AIRTIME_PRIO_COUNT];
+  uint64_t airUs[AIRTIME_PRIO_COUNT];   // Measured time on air since boot
+};
+
+void airtimeBegin();
+
+// Share of the budget a priority may fill, in percent
+uint8_t airtimeSharePct(uint8_t priority);
+
+// Decides whether a frame of the given priority and calculated airtime
+// goes out now. On AIRTIME_WAIT, *waitMs is how long until it fits.
+AirtimeVerdict airtimeAdmit(uint8_t priority, uint32_t airUs, uint32_t nowMs, uint32_t* waitMs);
+
+// Books a finished transmission (measured airtime)
+void airtimeRecord(uint8_t priority, uint32_t airUs, uint32_t nowMs);
+
+// Airtime in the current window
+uint64_t airtimeUsedUs(uint32_t nowMs);
+
+// Share of the budget used in the current window, in percent
+uint8_t airtimeUtilizationPct(uint32_t nowMs);
+
+const AirtimeStats& airtimeGetStats();
+
+#endif // LORA_AIRTIME_H
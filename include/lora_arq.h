@@ -0,0 +1,157 @@
+/*
+ * Selective-Repeat ARQ Between Stations
+ *
+ * Optional reliable delivery for data frames. A reliable frame has
+ * FRAME_FLAG_RELIABLE set and starts its payload with
+ *
+ *   [session][ARQ sequence][sender base]
+ *
+ * where session is picked at boot so the peer can tell a restart from an
+ * old duplicate, and sender base is the oldest sequence the sender still
+ * holds. Everything before it is settled, acknowledged or given up, so a
+ * receiver starting a window, or falling behind one, begins there rather
+ * than at whatever frame arrived first; frames lost ahead of that are
+ * still waited for and never acknowledged unseen.
+ *
+ * Acknowledgements are a 4-byte block carried by any frame with
+ * FRAME_FLAG_ACK, piggybacked on reverse traffic or sent alone in a
+ * FRAME_TYPE_ACK frame after ARQ_ACK_DELAY_MS:
+ *
+ *   [peer session][next expected seq][SACK bitmap, 16 bits LE]
+ *
+ * Bit i of the bitmap acknowledges (next expected + 1 + i), so losses
+ * are repaired selectively instead of going back N. Up to ARQ_WINDOW
+ * frames are in flight at once; up to ARQ_TX_SLOTS are buffered for
+ * sending. The retransmission timeout follows RFC 6298
+ * (SRTT + 4 * RTTVAR) with a floor derived from the frame airtime.
+ * Each timer runs up to a quarter longer at random, so two half duplex
+ * stations that lost frames by transmitting at once do not keep retrying
+ * in step.
+ *
+ * Frames are only sent reliably to one peer, but up to ARQ_RX_PEERS
+ * stations can send to us, each with its own receive window.
+ *
+ * Delivery is unordered: each new frame is passed up as it arrives and
+ * duplicates are suppressed, so a message may reach the peer's phone
+ * ahead of one written before it. The receiver may also acknowledge
+ * frames it never got but no longer needs (fragments rebuilt by FEC);
+ * the sender then drops them, sent or not.
+ *
+ * Phone messages are tracked by tag (never ARQ_NO_MESSAGE), so a
+ * delivery receipt can be reported once every frame carrying a message
+ * has been acknowledged, and a failure once any of them is given up. A
+ * message gets one receipt or the other, never both.
+ */
+
+#ifndef LORA_ARQ_H
+#define LORA_ARQ_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "lora_frame.h"
+
+// ===== ARQ CONFIGURATION =====
+#ifndef LORA_ARQ_ENABLED
+#define LORA_ARQ_ENABLED      1
+#endif
+#define ARQ_WINDOW            8
+#define ARQ_TX_SLOTS          16      // Power of two, >= ARQ_WINDOW
+#define ARQ_MAX_TRIES         6
+#define ARQ_RX_PEERS          4       // Senders tracked on the receive side
+#define ARQ_ACK_DELAY_MS      40      // Wait for reverse traffic to carry the ACK
+#define ARQ_MAX_RTO_MS        30000
+#define ARQ_HEADER_SIZE       3
+#define ARQ_ACK_SIZE          4
+#define ARQ_FRAME_OVERHEAD    (ARQ_HEADER_SIZE + ARQ_ACK_SIZE)
+#define ARQ_MAX_BODY          (LORA_FRAME_MAX_PAYLOAD - ARQ_FRAME_OVERHEAD)
+#define ARQ_RADIO_BACKLOG     2       // Frames left in the TX queue before pumping more
+#define ARQ_NO_MESSAGE        0       // Frame carries no tracked phone message
+#define ARQ_MAX_FRAME_MSGS    8       // Phone messages one frame may carry
+
+enum ArqRxResult : uint8_t {
+  ARQ_RX_NEW = 0,
+  ARQ_RX_DUPLICATE
+};
+
+struct ArqReceipt {
+  uint16_t msgNo;
+  bool delivered;     // false: gave up after ARQ_MAX_TRIES
+};
+
+// One frame ready for the radio, copied out of the ARQ buffer
+struct ArqOutFrame {
+  uint8_t flags;
+  uint8_t attempt;            // 1 for the first transmission
+  uint8_t header[ARQ_HEADER_SIZE];
+  uint8_t len;
+  uint8_t body[ARQ_MAX_BODY];
+};
+
+struct ArqStats {
+  uint32_t submitted;
+  uint32_t transmissions;
+  uint32_t retransmissions;
+  uint32_t acked;
+  uint32_t failed;
+  uint32_t bufferFull;
+  uint32_t received;
+  uint32_t duplicates;
+  uint32_t acksSent;          // Standalone ACK frames
+  uint32_t skipped;           // Acknowledged before being sent
+  uint32_t srttMs;
+  uint32_t rtoMs;
+  uint8_t inFlight;
+};
+
+// jitterSeed: a random draw, so two stations spread their retries apart
+void arqBegin(uint8_t session, uint32_t jitterSeed);
+
+// Lower bound for the RTO: one data frame plus one ACK on air, in ms
+void arqSetAirtime(uint32_t frameMs, uint32_t ackMs);
+
+// Buffers a frame body for reliable delivery. msgFirst..msgLast is the
+// range of phone messages it carries (ARQ_NO_MESSAGE if none);
+// completesMsg marks the frame holding the final piece of msgLast.
+// Returns false if the buffer is full or the range is longer than
+// ARQ_MAX_FRAME_MSGS.
+bool arqSubmit(uint8_t flags, const uint8_t* body, size_t len,
+               uint16_t msgFirst, uint16_t msgLast, bool completesMsg);
+
+// Frames arqSubmit() can still take
+size_t arqFreeSlots();
+
+// Next frame to put on air: an unsent frame inside the window, or one
+// whose RTO expired. A frame that exhausted its retries is dropped and
+// reported in receipts, at most one per call, so maxReceipts of
+// ARQ_MAX_FRAME_MSGS always holds them. Returns false when nothing is
+// due; call again while it reports receipts.
+bool arqNextTransmit(uint32_t nowMs, ArqOutFrame* out,
+                     ArqReceipt* receipts, size_t* receiptCount, size_t maxReceipts);
+
+// Processes an ACK block from the peer; fills receipts for messages
+// whose frames are now all acknowledged. Returns true if it stopped with
+// receipts full: take them and call again with the same block.
+// maxReceipts must be at least ARQ_MAX_FRAME_MSGS.
+bool arqOnAck(const uint8_t* block, uint32_t nowMs,
+              ArqReceipt* receipts, size_t* receiptCount, size_t maxReceipts);
+
+// Processes the ARQ header of a reliable frame received from src
+ArqRxResult arqOnReceive(uint8_t src, const uint8_t* header, uint32_t nowMs);
+
+// Counts seq from src as received without it having arrived, so the
+// next ACK covers it
+void arqMarkReceived(uint8_t src, uint8_t session, uint8_t seq);
+
+// ACK state per sender: pending if something arrived since the last ACK
+// to it; due once ARQ_ACK_DELAY_MS passed without reverse traffic.
+bool arqAckPending(uint8_t peer);
+bool arqAckDue(uint32_t nowMs, uint8_t* peer);
+void arqWriteAck(uint8_t peer, uint8_t* out);
+void arqNoteStandaloneAck();
+
+// Nothing buffered to send and no ACK owed: no timer needs servicing
+bool arqIdle();
+
+const ArqStats& arqGetStats();
+
+#endif // LORA_ARQ_H
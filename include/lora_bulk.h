@@ -0,0 +1,217 @@
+/*
+ * Resumable Bulk Transfers
+ *
+ * Binary objects such as photos or log files are too large for a phone
+ * message and may contain any byte. They are moved as a stream of
+ * fixed-size blocks, one block per FRAME_TYPE_BULK frame, outside ARQ.
+ * The receiver keeps a bitmap of the blocks it has and reports it back.
+ * The sender only repeats blocks the bitmap says are missing:
+ *
+ *   A: OFFER(object, size, block size)          ->  B
+ *   B: STATUS(first missing block, bitmap)      ->  A
+ *   A: DATA(block) ... DATA(block, POLL)        ->  B
+ *   B: STATUS(first missing block, bitmap)      ->  A
+ *   ... until STATUS has nothing missing
+ *
+ * Neither station holds the object:
+ * - The sending station asks its phone for LORA_BULK_WINDOW blocks at a
+ *   time and puts each on air as it arrives.
+ * - The receiving station hands each block to its phone, or to the
+ *   flash log while no phone is connected. When it has nowhere to put a
+ *   block, it drops it and answers the next poll with HOLD. The sender
+ *   then waits LORA_BULK_HOLD_MS before asking again.
+ *
+ * A POLL every LORA_BULK_POLL_EVERY blocks asks for a STATUS. The sender
+ * keeps sending meanwhile and only waits at the end of a pass. The next
+ * pass repeats the missing blocks. The bitmap covers
+ * LORA_BULK_STATUS_BYTES * 8 blocks after the first missing one; blocks
+ * beyond it that were already sent are not repeated until a STATUS
+ * covers them.
+ *
+ * Resuming: the phone names each object with a 32-bit ID.
+ * - An OFFER for an object the receiver already has is answered with its
+ *   bitmap. After a BLE drop or a reboot on either side, the phone offers
+ *   the object again and the transfer continues from the missing blocks.
+ * - The receiver checkpoints its first missing block and the status
+ *   bitmap to NVS every LORA_BULK_CHECKPOINT_BLOCKS blocks. A checkpoint
+ *   is queued behind the blocks it covers, so it is saved only after
+ *   they reached the phone or the log. After a reboot of the receiver,
+ *   the blocks since the last checkpoint come again, and so do blocks
+ *   beyond the bitmap span that the checkpoint could not record. The
+ *   sender trusts the first STATUS after a pass over its own records.
+ * - The phone gets every block with its byte offset, so a repeat is
+ *   harmless.
+ *
+ * On air, after the mesh header (transfer is a number the sender picks
+ * per offer):
+ *
+ *   OFFER    [op][transfer][object ID, 32][size, 32][block size]
+ *   DATA     [op | POLL][transfer][block, 16][data]
+ *   STATUS   [op | HOLD][transfer][poll answered, 16][first missing block, 16][bitmap]
+ *   REFUSE   [op][transfer]          receiver busy with another object
+ *   CANCEL   [op][transfer]
+ *
+ * A STATUS names the DATA block whose POLL it answers, or
+ * BULK_ANSWERS_OFFER. Only the answer to the last block of a pass (or to
+ * an offer) starts the next pass; earlier answers may still be on their
+ * way while the last blocks are, and would repeat those. Bit i of the
+ * bitmap is block (first missing + i). First missing equals the block
+ * count once nothing is missing. Integers are little
+ * endian, on air and over BLE.
+ *
+ * Phone side, over BLE, each starting with BLE_BULK_MARKER (0xF7, never
+ * the first byte of UTF-8 text):
+ *
+ *   phone -> station   OFFER    [F7][01][object ID][size, 32]
+ *                      BLOCK    [F7][02][object ID][block, 16][data]
+ *                      CANCEL   [F7][03][object ID]
+ *   station -> phone   NEED     [F7][11][object ID][block size][first block, 16][count]
+ *                      PROGRESS [F7][12][object ID][blocks delivered, 16][blocks, 16]
+ *                      SENT     [F7][13][object ID]
+ *                      STALLED  [F7][14][object ID][reason]
+ *                      INCOMING [F7][21][object ID][size, 32]
+ *                      DATA     [F7][22][object ID][offset, 32][data]
+ *                      COMPLETE [F7][23][object ID][size, 32]
+ *
+ * The phone answers NEED with BLOCK writes for exactly those blocks, in
+ * order.
+ *
+ * One object is sent and one received at a time, to and from the peer
+ * station. Not thread-safe: the caller serialises access (bulkMutex in
+ * main.cpp).
+ */
+
+#ifndef LORA_BULK_H
+#define LORA_BULK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== BULK CONFIGURATION =====
+#ifndef LORA_BULK_ENABLED
+#define LORA_BULK_ENABLED           1
+#endif
+#define LORA_BULK_MAX_BLOCKS        4096    // Bitmap of 512 bytes per side
+#define LORA_BULK_WINDOW            4       // Blocks asked from the phone at once
+#define LORA_BULK_BACKLOG           2       // Frames left in the TX queue before asking for more
+#define LORA_BULK_POLL_EVERY        16
+#define LORA_BULK_STATUS_BYTES      16      // Bitmap in a STATUS: 128 blocks
+#define LORA_BULK_CHECKPOINT_BLOCKS 32
+#define LORA_BULK_MAX_POLLS         5       // Unanswered in a row before the transfer stalls
+#define LORA_BULK_TURNAROUND_MS     1000    // Added to the airtime of a poll and its answer
+#define LORA_BULK_HOLD_MS           30000
+#define LORA_BULK_PHONE_TIMEOUT_MS  5000    // For blocks asked from the phone
+#define LORA_BULK_RX_IDLE_MS        300000  // Before a stalled incoming object may be replaced
+#define LORA_BULK_STORE_RESERVE     16      // Flash log entries kept for chat messages
+#define LORA_BULK_HEADER_SIZE       4       // DATA header on air
+#define LORA_BULK_STATUS_SIZE       (6 + LORA_BULK_STATUS_BYTES)
+#define LORA_BULK_NOTE_HEADER       10      // Phone DATA note before the block
+#define LORA_BULK_CHECKPOINT_SIZE   (14 + LORA_BULK_STATUS_BYTES)
+
+enum BulkFrameOp : uint8_t {
+  BULK_OP_OFFER = 1,
+  BULK_OP_DATA,
+  BULK_OP_STATUS,
+  BULK_OP_REFUSE,
+  BULK_OP_CANCEL
+};
+#define BULK_OP_MASK      0x0F
+#define BULK_FLAG_POLL    0x80      // DATA: answer with a STATUS
+#define BULK_FLAG_HOLD    0x80      // STATUS: blocks were dropped for lack of room
+#define BULK_ANSWERS_OFFER 0xFFFF   // STATUS: not asked for by a DATA block
+
+enum BulkPhoneOp : uint8_t {
+  BULK_PHONE_OFFER = 0x01,
+  BULK_PHONE_BLOCK = 0x02,
+  BULK_PHONE_CANCEL = 0x03,
+  BULK_PHONE_NEED = 0x11,
+  BULK_PHONE_PROGRESS = 0x12,
+  BULK_PHONE_SENT = 0x13,
+  BULK_PHONE_STALLED = 0x14,
+  BULK_PHONE_INCOMING = 0x21,
+  BULK_PHONE_DATA = 0x22,
+  BULK_PHONE_COMPLETE = 0x23
+};
+
+// Reason byte of STALLED
+enum BulkStallReason : uint8_t {
+  BULK_STALL_NO_ANSWER = 1,   // Peer station silent; offer again to resume
+  BULK_STALL_REFUSED,         // Peer is receiving another object
+  BULK_STALL_PHONE,           // Blocks asked for never came
+  BULK_STALL_BUSY,            // Another object is being sent
+  BULK_STALL_TOO_LARGE        // More than LORA_BULK_MAX_BLOCKS blocks, or empty
+};
+
+// How the phone side should handle what bulkOnFrame()/bulkPoll() hand it
+enum BulkNoteKind : uint8_t {
+  BULK_NOTE_STATUS = 0,       // Notify the phone if connected, else drop
+  BULK_NOTE_KEEP,             // Like a received message: notify, or keep in the log
+  BULK_NOTE_CHECKPOINT        // Receiver state for NVS, once the notes before it are handled
+};
+
+struct BulkStats {
+  uint32_t objectsSent;
+  uint32_t objectsReceived;
+  uint32_t blocksSent;
+  uint32_t blocksResent;
+  uint32_t blocksReceived;
+  uint32_t blocksDuplicate;
+  uint32_t blocksHeld;        // Dropped by the receiver for lack of room
+  uint32_t statusSent;
+  uint32_t statusReceived;
+  uint32_t pollTimeouts;
+  uint32_t stalls;
+  uint32_t resumes;           // Offers the receiver already had blocks for
+  uint32_t resumeSkipped;     // Blocks those resumes did not send again
+  uint32_t checkpoints;
+  uint32_t txBytesPerSec;     // Last object sent, offer to last STATUS
+  uint32_t rxBytesPerSec;     // Last object received, offer (or restore) to last block
+  uint32_t txObject;          // Current transfers; refreshed by bulkGetStats()
+  uint16_t txDelivered;
+  uint16_t txBlocks;
+  uint32_t rxObject;
+  uint16_t rxReceived;
+  uint16_t rxBlocks;
+  uint32_t stateBytes;        // RAM for both sides, bitmaps included
+};
+
+// Puts a bulk frame on air to dst: header, then data
+typedef bool (*BulkSendFn)(uint8_t dst, const uint8_t* hdr, size_t hdrLen, const uint8_t* data, size_t len);
+// Hands a note to the phone side; false if it could not be queued
+typedef bool (*BulkPhoneFn)(const uint8_t* note, size_t len, BulkNoteKind kind);
+// Whether a received block has somewhere to go right now
+typedef bool (*BulkRoomFn)();
+
+void bulkBegin(uint8_t peerId, BulkSendFn send, BulkPhoneFn phone, BulkRoomFn room);
+
+// Receiver state from the last checkpoint saved before a reboot
+void bulkRestore(const uint8_t* checkpoint, size_t len, uint32_t nowMs);
+
+// Poll timeout floor: one data frame and one STATUS on air, in ms
+void bulkSetAirtime(uint32_t dataFrameMs, uint32_t statusFrameMs);
+
+// A command from the phone, after the marker byte. blockSize is the
+// largest block a frame holds on the current profile; a new offer uses it.
+void bulkOnPhone(const uint8_t* msg, size_t len, uint8_t blockSize, uint32_t nowMs);
+
+// A FRAME_TYPE_BULK payload from src, after the mesh header
+void bulkOnFrame(uint8_t src, const uint8_t* payload, size_t len, uint32_t nowMs);
+
+// Asks the phone for blocks while the radio has room, and handles poll
+// and phone timeouts; call periodically. radioBacklog is the TX queue depth.
+void bulkPoll(uint32_t nowMs, size_t radioBacklog);
+
+// A BULK_NOTE_KEEP note could not be delivered or stored. If it held a
+// block, the block counts as missing again.
+void bulkForget(const uint8_t* note, size_t len);
+
+// Takes blocks that bulkForget() gave up since a checkpoint was queued
+// back out of it; call before saving the checkpoint
+void bulkTrimCheckpoint(uint8_t* checkpoint, size_t len);
+
+// Nothing being sent: no timer needs servicing
+bool bulkIdle();
+
+const BulkStats& bulkGetStats();
+
+#endif // LORA_BULK_H
@@ -0,0 +1,49 @@
+/*
+ * Multi-Channel Frequency Plan
+ *
+ * Instead of one shared carrier, every station listens on a home channel
+ * from LORA_CHANNEL_PLAN_MHZ, derived from its station ID by Fibonacci
+ * hashing, which spreads consecutive IDs (and paired odd/even IDs, where
+ * a plain modulo would stack all receivers on one channel):
+ *
+ *   home(id) = ((id * 0x9E3779B1) >> 24) % LORA_CHANNEL_COUNT
+ *
+ * A unicast frame is sent on the home channel of its next hop, so A->B
+ * and C->D run in parallel whenever B and D live on different channels.
+ * The radio hops to the target channel for CAD and transmission and
+ * returns home to receive.
+ *
+ * Rendezvous needs no handshake: a station's channel follows from its
+ * ID. A unicast frame without a known next hop (a mesh flood before a
+ * route is learned, or after one was lost) goes out on the home channel
+ * of its destination, which then answers and teaches routes both ways;
+ * relays sharing that channel carry it further. Only broadcasts are swept
+ * across every channel in the plan, ending on the sender's home channel
+ * so it is listening again when the first replies come. The plan is
+ * spaced for the widest link profile (500 kHz).
+ *
+ * With LORA_CHANNEL_COUNT 1 everything stays on the single frequency.
+ */
+
+#ifndef LORA_CHANNELS_H
+#define LORA_CHANNELS_H
+
+#include <stdint.h>
+
+// ===== CHANNEL PLAN =====
+#ifndef LORA_CHANNEL_COUNT
+#define LORA_CHANNEL_COUNT    4       // Channels used from the plan
+#endif
+#define LORA_CHANNEL_MAX      8       // One bit each in a frame's channel mask
+#define LORA_CHANNEL_ALL      ((uint8_t)((1u << LORA_CHANNEL_COUNT) - 1))
+
+extern const float LORA_CHANNEL_PLAN_MHZ[LORA_CHANNEL_MAX];
+
+uint8_t loraHomeChannel(uint8_t stationId);
+
+// Channels a frame for dst via nextHop goes out on: the home channel of
+// the next hop, of dst when there is none yet (LORA_BROADCAST_ID), or
+// every channel when dst is LORA_BROADCAST_ID too
+uint8_t loraChannelMask(uint8_t nextHop, uint8_t dst);
+
+#endif // LORA_CHANNELS_H
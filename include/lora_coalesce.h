@@ -0,0 +1,56 @@
+/*
+ * Coalescing of Short Messages into One LoRa Frame
+ *
+ * Every LoRa packet pays for its preamble, PHY header, frame header and
+ * CRC, which at SF7 costs more airtime than a typical chat line. Short
+ * messages that arrive within LORA_COALESCE_WINDOW_MS of each other, up
+ * to a byte budget and LORA_COALESCE_MAX_MSGS messages, are packed into a
+ * single frame with FRAME_FLAG_COALESCED set. Its payload is a list of records:
+ *
+ *   [length (1 byte)][message bytes] [length][message bytes] ...
+ *
+ * The receiving station splits the records back into separate BLE
+ * notifications. A batch holding a single message is sent as a plain
+ * frame, so a lone message pays no record overhead.
+ */
+
+#ifndef LORA_COALESCE_H
+#define LORA_COALESCE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "lora_frame.h"
+
+// ===== COALESCING CONFIGURATION =====
+// Window 0 disables coalescing; every message is framed immediately
+#ifndef LORA_COALESCE_WINDOW_MS
+#define LORA_COALESCE_WINDOW_MS   20
+#endif
+#ifndef LORA_COALESCE_BUDGET
+#define LORA_COALESCE_BUDGET      LORA_FRAME_MAX_PAYLOAD
+#endif
+#define LORA_COALESCE_RECORD_HDR  1
+#define LORA_COALESCE_MAX_MSGS    8       // Up to ARQ_MAX_FRAME_MSGS
+
+struct LoRaCoalescer {
+  uint8_t buf[LORA_FRAME_MAX_PAYLOAD];
+  size_t len;
+  uint8_t count;
+
+  void clear() { len = 0; count = 0; }
+  bool empty() const { return count == 0; }
+
+  // True if one more message of msgLen bytes stays within budget and count
+  bool fits(size_t msgLen, size_t budget) const;
+  void add(const uint8_t* msg, size_t msgLen);
+
+  // The only message of a single-entry batch, for sending unwrapped
+  const uint8_t* first(size_t* msgLen) const;
+};
+
+// Walks the records of a coalesced payload. Start with *offset = 0;
+// returns false at the end or on a truncated record.
+bool loraCoalescedNext(const uint8_t* payload, size_t len, size_t* offset,
+                       const uint8_t** msg, size_t* msgLen);
+
+#endif // LORA_COALESCE_H
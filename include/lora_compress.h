@@ -0,0 +1,58 @@
+/*
+ * Short-Message Text Compression
+ *
+ * Chat lines are too short for general-purpose compressors to find any
+ * repetition, so this is a SMAZ-style coder with a static codebook of
+ * fragments common in short chat text (" the", "ing", " you", ...).
+ * Each output byte is one of:
+ *
+ *   0x00-0xFD   codebook entry
+ *   0xFE b      one literal byte
+ *   0xFF n ...  run of n + 1 literal bytes
+ *
+ * Frames whose message(s) went through the coder carry
+ * FRAME_FLAG_COMPRESSED; the receiver inflates each message into a
+ * buffer of at most LORA_COMPRESS_MAX_MESSAGE bytes and rejects anything
+ * that would overrun it. A message is only sent compressed when that
+ * makes it shorter.
+ */
+
+#ifndef LORA_COMPRESS_H
+#define LORA_COMPRESS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== COMPRESSION CONFIGURATION =====
+#ifndef LORA_COMPRESS_ENABLED
+#define LORA_COMPRESS_ENABLED       1
+#endif
+#define LORA_COMPRESS_MAX_MESSAGE   255     // Longer messages are sent as-is
+#define LORA_COMPRESS_LITERAL       0xFE
+#define LORA_COMPRESS_RUN           0xFF
+#define LORA_COMPRESS_MAX_RUN       256
+
+struct LoRaCompressStats {
+  uint32_t messages;          // Offered to the coder
+  uint32_t compressed;        // Sent compressed (output was shorter)
+  uint32_t bytesIn;           // Of compressed messages, before
+  uint32_t bytesOut;          // Of compressed messages, after
+  uint32_t inflated;
+  uint32_t inflateErrors;
+};
+
+// Builds the first-byte index into the codebook; call once at startup
+void loraCompressBegin();
+
+// Compresses into out; returns the compressed length, or 0 if the result
+// would not fit in capacity (pass len - 1 to keep only real savings).
+size_t loraCompress(const uint8_t* in, size_t len, uint8_t* out, size_t capacity);
+
+// Inflates a compressed message; returns false on malformed input or if
+// the result would exceed capacity.
+bool loraDecompress(const uint8_t* in, size_t len, uint8_t* out, size_t capacity,
+                    size_t* outLen);
+
+const LoRaCompressStats& loraCompressGetStats();
+
+#endif // LORA_COMPRESS_H
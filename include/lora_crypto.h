@@ -0,0 +1,85 @@
+/*
+ * Authenticated Encryption of LoRa Frames
+ *
+ * With LORA_CRYPTO_ENABLED every frame is sealed with AES-128-CCM under
+ * a network key shared by all stations. Sealed frames carry frame
+ * version LORA_FRAME_VERSION_SEALED and this payload layout:
+ *
+ *   [mesh header, in clear][epoch, 16 bits LE][ciphertext][tag]
+ *
+ * Relays only need the per-hop mesh header and rewrite it in place, so
+ * it stays in clear and is not authenticated. The frame header is
+ * authenticated as associated data, with FRAME_FLAG_SNIFF masked out
+ * because relays rewrite that bit too. Everything else is encrypted:
+ * ACK block, ARQ and fragment headers, message.
+ *
+ * The 13-byte CCM nonce is [src][epoch][seq] padded with zeros. Only the
+ * epoch is extra on air; src and seq are already in the header. The
+ * sender takes a fresh epoch, reserved in NVS, at every boot and every
+ * time its 16-bit sequence number wraps, so a nonce is never reused
+ * under one key until 65536 epochs have passed. Rotate the key before
+ * that. Without a reserved epoch (NVS failing, or all of them used) the
+ * station stops sending rather than reuse one.
+ *
+ * Receivers, relays included, open a frame before dedup, route learning
+ * or anything else acts on its header. A relay opens a copy and passes
+ * the frame on still sealed.
+ *
+ * The tag is truncated to LORA_CRYPTO_TAG_SIZE bytes (4 by default, like
+ * a LoRaWAN MIC). A forgery then succeeds with probability 2^-32 per
+ * attempt, and at LoRa frame rates there are few attempts.
+ *
+ * Sealing and opening work in place in the frame buffer. On the ESP32,
+ * mbedTLS does the work on the AES accelerator. Host builds use a
+ * portable byte-oriented AES and a CCM implementation per RFC 3610, which
+ * produce the same frames.
+ */
+
+#ifndef LORA_CRYPTO_H
+#define LORA_CRYPTO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== CRYPTO CONFIGURATION =====
+#ifndef LORA_CRYPTO_ENABLED
+#define LORA_CRYPTO_ENABLED     0       // Both stations must agree and share the key
+#endif
+#define LORA_CRYPTO_DEFAULT_KEY "000102030405060708090a0b0c0d0e0f"
+#ifndef LORA_CRYPTO_KEY
+#define LORA_CRYPTO_KEY         LORA_CRYPTO_DEFAULT_KEY   // 128-bit network key in hex; replace it
+#endif
+#ifndef LORA_CRYPTO_TAG_SIZE
+#define LORA_CRYPTO_TAG_SIZE    4       // 4..16, even
+#endif
+#define LORA_CRYPTO_KEY_SIZE    16
+#define LORA_CRYPTO_EPOCH_SIZE  2
+#define LORA_CRYPTO_NONCE_SIZE  13
+#define LORA_CRYPTO_OVERHEAD    (LORA_CRYPTO_ENABLED ? LORA_CRYPTO_EPOCH_SIZE + LORA_CRYPTO_TAG_SIZE : 0)
+
+static_assert(LORA_CRYPTO_TAG_SIZE >= 4 && LORA_CRYPTO_TAG_SIZE <= 16 && LORA_CRYPTO_TAG_SIZE % 2 == 0,
+              "CCM tags are 4 to 16 bytes, even");
+
+struct LoRaCryptoStats {
+  uint32_t sealed;
+  uint32_t opened;
+  uint32_t rejected;          // Bad tag, or too short to hold one
+};
+
+// Sets the network key (32 hex digits); false if it is malformed
+bool loraCryptoBegin(const char* keyHex);
+
+// Seals an encoded frame in place. frame holds headerLen header bytes,
+// clearLen bytes left in clear (the mesh header), LORA_CRYPTO_EPOCH_SIZE
+// bytes for the epoch, bodyLen bytes to encrypt, then room for the tag.
+// The header's length field must already count all of it.
+bool loraCryptoSeal(uint8_t* frame, size_t headerLen, size_t clearLen, size_t bodyLen, uint16_t epoch);
+
+// Authenticates and decrypts a sealed frame in place. sealedLen covers
+// epoch, ciphertext and tag. On success the plaintext body starts
+// LORA_CRYPTO_EPOCH_SIZE bytes after the clear part.
+bool loraCryptoOpen(uint8_t* frame, size_t headerLen, size_t clearLen, size_t sealedLen);
+
+const LoRaCryptoStats& loraCryptoGetStats();
+
+#endif // LORA_CRYPTO_H
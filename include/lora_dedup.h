@@ -0,0 +1,63 @@
+/*
+ * Duplicate Frame Suppression
+ *
+ * Relays, echoes and repeated transmissions can deliver the same frame
+ * more than once. Every received frame is identified by (source station,
+ * frame sequence number) and checked right after its header is parsed,
+ * before any payload handling:
+ *
+ *   - two Bloom filter generations hold every ID seen recently; a miss
+ *     in both means the frame is new (the common case, O(1))
+ *   - on a filter hit, a small exact ring of the latest IDs confirms it
+ *   - a filter hit with no ring entry is a duplicate only if the ID can
+ *     have left the ring: more IDs went in after the generation(s) it
+ *     hit started than the ring holds. Otherwise the ring rules it out
+ *     and the frame is passed as new.
+ *
+ * The current generation is retired after LORA_DEDUP_GENERATION_IDS
+ * insertions or LORA_DEDUP_GENERATION_MS, whichever comes first, so an
+ * ID is remembered for one to two generations. With m filter bits, k
+ * hashes and n IDs per generation a filter hit is false about
+ * 2 * (1 - e^(-k*n/m))^k of the time: roughly 1% for the defaults below.
+ * Only hits past the ring's reach are dropped on the filter's word, so
+ * a new frame is lost less often than that, and never while fewer than
+ * LORA_DEDUP_RING_SIZE IDs arrived in the last two generations.
+ */
+
+#ifndef LORA_DEDUP_H
+#define LORA_DEDUP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== DEDUPLICATION CONFIGURATION =====
+#ifndef LORA_DEDUP_FILTER_BITS
+#define LORA_DEDUP_FILTER_BITS      2048    // Per generation, power of two
+#endif
+#ifndef LORA_DEDUP_HASHES
+#define LORA_DEDUP_HASHES           3       // At most 3 (one 32-bit hash, split)
+#endif
+#ifndef LORA_DEDUP_GENERATION_IDS
+#define LORA_DEDUP_GENERATION_IDS   128
+#endif
+#define LORA_DEDUP_GENERATION_MS    15000
+#define LORA_DEDUP_RING_SIZE        32
+
+struct LoRaDedupStats {
+  uint32_t checked;
+  uint32_t duplicates;
+  uint32_t ringHits;          // Confirmed by the exact ring
+  uint32_t filterOnlyHits;    // Older than the ring, or a false positive
+  uint32_t ringMisses;        // Filter hit the ring rules out: passed as new
+  uint32_t rotations;
+};
+
+void loraDedupBegin(uint32_t nowMs);
+
+// Returns true if (src, seq) was seen recently; otherwise records it
+// and returns false.
+bool loraDedupCheck(uint8_t src, uint16_t seq, uint32_t nowMs);
+
+const LoRaDedupStats& loraDedupGetStats();
+
+#endif // LORA_DEDUP_H
@@ -0,0 +1,59 @@
+/*
+ * Forward Error Correction for Fragment Groups
+ *
+ * A long message is sent as k data fragments (shards) followed by r
+ * repair shards. The code is a systematic Reed-Solomon erasure code over
+ * GF(256) with a Cauchy generator matrix:
+ *
+ *   repair[j] = sum over i of C[j][i] * data[i],   C[j][i] = 1 / (x_j + y_i)
+ *
+ * with x_j = LORA_FRAG_MAX_FRAGMENTS + j and y_i = i. Every square
+ * submatrix of a Cauchy matrix is invertible. So any k of the k + r shards
+ * rebuild the message, and decoding needs no pivot search.
+ *
+ * Data shards are all chunk bytes except the last. The repair shards are
+ * computed as if the last data shard were zero-padded to chunk bytes.
+ *
+ * Arithmetic uses log/exp tables (768 bytes, built by loraFecBegin()).
+ * Each shard term costs one table lookup per byte. Rebuilding e lost
+ * shards costs about (k + e) * e of them.
+ */
+
+#ifndef LORA_FEC_H
+#define LORA_FEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== FEC CONFIGURATION =====
+#ifndef LORA_FEC_ENABLED
+#define LORA_FEC_ENABLED        0       // Both stations must agree
+#endif
+#ifndef LORA_FEC_REPAIR_PCT
+#define LORA_FEC_REPAIR_PCT     25      // Repair shards per 100 data shards, rounded up
+#endif
+#define LORA_FEC_MIN_REPAIR     1
+#define LORA_FEC_MAX_REPAIR     8
+#define LORA_FEC_HEADER_SIZE    2       // After the fragment header: [data shards - 1][last data shard length]
+#define LORA_FEC_ROW_EMPTY      0xFF
+
+// Builds the GF(256) tables; call once at startup
+void loraFecBegin();
+
+// Repair shards to add to a group of dataCount data shards; 0 when FEC
+// is off. The group never exceeds LORA_FRAG_MAX_FRAGMENTS shards.
+uint8_t loraFecRepairCount(size_t dataCount);
+
+// Repair shard number repair (0-based) of msg split into dataCount shards
+// of chunk bytes. Writes chunk bytes to out.
+void loraFecEncode(const uint8_t* msg, size_t len, uint8_t dataCount, size_t chunk,
+                   uint8_t repair, uint8_t* out);
+
+// Rebuilds the data shards in place. rows holds dataCount rows of chunk
+// bytes, and rowShard[i] says which shard row i holds: either data shard
+// i itself, or a repair shard (dataCount + j) standing in for missing
+// data shard i. Afterwards row i holds data shard i. Returns false if
+// rowShard is inconsistent.
+bool loraFecDecode(uint8_t* rows, uint8_t dataCount, size_t chunk, const uint8_t* rowShard);
+
+#endif // LORA_FEC_H
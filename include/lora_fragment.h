@@ -0,0 +1,106 @@
+/*
+ * LoRa Fragmentation and Reassembly
+ *
+ * Messages longer than one SX1262 packet are split into numbered
+ * fragments. Each fragment is an ordinary frame with FRAME_FLAG_FRAGMENT
+ * set and a 3-byte fragment header at the start of its payload:
+ *
+ *   byte 0   message ID (per sender, wraps)
+ *   byte 1   fragment index (high nibble) | fragment count - 1 (low nibble)
+ *   byte 2   fragment chunk size (all fragments except the last)
+ *
+ * With FRAME_FLAG_FEC the fragment header is followed by two more bytes,
+ * and the group carries repair fragments after the data (lora_fec.h):
+ *
+ *   byte 3   data fragment count - 1 (low nibble)
+ *   byte 4   length of the last data fragment
+ *
+ * Here the count in byte 1 covers data and repair fragments. Any data
+ * fragment count of them rebuild the message.
+ *
+ * The receiver reassembles into a small number of fixed slots. Each slot
+ * holds at most LORA_FRAG_MAX_MESSAGE bytes. A slot is dropped if it
+ * stays incomplete past LORA_REASM_TIMEOUT_MS. When all slots are busy,
+ * the oldest one is evicted. ARQ acknowledges each fragment as it
+ * arrives, so a group dropped while its sender still retries the rest
+ * loses a message the sender will report delivered: there is a slot for
+ * every group one ARQ window can leave half received, and the timeout
+ * outlasts the sender's retries. A decoded FEC group keeps its slot until
+ * its remaining fragments arrive or the timeout expires, so late repair
+ * fragments are dropped instead of starting a new message.
+ *
+ * Message IDs wrap, and a sender starts them at random after a reboot,
+ * so a slot is keyed on the sender's ARQ session as well as its ID. ARQ
+ * has already dropped repeated frames, so a reliable fragment that finds
+ * its index taken, or its group decoded, belongs to a new message that
+ * reused the ID: the slot starts over instead of mixing the two.
+ */
+
+#ifndef LORA_FRAGMENT_H
+#define LORA_FRAGMENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "lora_frame.h"
+#include "lora_fec.h"
+
+// ===== FRAGMENT CONFIGURATION =====
+#define LORA_FRAG_HEADER_SIZE     3
+#define LORA_FRAG_FEC_HEADER_SIZE (LORA_FRAG_HEADER_SIZE + LORA_FEC_HEADER_SIZE)
+#define LORA_FRAG_MAX_FRAGMENTS   16
+#define LORA_FRAG_MAX_MESSAGE     1024    // Per-message memory cap
+#define LORA_REASM_SLOTS          8       // ARQ_WINDOW: one per frame a sender has in flight
+#define LORA_REASM_TIMEOUT_MS     180000  // Past ARQ giving up on a fragment
+#define LORA_FRAG_NO_SESSION      0       // Fragment sent without ARQ
+
+struct LoRaFragmentHeader {
+  uint8_t msgId;
+  uint8_t index;
+  uint8_t count;
+  uint8_t chunk;
+  uint8_t dataCount;    // count without FEC; the rest are repair fragments
+  uint8_t lastLen;      // FEC only: length of the last data fragment
+};
+
+struct LoRaFragmentStats {
+  uint32_t fragmentsSent;
+  uint32_t fragmentsReceived;
+  uint32_t messagesFragmented;
+  uint32_t messagesReassembled;
+  uint32_t messagesTimedOut;
+  uint32_t messagesEvicted;
+  uint32_t fragmentsDropped;    // Malformed, duplicate, late or oversized
+  uint32_t repairsSent;
+  uint32_t messagesRecovered;   // Reassembled with the help of repair fragments
+  uint32_t fragmentsRecovered;  // Data fragments rebuilt from repairs
+};
+
+// Largest payload worth putting in one frame for a spreading factor,
+// so slow profiles are not stuck with multi-second packets
+uint8_t loraFragmentChunkForSF(uint8_t sf);
+
+size_t loraFragmentCount(size_t len, size_t chunk);
+
+void loraFragmentWriteHeader(uint8_t* out, const LoRaFragmentHeader& hdr);
+bool loraFragmentReadHeader(const uint8_t* in, size_t len, LoRaFragmentHeader& hdr);
+
+// Header with the FEC extension, LORA_FRAG_FEC_HEADER_SIZE bytes
+void loraFragmentWriteFecHeader(uint8_t* out, const LoRaFragmentHeader& hdr);
+bool loraFragmentReadFecHeader(const uint8_t* in, size_t len, LoRaFragmentHeader& hdr);
+
+// Counts a fragment handed to the radio (sender-side statistics)
+void loraFragmentNoteSent(bool firstOfMessage, bool repair = false);
+
+// Adds one fragment's data. session is the ARQ session of a reliable
+// fragment, which ARQ has checked is no repeat, or LORA_FRAG_NO_SESSION.
+// When this completes a message, returns a pointer to it and sets
+// *outLen; the pointer stays valid until the next call. Returns NULL
+// while the message is still incomplete. An FEC group completes with any
+// hdr.dataCount of its fragments.
+const uint8_t* loraReassemblyPush(uint8_t src, uint8_t session, const LoRaFragmentHeader& hdr,
+                                  const uint8_t* data, size_t len,
+                                  uint32_t nowMs, size_t* outLen);
+
+const LoRaFragmentStats& loraFragmentGetStats();
+
+#endif // LORA_FRAGMENT_H
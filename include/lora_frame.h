@@ -0,0 +1,85 @@
+/*
+ * Binary LoRa Frame Format
+ *
+ * Replaces the JSON envelope ({"from":1,"to":2,"msg":"...","timestamp":...})
+ * that used to be sent over the air. Every frame is a small fixed header
+ * followed by the raw payload bytes:
+ *
+ *   offset  size  field
+ *   0       1     version (high nibble) | frame type (low nibble)
+ *   1       1     source (originating) station ID
+ *   2       1     destination (final) station ID (0xFF = broadcast)
+ *   3       2     sequence number (little endian)
+ *   5       1     flags
+ *   6       1     payload length
+ *   7       1-5   timestamp delta in ms (unsigned LEB128 varint)
+ *   ...     n     payload
+ *
+ * Version LORA_FRAME_VERSION_SEALED marks a frame whose payload is
+ * encrypted and authenticated (lora_crypto.h); the header is the same.
+ *
+ * Encoding and decoding work directly on the caller's buffer, no heap.
+ */
+
+#ifndef LORA_FRAME_H
+#define LORA_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== FRAME LIMITS =====
+#define LORA_FRAME_VERSION        1
+#define LORA_FRAME_VERSION_SEALED 2
+#define LORA_FRAME_MAX_SIZE       255   // SX1262 maximum packet length
+#define LORA_FRAME_FIXED_SIZE     7     // Header bytes before the varint
+#define LORA_FRAME_MAX_VARINT     5     // uint32_t needs at most 5 bytes
+#define LORA_FRAME_MAX_HEADER     (LORA_FRAME_FIXED_SIZE + LORA_FRAME_MAX_VARINT)
+#define LORA_FRAME_MAX_PAYLOAD    (LORA_FRAME_MAX_SIZE - LORA_FRAME_MAX_HEADER)
+#define LORA_FRAME_FLAGS_OFFSET   5     // Rewritten in place by relays
+
+#define LORA_BROADCAST_ID         0xFF
+
+// ===== FRAME FLAGS =====
+#define FRAME_FLAG_FRAGMENT       0x01  // Payload starts with a fragment header
+#define FRAME_FLAG_COALESCED      0x02  // Payload is a list of length-prefixed messages
+#define FRAME_FLAG_RELIABLE       0x04  // Payload starts with an ARQ header (lora_arq.h)
+#define FRAME_FLAG_ACK            0x08  // ARQ ACK block, first after the mesh header
+#define FRAME_FLAG_COMPRESSED     0x10  // Message text is compressed (lora_compress.h)
+#define FRAME_FLAG_MESH           0x20  // Payload starts with a per-hop routing header (lora_mesh.h)
+#define FRAME_FLAG_SNIFF          0x40  // Station that put this copy on air sniffs (low_power.h)
+#define FRAME_FLAG_FEC            0x80  // Fragment group with repair fragments (lora_fec.h)
+
+// ===== FRAME TYPES =====
+enum LoRaFrameType : uint8_t {
+  FRAME_TYPE_DATA = 0x0,  // Chat payload for the remote phone
+  FRAME_TYPE_CTRL = 0x1,  // Station-to-station control (link adaptation)
+  FRAME_TYPE_ACK  = 0x2,  // Standalone ARQ acknowledgement, no other payload
+  FRAME_TYPE_BULK = 0x3   // Bulk transfer block or status (lora_bulk.h)
+};
+
+struct LoRaFrameHeader {
+  uint8_t  version;     // 0 encodes as LORA_FRAME_VERSION
+  uint8_t  type;
+  uint8_t  src;
+  uint8_t  dst;
+  uint16_t seq;
+  uint8_t  flags;
+  uint8_t  length;      // Payload length in bytes
+  uint32_t tsDelta;     // Milliseconds since the sender's previous frame
+};
+
+// Number of bytes the header will occupy once encoded.
+size_t loraFrameHeaderSize(const LoRaFrameHeader& hdr);
+
+// Writes header + payload into buf. The payload may already sit at
+// buf + loraFrameHeaderSize(hdr) (in-place build), in which case it is
+// not copied. Returns the total frame length, or 0 if it does not fit.
+size_t loraFrameEncode(uint8_t* buf, size_t capacity,
+                       const LoRaFrameHeader& hdr, const uint8_t* payload);
+
+// Parses a received frame in place. On success fills hdr and points
+// payload into buf; returns false on a truncated or unknown-version frame.
+bool loraFrameDecode(const uint8_t* buf, size_t len,
+                     LoRaFrameHeader& hdr, const uint8_t** payload);
+
+#endif // LORA_FRAME_H
@@ -0,0 +1,95 @@
+/*
+ * Multi-Hop Mesh Routing
+ *
+ * The frame header is end to end: src is the originating station, dst
+ * the final destination (or LORA_BROADCAST_ID) and seq the originator's
+ * sequence number, so every copy of a relayed frame keeps the same
+ * (src, seq) and duplicate suppression stops floods. Routed frames set
+ * FRAME_FLAG_MESH and start their payload with a per-hop header:
+ *
+ *   byte 0   previous hop (station that put this copy on air)
+ *   byte 1   next hop (LORA_BROADCAST_ID = any station may relay)
+ *   byte 2   TTL (high nibble) | hops travelled (low nibble)
+ *
+ * Routes are learned from traffic: a frame from origin O heard via
+ * previous hop P after h hops is a route to O through P at cost h + 1.
+ * Unicast frames go to the learned next hop, or are flooded when there
+ * is no route. Each relay decrements the TTL and forwards in the radio
+ * context, without touching BLE. Frames without FRAME_FLAG_MESH
+ * (link adaptation control) are strictly neighbour to neighbour.
+ *
+ * Neighbours that receive in preamble-sniffing mode mark every copy they
+ * transmit with FRAME_FLAG_SNIFF. The flag is remembered per neighbour
+ * so frames to them (or broadcasts, if any neighbour sniffs) go out with
+ * a preamble long enough to span their sleep period.
+ */
+
+#ifndef LORA_MESH_H
+#define LORA_MESH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== MESH CONFIGURATION =====
+#define MESH_HEADER_SIZE          3
+#ifndef MESH_DEFAULT_TTL
+#define MESH_DEFAULT_TTL          3       // Relays allowed after the first hop
+#endif
+#define MESH_MAX_TTL              15
+#define MESH_ROUTE_SLOTS          16
+#define MESH_ROUTE_TIMEOUT_MS     120000
+#define MESH_FLOOD_AFTER_TRIES    3       // ARQ attempt that drops the route and floods
+
+struct LoRaMeshHeader {
+  uint8_t prevHop;
+  uint8_t nextHop;
+  uint8_t ttl;
+  uint8_t hops;
+};
+
+enum MeshDisposition : uint8_t {
+  MESH_IGNORE = 0,          // Addressed to another relay, or TTL spent
+  MESH_DELIVER,             // For this station only
+  MESH_RELAY,               // For someone else, forward it
+  MESH_DELIVER_AND_RELAY    // Broadcast with TTL left
+};
+
+struct LoRaMeshStats {
+  uint32_t relayed;
+  uint32_t flooded;           // Relayed with no known route
+  uint32_t ttlExpired;
+  uint32_t ignored;
+  uint32_t routeChanges;
+  uint32_t routesEvicted;
+};
+
+void meshBegin(uint8_t stationId);
+
+void meshWriteHeader(uint8_t* out, const LoRaMeshHeader& hdr);
+bool meshReadHeader(const uint8_t* in, size_t len, LoRaMeshHeader& hdr);
+
+// Header for a frame this station originates
+LoRaMeshHeader meshOriginate(uint8_t dst, uint32_t nowMs);
+
+// Learns the route back to origin from a received frame
+void meshLearn(uint8_t origin, const LoRaMeshHeader& hdr, uint32_t nowMs);
+
+MeshDisposition meshClassify(uint8_t dst, const LoRaMeshHeader& hdr);
+
+// Rewrites hdr for the next hop of a relayed copy
+void meshPrepareRelay(uint8_t dst, LoRaMeshHeader& hdr, uint32_t nowMs);
+
+// Next hop toward dst, or LORA_BROADCAST_ID to flood
+uint8_t meshNextHop(uint8_t dst, uint32_t nowMs);
+void meshForgetRoute(uint8_t dst);
+
+// Neighbour state from the station that put a frame on air
+void meshNoteNeighbour(uint8_t hop, bool sniffing);
+// True if nextHop (or, for LORA_BROADCAST_ID, any neighbour) sniffs
+bool meshNeighbourSniffs(uint8_t nextHop);
+uint8_t meshSniffingNeighbours();
+
+uint8_t meshRouteCount(uint32_t nowMs);
+const LoRaMeshStats& meshGetStats();
+
+#endif // LORA_MESH_H
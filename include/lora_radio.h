@@ -0,0 +1,170 @@
+/*
+ * Queued LoRa Radio Driver
+ *
+ * Owns the SX1262 receive/transmit state machine. Callers hand over
+ * fully encoded frames with loraRadioQueueFrame(), which only passes the
+ * frame's pool index through a FreeRTOS queue and returns immediately,
+ * so the BLE write callback is never stalled for the time-on-air.
+ *
+ * loraRadioService() drains the queue with startTransmit(), waits for the
+ * DIO1 TX-done interrupt, and drops straight back into receive mode after
+ * every frame. Received frames are passed to the registered RX handler.
+ *
+ * Modem reconfiguration (loraRadioQueueConfig) travels through the same
+ * queue as a barrier, so frames queued before it still go out with the
+ * old settings and frames queued after it with the new ones. Each
+ * reconfiguration is numbered, and a received frame carries the number
+ * of the settings it arrived with.
+ *
+ * With LORA_RADIO_TASK enabled the service routine runs in a dedicated
+ * FreeRTOS task that sleeps on a task notification given directly from
+ * the DIO1 ISR, so RX handling is no longer tied to the loop() period.
+ * The task is pinned to LORA_RADIO_CORE, the core loop() runs on, so the
+ * BLE stack on the other core never preempts it.
+ *
+ * For battery stations the receiver can sniff instead of listening
+ * continuously: the SX1262 sleeps and wakes on its own to look for a
+ * preamble (startReceiveDutyCycleAuto), so a sender has to use a
+ * preamble at least as long as the sniff period. Each frame carries its
+ * own preamble length; the driver reprograms it only when it changes.
+ *
+ * With LORA_LBT_ENABLED the driver listens before talking: each frame
+ * waits for a channel activity detection (CAD) scan to find the channel
+ * free. A busy channel means a random backoff over a window that doubles
+ * with every busy scan (LORA_LBT_CW_MIN..LORA_LBT_CW_MAX slots). A frame
+ * queued just after a reception starts with a random backoff as well,
+ * since every station that heard it may be answering. A frame queued
+ * just after our own transmission waits out that whole window, so the
+ * station we sent to gets the first turn and we hear it answer. The
+ * radio keeps receiving while a frame backs off.
+ *
+ * Frames name the channels of the plan (lora_channels.h) they go out on.
+ * The driver tunes to each in turn for CAD and transmission, sending the
+ * same buffer once per channel and finishing on the home channel, where
+ * it always receives.
+ *
+ * Every transmission is checked against the duty-cycle budget
+ * (lora_airtime.h) first, using the frame's calculated time on air and
+ * its priority. A frame that does not fit yet is held, and the queue
+ * behind it waits, except that the next frame may go first if its
+ * priority has a larger share of the budget. A frame that is shed is
+ * dropped.
+ *
+ * Queue wait, airtime and RX handling time are recorded per frame in the
+ * station_status histograms.
+ */
+
+#ifndef LORA_RADIO_H
+#define LORA_RADIO_H
+
+#include <Arduino.h>
+#include <RadioLib.h>
+#include "lora_frame.h"
+#include "frame_pool.h"
+#include "station_status.h"
+#include "lora_channels.h"
+#include "lora_airtime.h"
+
+// ===== QUEUE CONFIGURATION =====
+#define LORA_TX_QUEUE_DEPTH   16    // Frames waiting for airtime (one fragmented message)
+#define LORA_CONFIG_SLOTS     4     // Reconfigurations queued at once
+#define LORA_CONFIG_MARKER    0xF0  // Queue entries 0xF0 + n mean "apply config slot n"
+
+// ===== PREAMBLE CONFIGURATION =====
+#define LORA_PREAMBLE_SYMBOLS 8     // Normal preamble, enough for a continuous receiver
+#define LORA_SNIFF_MIN_SYMBOLS 8    // Symbols a sniffing receiver listens for each wake
+
+// ===== TASK CONFIGURATION =====
+// Set to 0 to fall back to polling loraRadioService() from loop()
+#ifndef LORA_RADIO_TASK
+#define LORA_RADIO_TASK       1
+#endif
+#define LORA_RADIO_TASK_STACK 6144
+#define LORA_RADIO_TASK_PRIO  (configMAX_PRIORITIES - 2)
+#ifndef LORA_RADIO_CORE
+#define LORA_RADIO_CORE       1       // With loop(); BLE runs on core 0
+#endif
+
+enum LoRaRadioState : uint8_t {
+  RADIO_STATE_IDLE = 0,
+  RADIO_STATE_RX,
+  RADIO_STATE_TX,
+  RADIO_STATE_CAD
+};
+
+struct LoRaRadioConfig {
+  uint8_t sf;
+  float bwKHz;
+  int8_t powerDbm;
+  uint16_t rxSniffSymbols;     // Sender preamble to sniff for, 0 = continuous RX
+  uint8_t rxChannel;           // Home channel in the plan
+};
+
+struct LoRaRadioStats {
+  uint32_t framesQueued;
+  uint32_t framesSent;
+  uint32_t framesReceived;
+  uint32_t txFailures;
+  uint32_t rxFailures;
+  uint32_t crcErrors;          // Part of rxFailures; mostly collisions
+  uint32_t queueFull;          // Frames rejected because the queue was full
+  uint32_t queueHighWater;     // Deepest the queue has been
+  uint32_t lastWaitUs;         // Queue wait of the last transmitted frame
+  uint32_t maxWaitUs;
+  uint64_t totalWaitUs;        // Sum over framesSent, for the average
+  uint32_t reconfigurations;
+  uint32_t preambleChanges;
+  uint64_t txAirUs;            // Time spent transmitting, startTransmit to TX done
+  uint32_t cadScans;
+  uint32_t cadBusy;            // Scans that found LoRa activity
+  uint32_t lbtDeferred;        // Free channel, deferred by persistence
+  uint32_t lbtForced;          // Sent after LORA_LBT_MAX_BUSY busy scans
+  uint32_t backoffs;
+  uint32_t maxBackoffUs;
+  uint64_t totalBackoffUs;
+  uint32_t dutyShed;           // Dropped by the duty-cycle scheduler
+  uint32_t dutyBypassed;       // Sent past a frame the budget held
+  uint32_t channelHops;        // Retunes away from or back to the home channel
+  uint32_t txPerChannel[LORA_CHANNEL_MAX];
+};
+
+// Receives ownership of each frame read from the radio
+typedef void (*LoRaRxHandler)(FrameHandle frame);
+
+// Attaches the DIO1 interrupt and enters receive mode. With
+// LORA_RADIO_TASK enabled this also starts the radio task.
+bool loraRadioBegin(SX1262* radio, LoRaRxHandler rxHandler);
+
+// The settings the radio was started with (radio.begin()), including
+// RX sniffing; call before loraRadioBegin(). Later changes travel with
+// loraRadioQueueConfig().
+void loraRadioSetInitialConfig(const LoRaRadioConfig& config);
+
+// Holds the radio task off so the CPU can light-sleep. Returns true,
+// with the hold taken, only if the radio is listening with nothing
+// queued or pending; release it with loraRadioResume() after waking,
+// passing the DIO1 level since the edge may have come during sleep.
+bool loraRadioHoldIdle();
+void loraRadioResume(bool dio1High);
+
+// Moves an encoded frame into the TX queue. Safe to call from the BLE
+// callback task; never blocks. Returns false (and frees the buffer) if
+// the queue is full.
+bool loraRadioQueueFrame(FrameHandle&& frame);
+
+// Queues a modem reconfiguration behind the frames already queued. Each
+// one is a barrier of its own: frames between two reconfigurations go out
+// with the first one's settings. Returns the generation the settings
+// will have (never 0), or 0 if the queue or all LORA_CONFIG_SLOTS are
+// taken. Frames received once they apply carry it in FrameBuffer::config.
+uint16_t loraRadioQueueConfig(const LoRaRadioConfig& config);
+
+// Advances the state machine: completes TX, reads RX, starts the next
+// queued frame. Runs in the radio task, or from loop() when polling.
+void loraRadioService();
+
+uint32_t loraRadioQueueDepth();
+LoRaRadioState loraRadioGetState();
+const LoRaRadioStats& loraRadioGetStats();
+
+#endif // LORA_RADIO_H
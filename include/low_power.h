@@ -0,0 +1,94 @@
+/*
+ * Low-Power Duty-Cycled Receive
+ *
+ * For battery relay stations. The SX1262 sniffs for a preamble instead
+ * of listening continuously (see loraRadioSetRxSniff): it sleeps for
+ * about LOW_POWER_SNIFF_MS, wakes for LORA_SNIFF_MIN_SYMBOLS symbols and
+ * goes back to sleep unless it hears a preamble. Senders learn that a
+ * neighbour sniffs from FRAME_FLAG_SNIFF on its frames and stretch the
+ * preamble of frames to it to lowPowerPreambleSymbols(), so one always
+ * overlaps a listen window.
+ *
+ * Between DIO1 interrupts the ESP32-S3 light-sleeps. lowPowerSleep()
+ * arms a level wakeup on DIO1 plus a timer for housekeeping (ARQ, link
+ * keepalives) and accounts the time asleep.
+ *
+ * BLE (LOW_POWER_BLE):
+ *   0  not started; the station is a relay only
+ *   1  advertises every LOW_POWER_ADV_INTERVAL_MS and stays connectable;
+ *      the CPU only sleeps while no phone is connected. Whether the
+ *      controller accepts light sleep depends on the SDK's BT modem-sleep
+ *      settings; refused sleeps are counted and the loop falls back to
+ *      its normal delay.
+ *
+ * Energy is estimated from time in each state and datasheet currents
+ * (LOW_POWER_*_MA), not measured.
+ */
+
+#ifndef LOW_POWER_H
+#define LOW_POWER_H
+
+#include <stdint.h>
+#include "latency_histogram.h"
+
+// ===== LOW POWER CONFIGURATION =====
+#ifndef LOW_POWER_MODE
+#define LOW_POWER_MODE            0
+#endif
+#ifndef LOW_POWER_BLE
+#define LOW_POWER_BLE             1
+#endif
+#define LOW_POWER_SNIFF_MS        100     // Radio sleep between preamble checks
+#define LOW_POWER_MAX_SLEEP_MS    1000    // CPU wakes at least this often
+#define LOW_POWER_ADV_INTERVAL_MS 1000
+
+// Supply and datasheet currents for the estimate
+#define LOW_POWER_SUPPLY_V        3.3f
+#define LOW_POWER_MCU_ACTIVE_MA   40.0f   // ESP32-S3, 240 MHz, mostly idle
+#define LOW_POWER_MCU_SLEEP_MA    0.24f   // ESP32-S3 light sleep
+#define LOW_POWER_RADIO_RX_MA     4.6f    // SX1262 RX, DC-DC
+#define LOW_POWER_RADIO_SLEEP_MA  0.0012f // SX1262 warm-start sleep
+#define LOW_POWER_RADIO_TX_MA     90.0f   // SX1262 at +14..+20 dBm
+
+enum LowPowerWake : uint8_t {
+  LOW_POWER_WAKE_RADIO = 0,   // DIO1
+  LOW_POWER_WAKE_TIMER,
+  LOW_POWER_WAKE_REJECTED     // Sleep refused, nothing slept
+};
+
+struct LowPowerStats {
+  uint32_t sleeps;
+  uint32_t radioWakes;
+  uint32_t timerWakes;
+  uint32_t rejected;
+  uint64_t sleepUs;
+  uint32_t delivered;           // Messages handed to the phone or relayed
+  LatencyHistogram wakeLatency; // Light-sleep exit: timer wake overshoot
+};
+
+struct LowPowerEnergy {
+  float averageMa;
+  float totalMj;
+  float perMessageMj;           // 0 until something was delivered
+  uint8_t sleepPct;             // CPU time in light sleep
+};
+
+void lowPowerBegin();
+
+float lowPowerSymbolMs(uint8_t sf, float bwKHz);
+
+// Preamble a sender needs so a sniffing receiver on sf/bw catches it
+uint16_t lowPowerPreambleSymbols(uint8_t sf, float bwKHz);
+
+// Light-sleeps until DIO1 goes high or maxMs pass
+LowPowerWake lowPowerSleep(uint8_t dio1Pin, uint32_t maxMs);
+
+void lowPowerNoteDelivered();
+
+// Energy since lowPowerBegin(); rxSniffSymbols is the sender preamble the
+// radio sniffs for (0: continuous RX)
+LowPowerEnergy lowPowerEstimate(uint64_t txAirUs, uint16_t rxSniffSymbols);
+
+const LowPowerStats& lowPowerGetStats();
+
+#endif // LOW_POWER_H
@@ -0,0 +1,115 @@
+/*
+ * Store-and-Forward Message Log in Flash
+ *
+ * Messages that cannot be delivered right away are kept in the "msglog"
+ * data partition (partitions.csv) and survive a reboot:
+ *
+ *   INBOUND   LoRa messages that arrived while no phone was connected,
+ *             replayed when one connects
+ *   OUTBOUND  phone messages until the peer acknowledged them (or ARQ
+ *             gave up), sent again after a reboot
+ *
+ * The partition is used as a circular log of MSG_STORE_SECTOR_SIZE
+ * sectors, so erases are spread evenly over all of it. Each sector
+ * starts with [magic][sequence number, 32 bits]. Records follow it,
+ * 4-byte aligned:
+ *
+ *   [state][kind][length, 16 bits LE][CRC-16, 16 bits LE][tag, 16 bits LE][message]
+ *
+ * A record is written with a single flash write. Retiring it clears bits
+ * in its state byte, which NOR flash allows without an erase. A record
+ * torn by a reset fails its CRC, and appending then continues in a fresh
+ * sector. When the log wraps into a sector that still holds pending
+ * records, those records are dropped and counted as lost.
+ *
+ * Pending records are listed in a RAM index (offset and tag, per kind)
+ * that msgStoreBegin() rebuilds by scanning the used sectors. Appending
+ * needs no lookup and no file-system metadata, so throughput is bounded
+ * by flash programming. msgStoreMaintain() erases the next sector ahead
+ * of time, so appends rarely wait for an erase.
+ *
+ * Flash goes through a MsgStoreBackend: the partition on the ESP32, or
+ * msgStoreRamBackend(), which emulates NOR semantics in RAM for host runs.
+ *
+ * Not thread-safe: the caller serialises access (storeMutex in main.cpp).
+ */
+
+#ifndef MSG_STORE_H
+#define MSG_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== STORE CONFIGURATION =====
+#ifndef MSG_STORE_ENABLED
+#define MSG_STORE_ENABLED         1
+#endif
+#define MSG_STORE_PARTITION       "msglog"
+#define MSG_STORE_SUBTYPE         0x40    // Custom data subtype in partitions.csv
+#define MSG_STORE_SECTOR_SIZE     4096
+#define MSG_STORE_INDEX_SIZE      128     // Pending records tracked per kind
+#define MSG_STORE_HEADER_SIZE     8
+#define MSG_STORE_MAX_MESSAGE     1024    // BLE_MESSAGE_MAX; one record is one flash write
+#define MSG_STORE_NONE            0xFFFFFFFF
+#define MSG_STORE_REPLAY_DELAY_MS 1500    // After a connect, for the phone to subscribe
+#define MSG_STORE_REPLAY_BATCHES  4       // Notifications per replay pass
+
+enum MsgStoreKind : uint8_t {
+  MSG_STORE_INBOUND = 0,
+  MSG_STORE_OUTBOUND,
+  MSG_STORE_KINDS
+};
+
+struct MsgStoreBackend {
+  bool (*read)(void* ctx, uint32_t offset, void* buf, size_t len);
+  bool (*write)(void* ctx, uint32_t offset, const void* buf, size_t len);
+  bool (*erase)(void* ctx, uint32_t offset);    // One sector
+  void* ctx;
+  uint32_t size;                                // Multiple of MSG_STORE_SECTOR_SIZE
+};
+
+struct MsgStoreStats {
+  uint32_t appended;
+  uint32_t retired;
+  uint32_t lost;                  // Dropped by wraparound or a full index
+  uint32_t corrupt;               // Torn or bad records skipped by the boot scan
+  uint32_t erases;
+  uint32_t sectors;
+  uint32_t recovered;             // Pending records found by the boot scan
+  uint64_t bytesWritten;
+};
+
+// Scans the log and rebuilds the index; false if the backend is unusable
+bool msgStoreBegin(const MsgStoreBackend& backend);
+
+#ifdef ARDUINO
+// msgStoreBegin() on the MSG_STORE_PARTITION data partition
+bool msgStoreBeginPartition();
+#endif
+
+// NOR-flash emulation over mem (size bytes). Fill it with 0xFF for a
+// blank log; keep it across msgStoreBegin() calls to emulate a reboot.
+MsgStoreBackend msgStoreRamBackend(uint8_t* mem, uint32_t size);
+
+// Appends a message. The tag is kept with it (the station's message tag
+// for outbound messages, which ARQ receipts name). Returns the record id, or MSG_STORE_NONE.
+uint32_t msgStoreAppend(uint8_t kind, const uint8_t* msg, size_t len, uint16_t tag);
+
+size_t msgStorePending(uint8_t kind);
+
+// The i-th pending message of a kind, oldest first. Copies up to cap
+// bytes into buf. Returns its record id, or MSG_STORE_NONE.
+uint32_t msgStoreGet(uint8_t kind, size_t i, uint8_t* buf, size_t cap, size_t* len, uint16_t* tag);
+
+// Marks a record delivered; it is no longer pending
+void msgStoreRetire(uint32_t id);
+
+// Retires the oldest pending record of a kind with this tag, if any
+bool msgStoreRetireTag(uint8_t kind, uint16_t tag);
+
+// Erases the next sector ahead of time; call when idle
+void msgStoreMaintain();
+
+const MsgStoreStats& msgStoreGetStats();
+
+#endif // MSG_STORE_H
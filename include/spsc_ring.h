@@ -0,0 +1,138 @@
+/*
+ * Single-Producer Single-Consumer Record Ring
+ *
+ * Hands variable-length records from one task to another without locks.
+ * Each side owns one index, and publishes it with a release store only
+ * after its slot is written or read. Neither side ever waits: a
+ * producer that finds no room gets NULL and counts a drop.
+ *
+ * Records are stored contiguously, 4-byte aligned:
+ *
+ *   [length, 16 bits][type][flags][payload]
+ *
+ * A record that would run past the end of the buffer is placed at the
+ * start instead. The skipped tail is marked with length 0xFFFF.
+ *
+ * Producer: p = claim(len), fill p, commit(len, type, flags).
+ * Consumer: p = peek(&len, &type, &flags), use p, release().
+ *
+ * Exactly one task may produce and one may consume.
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#define SPSC_RECORD_HEADER  4
+#define SPSC_WRAP_MARKER    0xFFFF
+
+template <uint32_t N>
+class SpscRing {
+  static_assert((N & (N - 1)) == 0 && N >= 64, "SpscRing size must be a power of two");
+
+ public:
+  SpscRing() : head(0), tail(0), claimAt(0), claimPad(0), drops(0), highWater(0) {}
+
+  // Producer: whether claim(len) would succeed now, without counting a
+  // drop. Only the consumer changes the answer meanwhile, and only to yes.
+  // Room for one record of len bytes is also room for several whose
+  // headers and 4-byte aligned payloads add up to len.
+  bool hasRoom(size_t len) const {
+    uint32_t need = recordSize(len);
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t used = h - tail.load(std::memory_order_acquire);
+    uint32_t off = h & (N - 1);
+    uint32_t pad = (off + need > N) ? N - off : 0;
+    return len <= SPSC_WRAP_MARKER - 1 && used + pad + need <= N;
+  }
+
+  // Producer: payload space for len bytes, or NULL if the ring is full
+  uint8_t* claim(size_t len) {
+    uint32_t need = recordSize(len);
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t used = h - tail.load(std::memory_order_acquire);
+    uint32_t off = h & (N - 1);
+    uint32_t pad = (off + need > N) ? N - off : 0;
+    if (len > SPSC_WRAP_MARKER - 1 || used + pad + need > N) {
+      drops++;
+      return NULL;
+    }
+    if (used + pad + need > highWater) {
+      highWater = used + pad + need;
+    }
+    claimAt = h;
+    claimPad = pad;
+    return buf + ((h + pad) & (N - 1)) + SPSC_RECORD_HEADER;
+  }
+
+  // Producer: publishes the record filled after claim()
+  void commit(size_t len, uint8_t type, uint8_t flags) {
+    if (claimPad > 0) {
+      writeHeader(claimAt & (N - 1), SPSC_WRAP_MARKER, 0, 0);
+    }
+    uint32_t at = claimAt + claimPad;
+    writeHeader(at & (N - 1), (uint16_t)len, type, flags);
+    head.store(at + recordSize(len), std::memory_order_release);
+  }
+
+  // Consumer: the oldest record, or NULL if the ring is empty
+  const uint8_t* peek(size_t* len, uint8_t* type, uint8_t* flags) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    for (;;) {
+      if (t == head.load(std::memory_order_acquire)) {
+        return NULL;
+      }
+      const uint8_t* rec = buf + (t & (N - 1));
+      uint16_t n = (uint16_t)(rec[0] | (rec[1] << 8));
+      if (n == SPSC_WRAP_MARKER) {
+        t += N - (t & (N - 1));
+        tail.store(t, std::memory_order_release);
+        continue;
+      }
+      *len = n;
+      *type = rec[2];
+      *flags = rec[3];
+      return rec + SPSC_RECORD_HEADER;
+    }
+  }
+
+  // Consumer: frees the record returned by peek()
+  void release() {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    const uint8_t* rec = buf + (t & (N - 1));
+    tail.store(t + recordSize(rec[0] | (rec[1] << 8)), std::memory_order_release);
+  }
+
+  bool empty() const {
+    return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+  }
+
+  // Producer-side counters
+  uint32_t dropCount() const { return drops; }
+  uint32_t highWaterBytes() const { return highWater; }
+
+ private:
+  static uint32_t recordSize(size_t len) {
+    return (uint32_t)(SPSC_RECORD_HEADER + len + 3) & ~3u;
+  }
+
+  void writeHeader(uint32_t off, uint16_t len, uint8_t type, uint8_t flags) {
+    buf[off] = (uint8_t)(len & 0xFF);
+    buf[off + 1] = (uint8_t)(len >> 8);
+    buf[off + 2] = type;
+    buf[off + 3] = flags;
+  }
+
+  uint8_t buf[N];
+  std::atomic<uint32_t> head;   // Written by the producer only
+  std::atomic<uint32_t> tail;   // Written by the consumer only
+  uint32_t claimAt;
+  uint32_t claimPad;
+  uint32_t drops;
+  uint32_t highWater;
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,48 @@
+/*
+ * Persistent Station Configuration
+ *
+ * The link profile and transmit power last applied by link adaptation
+ * are kept in NVS (Preferences namespace STATION_CONFIG_NAMESPACE), so a
+ * station coming back from a reset or brown-out starts listening on the
+ * settings the link was actually using. Stored values only apply to the
+ * station ID they were written for; a board flashed for another role
+ * starts from the compiled defaults. A boot counter is kept as well, and
+ * a counter of the encryption nonce epochs handed out (lora_crypto.h),
+ * and the receiver checkpoint of an incoming bulk transfer (lora_bulk.h).
+ */
+
+#ifndef STATION_CONFIG_H
+#define STATION_CONFIG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define STATION_CONFIG_NAMESPACE  "station"
+
+struct StationConfig {
+  uint8_t stationId;
+  uint8_t profile;          // Index into LINK_PROFILES
+  int8_t powerDbm;
+  uint32_t bootCount;       // Including this boot; 0 if NVS is unavailable
+  bool restored;            // profile/power came from NVS
+};
+
+// Loads the stored link settings for stationId (defaults otherwise) and
+// counts this boot
+void stationConfigLoad(uint8_t stationId, StationConfig& cfg);
+
+// Stores new link settings; skips the flash write if nothing changed
+void stationConfigSaveLink(uint8_t profile, int8_t powerDbm);
+
+// Reserves count nonce epochs never handed out before and returns the
+// first; 0 if NVS is unavailable
+uint32_t stationConfigReserveEpochs(uint32_t count);
+
+// Stores the bulk receiver checkpoint
+void stationConfigSaveBulk(const uint8_t* checkpoint, size_t len);
+
+// Loads the bulk receiver checkpoint into checkpoint; returns its length,
+// 0 if there is none or NVS is unavailable
+size_t stationConfigLoadBulk(uint8_t* checkpoint, size_t cap);
+
+#endif // STATION_CONFIG_H
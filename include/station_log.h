@@ -0,0 +1,65 @@
+/*
+ * Deferred Binary Log
+ *
+ * Serial output at 115200 baud costs about 90 us per character, and the
+ * message path used to print several emoji lines per message from the
+ * BLE callback and the radio task. Hot-path code now logs an event ID
+ * and up to LOG_MAX_ARGS 32-bit arguments into a lock-free ring instead.
+ * That costs one compare-and-swap and a few stores, and works from any
+ * task or ISR on either core. A low-priority task formats the entries
+ * with the printf format registered for each event and writes them to
+ * Serial.
+ *
+ * When the ring is full, new entries are dropped and counted. The
+ * writer never waits for the UART. The drain task reports how many
+ * entries were dropped.
+ *
+ * Levels are checked at compile time. LOG_INFO(...) with LOG_LEVEL below
+ * LOG_LEVEL_INFO compiles to nothing. Formats take integers only
+ * (%u, %d, %x), so message text is not logged, only its length.
+ */
+
+#ifndef STATION_LOG_H
+#define STATION_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== LOG CONFIGURATION =====
+#define LOG_LEVEL_NONE        0
+#define LOG_LEVEL_ERROR       1
+#define LOG_LEVEL_WARN        2
+#define LOG_LEVEL_INFO        3
+#define LOG_LEVEL_DEBUG       4
+#ifndef LOG_LEVEL
+#define LOG_LEVEL             LOG_LEVEL_INFO
+#endif
+#define LOG_RING_SIZE         128     // Power of two
+#define LOG_MAX_ARGS          4
+#define LOG_DRAIN_MS          20
+#define LOG_TASK_STACK        3072
+#define LOG_TASK_PRIO         1       // Just above idle
+
+#define LOG_AT(level, event, ...) \
+  do { if ((level) <= LOG_LEVEL) logWrite((event), ##__VA_ARGS__); } while (0)
+#define LOG_ERROR(event, ...) LOG_AT(LOG_LEVEL_ERROR, event, ##__VA_ARGS__)
+#define LOG_WARN(event, ...)  LOG_AT(LOG_LEVEL_WARN, event, ##__VA_ARGS__)
+#define LOG_INFO(event, ...)  LOG_AT(LOG_LEVEL_INFO, event, ##__VA_ARGS__)
+#define LOG_DEBUG(event, ...) LOG_AT(LOG_LEVEL_DEBUG, event, ##__VA_ARGS__)
+
+struct LogStats {
+  uint32_t written;
+  uint32_t dropped;           // Ring full
+  uint32_t highWater;         // Most entries waiting at once
+};
+
+// Registers the format of each event ID (formats[id]) and starts the
+// drain task. Entries written before this wait in the ring.
+void logBegin(const char* const* formats, size_t count);
+
+// Queues one event; safe from any task or ISR
+void logWrite(uint16_t event, uint32_t a0 = 0, uint32_t a1 = 0, uint32_t a2 = 0, uint32_t a3 = 0);
+
+LogStats logGetStats();
+
+#endif // STATION_LOG_H
@@ -0,0 +1,39 @@
+/*
+ * Platform Seam for the Protocol Modules
+ *
+ * The protocol code (framing, fragmentation, coalescing, ARQ, compression,
+ * duplicate filter, mesh routing, channel plan, frame pool, status) only
+ * needs short critical sections from the platform. They go through these
+ * macros so the same sources also build with a plain host compiler, for
+ * example in a native simulation that drives two stations over a modelled
+ * channel. The radio driver, BLE, NVS and sleep code stay ESP32-only.
+ *
+ *   STATION_LOCK(name)         defines a file-scope lock
+ *   STATION_ENTER(name)        enters it
+ *   STATION_EXIT(name)         leaves it
+ *
+ * On the ESP32 the lock is a portMUX spinlock (safe across both cores and
+ * from ISRs); on a host it is a std::mutex.
+ */
+
+#ifndef STATION_PLATFORM_H
+#define STATION_PLATFORM_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+#define STATION_LOCK(name)    static portMUX_TYPE name = portMUX_INITIALIZER_UNLOCKED
+#define STATION_ENTER(name)   portENTER_CRITICAL(&name)
+#define STATION_EXIT(name)    portEXIT_CRITICAL(&name)
+
+#else
+#include <mutex>
+#include <string.h>
+
+#define STATION_LOCK(name)    static std::mutex name
+#define STATION_ENTER(name)   (name).lock()
+#define STATION_EXIT(name)    (name).unlock()
+
+#endif
+
+#endif // STATION_PLATFORM_H
@@ -0,0 +1,91 @@
+/*
+ * Per-Stage Latency Telemetry and Status Snapshot
+ *
+ * Every hop a message takes is timestamped with micros() and the time
+ * spent in each stage goes into a fixed-bucket LatencyHistogram:
+ *
+ *   BLE_INGEST   phone write complete -> handed to the radio queue / ARQ
+ *   QUEUE_WAIT   queued -> TX start (queue, LBT backoff, first channel)
+ *   AIRTIME      TX start -> TX done interrupt
+ *   RX_DECODE    RX-done interrupt -> frame decoded and checked
+ *   RX_DELIVER   decoded -> BLE notification to the phone returned
+ *   RX_TOTAL     RX-done interrupt -> RX handler returned
+ *
+ * Each stage has a single writer (loop(), the radio task or, for
+ * RX_DELIVER, the phone task), so recording is one bucket search and a
+ * few increments, no lock. RX_DELIVER covers only messages that go
+ * straight to a connected phone, not those logged for a later replay.
+ *
+ * statusBuildSnapshot() serialises the histograms plus a counter table
+ * into a compact binary blob served by the BLE status characteristic.
+ * All integers are little endian:
+ *
+ *   offset  size  field
+ *   0       1     format version (STATUS_FORMAT_VERSION)
+ *   1       1     station ID
+ *   2       1     stage count S
+ *   3       1     bucket count B (bounds: LATENCY_BUCKET_LIMITS_US)
+ *   4       1     counter count C
+ *   5       1     reserved, 0
+ *   6       4     uptime, ms
+ *   10      4*C   counters, in StatusCounter order
+ *   ...     S * (12 + 4*B)  per stage: count, max us, average us, buckets
+ */
+
+#ifndef STATION_STATUS_H
+#define STATION_STATUS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "latency_histogram.h"
+
+// ===== STATUS CONFIGURATION =====
+#define STATUS_CHARACTERISTIC_UUID "6E400004-B5A3-F393-E0A9-E50E24DCCA9E"
+#define STATUS_FORMAT_VERSION      1
+#define STATUS_HEADER_SIZE         10
+
+enum StatusStage : uint8_t {
+  STATUS_STAGE_BLE_INGEST = 0,
+  STATUS_STAGE_QUEUE_WAIT,
+  STATUS_STAGE_AIRTIME,
+  STATUS_STAGE_RX_DECODE,
+  STATUS_STAGE_RX_DELIVER,
+  STATUS_STAGE_RX_TOTAL,
+  STATUS_STAGE_COUNT
+};
+
+// New counters go at the end; the phone reads them by position
+enum StatusCounter : uint8_t {
+  STATUS_CTR_PHONE_MESSAGES = 0,
+  STATUS_CTR_BLE_NOTIFICATIONS,
+  STATUS_CTR_FRAMES_QUEUED,
+  STATUS_CTR_FRAMES_SENT,
+  STATUS_CTR_FRAMES_RECEIVED,
+  STATUS_CTR_TX_FAILURES,
+  STATUS_CTR_RX_FAILURES,
+  STATUS_CTR_CRC_ERRORS,
+  STATUS_CTR_QUEUE_FULL,
+  STATUS_CTR_CAD_BUSY,
+  STATUS_CTR_BACKOFFS,
+  STATUS_CTR_ARQ_RETRANSMISSIONS,
+  STATUS_CTR_ARQ_ACKED,
+  STATUS_CTR_ARQ_FAILED,
+  STATUS_CTR_DUPLICATES,
+  STATUS_CTR_RELAYED,
+  STATUS_CTR_POOL_FAILURES,
+  STATUS_CTR_POOL_HIGH_WATER,
+  STATUS_CTR_COUNT
+};
+
+#define STATUS_STAGE_SIZE     (12 + 4 * LATENCY_BUCKETS)
+#define STATUS_SNAPSHOT_SIZE  (STATUS_HEADER_SIZE + 4 * STATUS_CTR_COUNT + \
+                               STATUS_STAGE_COUNT * STATUS_STAGE_SIZE)
+
+void statusRecord(StatusStage stage, uint32_t us);
+const LatencyHistogram& statusHistogram(StatusStage stage);
+
+// Writes the snapshot; returns its length, or 0 if cap is too small
+size_t statusBuildSnapshot(uint8_t* out, size_t cap, uint8_t stationId, uint32_t uptimeMs,
+                           const uint32_t counters[STATUS_CTR_COUNT]);
+
+#endif // STATION_STATUS_H
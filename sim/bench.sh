@@ -0,0 +1,224 @@
+#!/bin/sh
+# End-to-end regression run and benchmark tables on the simulator
+# (sim/sim.h). Each builds the "sim" environment, with extra -D flags
+# where a table compares firmware settings, and runs both stations on
+# virtual time, so a table takes seconds.
+#
+#   sim/bench.sh check      every message arrives once and intact, with
+#                           a truthful receipt, over a set of seeds and
+#                           loss rates; exits 1 on the first failure
+#   sim/bench.sh window     messages/s and latency against the coalescing
+#                           window (LORA_COALESCE_WINDOW_MS)
+#   sim/bench.sh nodes      delivery and airtime against the number of
+#                           stations, with relays in a line between the
+#                           two phones' stations (--relays)
+#   sim/bench.sh contention
+#                           total goodput and collisions of 2-5 stations
+#                           writing on one channel, listen-before-talk
+#                           (LORA_LBT_ENABLED) off and on (--stations)
+#   sim/bench.sh channels   total goodput of four independent pairs of
+#                           stations against the channels in the plan
+#                           (LORA_CHANNEL_COUNT)
+#   sim/bench.sh fec        long messages with forward error correction
+#                           (LORA_FEC_ENABLED) off and on, against loss,
+#                           on a fixed SF7 profile (LINK_ADAPT_ENABLED 0)
+#   sim/bench.sh bulk       bulk transfer (--bulk) throughput against
+#                           loss and BLE drops: blocks sent, resent, and
+#                           skipped when the sender resumes after a drop
+#
+# Tables average both directions over the seeds in SEEDS (default 1-8):
+# delivered share, messages/s delivered, median and 90th percentile
+# latency, payload share of the bytes on air (compressed text as sent)
+# and airtime per delivered message. The contention, channels and bulk
+# tables have their own columns, described there.
+#
+# Build options go through PLATFORMIO_BUILD_FLAGS, which PlatformIO adds
+# to the environment's own.
+set -e
+cd "$(dirname "$0")/.."
+
+SEEDS="${SEEDS:-1 2 3 4 5 6 7 8}"
+BIN=.pio/bench
+
+# build NAME [FLAGS]: the simulator built with FLAGS, as $BIN/NAME
+build() {
+  PLATFORMIO_BUILD_FLAGS="$2" pio run -s -e sim
+  mkdir -p "$BIN"
+  cp .pio/build/sim/program "$BIN/$1"
+}
+
+# run NAME ARGS...: one run of $BIN/NAME, failing the script if it fails
+run() {
+  name=$1
+  shift
+  if ! out=$("$BIN/$name" "$@"); then
+    echo "$out"
+    echo "FAILED: $name $*"
+    exit 1
+  fi
+}
+
+# header TITLE: the column names, TITLE over the settings column
+header() {
+  printf '%-12s %9s %8s %9s %9s %7s %10s\n' "$1" delivered msgs/s "p50 ms" "p90 ms" payload "air ms/msg"
+}
+
+# row LABEL NAME ARGS...: runs of $BIN/NAME over the seeds, as one line
+row() {
+  label=$1
+  name=$2
+  shift 2
+  for seed in $SEEDS; do
+    "$BIN/$name" "$@" --seed=$seed || true
+  done | awk -v label="$label" '
+    / -> .*written/ { written += $5; delivered += $7 }
+    /throughput/ { rate += $2; p50 += $9; p90 += $11; dirs++ }
+    /^Airtime/ { payload += $3; air += $9; runs++ }
+    END {
+      printf "%-12s %8.1f%% %8.2f %9.0f %9.0f %6.1f%% %10.0f\n", label,
+             written ? 100 * delivered / written : 0, runs ? rate / runs : 0,
+             dirs ? p50 / dirs : 0, dirs ? p90 / dirs : 0, runs ? payload / runs : 0, runs ? air / runs : 0
+    }'
+}
+
+# totalRow LABEL NAME ARGS...: runs of $BIN/NAME over the seeds, as one
+# line of totals over every station: delivered share, messages/s and
+# payload B/s delivered, frames lost to collisions, airtime per message
+totalRow() {
+  label=$1
+  name=$2
+  shift 2
+  for seed in $SEEDS; do
+    "$BIN/$name" "$@" --seed=$seed || true
+  done | awk -v label="$label" '
+    /^All stations/ { written += $4; delivered += $6; rate += $8; bytes += $10; collisions += $14; runs++ }
+    /^Airtime/ { air += $9 }
+    END {
+      printf "%-12s %8.1f%% %8.2f %9.1f %10.0f %10.0f\n", label,
+             written ? 100 * delivered / written : 0, runs ? rate / runs : 0, runs ? bytes / runs : 0,
+             runs ? collisions / runs : 0, runs ? air / runs : 0
+    }'
+}
+
+totalHeader() {
+  printf '%-12s %9s %8s %9s %10s %10s\n' "$1" delivered msgs/s "B/s" collisions "air ms/msg"
+}
+
+check() {
+  build default
+  for seed in $SEEDS; do
+    for loss in 0 10; do
+      run default --count=100 --loss=$loss --seed=$seed --check
+    done
+    run default --count=100 --loss=5 --reconnect=20 --seed=$seed --check
+    run default --count=30 --rate=0.1 --size=100:600 --loss=5 --seed=$seed --check
+    run default --count=20 --bulk=20000 --loss=5 --reconnect=20 --seed=$seed --check
+  done
+  echo "check: all runs passed"
+}
+
+# Short messages, at a rate the link carries with or without coalescing,
+# so the table compares latency and airtime, not messages refused at a
+# full ring
+window() {
+  header "window ms"
+  for ms in 0 20 50 100 250; do
+    build window$ms "-DLORA_COALESCE_WINDOW_MS=$ms"
+    row $ms window$ms --rate=4 --size=20:40 --count=400
+  done
+}
+
+# One channel, so a flood before the first route reaches every relay
+nodes() {
+  build line -DLORA_CHANNEL_COUNT=1
+  header "nodes"
+  for relays in 0 1 2 3; do
+    row $((relays + 2)) line --relays=$relays --rate=0.2 --count=100
+  done
+}
+
+# Every station on one channel, each phone writing a message a second
+contention() {
+  for lbt in 0 1; do
+    build lbt$lbt "-DLORA_CHANNEL_COUNT=1 -DLORA_LBT_ENABLED=$lbt"
+  done
+  totalHeader "stations/lbt"
+  for stations in 2 3 4 5; do
+    for lbt in 0 1; do
+      totalRow "$stations/$lbt" lbt$lbt --stations=$stations --rate=1 --count=150
+    done
+  done
+}
+
+# Four pairs in range of each other, both phones of each writing a message
+# a second; a channel of its own for every station at 8
+channels() {
+  for count in 1 2 4 8; do
+    build channels$count "-DLORA_CHANNEL_COUNT=$count"
+  done
+  totalHeader "channels"
+  for count in 1 2 4 8; do
+    totalRow $count channels$count --stations=8 --rate=1 --count=150
+  done
+}
+
+# Messages of two or three fragments at SF7, ARQ repairing what FEC
+# cannot. Link adaptation is off, so both builds stay on SF7 whatever
+# the loss and the table compares FEC, not the profiles it ends up on.
+fec() {
+  for enabled in 0 1; do
+    build fec$enabled "-DLORA_FEC_ENABLED=$enabled -DLINK_ADAPT_ENABLED=0"
+  done
+  header "fec/loss %"
+  for loss in 0 10 20 30; do
+    for enabled in 0 1; do
+      row "$enabled/$loss" fec$enabled --rate=0.05 --size=250:500 --count=30 --loss=$loss --duration=1500
+    done
+  done
+}
+
+# bulkRow LABEL NAME ARGS...: bulk runs of $BIN/NAME over the seeds, as
+# one line: runs that completed, bytes delivered, B/s and seconds from the
+# first offer to the last byte at the phone, then per run the offers, blocks sent, resent
+# and skipped on resume
+bulkRow() {
+  label=$1
+  name=$2
+  shift 2
+  for seed in $SEEDS; do
+    "$BIN/$name" "$@" --seed=$seed || true
+  done | awk -v label="$label" '
+    /^  bulk: / { runs++; delivered += $5; offers += $9; if ($14 > 0) { done++; rate += $10; secs += $14 } }
+    /^  bulk blocks/ { sent += $4; resent += $6; skipped += $14 }
+    END {
+      printf "%-16s %4d/%-3d %8.1f%% %7.0f %7.1f %6.1f %7.1f %7.1f %8.1f\n", label, done, runs,
+             runs ? delivered / runs : 0, done ? rate / done : 0, done ? secs / done : 0,
+             runs ? offers / runs : 0, runs ? sent / runs : 0, runs ? resent / runs : 0, runs ? skipped / runs : 0
+    }'
+}
+
+# One 50 kB object from M1's phone, nothing else on the air
+bulk() {
+  build default
+  printf '%-16s %8s %9s %7s %7s %6s %7s %7s %8s\n' scenario done delivered "B/s" "done s" offers sent resent skipped
+  for loss in 0 5 10 20; do
+    bulkRow "loss $loss%" default --bulk=50000 --count=0 --oneway --loss=$loss
+  done
+  for every in 30 10; do
+    bulkRow "drop every ${every}s" default --bulk=50000 --count=0 --oneway --loss=5 --reconnect=$every
+  done
+}
+
+case "$1" in
+  check) check ;;
+  window) window ;;
+  nodes) nodes ;;
+  contention) contention ;;
+  channels) channels ;;
+  fec) fec ;;
+  bulk) bulk ;;
+  *)
+    sed -n '2,/^$/s/^# \{0,1\}//p' "$0"
+    exit 2
+    ;;
+esac
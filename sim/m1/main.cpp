@@ -0,0 +1,12 @@
+// Station M1: the firmware built from src/main.cpp as station 1
+#include "../sim_station.h"
+
+#define STATION_ID 1
+
+namespace sim_m1 {
+#include "../sim_station_begin.inc"
+#include "../../src/main.cpp"
+#include "../sim_station_end.inc"
+}
+
+const SimStation simStationM1 = { "M1", sim_m1::setup, sim_m1::loop, sim_m1::simCounters };
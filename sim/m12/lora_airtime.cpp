@@ -0,0 +1,5 @@
+#include "../sim_station.h"
+
+namespace sim_m12 {
+#include "../../src/lora_airtime.cpp"
+}
@@ -0,0 +1,14 @@
+// Station M12: the firmware built from src/main.cpp as station 12, paired
+// with M13 (sim_main.cpp --stations)
+#include "../sim_station.h"
+
+#define STATION_ID 12
+#define STATION_PEER_ID 13
+
+namespace sim_m12 {
+#include "../sim_station_begin.inc"
+#include "../../src/main.cpp"
+#include "../sim_station_end.inc"
+}
+
+const SimStation simStationM12 = { "M12", sim_m12::setup, sim_m12::loop, sim_m12::simCounters };
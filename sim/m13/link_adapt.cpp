@@ -0,0 +1,5 @@
+#include "../sim_station.h"
+
+namespace sim_m13 {
+#include "../../src/link_adapt.cpp"
+}
@@ -0,0 +1,14 @@
+// Station M13: the firmware built from src/main.cpp as station 13, paired
+// with M12 (sim_main.cpp --stations)
+#include "../sim_station.h"
+
+#define STATION_ID 13
+#define STATION_PEER_ID 12
+
+namespace sim_m13 {
+#include "../sim_station_begin.inc"
+#include "../../src/main.cpp"
+#include "../sim_station_end.inc"
+}
+
+const SimStation simStationM13 = { "M13", sim_m13::setup, sim_m13::loop, sim_m13::simCounters };
@@ -0,0 +1,5 @@
+#include "../sim_station.h"
+
+namespace sim_m2 {
+#include "../../src/frame_pool.cpp"
+}
@@ -0,0 +1,12 @@
+// Station M2: the firmware built from src/main.cpp as station 2
+#include "../sim_station.h"
+
+#define STATION_ID 2
+
+namespace sim_m2 {
+#include "../sim_station_begin.inc"
+#include "../../src/main.cpp"
+#include "../sim_station_end.inc"
+}
+
+const SimStation simStationM2 = { "M2", sim_m2::setup, sim_m2::loop, sim_m2::simCounters };
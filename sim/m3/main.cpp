@@ -0,0 +1,14 @@
+// Station M3: the firmware built from src/main.cpp as station 3, a relay
+// with no peer of its own (sim_main.cpp --relays)
+#include "../sim_station.h"
+
+#define STATION_ID 3
+#define STATION_PEER_ID LORA_BROADCAST_ID
+
+namespace sim_m3 {
+#include "../sim_station_begin.inc"
+#include "../../src/main.cpp"
+#include "../sim_station_end.inc"
+}
+
+const SimStation simStationM3 = { "M3", sim_m3::setup, sim_m3::loop, sim_m3::simCounters };
@@ -0,0 +1,5 @@
+#include "../sim_station.h"
+
+namespace sim_m4 {
+#include "../../src/ble_segment.cpp"
+}
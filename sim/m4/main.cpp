@@ -0,0 +1,14 @@
+// Station M4: the firmware built from src/main.cpp as station 4, a relay
+// with no peer of its own (sim_main.cpp --relays)
+#include "../sim_station.h"
+
+#define STATION_ID 4
+#define STATION_PEER_ID LORA_BROADCAST_ID
+
+namespace sim_m4 {
+#include "../sim_station_begin.inc"
+#include "../../src/main.cpp"
+#include "../sim_station_end.inc"
+}
+
+const SimStation simStationM4 = { "M4", sim_m4::setup, sim_m4::loop, sim_m4::simCounters };
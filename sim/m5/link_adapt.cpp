@@ -0,0 +1,5 @@
+#include "../sim_station.h"
+
+namespace sim_m5 {
+#include "../../src/link_adapt.cpp"
+}
@@ -0,0 +1,14 @@
+// Station M5: the firmware built from src/main.cpp as station 5, a relay
+// with no peer of its own (sim_main.cpp --relays)
+#include "../sim_station.h"
+
+#define STATION_ID 5
+#define STATION_PEER_ID LORA_BROADCAST_ID
+
+namespace sim_m5 {
+#include "../sim_station_begin.inc"
+#include "../../src/main.cpp"
+#include "../sim_station_end.inc"
+}
+
+const SimStation simStationM5 = { "M5", sim_m5::setup, sim_m5::loop, sim_m5::simCounters };
@@ -0,0 +1,14 @@
+// Station M6: the firmware built from src/main.cpp as station 6, paired
+// with M7 (sim_main.cpp --stations)
+#include "../sim_station.h"
+
+#define STATION_ID 6
+#define STATION_PEER_ID 7
+
+namespace sim_m6 {
+#include "../sim_station_begin.inc"
+#include "../../src/main.cpp"
+#include "../sim_station_end.inc"
+}
+
+const SimStation simStationM6 = { "M6", sim_m6::setup, sim_m6::loop, sim_m6::simCounters };
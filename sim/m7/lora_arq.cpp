@@ -0,0 +1,5 @@
+#include "../sim_station.h"
+
+namespace sim_m7 {
+#include "../../src/lora_arq.cpp"
+}
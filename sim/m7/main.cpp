@@ -0,0 +1,14 @@
+// Station M7: the firmware built from src/main.cpp as station 7, paired
+// with M6 (sim_main.cpp --stations)
+#include "../sim_station.h"
+
+#define STATION_ID 7
+#define STATION_PEER_ID 6
+
+namespace sim_m7 {
+#include "../sim_station_begin.inc"
+#include "../../src/main.cpp"
+#include "../sim_station_end.inc"
+}
+
+const SimStation simStationM7 = { "M7", sim_m7::setup, sim_m7::loop, sim_m7::simCounters };
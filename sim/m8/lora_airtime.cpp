@@ -0,0 +1,5 @@
+#include "../sim_station.h"
+
+namespace sim_m8 {
+#include "../../src/lora_airtime.cpp"
+}
@@ -0,0 +1,14 @@
+// Station M8: the firmware built from src/main.cpp as station 8, paired
+// with M9 (sim_main.cpp --stations)
+#include "../sim_station.h"
+
+#define STATION_ID 8
+#define STATION_PEER_ID 9
+
+namespace sim_m8 {
+#include "../sim_station_begin.inc"
+#include "../../src/main.cpp"
+#include "../sim_station_end.inc"
+}
+
+const SimStation simStationM8 = { "M8", sim_m8::setup, sim_m8::loop, sim_m8::simCounters };
@@ -0,0 +1,14 @@
+// Station M9: the firmware built from src/main.cpp as station 9, paired
+// with M8 (sim_main.cpp --stations)
+#include "../sim_station.h"
+
+#define STATION_ID 9
+#define STATION_PEER_ID 8
+
+namespace sim_m9 {
+#include "../sim_station_begin.inc"
+#include "../../src/main.cpp"
+#include "../sim_station_end.inc"
+}
+
+const SimStation simStationM9 = { "M9", sim_m9::setup, sim_m9::loop, sim_m9::simCounters };
@@ -0,0 +1,63 @@
+// Arduino core for the native simulator (sim/sim_arduino.cpp). millis()
+// and micros() are virtual time and wrap at 32 bits like on the ESP32.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <math.h>
+#include <string>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+
+#define IRAM_ATTR
+#define HIGH    0x1
+#define LOW     0x0
+#define INPUT   0x01
+#define OUTPUT  0x03
+#define ARDUINO_RUNNING_CORE 1
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+uint32_t esp_random();
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+// Prints to stdout when the simulation is verbose, one prefix per line
+class HardwareSerial {
+ public:
+  void begin(unsigned long baud) { (void)baud; }
+  // No host has the port open: FAST_BOOT does not wait for one
+  explicit operator bool() const { return false; }
+  size_t write(const uint8_t* data, size_t len);
+  size_t print(const char* text);
+  size_t println(const char* text = "");
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+  int available() { return 0; }
+  int read() { return -1; }
+  size_t readBytesUntil(char terminator, char* buffer, size_t len) {
+    (void)terminator; (void)buffer; (void)len;
+    return 0;
+  }
+};
+extern HardwareSerial Serial;
+
+// Cycle counter at 240 MHz of virtual time: firmware code costs nothing
+class EspClass {
+ public:
+  uint32_t getCycleCount();
+  uint32_t getFreeHeap() { return 256 * 1024; }
+};
+extern EspClass ESP;
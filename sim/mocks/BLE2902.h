@@ -0,0 +1,4 @@
+#pragma once
+#include "BLEDevice.h"
+
+class BLE2902 : public BLEDescriptor {};
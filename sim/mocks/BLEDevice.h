@@ -0,0 +1,122 @@
+// ESP32 BLE library for the native simulator: a GATT server per station
+// that a simulated phone (sim/sim_ble.cpp) connects to, writes and
+// receives notifications from.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+class BLEServer;
+class BLECharacteristic;
+
+typedef union {
+  struct { uint16_t conn_id; } connect;
+  struct { uint16_t conn_id; } disconnect;
+  struct { uint16_t conn_id; uint16_t mtu; } mtu;
+} esp_ble_gatts_cb_param_t;
+
+class BLEDescriptor {
+ public:
+  virtual ~BLEDescriptor() {}
+};
+
+class BLEServerCallbacks {
+ public:
+  virtual ~BLEServerCallbacks() {}
+  virtual void onConnect(BLEServer* server) { (void)server; }
+  virtual void onConnect(BLEServer* server, esp_ble_gatts_cb_param_t* param) { (void)server; (void)param; }
+  virtual void onDisconnect(BLEServer* server) { (void)server; }
+  virtual void onMtuChanged(BLEServer* server, esp_ble_gatts_cb_param_t* param) { (void)server; (void)param; }
+};
+
+class BLECharacteristicCallbacks {
+ public:
+  virtual ~BLECharacteristicCallbacks() {}
+  virtual void onRead(BLECharacteristic* characteristic) { (void)characteristic; }
+  virtual void onWrite(BLECharacteristic* characteristic) { (void)characteristic; }
+};
+
+class BLECharacteristic {
+ public:
+  static const uint32_t PROPERTY_READ = 1 << 0;
+  static const uint32_t PROPERTY_WRITE = 1 << 1;
+  static const uint32_t PROPERTY_NOTIFY = 1 << 2;
+  static const uint32_t PROPERTY_INDICATE = 1 << 3;
+  static const uint32_t PROPERTY_WRITE_NR = 1 << 4;
+
+  BLECharacteristic(int node, const char* uuid, uint32_t properties)
+      : node(node), uuid(uuid), properties(properties) {}
+
+  void setCallbacks(BLECharacteristicCallbacks* cb) { callbacks = cb; }
+  BLECharacteristicCallbacks* getCallbacks() { return callbacks; }
+  void addDescriptor(BLEDescriptor* descriptor) { (void)descriptor; }
+  void setValue(const uint8_t* data, size_t len) { value.assign(data, data + len); }
+  void setValue(const std::string& text) { value.assign(text.begin(), text.end()); }
+  void setValue(const char* text) { setValue(std::string(text)); }
+  std::string getValue() { return std::string(value.begin(), value.end()); }
+  uint8_t* getData() { return value.data(); }
+  size_t getLength() { return value.size(); }
+  const std::string& getUUID() const { return uuid; }
+
+  // Hands the current value to the connected phone
+  void notify(bool isNotification = true);
+
+ private:
+  int node;
+  std::string uuid;
+  uint32_t properties;
+  std::vector<uint8_t> value;
+  BLECharacteristicCallbacks* callbacks = nullptr;
+};
+
+class BLEService {
+ public:
+  explicit BLEService(int node) : node(node) {}
+  BLECharacteristic* createCharacteristic(const char* uuid, uint32_t properties);
+  BLECharacteristic* getCharacteristic(const char* uuid);
+  void start() {}
+
+ private:
+  int node;
+  std::vector<BLECharacteristic*> characteristics;
+};
+
+class BLEAdvertising {
+ public:
+  void addServiceUUID(const char* uuid) { (void)uuid; }
+  void setMinInterval(uint16_t interval) { (void)interval; }
+  void setMaxInterval(uint16_t interval) { (void)interval; }
+  void start() { advertising = true; }
+  void stop() { advertising = false; }
+  bool advertising = false;
+};
+
+class BLEServer {
+ public:
+  explicit BLEServer(int node) : node(node) {}
+  void setCallbacks(BLEServerCallbacks* cb) { callbacks = cb; }
+  BLEServerCallbacks* getCallbacks() { return callbacks; }
+  BLEService* createService(const char* uuid);
+  BLEService* getService() { return service; }
+  BLEAdvertising* getAdvertising() { return &advertisingState; }
+  void startAdvertising() { advertisingState.start(); }
+  uint32_t getConnectedCount();
+  uint16_t getConnId() { return 0; }
+  uint16_t getPeerMTU(uint16_t connId);
+
+ private:
+  int node;
+  BLEServerCallbacks* callbacks = nullptr;
+  BLEService* service = nullptr;
+  BLEAdvertising advertisingState;
+};
+
+class BLEDevice {
+ public:
+  static void init(const char* name);
+  static BLEServer* createServer();
+  static int setMTU(uint16_t mtu);
+  static uint16_t getMTU();
+  static BLEAdvertising* getAdvertising();
+};
@@ -0,0 +1,30 @@
+// NVS for the native simulator: one in-memory store per station. Every
+// write costs SIM_NVS_WRITE_US of virtual time in the calling task.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define SIM_NVS_WRITE_US 4000
+
+class Preferences {
+ public:
+  bool begin(const char* name, bool readOnly = false);
+  void end();
+  bool clear();
+  bool isKey(const char* key);
+  uint8_t getUChar(const char* key, uint8_t fallback = 0);
+  size_t putUChar(const char* key, uint8_t value);
+  int8_t getChar(const char* key, int8_t fallback = 0);
+  size_t putChar(const char* key, int8_t value);
+  uint32_t getUInt(const char* key, uint32_t fallback = 0);
+  size_t putUInt(const char* key, uint32_t value);
+  size_t getBytes(const char* key, void* buf, size_t len);
+  size_t putBytes(const char* key, const void* value, size_t len);
+
+ private:
+  int node = -1;
+  bool readOnly = false;
+  char space[16] = {};
+  size_t put(const char* key, const void* value, size_t len);
+  size_t get(const char* key, void* buf, size_t len);
+};
@@ -0,0 +1,70 @@
+// RadioLib's SX1262 for the native simulator, on the channel model in
+// sim/sim_radio.cpp. Only the calls the firmware makes are provided.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define RADIOLIB_ERR_NONE                   (0)
+#define RADIOLIB_ERR_UNKNOWN                (-1)
+#define RADIOLIB_ERR_PACKET_TOO_LONG        (-4)
+#define RADIOLIB_ERR_RX_TIMEOUT             (-6)
+#define RADIOLIB_ERR_CRC_MISMATCH           (-7)
+#define RADIOLIB_ERR_INVALID_BANDWIDTH      (-8)
+#define RADIOLIB_ERR_INVALID_SPREADING_FACTOR (-9)
+#define RADIOLIB_PREAMBLE_DETECTED          (-14)
+#define RADIOLIB_LORA_DETECTED              (-15)
+#define RADIOLIB_CHANNEL_FREE               (-16)
+#define RADIOLIB_SX126X_SYNC_WORD_PRIVATE   0x12
+#define RADIOLIB_SX126X_MAX_PACKET_LENGTH   255
+#define RADIOLIB_SX126X_RX_TIMEOUT_INF      0xFFFFFF
+#define RADIOLIB_SX126X_IRQ_RX_DONE         0x0002
+#define RADIOLIB_SX126X_IRQ_PREAMBLE_DETECTED 0x0004
+#define RADIOLIB_SX126X_IRQ_HEADER_VALID    0x0010
+#define RADIOLIB_SX126X_IRQ_RX_DEFAULT      0x0262
+
+class Module {
+ public:
+  Module(uint32_t cs, uint32_t irq, uint32_t rst, uint32_t gpio) {
+    (void)cs; (void)irq; (void)rst; (void)gpio;
+  }
+};
+
+struct SimRadio;
+
+class SX1262 {
+ public:
+  SX1262(Module* module) { delete module; }
+
+  // Binds the radio to the calling station's node
+  int16_t begin(float freq = 434.0, float bw = 125.0, uint8_t sf = 9, uint8_t cr = 7,
+                uint8_t syncWord = RADIOLIB_SX126X_SYNC_WORD_PRIVATE, int8_t power = 10,
+                uint16_t preambleLength = 8, float tcxoVoltage = 1.6, bool useRegulatorLDO = false);
+  int16_t setFrequency(float freq, bool calibrate = true);
+  int16_t setBandwidth(float bw);
+  int16_t setSpreadingFactor(uint8_t sf);
+  int16_t setCodingRate(uint8_t cr);
+  int16_t setOutputPower(int8_t power);
+  int16_t setPreambleLength(uint16_t preambleLength);
+  int16_t startTransmit(const uint8_t* data, size_t len, uint8_t addr = 0);
+  int16_t finishTransmit();
+  int16_t startReceive(uint32_t timeout = RADIOLIB_SX126X_RX_TIMEOUT_INF,
+                       uint16_t irqFlags = RADIOLIB_SX126X_IRQ_RX_DEFAULT,
+                       uint16_t irqMask = RADIOLIB_SX126X_IRQ_RX_DONE, size_t len = 0);
+  int16_t startReceiveDutyCycleAuto(uint16_t senderPreambleLength = 0, uint16_t minSymbols = 8,
+                                    uint16_t irqFlags = RADIOLIB_SX126X_IRQ_RX_DEFAULT,
+                                    uint16_t irqMask = RADIOLIB_SX126X_IRQ_RX_DONE);
+  int16_t startChannelScan();
+  int16_t getChannelScanResult();
+  int16_t standby();
+  int16_t sleep();
+  int16_t readData(uint8_t* data, size_t len);
+  size_t getPacketLength(bool update = true);
+  float getRSSI();
+  float getSNR();
+  uint16_t getIrqStatus();      // Only HEADER_VALID is modelled
+  void setDio1Action(void (*func)(void));
+  void clearDio1Action();
+
+ private:
+  SimRadio* sim = nullptr;
+};
@@ -0,0 +1,20 @@
+// Light sleep for the native simulator: refused, so low-power stations
+// fall back to their normal delay
+#pragma once
+#include <stdint.h>
+
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK    0
+#define ESP_FAIL  (-1)
+#endif
+typedef enum {
+  ESP_SLEEP_WAKEUP_UNDEFINED = 0,
+  ESP_SLEEP_WAKEUP_TIMER = 4,
+  ESP_SLEEP_WAKEUP_GPIO = 7
+} esp_sleep_wakeup_cause_t;
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t us);
+esp_err_t esp_sleep_enable_gpio_wakeup();
+esp_err_t esp_light_sleep_start();
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause();
@@ -0,0 +1,41 @@
+// FreeRTOS for the native simulator: tasks are coroutines on virtual time
+// (sim/sim_kernel.cpp). One tick is one millisecond.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+struct SimTask;
+struct SimQueue;
+struct SimMutex;
+struct SimTimer;
+typedef SimTask* TaskHandle_t;
+typedef SimQueue* QueueHandle_t;
+typedef SimMutex* SemaphoreHandle_t;
+typedef SimTimer* TimerHandle_t;
+
+// Tasks only switch when they block, so a critical section needs no lock
+typedef struct { int owner; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux)       ((void)(mux))
+#define portEXIT_CRITICAL(mux)        ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux)   ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux)    ((void)(mux))
+#define portYIELD_FROM_ISR(woken)     ((void)(woken))
+
+#define pdFALSE                 0
+#define pdTRUE                  1
+#define pdFAIL                  0
+#define pdPASS                  1
+#define portMAX_DELAY           ((TickType_t)0xFFFFFFFFu)
+#define configTICK_RATE_HZ      1000
+#define portTICK_PERIOD_MS      1
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(ms))
+#define configMAX_PRIORITIES    25
+#define tskIDLE_PRIORITY        0
+#define tskNO_AFFINITY          0x7FFFFFFF
+#define PRO_CPU_NUM             0
+#define APP_CPU_NUM             1
@@ -0,0 +1,7 @@
+#pragma once
+#include "FreeRTOS.h"
+
+// Mutexes only; taking one the task already holds stops the simulation
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex);
@@ -0,0 +1,219 @@
+/*
+ * Native Multi-Station Simulator
+ *
+ * Runs the unmodified station firmware (src/) for two stations, and up
+ * to three relays in a line between them (--relays) or up to three more
+ * pairs of stations sharing the air with them (--stations), in one
+ * Linux process, against functional mocks of the Arduino core, FreeRTOS,
+ * RadioLib's SX1262 and the ESP32 BLE library (sim/mocks). Build and run
+ * it with the PlatformIO "sim" environment:
+ *
+ *   pio run -e sim && .pio/build/sim/program --help
+ *
+ * sim/bench.sh check is the end-to-end regression run: fixed scenarios
+ * over several seeds, each required to pass --check.
+ *
+ * Time is virtual. Firmware code runs in zero time; time only moves when
+ * every task is blocked, straight to the next timeout or channel event.
+ * FreeRTOS tasks are coroutines on one host thread, switched only when
+ * they block (notification, mutex, queue, delay). A run is therefore
+ * deterministic for a given seed, and hours of traffic take seconds.
+ * That also means the sim exercises protocol behaviour, not data races:
+ * code between two blocking calls never interleaves with another task.
+ *
+ * Each station is its own copy of the firmware: every module is compiled
+ * inside namespace sim_m1, sim_m2 and so on (sim/m1, sim/m2, ...), so
+ * file-scope state is per station. The relays M3-M5 have no phone and
+ * no peer of their own; each hears only its neighbours in the line. The
+ * pairs M6-M7, M8-M9 and M12-M13 are like M1-M2, each station with a
+ * phone, and every station of a pair run hears every other.
+ * Mocks that need to know which station calls them use simCurrentNode(),
+ * set by the scheduler for the running task.
+ *
+ * The channel (sim_radio.cpp) models time on air per SF/BW/CR, random
+ * loss, an SNR floor per spreading factor, half duplex, CAD and
+ * collisions (with 6 dB capture) between every node on the same
+ * frequency, SF and bandwidth. An optional interferer puts foreign
+ * frames on the air. The phones (sim_ble.cpp) write numbered messages,
+ * and optionally one bulk object, over BLE and check what arrives at the
+ * other side.
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SIM_MAX_NODES     12        // Two stations, the interferer, three relays, three pairs
+#define SIM_NO_NODE       (-1)
+#define SIM_FOREVER       UINT64_MAX
+
+// ===== KERNEL (sim_kernel.cpp) =====
+struct SimTask;
+typedef void (*SimTaskFn)(void* arg);
+typedef void (*SimEventFn)(void* ctx, uint64_t arg);
+
+uint64_t simNowUs();
+
+// Node of the running task or event; SIM_NO_NODE from the driver
+int simCurrentNode();
+void simSetCurrentNode(int node);
+
+SimTask* simSpawn(int node, const char* name, SimTaskFn fn, void* arg, int priority, int core);
+SimTask* simCurrentTask();
+const char* simTaskName(const SimTask* task);
+int simTaskCore(const SimTask* task);
+
+// Blocks the running task until simWake() or the timeout; true if woken.
+// A zero timeout returns false at once.
+bool simBlock(uint64_t timeoutUs);
+void simWake(SimTask* task);
+
+// Costs virtual time in the calling task (flash writes, NVS commits);
+// ignored outside a task
+void simSpend(uint64_t us);
+
+// Runs fn(ctx, arg) at atUs in scheduler context, with node current
+void simSchedule(uint64_t atUs, int node, SimEventFn fn, void* ctx, uint64_t arg);
+
+// Runs tasks and events until untilUs, or until simStop()
+void simRun(uint64_t untilUs);
+void simStop();
+
+// Deterministic randomness for the whole simulation
+void simSeed(uint64_t seed);
+uint32_t simRandom();
+double simUniform();
+
+// FreeRTOS notification count of a task (xTaskNotifyGive/ulTaskNotifyTake)
+uint32_t* simNotifyCount(SimTask* task);
+
+// Serial output of the stations: off, or every line prefixed with the
+// station and virtual time
+void simSetVerbose(bool verbose);
+bool simVerbose();
+void simSetNodeName(int node, const char* name);
+const char* simNodeName(int node);
+
+// ===== CHANNEL AND RADIO (sim_radio.cpp) =====
+struct SimLink {
+  float lossPct;            // Random loss of frames that were otherwise received
+  float snrDb;
+  float rssiDbm;
+};
+
+void simChannelSetLink(int from, int to, const SimLink& link);
+
+// Foreign LoRa frames at a Poisson rate from node, each on the channel
+// and modem settings a random station is listening with
+void simInterfererStart(int node, float framesPerSec, size_t len);
+
+// Semtech AN1200.13 time on air, explicit header and CRC on
+uint32_t simTimeOnAirUs(uint8_t sf, float bwKHz, uint8_t cr, uint16_t preamble, size_t len);
+
+struct SimRadioStats {
+  uint32_t framesSent;
+  uint64_t airUs;
+  uint64_t airBytes;
+  uint32_t received;
+  uint32_t collisions;      // Frames lost to an overlapping frame
+  uint32_t missed;          // Frames that started while this node was not listening
+  uint32_t lost;            // Random loss and SNR below the floor
+  uint32_t cut;             // Receptions this node broke off by leaving RX
+  uint32_t cadScans;
+  uint32_t cadBusy;
+};
+const SimRadioStats& simRadioStats(int node);
+
+// ===== PHONES (sim_ble.cpp) =====
+struct SimPhoneConfig {
+  uint16_t mtu;
+  float ratePerSec;         // Messages the phone writes per second, Poisson
+  uint32_t count;           // Messages to write, 0 for none
+  size_t minLen;
+  size_t maxLen;
+  uint64_t connectUs;
+  uint64_t startUs;         // First message
+  uint64_t writeGapUs;      // Time one BLE write takes
+  uint64_t reconnectEveryUs;    // Drop and re-establish the link, 0 = never
+  uint32_t bulkBytes;       // One bulk object sent to the peer (lora_bulk.h), 0 = none
+};
+
+void simPhoneStart(int node, int peerNode, const SimPhoneConfig& config);
+
+struct SimPhoneReport {
+  uint32_t written;
+  uint32_t delivered;       // Arrived at the peer's phone, intact
+  uint32_t duplicates;
+  uint32_t corrupt;
+  uint32_t reordered;       // Arrived before an earlier message still missing
+  uint32_t receiptsDelivered;
+  uint32_t receiptsFailed;
+  uint32_t falseReceipts;   // "Delivered" for a message the peer never got
+  uint32_t unknownReceipts; // Receipt for a number the phone never used
+  uint64_t payloadBytes;    // Of delivered messages
+  uint64_t firstWriteUs;
+  uint64_t lastDeliveryUs;
+  size_t latencyCount;
+  const uint32_t* latencyUs;    // Write to peer notification, sorted
+  uint32_t bulkBytes;       // Bulk object size, 0 if none
+  uint32_t bulkDelivered;   // Of its bytes at the peer's phone, intact
+  uint32_t bulkCorrupt;     // Bytes that arrived wrong
+  uint32_t bulkOffers;      // The first offer and every resume
+  uint64_t bulkStartUs;     // First offer
+  uint64_t bulkSentUs;      // SENT from the station, 0 until then
+  uint64_t bulkCompleteUs;  // Last byte at the peer's phone, 0 until then
+};
+SimPhoneReport simPhoneReport(int node);
+
+// ===== STATIONS (sim/m1 ... sim/m13) =====
+struct SimStationCounters {
+  uint32_t framesQueued;
+  uint32_t framesSent;
+  uint32_t framesReceived;
+  uint32_t crcErrors;
+  uint32_t cadBusy;
+  uint32_t backoffs;
+  uint32_t dutyShed;
+  uint32_t dutyBypassed;
+  uint32_t arqTransmissions;
+  uint32_t arqRetransmissions;
+  uint32_t arqAcked;
+  uint32_t arqFailed;
+  uint32_t duplicates;
+  uint32_t poolFailures;
+  uint32_t profileSwitches;
+  uint32_t ringDrops;
+  uint32_t bulkBlocksSent;
+  uint32_t bulkBlocksResent;
+  uint32_t bulkBlocksReceived;
+  uint32_t bulkDuplicates;
+  uint32_t bulkResumeSkipped;
+  uint32_t bulkStateBytes;
+  uint32_t compressOffered;     // Messages offered to the text coder, retries included
+  uint32_t compressed;
+  uint32_t compressBytesIn;     // Of compressed messages, before
+  uint32_t compressBytesOut;    // and after
+};
+
+struct SimStation {
+  const char* name;
+  void (*setup)();
+  void (*loop)();
+  void (*counters)(SimStationCounters* out);
+};
+
+extern const SimStation simStationM1;
+extern const SimStation simStationM2;
+extern const SimStation simStationM3;
+extern const SimStation simStationM4;
+extern const SimStation simStationM5;
+extern const SimStation simStationM6;
+extern const SimStation simStationM7;
+extern const SimStation simStationM8;
+extern const SimStation simStationM9;
+extern const SimStation simStationM12;
+extern const SimStation simStationM13;
+
+#endif // SIM_H
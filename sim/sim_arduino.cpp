@@ -0,0 +1,242 @@
+// Arduino core, NVS and ESP-IDF odds and ends on virtual time
+#include <stdarg.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include <SPI.h>
+#include <Preferences.h>
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include <driver/gpio.h>
+#include "sim.h"
+
+HardwareSerial Serial;
+SPIClass SPI;
+EspClass ESP;
+
+unsigned long millis() {
+  return (uint32_t)(simNowUs() / 1000);
+}
+
+unsigned long micros() {
+  return (uint32_t)simNowUs();
+}
+
+void delay(uint32_t ms) {
+  vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+void delayMicroseconds(uint32_t us) {
+  simSpend(us);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  (void)pin;
+  (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  (void)pin;
+  (void)value;
+}
+
+// Light sleep is refused, so nobody samples DIO1 by hand
+int digitalRead(uint8_t pin) {
+  (void)pin;
+  return LOW;
+}
+
+uint32_t esp_random() {
+  return simRandom();
+}
+
+long random(long max) {
+  return max > 0 ? (long)(simRandom() % (uint32_t)max) : 0;
+}
+
+long random(long min, long max) {
+  return max > min ? min + random(max - min) : min;
+}
+
+void randomSeed(unsigned long seed) {
+  (void)seed;
+}
+
+uint32_t EspClass::getCycleCount() {
+  return (uint32_t)(simNowUs() * 240);
+}
+
+int64_t esp_timer_get_time() {
+  return (int64_t)simNowUs();
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t us) {
+  (void)us;
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_gpio_wakeup() {
+  return ESP_OK;
+}
+
+esp_err_t esp_light_sleep_start() {
+  return ESP_FAIL;
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() {
+  return ESP_SLEEP_WAKEUP_UNDEFINED;
+}
+
+esp_err_t gpio_wakeup_enable(gpio_num_t pin, gpio_int_type_t type) {
+  (void)pin;
+  (void)type;
+  return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_disable(gpio_num_t pin) {
+  (void)pin;
+  return ESP_OK;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t pin, gpio_int_type_t type) {
+  (void)pin;
+  (void)type;
+  return ESP_OK;
+}
+
+// ===== SERIAL =====
+static bool midLine[SIM_MAX_NODES + 1];     // Per node, and one for the driver
+
+size_t HardwareSerial::write(const uint8_t* data, size_t len) {
+  if (!simVerbose()) {
+    return len;
+  }
+  int node = simCurrentNode();
+  bool& started = midLine[(node >= 0 && node < SIM_MAX_NODES) ? node : SIM_MAX_NODES];
+  for (size_t i = 0; i < len; i++) {
+    if (!started) {
+      ::printf("[%11.6f %s] ", simNowUs() / 1e6, simNodeName(node));
+      started = true;
+    }
+    ::putchar(data[i]);
+    if (data[i] == '\n') {
+      started = false;
+    }
+  }
+  return len;
+}
+
+size_t HardwareSerial::print(const char* text) {
+  return write((const uint8_t*)text, strlen(text));
+}
+
+size_t HardwareSerial::println(const char* text) {
+  return print(text) + print("\n");
+}
+
+size_t HardwareSerial::printf(const char* format, ...) {
+  if (!simVerbose()) {
+    return 0;
+  }
+  char buf[1024];
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  if (n < 0) {
+    return 0;
+  }
+  return write((const uint8_t*)buf, (size_t)n < sizeof(buf) ? (size_t)n : sizeof(buf) - 1);
+}
+
+// ===== NVS =====
+static std::map<std::string, std::vector<uint8_t>> nvs[SIM_MAX_NODES];
+
+bool Preferences::begin(const char* name, bool ro) {
+  node = simCurrentNode();
+  if (node < 0 || node >= SIM_MAX_NODES) {
+    return false;
+  }
+  readOnly = ro;
+  snprintf(space, sizeof(space), "%s", name);
+  return true;
+}
+
+void Preferences::end() {
+  node = -1;
+}
+
+bool Preferences::clear() {
+  if (node < 0 || readOnly) {
+    return false;
+  }
+  std::string prefix = std::string(space) + "/";
+  auto& store = nvs[node];
+  for (auto it = store.begin(); it != store.end();) {
+    it = (it->first.compare(0, prefix.size(), prefix) == 0) ? store.erase(it) : std::next(it);
+  }
+  simSpend(SIM_NVS_WRITE_US);
+  return true;
+}
+
+bool Preferences::isKey(const char* key) {
+  return node >= 0 && nvs[node].count(std::string(space) + "/" + key) > 0;
+}
+
+size_t Preferences::put(const char* key, const void* value, size_t len) {
+  if (node < 0 || readOnly) {
+    return 0;
+  }
+  const uint8_t* p = (const uint8_t*)value;
+  nvs[node][std::string(space) + "/" + key].assign(p, p + len);
+  simSpend(SIM_NVS_WRITE_US);
+  return len;
+}
+
+size_t Preferences::get(const char* key, void* buf, size_t len) {
+  if (node < 0) {
+    return 0;
+  }
+  auto it = nvs[node].find(std::string(space) + "/" + key);
+  if (it == nvs[node].end() || it->second.size() > len) {
+    return 0;
+  }
+  memcpy(buf, it->second.data(), it->second.size());
+  return it->second.size();
+}
+
+uint8_t Preferences::getUChar(const char* key, uint8_t fallback) {
+  uint8_t v;
+  return get(key, &v, sizeof(v)) == sizeof(v) ? v : fallback;
+}
+
+size_t Preferences::putUChar(const char* key, uint8_t value) {
+  return put(key, &value, sizeof(value));
+}
+
+int8_t Preferences::getChar(const char* key, int8_t fallback) {
+  int8_t v;
+  return get(key, &v, sizeof(v)) == sizeof(v) ? v : fallback;
+}
+
+size_t Preferences::putChar(const char* key, int8_t value) {
+  return put(key, &value, sizeof(value));
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t fallback) {
+  uint32_t v;
+  return get(key, &v, sizeof(v)) == sizeof(v) ? v : fallback;
+}
+
+size_t Preferences::putUInt(const char* key, uint32_t value) {
+  return put(key, &value, sizeof(value));
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t len) {
+  return get(key, buf, len);
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+  return put(key, value, len);
+}
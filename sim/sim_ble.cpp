@@ -0,0 +1,498 @@
+// BLE GATT server mock and the simulated phones that talk to it
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include <BLEDevice.h>
+#include "sim.h"
+
+#define PHONE_TASK_PRIO       22        // The BLE host task
+#define PHONE_RECONNECT_US    2000000ULL
+#define RX_CHARACTERISTIC     "6E400002-B5A3-F393-E0A9-E50E24DCCA9E"
+
+// Phone-side framing, as in include/ble_segment.h and the app
+#define SEG_MARKER            0xF8
+#define SEG_MARKER_MASK       0xFC
+#define SEG_FIRST             0x01
+#define SEG_LAST              0x02
+#define RECEIPT_DELIVERED     0xFD
+#define RECEIPT_FAILED        0xFE
+#define BATCH_MARKER          0xFC
+#define BULK_MARKER           0xF7
+#define BULK_OFFER            0x01      // Bulk ops, as in include/lora_bulk.h
+#define BULK_BLOCK            0x02
+#define BULK_NEED             0x11
+#define BULK_SENT             0x13
+#define BULK_STALLED          0x14
+#define BULK_DATA             0x22
+#define BULK_NOTE_HEADER      10
+#define BULK_RETRY_US         5000000ULL    // Offer again after a stall, as the app does
+
+struct SimBle {
+  BLEServer* server;
+  uint16_t preferredMtu;
+};
+static SimBle ble[SIM_MAX_NODES];
+
+struct SentMessage {
+  uint64_t writeUs;
+  uint64_t deliverUs;       // 0 until the peer's phone has it
+  size_t len;
+  int receipt;              // 0 none, 1 delivered, -1 failed
+};
+
+struct SimPhone {
+  bool started;
+  int node;
+  int peer;
+  SimPhoneConfig cfg;
+  SimTask* task;
+  bool connected;
+  uint16_t msgNo;                         // Station numbers our writes from 1 per connection
+  std::map<uint16_t, uint32_t> numbered;  // Message number -> message id, this connection
+  std::vector<SentMessage> sent;          // By message id
+  std::vector<uint8_t> reassembly;
+  bool reassembling;
+  uint8_t expected;
+  uint32_t highestReceived;               // From the peer, +1
+  SimPhoneReport report;
+  std::vector<uint32_t> latencies;
+  uint64_t bulkOfferAt;                   // Next (re-)offer of our object, SIM_FOREVER if none due
+  bool bulkNeed;                          // Blocks the station asked for, not yet written
+  uint16_t bulkNeedFirst;
+  uint8_t bulkNeedCount;
+  uint8_t bulkBlockSize;
+  std::vector<bool> bulkArrived;          // Bytes of our object at the peer's phone
+};
+static SimPhone phones[SIM_MAX_NODES];
+
+// Message text for (sender, id): "#<id> " and words from a fixed list, so
+// the compressor gets realistic chat and the receiver can check it
+static const char* const WORDS[] = {
+  "the", "and", "you", "are", "on", "my", "way", "see", "at", "meet", "station", "north", "ridge",
+  "camp", "water", "ok", "copy", "back", "in", "ten", "minutes", "weather", "is", "clear", "wind",
+  "low", "battery", "good", "signal", "trail", "left", "right", "ahead", "wait", "for", "me"
+};
+
+static std::string messageText(int sender, uint32_t id, size_t len) {
+  std::string text = "#" + std::to_string(id) + " ";
+  uint32_t h = (uint32_t)sender * 0x9E3779B1u ^ id * 0x85EBCA6Bu;
+  while (text.size() < len) {
+    h = h * 1664525u + 1013904223u;
+    text += WORDS[(h >> 16) % (sizeof(WORDS) / sizeof(WORDS[0]))];
+    text += ' ';
+  }
+  text.resize(len);
+  return text;
+}
+
+// Byte at offset of the bulk object node sends
+static uint8_t bulkByte(int node, uint32_t offset) {
+  uint32_t h = (offset + 1) * 0x9E3779B1u ^ (uint32_t)node * 0x85EBCA6Bu;
+  return (uint8_t)(h >> 13);
+}
+
+static uint32_t bulkObjectId(int node) {
+  return 0xB0000000u | (uint32_t)node;
+}
+
+static uint32_t get32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+// ===== GATT SERVER =====
+BLECharacteristic* BLEService::createCharacteristic(const char* uuid, uint32_t properties) {
+  BLECharacteristic* c = new BLECharacteristic(node, uuid, properties);
+  characteristics.push_back(c);
+  return c;
+}
+
+BLECharacteristic* BLEService::getCharacteristic(const char* uuid) {
+  for (BLECharacteristic* c : characteristics) {
+    if (c->getUUID() == uuid) {
+      return c;
+    }
+  }
+  return NULL;
+}
+
+BLEService* BLEServer::createService(const char* uuid) {
+  (void)uuid;
+  service = new BLEService(node);
+  return service;
+}
+
+uint32_t BLEServer::getConnectedCount() {
+  return phones[node].connected ? 1 : 0;
+}
+
+uint16_t BLEServer::getPeerMTU(uint16_t connId) {
+  (void)connId;
+  return phones[node].cfg.mtu;
+}
+
+void BLEDevice::init(const char* name) {
+  (void)name;
+}
+
+BLEServer* BLEDevice::createServer() {
+  int node = simCurrentNode();
+  ble[node].server = new BLEServer(node);
+  return ble[node].server;
+}
+
+int BLEDevice::setMTU(uint16_t mtu) {
+  ble[simCurrentNode()].preferredMtu = mtu;
+  return 0;
+}
+
+uint16_t BLEDevice::getMTU() {
+  return ble[simCurrentNode()].preferredMtu;
+}
+
+BLEAdvertising* BLEDevice::getAdvertising() {
+  BLEServer* server = ble[simCurrentNode()].server;
+  return server != NULL ? server->getAdvertising() : NULL;
+}
+
+// ===== PHONE: RECEIVING =====
+// Counted in the sender's report, which describes one direction
+static void phoneMessage(SimPhone& phone, const uint8_t* data, size_t len) {
+  SimPhone& sender = phones[phone.peer];
+  std::string text((const char*)data, len);
+  uint32_t id = 0;
+  if (len < 2 || text[0] != '#' || sscanf(text.c_str() + 1, "%u", &id) != 1 || id >= sender.sent.size()) {
+    sender.report.corrupt++;
+    return;
+  }
+  SentMessage& m = sender.sent[id];
+  if (text != messageText(phone.peer, id, m.len)) {
+    sender.report.corrupt++;
+    return;
+  }
+  if (m.deliverUs != 0) {
+    sender.report.duplicates++;
+    return;
+  }
+  m.deliverUs = simNowUs();
+  sender.report.delivered++;
+  sender.report.payloadBytes += len;
+  sender.report.lastDeliveryUs = m.deliverUs;
+  sender.latencies.push_back((uint32_t)(m.deliverUs - m.writeUs));
+  if (id + 1 < phone.highestReceived) {
+    sender.report.reordered++;
+  } else {
+    phone.highestReceived = id + 1;
+  }
+}
+
+static void phoneReceipt(SimPhone& phone, bool delivered, uint16_t msgNo) {
+  auto it = phone.numbered.find(msgNo);
+  if (it == phone.numbered.end()) {
+    phone.report.unknownReceipts++;
+    return;
+  }
+  phone.sent[it->second].receipt = delivered ? 1 : -1;
+  phone.numbered.erase(it);
+  if (delivered) {
+    phone.report.receiptsDelivered++;
+  } else {
+    phone.report.receiptsFailed++;
+  }
+}
+
+// A bulk note: requests for our own object, or the peer's coming in.
+// Blocks are counted in the sender's report, like messages.
+static void phoneBulkNote(SimPhone& phone, const uint8_t* data, size_t len) {
+  if (len < 6) {
+    return;
+  }
+  uint32_t id = get32(data + 2);
+  SimPhone& sender = phones[phone.peer];
+  bool ours = phone.cfg.bulkBytes > 0 && id == bulkObjectId(phone.node);
+  bool theirs = sender.cfg.bulkBytes > 0 && id == bulkObjectId(phone.peer);
+
+  if (ours && data[1] == BULK_NEED && len >= 10) {
+    phone.bulkBlockSize = data[6];
+    phone.bulkNeedFirst = (uint16_t)(data[7] | (data[8] << 8));
+    phone.bulkNeedCount = data[9];
+    phone.bulkNeed = true;
+    simWake(phone.task);
+  } else if (ours && data[1] == BULK_SENT && phone.report.bulkSentUs == 0) {
+    phone.report.bulkSentUs = simNowUs();
+  } else if (ours && data[1] == BULK_STALLED && phone.report.bulkSentUs == 0) {
+    phone.bulkNeed = false;
+    phone.bulkOfferAt = simNowUs() + BULK_RETRY_US;
+    simWake(phone.task);
+  } else if (theirs && data[1] == BULK_DATA && len >= BULK_NOTE_HEADER) {
+    uint32_t offset = get32(data + 6);
+    for (size_t k = BULK_NOTE_HEADER; k < len; k++, offset++) {
+      if (offset >= sender.cfg.bulkBytes || data[k] != bulkByte(phone.peer, offset)) {
+        sender.report.bulkCorrupt++;
+      } else if (!sender.bulkArrived[offset]) {
+        sender.bulkArrived[offset] = true;
+        sender.report.bulkDelivered++;
+      }
+    }
+    // Done with the last byte: COMPLETE only confirms it, and is not
+    // repeated if the phone was away when it came
+    if (sender.report.bulkDelivered == sender.cfg.bulkBytes && sender.report.bulkCompleteUs == 0) {
+      sender.report.bulkCompleteUs = simNowUs();
+    }
+  }
+}
+
+static void phoneNotification(SimPhone& phone, const uint8_t* data, size_t len) {
+  if (len == 0) {
+    return;
+  }
+  if (data[0] == BULK_MARKER) {
+    phoneBulkNote(phone, data, len);
+    return;
+  }
+  if (len == 3 && (data[0] == RECEIPT_DELIVERED || data[0] == RECEIPT_FAILED)) {
+    phoneReceipt(phone, data[0] == RECEIPT_DELIVERED, (uint16_t)(data[1] | (data[2] << 8)));
+    return;
+  }
+  if (data[0] == BATCH_MARKER) {
+    size_t i = 1;
+    while (i < len && i + 1 + data[i] <= len) {
+      phoneMessage(phone, data + i + 1, data[i]);
+      i += 1 + data[i];
+    }
+    return;
+  }
+  if ((data[0] & SEG_MARKER_MASK) == SEG_MARKER && len >= 2) {
+    if (data[0] & SEG_FIRST) {
+      phone.reassembly.clear();
+      phone.reassembling = true;
+      phone.expected = 0;
+    }
+    if (!phone.reassembling || data[1] != phone.expected) {
+      phone.reassembling = false;
+      phones[phone.peer].report.corrupt++;
+      return;
+    }
+    phone.reassembly.insert(phone.reassembly.end(), data + 2, data + len);
+    phone.expected++;
+    if (data[0] & SEG_LAST) {
+      phone.reassembling = false;
+      if (phone.reassembly[0] == BULK_MARKER) {
+        phoneBulkNote(phone, phone.reassembly.data(), phone.reassembly.size());
+      } else {
+        phoneMessage(phone, phone.reassembly.data(), phone.reassembly.size());
+      }
+    }
+    return;
+  }
+  phoneMessage(phone, data, len);
+}
+
+void BLECharacteristic::notify(bool isNotification) {
+  (void)isNotification;
+  SimPhone& phone = phones[node];
+  if ((properties & PROPERTY_NOTIFY) && phone.started && phone.connected) {
+    phoneNotification(phone, value.data(), value.size());
+  }
+}
+
+// ===== PHONE: CONNECTING AND WRITING =====
+static void connect(SimPhone& phone) {
+  BLEServer* server = ble[phone.node].server;
+  phone.connected = true;
+  phone.msgNo = 0;
+  phone.numbered.clear();
+  phone.reassembling = false;
+  phone.bulkNeed = false;
+  if (phone.report.bulkOffers > 0 && phone.report.bulkSentUs == 0) {
+    phone.bulkOfferAt = simNowUs();     // Resume where the receiver stands
+  }
+  server->getAdvertising()->stop();
+  esp_ble_gatts_cb_param_t param = {};
+  if (server->getCallbacks() != NULL) {
+    server->getCallbacks()->onConnect(server);
+    server->getCallbacks()->onConnect(server, &param);
+    param.mtu.mtu = phone.cfg.mtu;
+    server->getCallbacks()->onMtuChanged(server, &param);
+  }
+}
+
+static void disconnect(SimPhone& phone) {
+  BLEServer* server = ble[phone.node].server;
+  phone.connected = false;
+  if (server->getCallbacks() != NULL) {
+    server->getCallbacks()->onDisconnect(server);
+  }
+}
+
+// One GATT write; the host task is busy until the station's onWrite returns
+static void write(SimPhone& phone, const uint8_t* data, size_t len) {
+  BLEService* service = ble[phone.node].server->getService();
+  BLECharacteristic* rx = service != NULL ? service->getCharacteristic(RX_CHARACTERISTIC) : NULL;
+  if (rx == NULL) {
+    return;
+  }
+  rx->setValue(data, len);
+  if (rx->getCallbacks() != NULL) {
+    rx->getCallbacks()->onWrite(rx);
+  }
+  simSpend(phone.cfg.writeGapUs);
+}
+
+// One message, segmented like the app does it when it exceeds one write
+static void writeMessage(SimPhone& phone, const uint8_t* p, size_t len) {
+  size_t chunk = phone.cfg.mtu - 3;
+  if (len <= chunk) {
+    write(phone, p, len);
+    return;
+  }
+  uint8_t seg[520];
+  size_t offset = 0;
+  uint8_t index = 0;
+  while (offset < len) {
+    size_t take = std::min(len - offset, chunk - 2);
+    seg[0] = SEG_MARKER | (offset == 0 ? SEG_FIRST : 0) | (offset + take == len ? SEG_LAST : 0);
+    seg[1] = index++;
+    memcpy(seg + 2, p + offset, take);
+    write(phone, seg, take + 2);
+    offset += take;
+  }
+}
+
+static void offerBulk(SimPhone& phone) {
+  uint8_t offer[10] = { BULK_MARKER, BULK_OFFER };
+  put32(offer + 2, bulkObjectId(phone.node));
+  put32(offer + 6, phone.cfg.bulkBytes);
+  if (phone.report.bulkOffers++ == 0) {
+    phone.report.bulkStartUs = simNowUs();
+  }
+  phone.bulkOfferAt = SIM_FOREVER;
+  writeMessage(phone, offer, sizeof(offer));
+}
+
+// The blocks of the last NEED, in order
+static void writeBulkBlocks(SimPhone& phone) {
+  uint8_t block[8 + 255] = { BULK_MARKER, BULK_BLOCK };
+  put32(block + 2, bulkObjectId(phone.node));
+  uint16_t first = phone.bulkNeedFirst;
+  uint8_t count = phone.bulkNeedCount;
+  phone.bulkNeed = false;
+  for (uint16_t i = first; i < first + count && phone.connected; i++) {
+    uint32_t offset = (uint32_t)i * phone.bulkBlockSize;
+    if (offset >= phone.cfg.bulkBytes) {
+      break;
+    }
+    size_t len = std::min<size_t>(phone.cfg.bulkBytes - offset, phone.bulkBlockSize);
+    block[6] = (uint8_t)i;
+    block[7] = (uint8_t)(i >> 8);
+    for (size_t k = 0; k < len; k++) {
+      block[8 + k] = bulkByte(phone.node, offset + (uint32_t)k);
+    }
+    writeMessage(phone, block, 8 + len);
+  }
+}
+
+static void sendMessage(SimPhone& phone) {
+  uint32_t id = (uint32_t)phone.sent.size();
+  size_t span = phone.cfg.maxLen - phone.cfg.minLen;
+  size_t len = phone.cfg.minLen + (span > 0 ? simRandom() % (span + 1) : 0);
+  std::string text = messageText(phone.node, id, len);
+  SentMessage m = { simNowUs(), 0, len, 0 };
+  phone.sent.push_back(m);
+  if (phone.report.written++ == 0) {
+    phone.report.firstWriteUs = m.writeUs;
+  }
+
+  // Numbered before the write: a station that refuses it answers with a
+  // failed receipt from inside the last write
+  phone.msgNo = (uint16_t)(phone.msgNo + 1) ? (uint16_t)(phone.msgNo + 1) : 1;
+  phone.numbered[phone.msgNo] = id;
+
+  writeMessage(phone, (const uint8_t*)text.data(), len);
+}
+
+static uint64_t poissonGapUs(float ratePerSec) {
+  return 1 + (uint64_t)(-log(1.0 - simUniform()) / ratePerSec * 1e6);
+}
+
+static void phoneTaskMain(void* arg) {
+  SimPhone& phone = *(SimPhone*)arg;
+  uint64_t nextWrite = phone.cfg.startUs;
+  uint64_t nextDrop = phone.cfg.reconnectEveryUs ? phone.cfg.connectUs + phone.cfg.reconnectEveryUs : SIM_FOREVER;
+  simBlock(phone.cfg.connectUs - simNowUs());
+
+  for (;;) {
+    // Connect as soon as the station advertises
+    BLEServer* server = ble[phone.node].server;
+    if (!phone.connected) {
+      if (server != NULL && server->getAdvertising()->advertising) {
+        connect(phone);
+      } else {
+        simBlock(10000);
+        continue;
+      }
+    }
+    uint64_t now = simNowUs();
+    if (now >= nextDrop) {
+      disconnect(phone);
+      nextDrop = now + phone.cfg.reconnectEveryUs;
+      simBlock(PHONE_RECONNECT_US);
+      continue;
+    }
+    if (phone.bulkNeed) {
+      writeBulkBlocks(phone);
+      continue;
+    }
+    if (now >= phone.bulkOfferAt) {
+      offerBulk(phone);
+      continue;
+    }
+    if (phone.report.written < phone.cfg.count && now >= nextWrite) {
+      sendMessage(phone);
+      nextWrite += poissonGapUs(phone.cfg.ratePerSec);
+      continue;
+    }
+    uint64_t wake = std::min(nextDrop, phone.report.written < phone.cfg.count ? nextWrite : SIM_FOREVER);
+    wake = std::min(wake, phone.bulkOfferAt);
+    simBlock(wake == SIM_FOREVER ? SIM_FOREVER : wake - now);
+  }
+}
+
+void simPhoneStart(int node, int peerNode, const SimPhoneConfig& config) {
+  SimPhone& phone = phones[node];
+  phone.started = true;
+  phone.node = node;
+  phone.peer = peerNode;
+  phone.cfg = config;
+  if (phone.cfg.mtu < 23) {
+    phone.cfg.mtu = 23;
+  }
+  phone.bulkOfferAt = phone.cfg.bulkBytes > 0 ? phone.cfg.startUs : SIM_FOREVER;
+  phone.bulkArrived.assign(phone.cfg.bulkBytes, false);
+  phone.report.bulkBytes = phone.cfg.bulkBytes;
+  phone.task = simSpawn(node, "nimble_host", phoneTaskMain, &phone, PHONE_TASK_PRIO, 0);
+}
+
+SimPhoneReport simPhoneReport(int node) {
+  SimPhone& phone = phones[node];
+  SimPhoneReport r = phone.report;
+  r.falseReceipts = 0;
+  for (const SentMessage& m : phone.sent) {
+    if (m.receipt == 1 && m.deliverUs == 0) {
+      r.falseReceipts++;
+    }
+  }
+  std::sort(phone.latencies.begin(), phone.latencies.end());
+  r.latencyCount = phone.latencies.size();
+  r.latencyUs = phone.latencies.data();
+  return r;
+}
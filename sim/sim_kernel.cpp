@@ -0,0 +1,576 @@
+// Virtual-time scheduler and the FreeRTOS calls the firmware uses
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+#include <deque>
+#include <queue>
+#include <string>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+#include "sim.h"
+
+#define SIM_STACK_SIZE      (256 * 1024)
+#define SIM_SPIN_LIMIT      1000000     // Task switches without time moving
+#define SIM_MUTEX_WARN_US   10000000ULL // A mutex wait this long is reported
+#define TICK_US             1000ULL
+
+enum SimTaskState : uint8_t {
+  TASK_READY = 0,
+  TASK_BLOCKED,
+  TASK_DONE
+};
+
+struct SimTask {
+  ucontext_t ctx;
+  char* stack;
+  std::string name;
+  SimTaskFn fn;
+  void* arg;
+  int node;
+  int core;
+  int priority;
+  SimTaskState state;
+  bool woken;
+  bool sleeping;            // simSpend()/vTaskDelay(): wakes only on time
+  uint64_t wakeAt;
+  uint64_t readySeq;
+  uint32_t notify;
+};
+
+struct SimEvent {
+  uint64_t at;
+  uint64_t seq;
+  int node;
+  SimEventFn fn;
+  void* ctx;
+  uint64_t arg;
+  bool operator>(const SimEvent& o) const { return at != o.at ? at > o.at : seq > o.seq; }
+};
+
+static std::vector<SimTask*> tasks;
+static std::priority_queue<SimEvent, std::vector<SimEvent>, std::greater<SimEvent>> events;
+static ucontext_t schedulerCtx;
+static SimTask* running = NULL;
+static int eventNode = SIM_NO_NODE;
+static uint64_t now = 0;
+static uint64_t sequence = 0;
+static bool stopped = false;
+static uint64_t rngState = 0x9E3779B97F4A7C15ULL;
+static bool verbose = false;
+static const char* nodeNames[SIM_MAX_NODES] = {};
+
+static void fatal(const char* what) {
+  fprintf(stderr, "sim: %s (task %s, t=%.6f s)\n", what, running ? running->name.c_str() : "-", now / 1e6);
+  exit(2);
+}
+
+uint64_t simNowUs() {
+  return now;
+}
+
+int simCurrentNode() {
+  return running != NULL ? running->node : eventNode;
+}
+
+void simSetCurrentNode(int node) {
+  eventNode = node;
+}
+
+static void makeReady(SimTask* t) {
+  t->state = TASK_READY;
+  t->wakeAt = SIM_FOREVER;
+  t->readySeq = ++sequence;
+}
+
+static void trampoline() {
+  SimTask* t = running;
+  t->fn(t->arg);
+  // FreeRTOS tasks never return; treat it as the task deleting itself
+  t->state = TASK_DONE;
+  swapcontext(&t->ctx, &schedulerCtx);
+}
+
+SimTask* simSpawn(int node, const char* name, SimTaskFn fn, void* arg, int priority, int core) {
+  SimTask* t = new SimTask();
+  t->stack = (char*)malloc(SIM_STACK_SIZE);
+  t->name = std::string(node >= 0 && nodeNames[node] ? nodeNames[node] : "?") + "/" + name;
+  t->fn = fn;
+  t->arg = arg;
+  t->node = node;
+  t->core = core;
+  t->priority = priority;
+  t->woken = false;
+  t->sleeping = false;
+  t->notify = 0;
+  getcontext(&t->ctx);
+  t->ctx.uc_stack.ss_sp = t->stack;
+  t->ctx.uc_stack.ss_size = SIM_STACK_SIZE;
+  t->ctx.uc_link = NULL;
+  makecontext(&t->ctx, trampoline, 0);
+  makeReady(t);
+  tasks.push_back(t);
+  return t;
+}
+
+SimTask* simCurrentTask() {
+  return running;
+}
+
+const char* simTaskName(const SimTask* task) {
+  return task->name.c_str();
+}
+
+int simTaskCore(const SimTask* task) {
+  return task->core;
+}
+
+uint32_t* simNotifyCount(SimTask* task) {
+  return &task->notify;
+}
+
+static void switchToScheduler() {
+  SimTask* t = running;
+  swapcontext(&t->ctx, &schedulerCtx);
+}
+
+bool simBlock(uint64_t timeoutUs) {
+  if (running == NULL) {
+    fatal("blocking call outside a task");
+  }
+  if (timeoutUs == 0) {
+    return false;
+  }
+  SimTask* t = running;
+  t->state = TASK_BLOCKED;
+  t->woken = false;
+  t->wakeAt = (timeoutUs == SIM_FOREVER) ? SIM_FOREVER : now + timeoutUs;
+  switchToScheduler();
+  return t->woken;
+}
+
+void simWake(SimTask* task) {
+  if (task != NULL && task->state == TASK_BLOCKED && !task->sleeping) {
+    makeReady(task);
+    task->woken = true;
+  }
+}
+
+static void sleepUntil(uint64_t at) {
+  SimTask* t = running;
+  t->sleeping = true;
+  while (now < at) {
+    simBlock(at - now);
+  }
+  t->sleeping = false;
+}
+
+void simSpend(uint64_t us) {
+  if (running != NULL && us > 0) {
+    sleepUntil(now + us);
+  }
+}
+
+void simSchedule(uint64_t atUs, int node, SimEventFn fn, void* ctx, uint64_t arg) {
+  SimEvent e = { atUs < now ? now : atUs, ++sequence, node, fn, ctx, arg };
+  events.push(e);
+}
+
+static SimTask* pickReady() {
+  SimTask* best = NULL;
+  for (SimTask* t : tasks) {
+    if (t->state == TASK_READY &&
+        (best == NULL || t->priority > best->priority ||
+         (t->priority == best->priority && t->readySeq < best->readySeq))) {
+      best = t;
+    }
+  }
+  return best;
+}
+
+void simRun(uint64_t untilUs) {
+  stopped = false;
+  uint64_t spins = 0;
+  uint64_t spinTime = now;
+  while (!stopped) {
+    SimTask* t = pickReady();
+    if (t != NULL) {
+      if (now != spinTime) {
+        spinTime = now;
+        spins = 0;
+      } else if (++spins > SIM_SPIN_LIMIT) {
+        running = t;
+        fatal("tasks keep running without time moving on");
+      }
+      running = t;
+      swapcontext(&schedulerCtx, &t->ctx);
+      running = NULL;
+      continue;
+    }
+
+    // Everyone waits: move time to the next event or timeout
+    uint64_t next = events.empty() ? SIM_FOREVER : events.top().at;
+    for (SimTask* b : tasks) {
+      if (b->state == TASK_BLOCKED && b->wakeAt < next) {
+        next = b->wakeAt;
+      }
+    }
+    if (next > untilUs) {
+      now = untilUs;
+      return;
+    }
+    now = next;
+    while (!events.empty() && events.top().at <= now) {
+      SimEvent e = events.top();
+      events.pop();
+      eventNode = e.node;
+      e.fn(e.ctx, e.arg);
+      eventNode = SIM_NO_NODE;
+    }
+    for (SimTask* b : tasks) {
+      if (b->state == TASK_BLOCKED && b->wakeAt <= now) {
+        makeReady(b);
+      }
+    }
+  }
+}
+
+void simStop() {
+  stopped = true;
+}
+
+// splitmix64
+void simSeed(uint64_t seed) {
+  rngState = seed;
+}
+
+static uint64_t next64() {
+  uint64_t z = (rngState += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+uint32_t simRandom() {
+  return (uint32_t)(next64() >> 32);
+}
+
+double simUniform() {
+  return (next64() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void simSetVerbose(bool on) {
+  verbose = on;
+}
+
+bool simVerbose() {
+  return verbose;
+}
+
+void simSetNodeName(int node, const char* name) {
+  nodeNames[node] = name;
+}
+
+const char* simNodeName(int node) {
+  return (node >= 0 && node < SIM_MAX_NODES && nodeNames[node]) ? nodeNames[node] : "--";
+}
+
+// ===== TASKS =====
+static uint64_t ticksToUs(TickType_t ticks) {
+  return ticks == portMAX_DELAY ? SIM_FOREVER : ticks * TICK_US;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+  (void)stackDepth;
+  SimTask* t = simSpawn(simCurrentNode(), name, fn, arg, (int)priority, core == tskNO_AFFINITY ? 0 : core);
+  if (handle != NULL) {
+    *handle = t;
+  }
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* arg,
+                       UBaseType_t priority, TaskHandle_t* handle) {
+  return xTaskCreatePinnedToCore(fn, name, stackDepth, arg, priority, handle, tskNO_AFFINITY);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  return running;
+}
+
+void xTaskNotifyGive(TaskHandle_t task) {
+  task->notify++;
+  simWake(task);
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken) {
+  xTaskNotifyGive(task);
+  if (woken != NULL) {
+    *woken = pdTRUE;
+  }
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+  SimTask* t = running;
+  uint64_t timeout = ticksToUs(ticks);
+  uint64_t deadline = (timeout == SIM_FOREVER) ? SIM_FOREVER : now + timeout;
+  while (t->notify == 0 && now < deadline) {
+    simBlock(deadline == SIM_FOREVER ? SIM_FOREVER : deadline - now);
+  }
+  uint32_t value = t->notify;
+  if (value > 0) {
+    t->notify = clearOnExit ? 0 : value - 1;
+  }
+  return value;
+}
+
+void vTaskDelay(TickType_t ticks) {
+  if (ticks == 0) {
+    // Yield: behind every other ready task of the same priority
+    makeReady(running);
+    switchToScheduler();
+    return;
+  }
+  sleepUntil(now + ticks * TICK_US);
+}
+
+TickType_t xTaskGetTickCount() {
+  return (TickType_t)(now / TICK_US);
+}
+
+BaseType_t xPortGetCoreID() {
+  return running != NULL ? running->core : 0;
+}
+
+// ===== MUTEXES =====
+struct SimMutex {
+  SimTask* owner;
+  std::deque<SimTask*> waiters;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  return new SimMutex();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks) {
+  SimTask* t = running;
+  if (mutex->owner == NULL) {
+    mutex->owner = t;
+    return pdTRUE;
+  }
+  if (mutex->owner == t) {
+    fatal("task takes a mutex it already holds");
+  }
+  uint64_t timeout = ticksToUs(ticks);
+  if (timeout == 0) {
+    return pdFALSE;
+  }
+  uint64_t start = now;
+  uint64_t deadline = (timeout == SIM_FOREVER) ? SIM_FOREVER : now + timeout;
+  bool warned = false;
+  mutex->waiters.push_back(t);
+  while (mutex->owner != t) {
+    if (now >= deadline) {
+      for (size_t i = 0; i < mutex->waiters.size(); i++) {
+        if (mutex->waiters[i] == t) {
+          mutex->waiters.erase(mutex->waiters.begin() + i);
+          break;
+        }
+      }
+      return pdFALSE;
+    }
+    if (!warned && now - start >= SIM_MUTEX_WARN_US) {
+      fprintf(stderr, "sim: %s waits %.1f s for a mutex held by %s\n", t->name.c_str(),
+              (now - start) / 1e6, mutex->owner ? mutex->owner->name.c_str() : "-");
+      warned = true;
+    }
+    uint64_t wait = (deadline == SIM_FOREVER) ? SIM_MUTEX_WARN_US : deadline - now;
+    simBlock(wait);
+  }
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex) {
+  if (mutex->owner != running) {
+    fatal("mutex given by a task that does not hold it");
+  }
+  if (mutex->waiters.empty()) {
+    mutex->owner = NULL;
+  } else {
+    mutex->owner = mutex->waiters.front();
+    mutex->waiters.pop_front();
+    simWake(mutex->owner);
+  }
+  return pdTRUE;
+}
+
+// ===== QUEUES =====
+struct SimQueue {
+  size_t length;
+  size_t itemSize;
+  std::deque<std::vector<uint8_t>> items;
+  std::vector<SimTask*> waiting;
+};
+
+static void wakeWaiting(SimQueue* q) {
+  for (SimTask* t : q->waiting) {
+    simWake(t);
+  }
+  q->waiting.clear();
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  SimQueue* q = new SimQueue();
+  q->length = length;
+  q->itemSize = itemSize;
+  return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t ticks) {
+  uint64_t timeout = ticksToUs(ticks);
+  uint64_t deadline = (timeout == SIM_FOREVER) ? SIM_FOREVER : now + timeout;
+  while (q->items.size() >= q->length) {
+    if (running == NULL || now >= deadline) {
+      return pdFALSE;
+    }
+    q->waiting.push_back(running);
+    simBlock(deadline == SIM_FOREVER ? SIM_FOREVER : deadline - now);
+  }
+  const uint8_t* p = (const uint8_t*)item;
+  q->items.push_back(std::vector<uint8_t>(p, p + q->itemSize));
+  wakeWaiting(q);
+  return pdTRUE;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void* item, BaseType_t* woken) {
+  if (woken != NULL) {
+    *woken = pdFALSE;
+  }
+  return xQueueSend(q, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t ticks) {
+  uint64_t timeout = ticksToUs(ticks);
+  uint64_t deadline = (timeout == SIM_FOREVER) ? SIM_FOREVER : now + timeout;
+  while (q->items.empty()) {
+    if (running == NULL || now >= deadline) {
+      return pdFALSE;
+    }
+    q->waiting.push_back(running);
+    simBlock(deadline == SIM_FOREVER ? SIM_FOREVER : deadline - now);
+  }
+  memcpy(item, q->items.front().data(), q->itemSize);
+  q->items.pop_front();
+  wakeWaiting(q);
+  return pdTRUE;
+}
+
+// Non-blocking only: the firmware peeks with a zero timeout
+BaseType_t xQueuePeek(QueueHandle_t q, void* item, TickType_t ticks) {
+  (void)ticks;
+  if (q->items.empty()) {
+    return pdFALSE;
+  }
+  memcpy(item, q->items.front().data(), q->itemSize);
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+  return (UBaseType_t)q->items.size();
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q) {
+  return (UBaseType_t)(q->length - q->items.size());
+}
+
+// ===== SOFTWARE TIMERS =====
+#define TIMER_TASK_PRIO 1
+
+struct SimTimer {
+  int node;
+  uint64_t periodUs;
+  bool autoReload;
+  bool active;
+  uint64_t expiry;
+  void* id;
+  TimerCallbackFunction_t callback;
+};
+
+static std::vector<SimTimer*> timers;
+static SimTask* timerTask[SIM_MAX_NODES] = {};
+
+static void timerTaskMain(void* arg) {
+  int node = (int)(intptr_t)arg;
+  for (;;) {
+    SimTimer* due = NULL;
+    for (SimTimer* tm : timers) {
+      if (tm->node == node && tm->active && (due == NULL || tm->expiry < due->expiry)) {
+        due = tm;
+      }
+    }
+    if (due == NULL) {
+      simBlock(SIM_FOREVER);
+    } else if (due->expiry > now) {
+      simBlock(due->expiry - now);
+    } else {
+      due->active = due->autoReload;
+      due->expiry += due->periodUs;
+      due->callback(due);
+    }
+  }
+}
+
+TimerHandle_t xTimerCreate(const char* name, TickType_t period, UBaseType_t autoReload, void* id,
+                           TimerCallbackFunction_t callback) {
+  int node = simCurrentNode();
+  if (node < 0 || node >= SIM_MAX_NODES) {
+    fatal("timer created outside a station");
+  }
+  if (timerTask[node] == NULL) {
+    timerTask[node] = simSpawn(node, "Tmr Svc", timerTaskMain, (void*)(intptr_t)node, TIMER_TASK_PRIO, 0);
+  }
+  (void)name;
+  SimTimer* tm = new SimTimer();
+  tm->node = node;
+  tm->periodUs = ticksToUs(period);
+  tm->autoReload = autoReload != pdFALSE;
+  tm->active = false;
+  tm->expiry = 0;
+  tm->id = id;
+  tm->callback = callback;
+  timers.push_back(tm);
+  return tm;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticks) {
+  (void)ticks;
+  timer->active = true;
+  timer->expiry = now + timer->periodUs;
+  simWake(timerTask[timer->node]);
+  return pdPASS;
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticks) {
+  (void)ticks;
+  timer->active = false;
+  simWake(timerTask[timer->node]);
+  return pdPASS;
+}
+
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticks) {
+  return xTimerStart(timer, ticks);
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t ticks) {
+  timer->periodUs = ticksToUs(period);
+  return xTimerStart(timer, ticks);
+}
+
+void* pvTimerGetTimerID(TimerHandle_t timer) {
+  return timer->id;
+}
@@ -0,0 +1,347 @@
+// Benchmark driver: two stations, a phone on each, a channel between them
+// and optionally relays in a line from one to the other, or more pairs of
+// stations on the same air
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+
+#define NODE_M1               0
+#define NODE_M2               1
+#define NODE_INTERFERER       2
+#define NODE_RELAY            3         // First of the relays, M3 on
+#define MAX_RELAYS            3         // MESH_DEFAULT_TTL
+#define NODE_PAIRS            6         // First of the stations after M1-M2, M6 on
+#define MAX_STATIONS          8         // With a phone: M1-M2 and three more pairs
+#define LOOP_TASK_PRIO        1         // Arduino's loopTask
+#define LOOP_TASK_CORE        1
+#define MAX_DURATION_S        4000      // micros() wraps at 2^32 us
+#define DRAIN_US              10000000ULL   // After the last write, for retransmissions and receipts
+
+struct Options {
+  float rate = 1.0f;
+  uint32_t count = 200;
+  size_t minLen = 20;
+  size_t maxLen = 80;
+  float loss = 5.0f;
+  float snr = 5.0f;
+  uint16_t mtu = 185;
+  uint64_t seed = 1;
+  uint32_t duration = 600;
+  float interference = 0.0f;
+  uint32_t reconnect = 0;
+  uint32_t relays = 0;
+  uint32_t stations = 2;
+  uint32_t bulk = 0;
+  bool oneWay = false;
+  bool verbose = false;
+  bool check = false;
+};
+
+static void usage() {
+  printf("usage: program [options]\n"
+         "  --rate=N          messages per second from each phone (1)\n"
+         "  --count=N         messages per phone (200)\n"
+         "  --size=MIN[:MAX]  message length in bytes (20:80)\n"
+         "  --loss=PCT        random frame loss each way (5)\n"
+         "  --snr=DB          link SNR at 14 dBm, 125 kHz (5)\n"
+         "  --mtu=N           ATT MTU the phones negotiate (185)\n"
+         "  --seed=N          random seed (1)\n"
+         "  --duration=S      virtual seconds to run at most (600, max %d)\n"
+         "  --interference=N  foreign frames per second on the air (0)\n"
+         "  --reconnect=S     phones drop and reconnect every S seconds (never)\n"
+         "  --relays=N        relays M3... in a line between M1 and M2, each hearing only its\n"
+         "                    neighbours (0, max %d; build with -DLORA_CHANNEL_COUNT=1)\n"
+         "  --stations=N      stations whose phones write, in pairs M1-M2, M6-M7, M8-M9, M12-M13,\n"
+         "                    all hearing each other (2, max %d; not with --relays)\n"
+         "  --bulk=BYTES      M1's phone also sends one bulk object of BYTES to M2 (none)\n"
+         "  --oneway          only the first phone of each pair writes\n"
+         "  --verbose         station serial output with virtual timestamps\n"
+         "  --check           exit 1 unless every message arrived once and intact (in any order)\n",
+         MAX_DURATION_S, MAX_RELAYS, MAX_STATIONS);
+}
+
+static bool parse(int argc, char** argv, Options& o) {
+  static const struct option longOptions[] = {
+    { "rate", required_argument, NULL, 'r' },
+    { "count", required_argument, NULL, 'n' },
+    { "size", required_argument, NULL, 's' },
+    { "loss", required_argument, NULL, 'l' },
+    { "snr", required_argument, NULL, 'q' },
+    { "mtu", required_argument, NULL, 'm' },
+    { "seed", required_argument, NULL, 'S' },
+    { "duration", required_argument, NULL, 'd' },
+    { "interference", required_argument, NULL, 'i' },
+    { "reconnect", required_argument, NULL, 'R' },
+    { "relays", required_argument, NULL, 'N' },
+    { "stations", required_argument, NULL, 'P' },
+    { "bulk", required_argument, NULL, 'B' },
+    { "oneway", no_argument, NULL, 'o' },
+    { "verbose", no_argument, NULL, 'v' },
+    { "check", no_argument, NULL, 'c' },
+    { "help", no_argument, NULL, 'h' },
+    { NULL, 0, NULL, 0 }
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "h", longOptions, NULL)) != -1) {
+    switch (c) {
+      case 'r': o.rate = strtof(optarg, NULL); break;
+      case 'n': o.count = strtoul(optarg, NULL, 0); break;
+      case 's': {
+        char* end;
+        o.minLen = strtoul(optarg, &end, 0);
+        o.maxLen = *end == ':' ? strtoul(end + 1, NULL, 0) : o.minLen;
+        break;
+      }
+      case 'l': o.loss = strtof(optarg, NULL); break;
+      case 'q': o.snr = strtof(optarg, NULL); break;
+      case 'm': o.mtu = (uint16_t)strtoul(optarg, NULL, 0); break;
+      case 'S': o.seed = strtoull(optarg, NULL, 0); break;
+      case 'd': o.duration = strtoul(optarg, NULL, 0); break;
+      case 'i': o.interference = strtof(optarg, NULL); break;
+      case 'R': o.reconnect = strtoul(optarg, NULL, 0); break;
+      case 'N': o.relays = strtoul(optarg, NULL, 0); break;
+      case 'P': o.stations = strtoul(optarg, NULL, 0); break;
+      case 'B': o.bulk = strtoul(optarg, NULL, 0); break;
+      case 'o': o.oneWay = true; break;
+      case 'v': o.verbose = true; break;
+      case 'c': o.check = true; break;
+      default: usage(); return false;
+    }
+  }
+  if (o.rate <= 0 || o.minLen < 8 || o.maxLen < o.minLen || o.maxLen > 1024 || o.duration == 0 ||
+      o.duration > MAX_DURATION_S || o.mtu > 517 || o.relays > MAX_RELAYS ||
+      o.stations < 2 || o.stations > MAX_STATIONS || (o.relays > 0 && o.stations > 2)) {
+    fprintf(stderr, "sim: bad option value\n");
+    return false;
+  }
+  return true;
+}
+
+static void stationTask(void* arg) {
+  const SimStation* station = (const SimStation*)arg;
+  station->setup();
+  for (;;) {
+    station->loop();
+  }
+}
+
+static uint32_t percentile(const SimPhoneReport& r, unsigned pct) {
+  if (r.latencyCount == 0) {
+    return 0;
+  }
+  size_t i = (r.latencyCount * pct + 99) / 100;
+  return r.latencyUs[i > 0 ? i - 1 : 0];
+}
+
+static bool settled(const SimPhoneReport& r, uint32_t count) {
+  return r.written >= count && r.receiptsDelivered + r.receiptsFailed >= r.written &&
+         (r.bulkBytes == 0 || (r.bulkSentUs != 0 && r.bulkCompleteUs != 0));
+}
+
+static void printDirection(const char* name, const SimPhoneReport& r) {
+  uint64_t spanUs = r.lastDeliveryUs > r.firstWriteUs ? r.lastDeliveryUs - r.firstWriteUs : 0;
+  printf("%s: written %u, delivered %u (%.1f%%), lost %u, duplicates %u, corrupt %u, reordered %u\n", name,
+         (unsigned)r.written, (unsigned)r.delivered, r.written ? 100.0 * r.delivered / r.written : 0.0,
+         (unsigned)(r.written - r.delivered), (unsigned)r.duplicates, (unsigned)r.corrupt,
+         (unsigned)r.reordered);
+  printf("  receipts: delivered %u, failed %u, false \"delivered\" %u, unknown %u\n",
+         (unsigned)r.receiptsDelivered, (unsigned)r.receiptsFailed, (unsigned)r.falseReceipts,
+         (unsigned)r.unknownReceipts);
+  printf("  throughput %.2f msgs/s, %.1f payload B/s; latency p50 %.0f p90 %.0f p99 %.0f max %.0f ms\n",
+         spanUs ? r.delivered * 1e6 / spanUs : 0.0, spanUs ? r.payloadBytes * 1e6 / spanUs : 0.0,
+         percentile(r, 50) / 1e3, percentile(r, 90) / 1e3, percentile(r, 99) / 1e3,
+         r.latencyCount ? r.latencyUs[r.latencyCount - 1] / 1e3 : 0.0);
+  if (r.bulkBytes > 0) {
+    uint64_t doneUs = r.bulkCompleteUs > r.bulkStartUs ? r.bulkCompleteUs - r.bulkStartUs : 0;
+    printf("  bulk: %u bytes, delivered %.1f%%, corrupt %u, offers %u, %.1f B/s, done in %.1f s\n",
+           (unsigned)r.bulkBytes, 100.0 * r.bulkDelivered / r.bulkBytes, (unsigned)r.bulkCorrupt,
+           (unsigned)r.bulkOffers, doneUs ? r.bulkBytes * 1e6 / doneUs : 0.0, doneUs / 1e6);
+  }
+}
+
+static void printStation(const SimStation& s, int node) {
+  SimStationCounters c = {};
+  s.counters(&c);
+  const SimRadioStats& rs = simRadioStats(node);
+  printf("%s: frames queued %u sent %u received %u, CRC errors %u, CAD busy %u/%u, backoffs %u, duty shed %u passed %u\n",
+         s.name, (unsigned)c.framesQueued, (unsigned)c.framesSent, (unsigned)c.framesReceived,
+         (unsigned)c.crcErrors, (unsigned)c.cadBusy, (unsigned)rs.cadScans, (unsigned)c.backoffs,
+         (unsigned)c.dutyShed, (unsigned)c.dutyBypassed);
+  printf("  ARQ sent %u retx %u acked %u failed %u, duplicates %u, pool failures %u, profile switches %u, ring drops %u\n",
+         (unsigned)c.arqTransmissions, (unsigned)c.arqRetransmissions, (unsigned)c.arqAcked,
+         (unsigned)c.arqFailed, (unsigned)c.duplicates, (unsigned)c.poolFailures, (unsigned)c.profileSwitches,
+         (unsigned)c.ringDrops);
+  printf("  channel: %.1f s on air, %llu bytes; heard %u, collisions %u, missed %u, cut %u, lost %u\n", rs.airUs / 1e6,
+         (unsigned long long)rs.airBytes, (unsigned)rs.received, (unsigned)rs.collisions, (unsigned)rs.missed, (unsigned)rs.cut,
+         (unsigned)rs.lost);
+  if (c.bulkBlocksSent + c.bulkBlocksReceived > 0) {
+    printf("  bulk blocks sent %u resent %u received %u duplicate %u, skipped on resume %u, state %u bytes\n",
+           (unsigned)c.bulkBlocksSent, (unsigned)c.bulkBlocksResent, (unsigned)c.bulkBlocksReceived,
+           (unsigned)c.bulkDuplicates, (unsigned)c.bulkResumeSkipped, (unsigned)c.bulkStateBytes);
+  }
+}
+
+static const SimStation* const relayStations[MAX_RELAYS] = { &simStationM3, &simStationM4, &simStationM5 };
+
+// Stations with a phone, in pairs that are each other's peer. The IDs
+// after M1-M2 are picked so that with 8 channels every station has a home
+// channel of its own (lora_channels.h).
+struct Endpoint {
+  int node;
+  const SimStation* station;
+};
+static const Endpoint endpoints[MAX_STATIONS] = {
+  { NODE_M1, &simStationM1 }, { NODE_M2, &simStationM2 }, { NODE_PAIRS, &simStationM6 },
+  { NODE_PAIRS + 1, &simStationM7 }, { NODE_PAIRS + 2, &simStationM8 }, { NODE_PAIRS + 3, &simStationM9 },
+  { NODE_PAIRS + 4, &simStationM12 }, { NODE_PAIRS + 5, &simStationM13 }
+};
+
+int main(int argc, char** argv) {
+  Options o;
+  if (!parse(argc, argv, o)) {
+    return 2;
+  }
+  simSeed(o.seed);
+  simSetVerbose(o.verbose);
+  simSetNodeName(NODE_INTERFERER, "IF");
+
+  // The line M1, M3, ..., M2, each hop with the link options and anything
+  // further apart out of range; or the pairs, every station hearing every
+  // other. The interferer is a little beyond every station.
+  uint32_t endpointCount = (o.stations + 1) & ~1u;
+  int line[MAX_RELAYS + MAX_STATIONS];
+  const SimStation* stations[MAX_RELAYS + MAX_STATIONS];
+  int nodes = 0;
+  for (uint32_t i = 0; i < endpointCount; i++) {
+    line[nodes] = endpoints[i].node;
+    stations[nodes++] = endpoints[i].station;
+  }
+  for (uint32_t i = 0; i < o.relays; i++) {
+    line[nodes] = line[nodes - 1];
+    stations[nodes] = stations[nodes - 1];
+    line[nodes - 1] = NODE_RELAY + i;
+    stations[nodes++ - 1] = relayStations[i];
+  }
+  SimLink link = { o.loss, o.snr, -100.0f - (10.0f - o.snr) };
+  SimLink beyond = { 100.0f, -30.0f, -140.0f };
+  SimLink far = { 0.0f, o.snr - 3.0f, link.rssiDbm - 3.0f };
+  for (int i = 0; i < nodes; i++) {
+    for (int j = 0; j < nodes; j++) {
+      if (i != j) {
+        simChannelSetLink(line[i], line[j], (o.relays == 0 || i == j + 1 || j == i + 1) ? link : beyond);
+      }
+    }
+    simChannelSetLink(NODE_INTERFERER, line[i], far);
+    simSetNodeName(line[i], stations[i]->name);
+    simSpawn(line[i], "loopTask", stationTask, (void*)stations[i], LOOP_TASK_PRIO, LOOP_TASK_CORE);
+  }
+
+  // With an odd --stations the last one's peer writes nothing
+  SimPhoneConfig phone = {};
+  phone.mtu = o.mtu;
+  phone.ratePerSec = o.rate;
+  phone.minLen = o.minLen;
+  phone.maxLen = o.maxLen;
+  phone.connectUs = 2000000;
+  phone.startUs = 5000000;
+  phone.writeGapUs = 7500;              // One write per 7.5 ms connection event
+  phone.reconnectEveryUs = o.reconnect * 1000000ULL;
+  uint32_t counts[MAX_STATIONS] = {};
+  for (uint32_t i = 0; i < endpointCount; i++) {
+    counts[i] = (i < o.stations && (i % 2 == 0 || !o.oneWay)) ? o.count : 0;
+    phone.count = counts[i];
+    phone.bulkBytes = i == 0 ? o.bulk : 0;
+    simPhoneStart(endpoints[i].node, endpoints[i ^ 1].node, phone);
+  }
+  if (o.interference > 0) {
+    simInterfererStart(NODE_INTERFERER, o.interference, 24);
+  }
+
+  // Until every phone has a receipt for everything it wrote, then a
+  // little longer for stragglers
+  uint64_t endUs = o.duration * 1000000ULL;
+  uint64_t t = 0;
+  while (t < endUs) {
+    t += 1000000;
+    simRun(t);
+    bool done = true;
+    for (uint32_t i = 0; i < endpointCount; i++) {
+      done = done && settled(simPhoneReport(endpoints[i].node), counts[i]);
+    }
+    if (done) {
+      simRun(t + DRAIN_US < endUs ? t + DRAIN_US : endUs);
+      break;
+    }
+  }
+  uint64_t elapsedUs = simNowUs();
+
+  printf("\n=== %.1f s simulated, seed %llu: %.2f msgs/s per phone, %u-%u bytes, loss %.1f%%, SNR %.1f dB, MTU %u, "
+         "%u relays ===\n", elapsedUs / 1e6, (unsigned long long)o.seed, o.rate, (unsigned)o.minLen, (unsigned)o.maxLen,
+         o.loss, o.snr, (unsigned)o.mtu, (unsigned)o.relays);
+  SimPhoneReport reports[MAX_STATIONS];
+  SimPhoneReport all = {};
+  uint64_t payload = 0;
+  for (uint32_t i = 0; i < endpointCount; i++) {
+    SimPhoneReport& r = reports[i];
+    r = simPhoneReport(endpoints[i].node);
+    if (i == 0 || counts[i] > 0) {
+      char name[16];
+      snprintf(name, sizeof(name), "%s -> %s", endpoints[i].station->name, endpoints[i ^ 1].station->name);
+      printDirection(name, r);
+    }
+    all.written += r.written;
+    all.delivered += r.delivered;
+    all.payloadBytes += r.payloadBytes;
+    if (r.written > 0 && (all.firstWriteUs == 0 || r.firstWriteUs < all.firstWriteUs)) {
+      all.firstWriteUs = r.firstWriteUs;
+    }
+    all.lastDeliveryUs = r.lastDeliveryUs > all.lastDeliveryUs ? r.lastDeliveryUs : all.lastDeliveryUs;
+    // Delivered text as it went on air, at the sender's compression ratio.
+    // A message ARQ had no room for is offered again, so the coder's
+    // totals only give ratios.
+    SimStationCounters c = {};
+    endpoints[i].station->counters(&c);
+    double sent = 1.0;
+    if (c.compressOffered > 0 && c.compressBytesIn > 0) {
+      sent -= (double)c.compressed / c.compressOffered * (1.0 - (double)c.compressBytesOut / c.compressBytesIn);
+    }
+    payload += (uint64_t)(r.payloadBytes * sent) + r.bulkDelivered;
+  }
+
+  // Every station's transmissions, the relays' included
+  uint64_t airUs = 0;
+  uint64_t airBytes = 0;
+  uint32_t collisions = 0;
+  for (int i = 0; i < nodes; i++) {
+    airUs += simRadioStats(line[i]).airUs;
+    airBytes += simRadioStats(line[i]).airBytes;
+    collisions += simRadioStats(line[i]).collisions;
+  }
+  uint64_t spanUs = all.lastDeliveryUs > all.firstWriteUs ? all.lastDeliveryUs - all.firstWriteUs : 0;
+  printf("All stations: written %u, delivered %u (%.1f%%), %.2f msgs/s, %.1f payload B/s, collisions %u\n",
+         (unsigned)all.written, (unsigned)all.delivered, all.written ? 100.0 * all.delivered / all.written : 0.0,
+         spanUs ? all.delivered * 1e6 / spanUs : 0.0, spanUs ? all.payloadBytes * 1e6 / spanUs : 0.0,
+         (unsigned)collisions);
+  printf("Airtime: efficiency %.1f%% (payload / bytes on air), %.0f ms per delivered message, channel busy %.1f%%\n",
+         airBytes ? 100.0 * payload / airBytes : 0.0, all.delivered ? airUs / 1e3 / all.delivered : 0.0,
+         elapsedUs ? 100.0 * airUs / elapsedUs : 0.0);
+  for (int i = 0; i < nodes; i++) {
+    printStation(*stations[i], line[i]);
+  }
+
+  // Receipts that lie are a bug at any loss rate; the rest only with
+  // --check. Reordering is reported but allowed: ARQ delivers unordered.
+  bool ok = true;
+  for (uint32_t i = 0; i < endpointCount; i++) {
+    const SimPhoneReport& r = reports[i];
+    ok = ok && r.falseReceipts == 0 && r.corrupt == 0 && r.bulkCorrupt == 0;
+    if (o.check) {
+      ok = ok && r.delivered == r.written && r.duplicates == 0 && r.bulkDelivered == r.bulkBytes &&
+           (r.bulkBytes == 0 || r.bulkCompleteUs != 0);
+    }
+  }
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
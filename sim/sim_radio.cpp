@@ -0,0 +1,489 @@
+// Simulated LoRa channel and the SX1262 on top of it
+#include <math.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+#include <RadioLib.h>
+#include "sim.h"
+
+#define SIM_REF_POWER_DBM   14      // SimLink SNR/RSSI are for this TX power at 125 kHz
+#define SIM_CAPTURE_DB      6       // A frame this much stronger survives an overlap
+#define SIM_LOCK_SYMBOLS    4       // Preamble symbols a receiver needs to sync
+#define SIM_CAD_SYMBOLS     2
+#define SIM_SNR_NOISE_DB    1.0f
+
+enum SimRadioMode : uint8_t {
+  MODE_SLEEP = 0,
+  MODE_STANDBY,
+  MODE_RX,
+  MODE_TX,
+  MODE_CAD
+};
+
+struct SimTransmission {
+  uint32_t id;
+  int node;
+  float mhz;
+  float bwKHz;
+  uint8_t sf;
+  int8_t powerDbm;
+  uint64_t start;
+  uint64_t end;
+  uint64_t lockDeadline;    // Last moment a receiver can still catch the preamble
+  uint64_t detectAt;        // Receivers synced to it flag a preamble from here
+  uint64_t headerEnd;       // ... and a valid header from here
+  std::vector<uint8_t> data;
+};
+
+struct SimRadio {
+  int node;
+  bool bound;
+  float mhz;
+  float bwKHz;
+  uint8_t sf;
+  uint8_t cr;
+  int8_t powerDbm;
+  uint16_t preamble;
+  SimRadioMode mode;
+  uint32_t op;              // Changes with every mode change; stale events see it
+  void (*dio1)(void);
+
+  uint32_t locked;          // Transmission being received, 0 = none
+  bool corrupted;
+  uint64_t cadStart;
+
+  // Last completed reception, for readData()
+  std::vector<uint8_t> rx;
+  bool rxCrcError;
+  float rxRssi;
+  float rxSnr;
+  int16_t cadResult;
+};
+
+static SimRadio radios[SIM_MAX_NODES];
+static SimRadioStats radioStats[SIM_MAX_NODES];
+static SimLink links[SIM_MAX_NODES][SIM_MAX_NODES];
+static bool linkSet[SIM_MAX_NODES][SIM_MAX_NODES];
+static std::deque<SimTransmission> onAir;
+static uint32_t nextTxId = 1;
+
+static const SimLink DEFAULT_LINK = { 0.0f, 10.0f, -80.0f };
+
+uint32_t simTimeOnAirUs(uint8_t sf, float bwKHz, uint8_t cr, uint16_t preamble, size_t len) {
+  double symbolUs = (double)(1UL << sf) * 1000.0 / bwKHz;
+  bool lowDataRate = symbolUs >= 16000.0;
+  int num = 8 * (int)len - 4 * sf + 28 + 16;
+  int den = 4 * (sf - (lowDataRate ? 2 : 0));
+  int blocks = num > 0 ? (num + den - 1) / den : 0;
+  double symbols = preamble + 4.25 + 8 + blocks * cr;
+  return (uint32_t)(symbols * symbolUs);
+}
+
+static double symbolUs(const SimRadio& r) {
+  return (double)(1UL << r.sf) * 1000.0 / r.bwKHz;
+}
+
+// Demodulation floor of the SX1262 per spreading factor
+static float snrFloorDb(uint8_t sf) {
+  return -2.5f * (sf - 4);
+}
+
+void simChannelSetLink(int from, int to, const SimLink& link) {
+  links[from][to] = link;
+  linkSet[from][to] = true;
+}
+
+static const SimLink& linkBetween(int from, int to) {
+  return linkSet[from][to] ? links[from][to] : DEFAULT_LINK;
+}
+
+static float rxSnrDb(const SimTransmission& tx, int to) {
+  return linkBetween(tx.node, to).snrDb + (tx.powerDbm - SIM_REF_POWER_DBM) - 10.0f * log10f(tx.bwKHz / 125.0f);
+}
+
+static float rxRssiDbm(const SimTransmission& tx, int to) {
+  return linkBetween(tx.node, to).rssiDbm + (tx.powerDbm - SIM_REF_POWER_DBM);
+}
+
+static bool sameChannel(const SimTransmission& tx, const SimRadio& r) {
+  return fabsf(tx.mhz - r.mhz) < 0.001f && tx.sf == r.sf && fabsf(tx.bwKHz - r.bwKHz) < 0.1f;
+}
+
+static SimTransmission* findTx(uint32_t id) {
+  for (SimTransmission& tx : onAir) {
+    if (tx.id == id) {
+      return &tx;
+    }
+  }
+  return NULL;
+}
+
+static void raiseDio1(SimRadio& r) {
+  if (r.dio1 != NULL) {
+    int was = simCurrentNode();
+    simSetCurrentNode(r.node);
+    r.dio1();
+    simSetCurrentNode(was);
+  }
+}
+
+// Any mode change drops a reception in progress and cancels pending IRQs
+static void setMode(SimRadio& r, SimRadioMode mode) {
+  if (r.locked != 0 && findTx(r.locked) != NULL) {
+    radioStats[r.node].cut++;
+  }
+  r.mode = mode;
+  r.op++;
+  r.locked = 0;
+}
+
+// A listening receiver syncs to a frame, or the frame collides with the
+// one it already follows
+static void offerFrame(SimRadio& r, const SimTransmission& tx) {
+  if (r.mode != MODE_RX || !sameChannel(tx, r) || rxSnrDb(tx, r.node) < snrFloorDb(tx.sf) - 5.0f) {
+    return;
+  }
+  if (r.locked == 0) {
+    r.locked = tx.id;
+    r.corrupted = false;
+    return;
+  }
+  const SimTransmission* current = findTx(r.locked);
+  if (current == NULL || current->end <= tx.start) {
+    r.locked = tx.id;
+    r.corrupted = false;
+    return;
+  }
+  radioStats[r.node].collisions++;
+  if (rxRssiDbm(*current, r.node) >= rxRssiDbm(tx, r.node) + SIM_CAPTURE_DB) {
+    return;
+  }
+  r.corrupted = true;
+}
+
+static void pruneOnAir() {
+  uint64_t now = simNowUs();
+  while (!onAir.empty() && onAir.front().end + 10000000ULL < now) {
+    onAir.pop_front();
+  }
+}
+
+static void txEnd(void* ctx, uint64_t arg) {
+  SimRadio& sender = *(SimRadio*)ctx;
+  const SimTransmission* tx = findTx((uint32_t)arg);
+  if (tx == NULL) {
+    return;
+  }
+
+  for (SimRadio& r : radios) {
+    if (!r.bound || r.node == tx->node || r.locked != tx->id) {
+      continue;
+    }
+    r.locked = 0;
+    if (r.mode != MODE_RX) {
+      continue;
+    }
+    if (!r.corrupted) {
+      const SimLink& link = linkBetween(tx->node, r.node);
+      float snr = rxSnrDb(*tx, r.node);
+      if (snr < snrFloorDb(tx->sf) || simUniform() * 100.0 < link.lossPct) {
+        radioStats[r.node].lost++;
+        continue;
+      }
+      r.rx = tx->data;
+      r.rxCrcError = false;
+      r.rxSnr = snr + SIM_SNR_NOISE_DB * (float)(simUniform() * 2.0 - 1.0);
+      r.rxRssi = rxRssiDbm(*tx, r.node);
+      radioStats[r.node].received++;
+    } else {
+      r.rx.assign(tx->data.size(), 0);
+      r.rxCrcError = true;
+    }
+    raiseDio1(r);
+  }
+
+  // TX done only if the sender was not interrupted meanwhile
+  if (sender.mode == MODE_TX && sender.op == (uint32_t)(arg >> 32)) {
+    setMode(sender, MODE_STANDBY);
+    raiseDio1(sender);
+  }
+  pruneOnAir();
+}
+
+static uint32_t startFrame(SimRadio& r, const uint8_t* data, size_t len) {
+  setMode(r, MODE_TX);
+  SimTransmission tx;
+  tx.id = nextTxId++;
+  tx.node = r.node;
+  tx.mhz = r.mhz;
+  tx.bwKHz = r.bwKHz;
+  tx.sf = r.sf;
+  tx.powerDbm = r.powerDbm;
+  tx.start = simNowUs();
+  tx.end = tx.start + simTimeOnAirUs(r.sf, r.bwKHz, r.cr, r.preamble, len);
+  tx.lockDeadline = tx.start + (uint64_t)((r.preamble > SIM_LOCK_SYMBOLS ? r.preamble - SIM_LOCK_SYMBOLS : 0) *
+                                          symbolUs(r));
+  tx.detectAt = tx.start + (uint64_t)(SIM_LOCK_SYMBOLS * symbolUs(r));
+  tx.headerEnd = tx.start + (uint64_t)((r.preamble + 4.25 + 8) * symbolUs(r));
+  tx.data.assign(data, data + len);
+  onAir.push_back(tx);
+
+  SimRadioStats& s = radioStats[r.node];
+  s.framesSent++;
+  s.airUs += tx.end - tx.start;
+  s.airBytes += len;
+  for (SimRadio& other : radios) {
+    if (other.bound && other.node != r.node) {
+      if (other.mode != MODE_RX && sameChannel(tx, other)) {
+        radioStats[other.node].missed++;
+      }
+      offerFrame(other, onAir.back());
+    }
+  }
+  simSchedule(tx.end, r.node, txEnd, &r, ((uint64_t)r.op << 32) | tx.id);
+  return tx.id;
+}
+
+static void cadEnd(void* ctx, uint64_t op) {
+  SimRadio& r = *(SimRadio*)ctx;
+  if (r.mode != MODE_CAD || r.op != (uint32_t)op) {
+    return;
+  }
+  uint64_t now = simNowUs();
+  bool busy = false;
+  for (const SimTransmission& tx : onAir) {
+    if (tx.node != r.node && tx.start < now && tx.end > r.cadStart && sameChannel(tx, r) &&
+        rxSnrDb(tx, r.node) >= snrFloorDb(tx.sf)) {
+      busy = true;
+      break;
+    }
+  }
+  radioStats[r.node].cadScans++;
+  if (busy) {
+    radioStats[r.node].cadBusy++;
+  }
+  r.cadResult = busy ? RADIOLIB_LORA_DETECTED : RADIOLIB_CHANNEL_FREE;
+  setMode(r, MODE_STANDBY);
+  raiseDio1(r);
+}
+
+const SimRadioStats& simRadioStats(int node) {
+  return radioStats[node];
+}
+
+// ===== INTERFERER =====
+struct SimInterferer {
+  int node;
+  float framesPerSec;
+  size_t len;
+};
+static SimInterferer interferer;
+
+static void interfererFrame(void* ctx, uint64_t arg) {
+  (void)ctx;
+  (void)arg;
+  SimRadio& r = radios[interferer.node];
+  if (r.mode != MODE_TX) {
+    // Lands on whichever station it picks, with that station's modem settings
+    int targets[SIM_MAX_NODES];
+    int count = 0;
+    for (int i = 0; i < SIM_MAX_NODES; i++) {
+      if (i != interferer.node && radios[i].bound) {
+        targets[count++] = i;
+      }
+    }
+    if (count > 0) {
+      int target = targets[simRandom() % count];
+      r.mhz = radios[target].mhz;
+      r.sf = radios[target].sf;
+      r.bwKHz = radios[target].bwKHz;
+      uint8_t junk[RADIOLIB_SX126X_MAX_PACKET_LENGTH];
+      for (size_t i = 0; i < interferer.len; i++) {
+        junk[i] = (uint8_t)simRandom();
+      }
+      startFrame(r, junk, interferer.len);
+    }
+  }
+  double gapUs = -log(1.0 - simUniform()) / interferer.framesPerSec * 1e6;
+  simSchedule(simNowUs() + (uint64_t)gapUs + 1, interferer.node, interfererFrame, NULL, 0);
+}
+
+void simInterfererStart(int node, float framesPerSec, size_t len) {
+  SimRadio& r = radios[node];
+  r.node = node;
+  r.bound = true;
+  r.cr = 5;
+  r.powerDbm = SIM_REF_POWER_DBM;
+  r.preamble = 8;
+  r.mode = MODE_STANDBY;
+  interferer.node = node;
+  interferer.framesPerSec = framesPerSec;
+  interferer.len = len < RADIOLIB_SX126X_MAX_PACKET_LENGTH ? len : RADIOLIB_SX126X_MAX_PACKET_LENGTH;
+  if (framesPerSec > 0) {
+    simSchedule(simNowUs(), node, interfererFrame, NULL, 0);
+  }
+}
+
+// ===== SX1262 =====
+int16_t SX1262::begin(float freq, float bw, uint8_t sf, uint8_t cr, uint8_t syncWord, int8_t power,
+                      uint16_t preambleLength, float tcxoVoltage, bool useRegulatorLDO) {
+  (void)syncWord;
+  (void)tcxoVoltage;
+  (void)useRegulatorLDO;
+  int node = simCurrentNode();
+  if (node < 0 || node >= SIM_MAX_NODES) {
+    return RADIOLIB_ERR_UNKNOWN;
+  }
+  sim = &radios[node];
+  sim->node = node;
+  sim->bound = true;
+  sim->mhz = freq;
+  sim->bwKHz = bw;
+  sim->sf = sf;
+  sim->cr = cr;
+  sim->powerDbm = power;
+  sim->preamble = preambleLength;
+  setMode(*sim, MODE_STANDBY);
+  return RADIOLIB_ERR_NONE;
+}
+
+int16_t SX1262::setFrequency(float freq, bool calibrate) {
+  (void)calibrate;
+  setMode(*sim, MODE_STANDBY);
+  sim->mhz = freq;
+  return RADIOLIB_ERR_NONE;
+}
+
+int16_t SX1262::setBandwidth(float bw) {
+  setMode(*sim, MODE_STANDBY);
+  sim->bwKHz = bw;
+  return RADIOLIB_ERR_NONE;
+}
+
+int16_t SX1262::setSpreadingFactor(uint8_t sf) {
+  if (sf < 5 || sf > 12) {
+    return RADIOLIB_ERR_INVALID_SPREADING_FACTOR;
+  }
+  setMode(*sim, MODE_STANDBY);
+  sim->sf = sf;
+  return RADIOLIB_ERR_NONE;
+}
+
+int16_t SX1262::setCodingRate(uint8_t cr) {
+  setMode(*sim, MODE_STANDBY);
+  sim->cr = cr;
+  return RADIOLIB_ERR_NONE;
+}
+
+int16_t SX1262::setOutputPower(int8_t power) {
+  setMode(*sim, MODE_STANDBY);
+  sim->powerDbm = power;
+  return RADIOLIB_ERR_NONE;
+}
+
+int16_t SX1262::setPreambleLength(uint16_t preambleLength) {
+  setMode(*sim, MODE_STANDBY);
+  sim->preamble = preambleLength;
+  return RADIOLIB_ERR_NONE;
+}
+
+int16_t SX1262::startTransmit(const uint8_t* data, size_t len, uint8_t addr) {
+  (void)addr;
+  if (len > RADIOLIB_SX126X_MAX_PACKET_LENGTH) {
+    return RADIOLIB_ERR_PACKET_TOO_LONG;
+  }
+  startFrame(*sim, data, len);
+  return RADIOLIB_ERR_NONE;
+}
+
+int16_t SX1262::finishTransmit() {
+  setMode(*sim, MODE_STANDBY);
+  return RADIOLIB_ERR_NONE;
+}
+
+// Catches frames whose preamble is still on the air
+int16_t SX1262::startReceive(uint32_t timeout, uint16_t irqFlags, uint16_t irqMask, size_t len) {
+  (void)timeout;
+  (void)irqFlags;
+  (void)irqMask;
+  (void)len;
+  setMode(*sim, MODE_RX);
+  uint64_t now = simNowUs();
+  for (const SimTransmission& tx : onAir) {
+    if (tx.node != sim->node && tx.start <= now && now <= tx.lockDeadline) {
+      offerFrame(*sim, tx);
+    }
+  }
+  return RADIOLIB_ERR_NONE;
+}
+
+// Sniffing is modelled as continuous reception
+int16_t SX1262::startReceiveDutyCycleAuto(uint16_t senderPreambleLength, uint16_t minSymbols,
+                                          uint16_t irqFlags, uint16_t irqMask) {
+  (void)senderPreambleLength;
+  (void)minSymbols;
+  (void)irqFlags;
+  (void)irqMask;
+  return startReceive();
+}
+
+int16_t SX1262::startChannelScan() {
+  setMode(*sim, MODE_CAD);
+  sim->cadStart = simNowUs();
+  uint64_t duration = (uint64_t)(SIM_CAD_SYMBOLS * symbolUs(*sim));
+  simSchedule(sim->cadStart + duration, sim->node, cadEnd, sim, sim->op);
+  return RADIOLIB_ERR_NONE;
+}
+
+int16_t SX1262::getChannelScanResult() {
+  return sim->cadResult;
+}
+
+int16_t SX1262::standby() {
+  setMode(*sim, MODE_STANDBY);
+  return RADIOLIB_ERR_NONE;
+}
+
+int16_t SX1262::sleep() {
+  setMode(*sim, MODE_SLEEP);
+  return RADIOLIB_ERR_NONE;
+}
+
+int16_t SX1262::readData(uint8_t* data, size_t len) {
+  size_t n = sim->rx.size() < len ? sim->rx.size() : len;
+  if (sim->rxCrcError) {
+    return RADIOLIB_ERR_CRC_MISMATCH;
+  }
+  memcpy(data, sim->rx.data(), n);
+  return RADIOLIB_ERR_NONE;
+}
+
+size_t SX1262::getPacketLength(bool update) {
+  (void)update;
+  return sim->rx.size();
+}
+
+float SX1262::getRSSI() {
+  return sim->rxRssi;
+}
+
+float SX1262::getSNR() {
+  return sim->rxSnr;
+}
+
+uint16_t SX1262::getIrqStatus() {
+  const SimTransmission* tx = (sim->mode == MODE_RX && sim->locked != 0) ? findTx(sim->locked) : NULL;
+  uint64_t now = simNowUs();
+  if (tx == NULL || now < tx->detectAt) {
+    return 0;
+  }
+  return RADIOLIB_SX126X_IRQ_PREAMBLE_DETECTED | (now >= tx->headerEnd ? RADIOLIB_SX126X_IRQ_HEADER_VALID : 0);
+}
+
+void SX1262::setDio1Action(void (*func)(void)) {
+  sim->dio1 = func;
+}
+
+void SX1262::clearDio1Action() {
+  sim->dio1 = NULL;
+}
@@ -0,0 +1,45 @@
+/*
+ * Station Build Glue for the Simulator
+ *
+ * Every firmware module is compiled once per station, inside that
+ * station's namespace (sim/m1/<module>.cpp, sim/m2/<module>.cpp):
+ *
+ *   #include "../sim_station.h"
+ *   namespace sim_m1 {
+ *   #include "../../src/lora_arq.cpp"
+ *   }
+ *
+ * This header pulls in every system and mock header the firmware uses
+ * first, outside the namespace, so their include guards keep the
+ * firmware's own #include lines from reopening them inside it. Only the
+ * project headers (include/) end up namespaced, together with the code.
+ */
+
+#ifndef SIM_STATION_H
+#define SIM_STATION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <Arduino.h>
+#include <SPI.h>
+#include <Preferences.h>
+#include <RadioLib.h>
+#include <BLEDevice.h>
+#include <BLEServer.h>
+#include <BLEUtils.h>
+#include <BLE2902.h>
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include <driver/gpio.h>
+#include "sim.h"
+
+// Flash costs of the message log partition (ESP32-S3 SPI NOR, typical)
+#define SIM_FLASH_WRITE_US_PER_PAGE   700     // Per 256-byte page programmed
+#define SIM_FLASH_ERASE_US            45000   // Per 4 KB sector
+#define SIM_FLASH_PAGE                256
+
+#endif // SIM_STATION_H
@@ -0,0 +1,115 @@
+#include "ble_segment.h"
+#include <string.h>
+
+void BleSegmenter::begin(const uint8_t* message, size_t length, uint16_t mtu) {
+  msg = message;
+  len = length;
+  offset = 0;
+  index = 0;
+  if (mtu < BLE_DEFAULT_MTU) {
+    mtu = BLE_DEFAULT_MTU;
+  }
+  chunk = mtu - BLE_ATT_OVERHEAD;
+}
+
+size_t BleSegmenter::next(uint8_t* out) {
+  if (offset >= len) {
+    return 0;
+  }
+
+  // Whole message fits: send it untouched
+  if (offset == 0 && len <= chunk) {
+    memcpy(out, msg, len);
+    offset = len;
+    return len;
+  }
+
+  size_t room = chunk - BLE_SEG_HEADER_SIZE;
+  size_t take = (len - offset < room) ? len - offset : room;
+
+  uint8_t flags = 0;
+  if (offset == 0) flags |= BLE_SEG_FIRST;
+  if (offset + take == len) flags |= BLE_SEG_LAST;
+
+  out[0] = BLE_SEG_MARKER | flags;
+  out[1] = index++;
+  memcpy(out + BLE_SEG_HEADER_SIZE, msg + offset, take);
+  offset += take;
+  return take + BLE_SEG_HEADER_SIZE;
+}
+
+void BleBatch::begin(uint16_t mtu) {
+  if (mtu < BLE_DEFAULT_MTU) {
+    mtu = BLE_DEFAULT_MTU;
+  }
+  cap = mtu - BLE_ATT_OVERHEAD;
+  if (cap > sizeof(buf)) {
+    cap = sizeof(buf);
+  }
+  buf[0] = BLE_BATCH_MARKER;
+  len = 1;
+  count = 0;
+}
+
+bool BleBatch::add(const uint8_t* msg, size_t msgLen) {
+  if (msgLen > BLE_BATCH_MAX_MESSAGE || len + 1 + msgLen > cap) {
+    return false;
+  }
+  buf[len++] = (uint8_t)msgLen;
+  memcpy(buf + len, msg, msgLen);
+  len += msgLen;
+  count++;
+  return true;
+}
+
+void BleReassembler::reset() {
+  len = 0;
+  expected = 0;
+  active = false;
+}
+
+BleReassemblyResult BleReassembler::push(const uint8_t* data, size_t dataLen) {
+  if (dataLen == 0) {
+    return BLE_REASM_PENDING;
+  }
+
+  // Unsegmented write: one write is one message
+  if ((data[0] & BLE_SEG_MARKER_MASK) != BLE_SEG_MARKER) {
+    reset();
+    if (dataLen > sizeof(buf)) {
+      return BLE_REASM_ERROR;
+    }
+    memcpy(buf, data, dataLen);
+    len = dataLen;
+    return BLE_REASM_COMPLETE;
+  }
+
+  if (dataLen < BLE_SEG_HEADER_SIZE) {
+    reset();
+    return BLE_REASM_ERROR;
+  }
+
+  uint8_t flags = data[0];
+  uint8_t index = data[1];
+  const uint8_t* body = data + BLE_SEG_HEADER_SIZE;
+  size_t bodyLen = dataLen - BLE_SEG_HEADER_SIZE;
+
+  if (flags & BLE_SEG_FIRST) {
+    reset();
+    active = true;
+  }
+  if (!active || index != expected || len + bodyLen > sizeof(buf)) {
+    reset();
+    return BLE_REASM_ERROR;
+  }
+
+  memcpy(buf + len, body, bodyLen);
+  len += bodyLen;
+  expected++;
+
+  if (flags & BLE_SEG_LAST) {
+    active = false;
+    return BLE_REASM_COMPLETE;
+  }
+  return BLE_REASM_PENDING;
+}
@@ -0,0 +1,67 @@
+#include "station_platform.h"
+#include "frame_pool.h"
+
+static FrameBuffer buffers[FRAME_POOL_SIZE];
+static uint8_t freeList[FRAME_POOL_SIZE];
+static uint8_t freeCount = 0;
+static bool poolReady = false;
+static FramePoolStats stats = {};
+STATION_LOCK(poolMux);
+
+FrameHandle framePoolAlloc() {
+  uint8_t index = FRAME_POOL_INVALID;
+
+  STATION_ENTER(poolMux);
+  if (!poolReady) {
+    for (uint8_t i = 0; i < FRAME_POOL_SIZE; i++) {
+      freeList[i] = FRAME_POOL_SIZE - 1 - i;
+    }
+    freeCount = FRAME_POOL_SIZE;
+    poolReady = true;
+  }
+  if (freeCount > 0) {
+    index = freeList[--freeCount];
+    stats.allocations++;
+    stats.inUse++;
+    if (stats.inUse > stats.highWater) {
+      stats.highWater = stats.inUse;
+    }
+  } else {
+    stats.allocFailures++;
+  }
+  STATION_EXIT(poolMux);
+
+  if (index != FRAME_POOL_INVALID) {
+    buffers[index].len = 0;
+    buffers[index].stampUs = 0;
+    buffers[index].rssi = 0;
+    buffers[index].snrQ = 0;
+    buffers[index].preamble = 0;
+    buffers[index].channels = 0;
+    buffers[index].priority = 0;
+  }
+  return FrameHandle(index);
+}
+
+void FrameHandle::reset() {
+  if (index == FRAME_POOL_INVALID) return;
+
+  STATION_ENTER(poolMux);
+  freeList[freeCount++] = index;
+  stats.inUse--;
+  STATION_EXIT(poolMux);
+
+  index = FRAME_POOL_INVALID;
+}
+
+FrameBuffer* FrameHandle::operator->() const {
+  return &buffers[index];
+}
+
+FrameBuffer& FrameHandle::operator*() const {
+  return buffers[index];
+}
+
+const FramePoolStats& framePoolGetStats() {
+  return stats;
+}
@@ -0,0 +1,332 @@
+#include "station_platform.h"
+#include "link_adapt.h"
+
+// Slowest (most robust) first; index LINK_DEFAULT_PROFILE is the boot profile
+const LoRaProfile LINK_PROFILES[LINK_PROFILE_COUNT] = {
+  { 12, 125.0f, -20 },
+  { 10, 125.0f, -15 },
+  {  9, 125.0f, -12 },
+  {  7, 125.0f,  -7 },
+  {  7, 250.0f,  -4 },
+  {  7, 500.0f,  -1 },
+};
+
+#define LINK_EWMA_ALPHA     0.25f
+#define LINK_LOSS_WINDOW    16
+#define LINK_COUNT_MAX_GAP  1024    // More between two reports means the peer rebooted
+
+static uint8_t myId = 0;
+static uint8_t peerId = 0;
+static LinkSendFn sendFn = 0;
+static LinkApplyFn applyFn = 0;
+
+static uint8_t current = LINK_DEFAULT_PROFILE;
+static uint8_t previous = LINK_DEFAULT_PROFILE;
+static int8_t power = LINK_DEFAULT_POWER;
+static LinkState state = LINK_STABLE;
+static uint8_t switchId = 0;
+static uint8_t acceptedProfile = 0;   // LINK_ACCEPTED: what, and for which proposal
+static uint8_t acceptedId = 0;
+static uint16_t switchConfig = 0;     // Radio generation of the profile being verified
+
+static uint32_t stateSinceMs = 0;
+static uint32_t lastProbeMs = 0;
+static uint32_t lastHeardMs = 0;
+static uint32_t lastReportMs = 0;
+static uint32_t lastDecideMs = 0;
+
+static bool haveSnr = false;
+static bool havePeerSnr = false;
+static uint16_t sentToPeer = 0;     // Frames we queued for the peer
+static uint16_t heardFromPeer = 0;  // Frames the peer sent to us that arrived
+static bool haveCount = false;      // Baseline from the peer's last report
+static uint16_t lastPeerSent = 0;
+static uint16_t lastHeard = 0;
+static uint16_t winExpected = 0;
+static uint16_t winReceived = 0;
+static uint16_t samples = 0;        // Frames heard since the last change
+
+static LinkAdaptStats stats = {};
+STATION_LOCK(sentMux);
+
+static void sendCtrl(LinkCtrlOpcode op, uint8_t profile, uint8_t id) {
+  float report = haveSnr ? stats.snrAvg * 4.0f : -128.0f;
+  if (report > 127.0f) report = 127.0f;
+  if (report < -128.0f) report = -128.0f;
+
+  // The count includes this frame, which the peer has counted on arrival
+  STATION_ENTER(sentMux);
+  uint16_t sent = (uint16_t)(sentToPeer + 1);
+  STATION_EXIT(sentMux);
+
+  uint8_t ctrl[LINK_CTRL_SIZE];
+  ctrl[0] = op;
+  ctrl[1] = profile;
+  ctrl[2] = id;
+  ctrl[3] = (uint8_t)(int8_t)report;
+  ctrl[4] = (uint8_t)(sent & 0xFF);
+  ctrl[5] = (uint8_t)(sent >> 8);
+  if (sendFn != 0) {
+    sendFn(ctrl, sizeof(ctrl));
+  }
+}
+
+static uint16_t applyRadio() {
+  return (applyFn != 0) ? applyFn(LINK_PROFILES[current], power) : 0;
+}
+
+static bool supports(uint8_t profile, float marginDb) {
+  return haveSnr && stats.snrAvg - LINK_PROFILES[profile].requiredSnrDb >= marginDb;
+}
+
+static void resetSamples() {
+  samples = 0;
+  winExpected = 0;
+  winReceived = 0;
+  haveCount = false;
+  stats.lossPct = 0;
+}
+
+// Loss between two reports of the peer's sent count
+static void countLoss(uint16_t peerSent) {
+  uint16_t sent = (uint16_t)(peerSent - lastPeerSent);
+  uint16_t heard = (uint16_t)(heardFromPeer - lastHeard);
+  bool baseline = haveCount && sent <= LINK_COUNT_MAX_GAP;
+  haveCount = true;
+  lastPeerSent = peerSent;
+  lastHeard = heardFromPeer;
+  if (!baseline) {
+    return;
+  }
+
+  // A frame can overtake the report that counted it
+  if (heard > sent) {
+    heard = sent;
+  }
+  winExpected += sent;
+  winReceived += heard;
+  if (winExpected >= LINK_LOSS_WINDOW) {
+    stats.lossPct = (uint8_t)(100u * (winExpected - winReceived) / winExpected);
+    winExpected = 0;
+    winReceived = 0;
+  }
+}
+
+// The PROBE queued behind the new settings is the first frame the peer
+// can hear on them
+static void switchTo(uint8_t profile, uint32_t nowMs) {
+  previous = current;
+  current = profile;
+  switchConfig = applyRadio();
+  sendCtrl(LINK_OP_PROBE, current, switchId);
+
+  state = LINK_VERIFYING;
+  stateSinceMs = lastProbeMs = nowMs;
+  resetSamples();
+  stats.switches++;
+}
+
+#if LINK_ADAPT_ENABLED
+static void propose(uint8_t profile, uint32_t nowMs) {
+  switchId++;
+  state = LINK_PROPOSED;
+  stateSinceMs = nowMs;
+  sendCtrl(LINK_OP_PROPOSE, profile, switchId);
+}
+#endif
+
+void linkAdaptBegin(uint8_t stationId, LinkSendFn send, LinkApplyFn apply, uint32_t nowMs) {
+  myId = stationId;
+  sendFn = send;
+  applyFn = apply;
+  current = previous = LINK_DEFAULT_PROFILE;
+  power = LINK_DEFAULT_POWER;
+  state = LINK_STABLE;
+  lastHeardMs = lastReportMs = lastDecideMs = nowMs;
+}
+
+void linkAdaptRestore(uint8_t profile, int8_t powerDbm) {
+  if (profile < LINK_PROFILE_COUNT) {
+    current = previous = profile;
+  }
+  power = powerDbm;
+}
+
+void linkAdaptOnFrame(uint8_t src, bool addressed, float rssi, float snr, uint16_t config, uint32_t nowMs) {
+  peerId = src;
+  lastHeardMs = nowMs;
+
+  if (!haveSnr) {
+    stats.snrAvg = snr;
+    stats.rssiAvg = rssi;
+    haveSnr = true;
+  } else {
+    stats.snrAvg += LINK_EWMA_ALPHA * (snr - stats.snrAvg);
+    stats.rssiAvg += LINK_EWMA_ALPHA * (rssi - stats.rssiAvg);
+  }
+
+  if (addressed) {
+    heardFromPeer++;
+  }
+  samples++;
+
+  // Hearing the peer at all on a new profile confirms the switch; a frame
+  // the radio took in on the old settings does not
+  if (state == LINK_VERIFYING && switchConfig != 0 && (int16_t)(config - switchConfig) >= 0) {
+    state = LINK_STABLE;
+  }
+}
+
+void linkAdaptOnControl(uint8_t src, const uint8_t* ctrl, size_t len, uint32_t nowMs) {
+  if (len < LINK_CTRL_SIZE) return;
+
+  uint8_t op = ctrl[0];
+  uint8_t profile = ctrl[1];
+  uint8_t id = ctrl[2];
+  if (profile >= LINK_PROFILE_COUNT) return;
+
+  if ((int8_t)ctrl[3] != -128) {
+    stats.peerSnr = (int8_t)ctrl[3] / 4.0f;
+    havePeerSnr = true;
+  }
+  countLoss((uint16_t)(ctrl[4] | (ctrl[5] << 8)));
+
+  if (op == LINK_OP_PROPOSE) {
+    // Both proposed at once: the lower station ID keeps its proposal
+    if (state == LINK_PROPOSED && myId < src) {
+      return;
+    }
+    uint8_t chosen = profile;
+    while (chosen > current && !supports(chosen, LINK_MARGIN_DB + LINK_UP_HYSTERESIS_DB)) {
+      chosen--;
+    }
+    sendCtrl(LINK_OP_ACCEPT, chosen, id);
+    state = LINK_STABLE;
+    if (chosen != current) {
+      state = LINK_ACCEPTED;
+      stateSinceMs = nowMs;
+      acceptedProfile = chosen;
+      acceptedId = id;
+    }
+  } else if (op == LINK_OP_ACCEPT) {
+    if (state != LINK_PROPOSED || id != switchId) {
+      return;
+    }
+    state = LINK_STABLE;
+    if (profile != current) {
+      // Tells the peer its ACCEPT arrived, on the profile it still listens
+      // on. Twice: losing it splits the link until we revert.
+      sendCtrl(LINK_OP_PROBE, profile, id);
+      sendCtrl(LINK_OP_PROBE, profile, id);
+      switchTo(profile, nowMs);
+    }
+  } else if (op == LINK_OP_PROBE) {
+    if (state == LINK_ACCEPTED && id == acceptedId && profile == acceptedProfile) {
+      switchId = id;
+      switchTo(profile, nowMs);
+    } else if (profile == current) {
+      // The peer is verifying: let it hear us
+      sendCtrl(LINK_OP_REPORT, current, switchId);
+    }
+  }
+}
+
+void linkAdaptPoll(uint32_t nowMs) {
+  if ((state == LINK_PROPOSED || state == LINK_ACCEPTED) && nowMs - stateSinceMs > LINK_PROPOSE_TIMEOUT_MS) {
+    // The peer may have switched without us and spent the time on a
+    // profile we never took; what we missed then is no link loss
+    if (state == LINK_ACCEPTED) {
+      resetSamples();
+    }
+    state = LINK_STABLE;
+  }
+  if (state == LINK_VERIFYING && nowMs - lastProbeMs >= LINK_PROBE_MS) {
+    lastProbeMs = nowMs;
+    sendCtrl(LINK_OP_PROBE, current, switchId);
+  }
+
+  // Nothing heard on the new profile: go back to the one that worked
+  if (state == LINK_VERIFYING && nowMs - stateSinceMs > LINK_VERIFY_MS) {
+    current = previous;
+    applyRadio();
+    state = LINK_STABLE;
+    resetSamples();
+    stats.reverts++;
+  }
+
+  if (peerId == 0) return;
+
+  // Long silence off the boot settings: both sides return to them
+  bool offDefault = (current != LINK_DEFAULT_PROFILE || power != LINK_DEFAULT_POWER);
+  if (offDefault && nowMs - lastHeardMs > LINK_SILENCE_MS) {
+    current = previous = LINK_DEFAULT_PROFILE;
+    power = LINK_DEFAULT_POWER;
+    applyRadio();
+    state = LINK_STABLE;
+    resetSamples();
+    havePeerSnr = false;
+    lastHeardMs = nowMs;
+    stats.silenceFallbacks++;
+    return;
+  }
+
+  // Keepalive carrying our SNR report
+  uint32_t reportMs = offDefault ? LINK_REPORT_FAST_MS : LINK_REPORT_MS;
+  if (state == LINK_STABLE && nowMs - lastReportMs > reportMs) {
+    lastReportMs = nowMs;
+    sendCtrl(LINK_OP_REPORT, current, switchId);
+  }
+
+  if (state != LINK_STABLE || nowMs - lastDecideMs < LINK_DECIDE_MS) return;
+  lastDecideMs = nowMs;
+
+#if LINK_ADAPT_ENABLED
+  // Data rate from our own reception of the peer
+  if (samples >= LINK_MIN_SAMPLES) {
+    if ((stats.lossPct > LINK_LOSS_FALLBACK_PCT || !supports(current, LINK_MARGIN_DB)) && current > 0) {
+      propose(current - 1, nowMs);
+    } else if (current + 1 < LINK_PROFILE_COUNT && supports(current + 1, LINK_MARGIN_DB + LINK_UP_HYSTERESIS_DB)) {
+      propose(current + 1, nowMs);
+    }
+  }
+#endif
+
+  // Output power from how well the peer hears us; one step per report
+  if (havePeerSnr) {
+    float peerMargin = stats.peerSnr - LINK_PROFILES[current].requiredSnrDb - LINK_MARGIN_DB;
+    int8_t newPower = power;
+    if (peerMargin > LINK_POWER_STEP + 3 && power - LINK_POWER_STEP >= LINK_MIN_POWER) {
+      newPower = power - LINK_POWER_STEP;
+    } else if (peerMargin < 0 && power + LINK_POWER_STEP <= LINK_MAX_POWER) {
+      newPower = power + LINK_POWER_STEP;
+    }
+    if (newPower != power) {
+      power = newPower;
+      applyRadio();
+      havePeerSnr = false;
+      stats.powerChanges++;
+    }
+  }
+}
+
+void linkAdaptCountSent() {
+  STATION_ENTER(sentMux);
+  sentToPeer++;
+  STATION_EXIT(sentMux);
+}
+
+uint8_t linkAdaptProfileIndex() {
+  return current;
+}
+
+int8_t linkAdaptPower() {
+  return power;
+}
+
+LinkState linkAdaptState() {
+  return state;
+}
+
+const LinkAdaptStats& linkAdaptGetStats() {
+  return stats;
+}
@@ -0,0 +1,131 @@
+#include "station_platform.h"
+#include "lora_airtime.h"
+
+// Reference points from the Semtech LoRa calculator
+static_assert(loraTimeOnAirUs(7, 125.0f, 10, 8) == 41216, "SF7/125 kHz, 10 bytes");
+static_assert(loraTimeOnAirUs(12, 125.0f, 10, 8) == 991232, "SF12/125 kHz, 10 bytes, low data rate");
+
+static AirtimeLedger ledger = {};
+static AirtimeStats stats = {};
+STATION_LOCK(airtimeMux);
+
+void AirtimeLedger::record(uint32_t nowMs, uint32_t us) {
+  uint32_t b = nowMs / LORA_DUTY_BUCKET_MS;
+  uint8_t i = b % LORA_DUTY_BUCKETS;
+  if (bucket[i] != b) {
+    bucket[i] = b;
+    airUs[i] = 0;
+  }
+  airUs[i] += us;
+}
+
+uint64_t AirtimeLedger::usedUs(uint32_t nowMs) const {
+  uint32_t current = nowMs / LORA_DUTY_BUCKET_MS;
+  uint64_t used = 0;
+  for (uint8_t i = 0; i < LORA_DUTY_BUCKETS; i++) {
+    if (current - bucket[i] < LORA_DUTY_BUCKETS) {
+      used += airUs[i];
+    }
+  }
+  return used;
+}
+
+uint32_t AirtimeLedger::waitMs(uint32_t nowMs, uint64_t needUs, uint64_t limitUs) const {
+  uint64_t used = usedUs(nowMs);
+  if (used + needUs <= limitUs) {
+    return 0;
+  }
+  if (needUs > limitUs) {
+    return UINT32_MAX;
+  }
+
+  // Oldest bucket first: bucket b leaves the window at (b + BUCKETS) * BUCKET_MS
+  uint32_t current = nowMs / LORA_DUTY_BUCKET_MS;
+  for (uint32_t age = LORA_DUTY_BUCKETS - 1; age > 0; age--) {
+    uint32_t b = current - age;
+    uint8_t i = b % LORA_DUTY_BUCKETS;
+    if (bucket[i] != b) {
+      continue;
+    }
+    used -= airUs[i];
+    if (used + needUs <= limitUs) {
+      return (b + LORA_DUTY_BUCKETS) * LORA_DUTY_BUCKET_MS - nowMs;
+    }
+  }
+  // Only the current bucket is left
+  return LORA_DUTY_WINDOW_MS - nowMs % LORA_DUTY_BUCKET_MS;
+}
+
+void airtimeBegin() {
+  STATION_ENTER(airtimeMux);
+  memset(&ledger, 0, sizeof(ledger));
+  memset(&stats, 0, sizeof(stats));
+  STATION_EXIT(airtimeMux);
+}
+
+uint8_t airtimeSharePct(uint8_t priority) {
+  return (priority == AIRTIME_PRIO_CONTROL) ? 100 :
+         (priority == AIRTIME_PRIO_BULK) ? LORA_DUTY_BULK_PCT : LORA_DUTY_DATA_PCT;
+}
+
+AirtimeVerdict airtimeAdmit(uint8_t priority, uint32_t airUs, uint32_t nowMs, uint32_t* waitMs) {
+  *waitMs = 0;
+  if (priority >= AIRTIME_PRIO_COUNT) {
+    priority = AIRTIME_PRIO_DATA;
+  }
+  if (!LORA_DUTY_CYCLE_ENABLED) {
+    STATION_ENTER(airtimeMux);
+    stats.admitted++;
+    STATION_EXIT(airtimeMux);
+    return AIRTIME_SEND;
+  }
+
+  uint64_t limitUs = LORA_DUTY_BUDGET_US * airtimeSharePct(priority) / 100;
+
+  STATION_ENTER(airtimeMux);
+  uint32_t wait = ledger.waitMs(nowMs, airUs, limitUs);
+  AirtimeVerdict verdict;
+  if (wait == 0) {
+    stats.admitted++;
+    verdict = AIRTIME_SEND;
+  } else if (priority == AIRTIME_PRIO_BULK || wait == UINT32_MAX ||
+             (priority == AIRTIME_PRIO_DATA && wait > LORA_DUTY_MAX_WAIT_MS)) {
+    stats.shed[priority]++;
+    verdict = AIRTIME_SHED;
+  } else {
+    stats.waits++;
+    if (wait > stats.maxWaitMs) {
+      stats.maxWaitMs = wait;
+    }
+    *waitMs = wait;
+    verdict = AIRTIME_WAIT;
+  }
+  STATION_EXIT(airtimeMux);
+  return verdict;
+}
+
+void airtimeRecord(uint8_t priority, uint32_t airUs, uint32_t nowMs) {
+  if (priority >= AIRTIME_PRIO_COUNT) {
+    priority = AIRTIME_PRIO_DATA;
+  }
+  STATION_ENTER(airtimeMux);
+  ledger.record(nowMs, airUs);
+  stats.airUs[priority] += airUs;
+  STATION_EXIT(airtimeMux);
+}
+
+uint64_t airtimeUsedUs(uint32_t nowMs) {
+  STATION_ENTER(airtimeMux);
+  uint64_t used = ledger.usedUs(nowMs);
+  STATION_EXIT(airtimeMux);
+  return used;
+}
+
+uint8_t airtimeUtilizationPct(uint32_t nowMs) {
+  uint64_t pct = airtimeUsedUs(nowMs) * 100 / LORA_DUTY_BUDGET_US;
+  return (uint8_t)(pct > 255 ? 255 : pct);
+}
+
+const AirtimeStats& airtimeGetStats() {
+  return stats;
+}
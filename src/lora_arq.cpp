@@ -0,0 +1,475 @@
+#include "lora_arq.h"
+#include <string.h>
+
+#define ARQ_SLOT_MASK       (ARQ_TX_SLOTS - 1)
+#define ARQ_INITIAL_RTO_MS  1000
+#define ARQ_RX_SPAN         32      // Sequences a receive window tracks
+#define ARQ_PROCESSING_MS   50      // Slack for queueing and decode
+#define ARQ_FAILED_SPAN     (ARQ_TX_SLOTS * ARQ_MAX_FRAME_MSGS)   // Messages the buffer can hold
+
+static_assert(ARQ_TX_SLOTS <= ARQ_RX_SPAN, "A receive window must cover everything the sender buffers");
+
+// Receive window for one sending station
+struct RxPeer {
+  bool used;
+  uint8_t src;
+  uint8_t session;
+  uint8_t next;
+  uint32_t bits;          // Bit i: next + i received
+  bool ackPending;
+  uint32_t ackSinceMs;
+  uint32_t lastMs;
+};
+
+struct TxEntry {
+  bool used;
+  bool sent;
+  uint8_t seq;
+  uint8_t flags;
+  uint8_t tries;
+  uint8_t len;
+  bool completesMsg;
+  uint16_t msgFirst;
+  uint16_t msgLast;
+  uint32_t sentMs;
+  uint32_t rtoMs;
+  uint32_t waitMs;        // rtoMs plus jitter: when this try times out
+  uint8_t body[ARQ_MAX_BODY];
+};
+
+static TxEntry slots[ARQ_TX_SLOTS];
+static uint8_t mySession = 0;
+static uint8_t base = 0;          // Oldest entry not yet acked or dropped
+static uint8_t nextSeq = 0;
+static uint16_t submittedComplete = 0;
+static uint16_t newestMsg = ARQ_NO_MESSAGE;
+static uint32_t failedMsgs[ARQ_FAILED_SPAN / 32];   // Bit msg % span: reported failed
+
+static bool haveRtt = false;
+static uint32_t srttMs = 0;
+static uint32_t rttvarMs = 0;
+static uint32_t rtoMs = ARQ_INITIAL_RTO_MS;
+static uint32_t minRtoMs = 0;
+
+static uint32_t jitterState = 1;
+
+static RxPeer rxPeers[ARQ_RX_PEERS];
+
+static ArqStats stats = {};
+
+// Message numbers wrap; compare them as a sliding window
+static bool msgAtOrBefore(uint16_t a, uint16_t b) {
+  return (int16_t)(a - b) <= 0;
+}
+
+static bool msgFailed(uint16_t msg) {
+  uint16_t bit = msg % ARQ_FAILED_SPAN;
+  return failedMsgs[bit / 32] & (1u << (bit % 32));
+}
+
+static void setMsgFailed(uint16_t msg, bool failed) {
+  uint16_t bit = msg % ARQ_FAILED_SPAN;
+  if (failed) {
+    failedMsgs[bit / 32] |= 1u << (bit % 32);
+  } else {
+    failedMsgs[bit / 32] &= ~(1u << (bit % 32));
+  }
+}
+
+// A message number seen for the first time takes over its bit from the
+// one ARQ_FAILED_SPAN before it, which no buffered frame carries any more
+static void trackNewMessages(uint16_t msgLast) {
+  if (newestMsg == ARQ_NO_MESSAGE) {
+    memset(failedMsgs, 0, sizeof(failedMsgs));
+    newestMsg = msgLast;
+  }
+  for (uint16_t n = 0; n < ARQ_FAILED_SPAN && !msgAtOrBefore(msgLast, newestMsg); n++) {
+    setMsgFailed(++newestMsg, false);
+  }
+  newestMsg = msgAtOrBefore(msgLast, newestMsg) ? newestMsg : msgLast;
+}
+
+static void advanceBase() {
+  while (base != nextSeq && !slots[base & ARQ_SLOT_MASK].used) {
+    base++;
+  }
+}
+
+static bool msgOutstanding(uint16_t msg) {
+  for (uint8_t s = base; s != nextSeq; s++) {
+    const TxEntry& e = slots[s & ARQ_SLOT_MASK];
+    if (e.used && e.msgFirst != ARQ_NO_MESSAGE &&
+        msgAtOrBefore(e.msgFirst, msg) && msgAtOrBefore(msg, e.msgLast)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Receipts a frame's messages may need
+static size_t msgSpan(const TxEntry& e) {
+  return (e.msgFirst == ARQ_NO_MESSAGE) ? 0 : (uint16_t)(e.msgLast - e.msgFirst) + 1;
+}
+
+static void addReceipt(uint16_t msg, bool delivered,
+                       ArqReceipt* receipts, size_t* count, size_t max) {
+  if (*count < max) {
+    receipts[*count].msgNo = msg;
+    receipts[*count].delivered = delivered;
+    (*count)++;
+  }
+}
+
+// Timeout plus up to a quarter more, drawn from the arqBegin() seed
+static uint32_t withJitter(uint32_t ms) {
+  jitterState = jitterState * 1664525u + 1013904223u;
+  return ms + (uint32_t)(((uint64_t)ms * (jitterState >> 16)) >> 18);
+}
+
+static void updateRtt(uint32_t sampleMs) {
+  if (!haveRtt) {
+    srttMs = sampleMs;
+    rttvarMs = sampleMs / 2;
+    haveRtt = true;
+  } else {
+    uint32_t err = (srttMs > sampleMs) ? srttMs - sampleMs : sampleMs - srttMs;
+    rttvarMs = (3 * rttvarMs + err) / 4;
+    srttMs = (7 * srttMs + sampleMs) / 8;
+  }
+
+  uint32_t var = 4 * rttvarMs;
+  rtoMs = srttMs + (var > 10 ? var : 10);
+  if (rtoMs < minRtoMs) rtoMs = minRtoMs;
+  if (rtoMs > ARQ_MAX_RTO_MS) rtoMs = ARQ_MAX_RTO_MS;
+  stats.srttMs = srttMs;
+  stats.rtoMs = rtoMs;
+}
+
+static RxPeer* findRxPeer(uint8_t src) {
+  for (uint8_t i = 0; i < ARQ_RX_PEERS; i++) {
+    if (rxPeers[i].used && rxPeers[i].src == src) {
+      return &rxPeers[i];
+    }
+  }
+  return NULL;
+}
+
+// Free slot, otherwise the sender heard from least recently
+static RxPeer* claimRxPeer(uint32_t nowMs) {
+  RxPeer* oldest = &rxPeers[0];
+  for (uint8_t i = 0; i < ARQ_RX_PEERS; i++) {
+    if (!rxPeers[i].used) {
+      return &rxPeers[i];
+    }
+    if (nowMs - rxPeers[i].lastMs > nowMs - oldest->lastMs) {
+      oldest = &rxPeers[i];
+    }
+  }
+  return oldest;
+}
+
+static void fillOut(const TxEntry& e, ArqOutFrame* out) {
+  out->flags = e.flags | FRAME_FLAG_RELIABLE;
+  out->attempt = e.tries;
+  out->header[0] = mySession;
+  out->header[1] = e.seq;
+  out->header[2] = base;
+  out->len = e.len;
+  memcpy(out->body, e.body, e.len);
+}
+
+void arqBegin(uint8_t session, uint32_t jitterSeed) {
+  mySession = session;
+  jitterState = jitterSeed;
+  memset(slots, 0, sizeof(slots));
+  base = nextSeq = 0;
+  submittedComplete = 0;
+  newestMsg = ARQ_NO_MESSAGE;
+  rtoMs = (minRtoMs > ARQ_INITIAL_RTO_MS) ? minRtoMs : ARQ_INITIAL_RTO_MS;
+  stats.rtoMs = rtoMs;
+}
+
+void arqSetAirtime(uint32_t frameMs, uint32_t ackMs) {
+  minRtoMs = frameMs + ackMs + ARQ_ACK_DELAY_MS + ARQ_PROCESSING_MS;
+  if (rtoMs < minRtoMs) {
+    rtoMs = minRtoMs;
+    stats.rtoMs = rtoMs;
+  }
+}
+
+bool arqSubmit(uint8_t flags, const uint8_t* body, size_t len,
+               uint16_t msgFirst, uint16_t msgLast, bool completesMsg) {
+  if ((uint8_t)(nextSeq - base) >= ARQ_TX_SLOTS || len > ARQ_MAX_BODY) {
+    stats.bufferFull++;
+    return false;
+  }
+  if (msgFirst != ARQ_NO_MESSAGE && (uint16_t)(msgLast - msgFirst) >= ARQ_MAX_FRAME_MSGS) {
+    return false;
+  }
+
+  TxEntry& e = slots[nextSeq & ARQ_SLOT_MASK];
+  e.used = true;
+  e.sent = false;
+  e.seq = nextSeq++;
+  e.flags = flags;
+  e.tries = 0;
+  e.len = (uint8_t)len;
+  e.msgFirst = msgFirst;
+  e.msgLast = msgLast;
+  e.completesMsg = completesMsg;
+  memcpy(e.body, body, len);
+
+  if (msgFirst != ARQ_NO_MESSAGE) {
+    trackNewMessages(msgLast);
+  }
+  if (completesMsg && msgLast != ARQ_NO_MESSAGE) {
+    submittedComplete = msgLast;
+  }
+  stats.submitted++;
+  return true;
+}
+
+size_t arqFreeSlots() {
+  return ARQ_TX_SLOTS - (uint8_t)(nextSeq - base);
+}
+
+bool arqNextTransmit(uint32_t nowMs, ArqOutFrame* out,
+                     ArqReceipt* receipts, size_t* receiptCount, size_t maxReceipts) {
+  // Retransmissions first: they hold the window back
+  for (uint8_t s = base; s != nextSeq; s++) {
+    TxEntry& e = slots[s & ARQ_SLOT_MASK];
+    if (!e.used || !e.sent || nowMs - e.sentMs < e.waitMs) {
+      continue;
+    }
+
+    if (e.tries >= ARQ_MAX_TRIES) {
+      size_t before = *receiptCount;
+      e.used = false;
+      stats.failed++;
+      if (e.msgFirst != ARQ_NO_MESSAGE) {
+        for (uint16_t m = e.msgFirst; msgAtOrBefore(m, e.msgLast); m++) {
+          if (m != ARQ_NO_MESSAGE && !msgFailed(m)) {
+            addReceipt(m, false, receipts, receiptCount, maxReceipts);
+            setMsgFailed(m, true);
+          }
+        }
+      }
+      if (*receiptCount > before) {
+        break;    // One frame's receipts per call
+      }
+      continue;
+    }
+
+    e.tries++;
+    e.sentMs = nowMs;
+    e.rtoMs = (e.rtoMs * 2 < ARQ_MAX_RTO_MS) ? e.rtoMs * 2 : ARQ_MAX_RTO_MS;
+    e.waitMs = withJitter(e.rtoMs);
+    stats.transmissions++;
+    stats.retransmissions++;
+    fillOut(e, out);
+    return true;
+  }
+  advanceBase();
+
+  // New frames while the window has room
+  for (uint8_t s = base; s != nextSeq && (uint8_t)(s - base) < ARQ_WINDOW; s++) {
+    TxEntry& e = slots[s & ARQ_SLOT_MASK];
+    if (!e.used || e.sent) {
+      continue;
+    }
+    e.sent = true;
+    e.tries = 1;
+    e.sentMs = nowMs;
+    e.rtoMs = rtoMs;
+    e.waitMs = withJitter(rtoMs);
+    stats.transmissions++;
+    stats.inFlight++;
+    fillOut(e, out);
+    return true;
+  }
+  return false;
+}
+
+bool arqOnAck(const uint8_t* block, uint32_t nowMs,
+              ArqReceipt* receipts, size_t* receiptCount, size_t maxReceipts) {
+  if (block[0] != mySession) {
+    return false;   // ACK for a previous boot
+  }
+  bool full = false;
+  uint8_t cum = block[1];
+  uint16_t sack = (uint16_t)(block[2] | (block[3] << 8));
+
+  for (uint8_t s = base; s != nextSeq; s++) {
+    TxEntry& e = slots[s & ARQ_SLOT_MASK];
+    if (!e.used) {
+      continue;
+    }
+
+    uint8_t d = (uint8_t)(e.seq - cum);
+    bool acked = (d >= 128) || (d >= 1 && d <= 16 && (sack & (1u << (d - 1))));
+    if (!acked) {
+      continue;
+    }
+    if (*receiptCount + msgSpan(e) > maxReceipts) {
+      full = true;
+      break;
+    }
+
+    // Karn: only frames sent once give an unambiguous RTT sample. A frame
+    // acknowledged before it was sent was rebuilt by the peer (FEC).
+    if (!e.sent) {
+      stats.skipped++;
+    } else if (e.tries == 1) {
+      updateRtt(nowMs - e.sentMs);
+    }
+    e.used = false;
+    stats.acked++;
+
+    if (e.msgFirst != ARQ_NO_MESSAGE) {
+      for (uint16_t m = e.msgFirst; msgAtOrBefore(m, e.msgLast); m++) {
+        if (m != ARQ_NO_MESSAGE && !msgFailed(m) && msgAtOrBefore(m, submittedComplete) &&
+            !msgOutstanding(m)) {
+          addReceipt(m, true, receipts, receiptCount, maxReceipts);
+        }
+      }
+    }
+  }
+  advanceBase();
+
+  uint8_t inFlight = 0;
+  for (uint8_t s = base; s != nextSeq; s++) {
+    const TxEntry& e = slots[s & ARQ_SLOT_MASK];
+    if (e.used && e.sent) inFlight++;
+  }
+  stats.inFlight = inFlight;
+  return full;
+}
+
+// Everything before next is delivered or settled; shift past what was
+// received out of order
+static void slideRxWindow(RxPeer* p) {
+  while (p->bits & 1) {
+    p->bits >>= 1;
+    p->next++;
+  }
+}
+
+ArqRxResult arqOnReceive(uint8_t src, const uint8_t* header, uint32_t nowMs) {
+  uint8_t session = header[0];
+  uint8_t seq = header[1];
+  uint8_t senderBase = header[2];
+
+  // New sender or a new boot of it: start a fresh receive window at the
+  // sender's base, so frames lost ahead of this one are still awaited
+  RxPeer* p = findRxPeer(src);
+  if (p == NULL || p->session != session) {
+    if (p == NULL) {
+      p = claimRxPeer(nowMs);
+    }
+    p->used = true;
+    p->src = src;
+    p->session = session;
+    p->next = senderBase;
+    p->bits = 0;
+    p->ackPending = false;
+  }
+  p->lastMs = nowMs;
+
+  if (!p->ackPending) {
+    p->ackPending = true;
+    p->ackSinceMs = nowMs;
+  }
+  stats.received++;
+
+  // The sender settled everything before its base, some of it by giving
+  // up: stop waiting for those
+  uint8_t behind = (uint8_t)(senderBase - p->next);
+  if (behind > 0 && behind < 128) {
+    p->bits = (behind < ARQ_RX_SPAN) ? p->bits >> behind : 0;
+    p->next = senderBase;
+    slideRxWindow(p);
+  }
+
+  uint8_t d = (uint8_t)(seq - p->next);
+  if (d >= 128) {
+    stats.duplicates++;
+    return ARQ_RX_DUPLICATE;
+  }
+  if (d >= ARQ_RX_SPAN) {
+    // Farther past the sender's base than it can have buffered: a
+    // malformed header. Drop it without acknowledging anything new.
+    stats.duplicates++;
+    return ARQ_RX_DUPLICATE;
+  }
+  if (p->bits & (1u << d)) {
+    stats.duplicates++;
+    return ARQ_RX_DUPLICATE;
+  }
+
+  p->bits |= (1u << d);
+  slideRxWindow(p);
+  return ARQ_RX_NEW;
+}
+
+void arqMarkReceived(uint8_t src, uint8_t session, uint8_t seq) {
+  RxPeer* p = findRxPeer(src);
+  if (p == NULL || p->session != session) {
+    return;
+  }
+  uint8_t d = (uint8_t)(seq - p->next);
+  if (d >= ARQ_RX_SPAN) {
+    return;   // Already delivered, or too far ahead to track
+  }
+  p->bits |= (1u << d);
+  slideRxWindow(p);
+}
+
+bool arqAckPending(uint8_t peer) {
+  RxPeer* p = findRxPeer(peer);
+  return p != NULL && p->ackPending;
+}
+
+bool arqAckDue(uint32_t nowMs, uint8_t* peer) {
+  for (uint8_t i = 0; i < ARQ_RX_PEERS; i++) {
+    const RxPeer& p = rxPeers[i];
+    if (p.used && p.ackPending && nowMs - p.ackSinceMs >= ARQ_ACK_DELAY_MS) {
+      *peer = p.src;
+      return true;
+    }
+  }
+  return false;
+}
+
+void arqWriteAck(uint8_t peer, uint8_t* out) {
+  RxPeer* p = findRxPeer(peer);
+  if (p == NULL) {
+    memset(out, 0, ARQ_ACK_SIZE);
+    return;
+  }
+  uint16_t sack = (uint16_t)(p->bits >> 1);
+  out[0] = p->session;
+  out[1] = p->next;
+  out[2] = (uint8_t)(sack & 0xFF);
+  out[3] = (uint8_t)(sack >> 8);
+  p->ackPending = false;
+}
+
+void arqNoteStandaloneAck() {
+  stats.acksSent++;
+}
+
+bool arqIdle() {
+  if (base != nextSeq) {
+    return false;
+  }
+  for (uint8_t i = 0; i < ARQ_RX_PEERS; i++) {
+    if (rxPeers[i].used && rxPeers[i].ackPending) {
+      return false;
+    }
+  }
+  return true;
+}
+
+const ArqStats& arqGetStats() {
+  return stats;
+}
@@ -0,0 +1,697 @@
+#include "lora_bulk.h"
+#include "lora_frame.h"
+#include "ble_segment.h"
+#include <string.h>
+
+#define BULK_BITMAP_SIZE    (LORA_BULK_MAX_BLOCKS / 8)
+#define BULK_STATUS_SPAN    (LORA_BULK_STATUS_BYTES * 8)
+#define BULK_OFFER_SIZE     11
+#define BULK_CP_ACTIVE      0x01
+#define BULK_CP_COMPLETE    0x02
+
+enum BulkTxState : uint8_t {
+  BULK_TX_IDLE = 0,
+  BULK_TX_WAITING,      // For a STATUS: after an offer, or the poll ending a pass
+  BULK_TX_SENDING,
+  BULK_TX_HOLD,         // Receiver had no room; ask again later
+  BULK_TX_PAUSED        // Stalled; the phone offers again to resume
+};
+
+// Object on its way out. Blocks below frontier were sent at least once;
+// of those, only the ones below reportEnd are known to be missing.
+struct BulkTx {
+  uint8_t state;
+  uint8_t xfer;
+  uint8_t blockSize;
+  uint8_t polls;          // Unanswered in a row
+  bool offered;           // No STATUS since the last offer
+  uint32_t objectId;
+  uint32_t size;
+  uint16_t blocks;
+  uint16_t delivered;     // Blocks the receiver has
+  uint16_t cursor;        // Where the current pass goes on
+  uint16_t frontier;
+  uint16_t reportEnd;
+  uint16_t passLast;      // Last block of the pass, BULK_ANSWERS_OFFER after an offer
+  uint16_t wantNext;      // Next block expected from the phone
+  uint16_t wantEnd;
+  uint16_t sincePoll;
+  uint32_t pollMs;
+  uint32_t phoneMs;
+  uint32_t startedMs;
+  uint8_t have[BULK_BITMAP_SIZE];
+};
+
+// Object on its way in
+struct BulkRx {
+  bool active;
+  bool complete;
+  bool held;              // A block was dropped since the last STATUS
+  uint8_t src;
+  uint8_t xfer;
+  uint8_t blockSize;
+  uint32_t objectId;
+  uint32_t size;
+  uint16_t blocks;
+  uint16_t received;
+  uint16_t base;          // First missing block
+  uint16_t sinceCheckpoint;
+  uint32_t startedMs;
+  uint32_t lastMs;
+  uint8_t have[BULK_BITMAP_SIZE];
+};
+
+static BulkTx tx;
+static BulkRx rx;
+static uint8_t peerId = 0;
+static uint8_t nextXfer = 0;
+static BulkSendFn sendFn = 0;
+static BulkPhoneFn phoneFn = 0;
+static BulkRoomFn roomFn = 0;
+static uint32_t pollTimeoutMs = LORA_BULK_TURNAROUND_MS;
+
+static BulkStats stats = {};
+
+static bool testBit(const uint8_t* map, uint16_t i) {
+  return (map[i >> 3] >> (i & 7)) & 1;
+}
+
+static void setBit(uint8_t* map, uint16_t i) {
+  map[i >> 3] |= (uint8_t)(1u << (i & 7));
+}
+
+static void clearBit(uint8_t* map, uint16_t i) {
+  map[i >> 3] &= (uint8_t)~(1u << (i & 7));
+}
+
+static void put16(uint8_t* p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+  put16(p, (uint16_t)v);
+  put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+  return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+static uint32_t blockCount(uint32_t size, uint8_t blockSize) {
+  return (size + blockSize - 1) / blockSize;
+}
+
+static size_t blockLen(uint32_t size, uint8_t blockSize, uint16_t blocks, uint16_t i) {
+  return (i + 1u == blocks) ? size - (uint32_t)i * blockSize : blockSize;
+}
+
+// [marker][op][object ID], the start of every note to the phone
+static size_t noteHeader(uint8_t* note, uint8_t op, uint32_t objectId) {
+  note[0] = BLE_BULK_MARKER;
+  note[1] = op;
+  put32(note + 2, objectId);
+  return 6;
+}
+
+static void sendNote(uint8_t op, uint32_t objectId, const uint8_t* extra, size_t extraLen, BulkNoteKind kind) {
+  uint8_t note[16];
+  size_t n = noteHeader(note, op, objectId);
+  if (extraLen > 0) {
+    memcpy(note + n, extra, extraLen);
+  }
+  if (phoneFn != 0) {
+    phoneFn(note, n + extraLen, kind);
+  }
+}
+
+static uint32_t bytesPerSec(uint32_t size, uint32_t startedMs, uint32_t nowMs) {
+  uint32_t ms = nowMs - startedMs;
+  return (uint32_t)((uint64_t)size * 1000 / (ms > 0 ? ms : 1));
+}
+
+// ----- Sending side -----
+
+static void sendOffer(uint32_t nowMs) {
+  uint8_t offer[BULK_OFFER_SIZE];
+  offer[0] = BULK_OP_OFFER;
+  offer[1] = tx.xfer;
+  put32(offer + 2, tx.objectId);
+  put32(offer + 6, tx.size);
+  offer[10] = tx.blockSize;
+  tx.state = BULK_TX_WAITING;
+  tx.offered = true;
+  tx.passLast = BULK_ANSWERS_OFFER;
+  tx.pollMs = nowMs;
+  if (sendFn != 0) {
+    sendFn(peerId, offer, sizeof(offer), NULL, 0);
+  }
+}
+
+static void stallTx(uint8_t reason) {
+  tx.state = BULK_TX_PAUSED;
+  stats.stalls++;
+  sendNote(BULK_PHONE_STALLED, tx.objectId, &reason, 1, BULK_NOTE_STATUS);
+}
+
+// Blocks still to send: never sent, or reported missing
+static bool wanted(uint16_t i) {
+  return !testBit(tx.have, i) && (i >= tx.frontier || i < tx.reportEnd);
+}
+
+static uint16_t nextWanted(uint16_t from) {
+  while (from < tx.blocks && !wanted(from)) {
+    from++;
+  }
+  return from;
+}
+
+static void startOffer(uint32_t objectId, uint32_t size, uint8_t blockSize, uint32_t nowMs) {
+  uint32_t blocks = blockSize ? blockCount(size, blockSize) : 0;
+  if (tx.state != BULK_TX_IDLE && tx.state != BULK_TX_PAUSED) {
+    uint8_t reason = BULK_STALL_BUSY;
+    sendNote(BULK_PHONE_STALLED, objectId, &reason, 1, BULK_NOTE_STATUS);
+    return;
+  }
+  if (blocks == 0 || blocks > LORA_BULK_MAX_BLOCKS || peerId == LORA_BROADCAST_ID) {
+    uint8_t reason = (peerId == LORA_BROADCAST_ID) ? BULK_STALL_REFUSED : BULK_STALL_TOO_LARGE;
+    sendNote(BULK_PHONE_STALLED, objectId, &reason, 1, BULK_NOTE_STATUS);
+    return;
+  }
+
+  memset(&tx, 0, sizeof(tx));
+  tx.xfer = nextXfer++;
+  tx.objectId = objectId;
+  tx.size = size;
+  tx.blockSize = blockSize;
+  tx.blocks = (uint16_t)blocks;
+  tx.startedMs = nowMs;
+  sendOffer(nowMs);
+}
+
+static void onPhoneBlock(uint32_t objectId, uint16_t index, const uint8_t* data, size_t len, uint32_t nowMs) {
+  if (tx.state != BULK_TX_SENDING || objectId != tx.objectId || tx.wantNext >= tx.wantEnd ||
+      index != tx.wantNext || len != blockLen(tx.size, tx.blockSize, tx.blocks, index)) {
+    return;
+  }
+  tx.wantNext++;
+  tx.phoneMs = nowMs;
+
+  bool resend = index < tx.frontier;
+  if (!resend) {
+    tx.frontier = index + 1;
+  }
+  // The last block of a pass always asks for a STATUS
+  bool last = nextWanted(index + 1) == tx.blocks;
+  bool poll = last || ++tx.sincePoll >= LORA_BULK_POLL_EVERY;
+
+  uint8_t hdr[LORA_BULK_HEADER_SIZE];
+  hdr[0] = BULK_OP_DATA | (poll ? BULK_FLAG_POLL : 0);
+  hdr[1] = tx.xfer;
+  put16(hdr + 2, index);
+  if (sendFn != 0) {
+    sendFn(peerId, hdr, sizeof(hdr), data, len);
+  }
+  stats.blocksSent++;
+  if (resend) {
+    stats.blocksResent++;
+  }
+  if (poll) {
+    tx.sincePoll = 0;
+  }
+  if (last) {
+    tx.state = BULK_TX_WAITING;
+    tx.offered = false;
+    tx.passLast = index;
+    tx.polls = 0;
+    tx.pollMs = nowMs;
+  }
+}
+
+static void onStatus(const uint8_t* p, size_t len, uint32_t nowMs) {
+  if (len < 6 || p[1] != tx.xfer || tx.state == BULK_TX_IDLE || tx.state == BULK_TX_PAUSED) {
+    return;
+  }
+  stats.statusReceived++;
+  uint16_t answers = get16(p + 2);
+  bool passOver = tx.state != BULK_TX_SENDING && (answers == tx.passLast || answers == BULK_ANSWERS_OFFER);
+
+  // Merge what the receiver has. At the end of a pass nothing is in
+  // flight, so its window is the whole truth there: blocks it lost to a
+  // reboot since its last checkpoint are missing again.
+  uint16_t base = get16(p + 4);
+  if (base > tx.blocks) {
+    base = tx.blocks;
+  }
+  for (uint16_t i = 0; i < base; i++) {
+    if (!testBit(tx.have, i)) {
+      setBit(tx.have, i);
+      tx.delivered++;
+    }
+  }
+  const uint8_t* bitmap = p + 6;
+  size_t span = (len - 6) * 8;
+  for (size_t k = 0; k < span && base + k < tx.blocks; k++) {
+    uint16_t i = (uint16_t)(base + k);
+    if (testBit(bitmap, (uint16_t)k) && !testBit(tx.have, i)) {
+      setBit(tx.have, i);
+      tx.delivered++;
+    } else if (passOver && !testBit(bitmap, (uint16_t)k) && testBit(tx.have, i)) {
+      clearBit(tx.have, i);
+      tx.delivered--;
+    }
+  }
+
+  // First answer to an offer: whatever the receiver has is not sent again
+  if (tx.offered && answers == BULK_ANSWERS_OFFER) {
+    if (tx.delivered > 0) {
+      stats.resumes++;
+      stats.resumeSkipped += tx.delivered;
+    }
+    tx.offered = false;
+  }
+
+  uint8_t progress[4];
+  put16(progress, tx.delivered);
+  put16(progress + 2, tx.blocks);
+  if (base == tx.blocks) {
+    stats.objectsSent++;
+    stats.txBytesPerSec = bytesPerSec(tx.size, tx.startedMs, nowMs);
+    tx.state = BULK_TX_IDLE;
+    sendNote(BULK_PHONE_SENT, tx.objectId, NULL, 0, BULK_NOTE_STATUS);
+    return;
+  }
+  sendNote(BULK_PHONE_PROGRESS, tx.objectId, progress, sizeof(progress), BULK_NOTE_STATUS);
+
+  if (p[0] & BULK_FLAG_HOLD) {
+    tx.state = BULK_TX_HOLD;
+    tx.polls = 0;
+    tx.pollMs = nowMs;
+    return;
+  }
+  // The answer to the end of a pass: nothing is in flight, the bitmap is
+  // complete up to its span, and a new pass starts at the first gap.
+  // Other answers only add to what is known.
+  if (passOver) {
+    tx.polls = 0;
+    tx.state = BULK_TX_SENDING;
+    tx.cursor = base;
+    tx.reportEnd = (base + span < tx.blocks) ? (uint16_t)(base + span) : tx.blocks;
+    tx.wantNext = tx.wantEnd = 0;
+    tx.sincePoll = 0;
+  }
+}
+
+// ----- Receiving side -----
+
+static void sendStatus(uint16_t answers) {
+  uint8_t status[LORA_BULK_STATUS_SIZE];
+  memset(status, 0, sizeof(status));
+  status[0] = BULK_OP_STATUS | (rx.held ? BULK_FLAG_HOLD : 0);
+  status[1] = rx.xfer;
+  put16(status + 2, answers);
+  put16(status + 4, rx.base);
+  for (uint16_t k = 0; k < BULK_STATUS_SPAN && rx.base + k < rx.blocks; k++) {
+    if (testBit(rx.have, (uint16_t)(rx.base + k))) {
+      setBit(status + 6, k);
+    }
+  }
+  rx.held = false;
+  stats.statusSent++;
+  if (sendFn != 0) {
+    sendFn(rx.src, status, sizeof(status), NULL, 0);
+  }
+}
+
+// Queued behind the blocks it covers, so it is saved once they are handled
+static void checkpoint() {
+  uint8_t cp[LORA_BULK_CHECKPOINT_SIZE];
+  memset(cp, 0, sizeof(cp));
+  cp[0] = (rx.active ? BULK_CP_ACTIVE : 0) | (rx.complete ? BULK_CP_COMPLETE : 0);
+  cp[1] = rx.src;
+  cp[2] = rx.xfer;
+  cp[3] = rx.blockSize;
+  put32(cp + 4, rx.objectId);
+  put32(cp + 8, rx.size);
+  put16(cp + 12, rx.base);
+  for (uint16_t k = 0; k < BULK_STATUS_SPAN && rx.base + k < rx.blocks; k++) {
+    if (testBit(rx.have, (uint16_t)(rx.base + k))) {
+      setBit(cp + 14, k);
+    }
+  }
+  rx.sinceCheckpoint = 0;
+  if (phoneFn != 0 && phoneFn(cp, sizeof(cp), BULK_NOTE_CHECKPOINT)) {
+    stats.checkpoints++;
+  }
+}
+
+static void sendShort(uint8_t op, uint8_t dst, uint8_t xfer) {
+  uint8_t msg[2] = { op, xfer };
+  if (sendFn != 0) {
+    sendFn(dst, msg, sizeof(msg), NULL, 0);
+  }
+}
+
+static void onOffer(uint8_t src, const uint8_t* p, size_t len, uint32_t nowMs) {
+  if (len < BULK_OFFER_SIZE) {
+    return;
+  }
+  uint32_t objectId = get32(p + 2);
+  uint32_t size = get32(p + 6);
+  uint8_t blockSize = p[10];
+  uint32_t blocks = blockSize ? blockCount(size, blockSize) : 0;
+  if (blocks == 0 || blocks > LORA_BULK_MAX_BLOCKS) {
+    sendShort(BULK_OP_REFUSE, src, p[1]);
+    return;
+  }
+
+  // Known object: resume where it stands
+  if (rx.active && rx.src == src && rx.objectId == objectId && rx.size == size && rx.blockSize == blockSize) {
+    rx.xfer = p[1];
+    rx.lastMs = nowMs;
+    sendStatus(BULK_ANSWERS_OFFER);
+    return;
+  }
+  if (rx.active && !rx.complete && nowMs - rx.lastMs < LORA_BULK_RX_IDLE_MS) {
+    sendShort(BULK_OP_REFUSE, src, p[1]);
+    return;
+  }
+
+  memset(&rx, 0, sizeof(rx));
+  rx.active = true;
+  rx.src = src;
+  rx.xfer = p[1];
+  rx.blockSize = blockSize;
+  rx.objectId = objectId;
+  rx.size = size;
+  rx.blocks = (uint16_t)blocks;
+  rx.startedMs = rx.lastMs = nowMs;
+  uint8_t sizeLe[4];
+  put32(sizeLe, size);
+  sendNote(BULK_PHONE_INCOMING, objectId, sizeLe, sizeof(sizeLe), BULK_NOTE_KEEP);
+  checkpoint();
+  sendStatus(BULK_ANSWERS_OFFER);
+}
+
+// The block goes to the phone, or the log, with its byte offset
+static bool deliverBlock(uint16_t index, const uint8_t* data, size_t len) {
+  static uint8_t note[LORA_BULK_NOTE_HEADER + LORA_FRAME_MAX_PAYLOAD];
+  if (len > LORA_FRAME_MAX_PAYLOAD || (roomFn != 0 && !roomFn())) {
+    return false;
+  }
+  size_t n = noteHeader(note, BULK_PHONE_DATA, rx.objectId);
+  put32(note + n, (uint32_t)index * rx.blockSize);
+  memcpy(note + LORA_BULK_NOTE_HEADER, data, len);
+  return phoneFn != 0 && phoneFn(note, LORA_BULK_NOTE_HEADER + len, BULK_NOTE_KEEP);
+}
+
+static void onData(uint8_t src, const uint8_t* p, size_t len, uint32_t nowMs) {
+  if (len < LORA_BULK_HEADER_SIZE || !rx.active || rx.src != src || rx.xfer != p[1]) {
+    return;
+  }
+  uint16_t index = get16(p + 2);
+  const uint8_t* data = p + LORA_BULK_HEADER_SIZE;
+  size_t dataLen = len - LORA_BULK_HEADER_SIZE;
+  if (index >= rx.blocks || dataLen != blockLen(rx.size, rx.blockSize, rx.blocks, index)) {
+    return;
+  }
+  rx.lastMs = nowMs;
+
+  if (testBit(rx.have, index)) {
+    stats.blocksDuplicate++;
+  } else if (!deliverBlock(index, data, dataLen)) {
+    rx.held = true;
+    stats.blocksHeld++;
+  } else {
+    setBit(rx.have, index);
+    rx.received++;
+    stats.blocksReceived++;
+    while (rx.base < rx.blocks && testBit(rx.have, rx.base)) {
+      rx.base++;
+    }
+    if (rx.received == rx.blocks) {
+      uint8_t sizeLe[4];
+      put32(sizeLe, rx.size);
+      rx.complete = true;
+      stats.objectsReceived++;
+      stats.rxBytesPerSec = bytesPerSec(rx.size, rx.startedMs, nowMs);
+      sendNote(BULK_PHONE_COMPLETE, rx.objectId, sizeLe, sizeof(sizeLe), BULK_NOTE_KEEP);
+      checkpoint();
+      sendStatus(index);
+      return;
+    }
+    if (++rx.sinceCheckpoint >= LORA_BULK_CHECKPOINT_BLOCKS) {
+      checkpoint();
+    }
+  }
+  if (p[0] & BULK_FLAG_POLL) {
+    sendStatus(index);
+  }
+}
+
+// ----- API -----
+
+void bulkBegin(uint8_t peer, BulkSendFn send, BulkPhoneFn phone, BulkRoomFn room) {
+  memset(&tx, 0, sizeof(tx));
+  memset(&rx, 0, sizeof(rx));
+  peerId = peer;
+  sendFn = send;
+  phoneFn = phone;
+  roomFn = room;
+  stats = BulkStats();
+  stats.stateBytes = sizeof(tx) + sizeof(rx);
+}
+
+void bulkRestore(const uint8_t* cp, size_t len, uint32_t nowMs) {
+  if (len != LORA_BULK_CHECKPOINT_SIZE || !(cp[0] & BULK_CP_ACTIVE) || cp[3] == 0) {
+    return;
+  }
+  uint32_t size = get32(cp + 8);
+  uint32_t blocks = blockCount(size, cp[3]);
+  uint16_t base = get16(cp + 12);
+  if (blocks == 0 || blocks > LORA_BULK_MAX_BLOCKS || base > blocks) {
+    return;
+  }
+
+  memset(&rx, 0, sizeof(rx));
+  rx.active = true;
+  rx.complete = (cp[0] & BULK_CP_COMPLETE) != 0;
+  rx.src = cp[1];
+  rx.xfer = cp[2];
+  rx.blockSize = cp[3];
+  rx.objectId = get32(cp + 4);
+  rx.size = size;
+  rx.blocks = (uint16_t)blocks;
+  rx.base = base;
+  rx.startedMs = rx.lastMs = nowMs;
+  for (uint16_t i = 0; i < base; i++) {
+    setBit(rx.have, i);
+  }
+  rx.received = base;
+  for (uint16_t k = 0; k < BULK_STATUS_SPAN && base + k < rx.blocks; k++) {
+    if (testBit(cp + 14, k)) {
+      setBit(rx.have, (uint16_t)(base + k));
+      rx.received++;
+    }
+  }
+}
+
+void bulkSetAirtime(uint32_t dataFrameMs, uint32_t statusFrameMs) {
+  pollTimeoutMs = dataFrameMs + statusFrameMs + LORA_BULK_TURNAROUND_MS;
+}
+
+void bulkOnPhone(const uint8_t* msg, size_t len, uint8_t blockSize, uint32_t nowMs) {
+  if (len < 5) {
+    return;
+  }
+  uint32_t objectId = get32(msg + 1);
+
+  switch (msg[0]) {
+    case BULK_PHONE_OFFER:
+      if (len < 9) {
+        return;
+      }
+      // Offered again after a drop or a stall: the receiver's bitmap says
+      // where to go on
+      if (tx.state != BULK_TX_IDLE && tx.objectId == objectId && tx.size == get32(msg + 5)) {
+        sendOffer(nowMs);
+        tx.polls = 0;
+        return;
+      }
+      startOffer(objectId, get32(msg + 5), blockSize, nowMs);
+      break;
+    case BULK_PHONE_BLOCK:
+      if (len >= 7) {
+        onPhoneBlock(objectId, get16(msg + 5), msg + 7, len - 7, nowMs);
+      }
+      break;
+    case BULK_PHONE_CANCEL:
+      if (tx.state != BULK_TX_IDLE && tx.objectId == objectId) {
+        sendShort(BULK_OP_CANCEL, peerId, tx.xfer);
+        tx.state = BULK_TX_IDLE;
+      }
+      break;
+  }
+}
+
+void bulkOnFrame(uint8_t src, const uint8_t* payload, size_t len, uint32_t nowMs) {
+  if (len < 2) {
+    return;
+  }
+  switch (payload[0] & BULK_OP_MASK) {
+    case BULK_OP_OFFER:
+      onOffer(src, payload, len, nowMs);
+      break;
+    case BULK_OP_DATA:
+      onData(src, payload, len, nowMs);
+      break;
+    case BULK_OP_STATUS:
+      if (src == peerId) {
+        onStatus(payload, len, nowMs);
+      }
+      break;
+    case BULK_OP_REFUSE:
+      if (src == peerId && payload[1] == tx.xfer && tx.state == BULK_TX_WAITING) {
+        stallTx(BULK_STALL_REFUSED);
+      }
+      break;
+    case BULK_OP_CANCEL:
+      if (rx.active && rx.src == src && rx.xfer == payload[1]) {
+        rx.active = false;
+        checkpoint();
+      }
+      break;
+  }
+}
+
+void bulkPoll(uint32_t nowMs, size_t radioBacklog) {
+  switch (tx.state) {
+    case BULK_TX_WAITING:
+    case BULK_TX_HOLD: {
+      // The clock starts once our frames are off the queue
+      if (radioBacklog > 0) {
+        tx.pollMs = nowMs;
+        return;
+      }
+      uint32_t wait = (tx.state == BULK_TX_HOLD) ? LORA_BULK_HOLD_MS : pollTimeoutMs;
+      if (nowMs - tx.pollMs < wait) {
+        return;
+      }
+      if (tx.state == BULK_TX_WAITING) {
+        stats.pollTimeouts++;
+        if (++tx.polls > LORA_BULK_MAX_POLLS) {
+          stallTx(BULK_STALL_NO_ANSWER);
+          return;
+        }
+      }
+      // An offer doubles as a poll
+      bool offered = tx.offered;
+      sendOffer(nowMs);
+      tx.offered = offered;
+      break;
+    }
+    case BULK_TX_SENDING: {
+      if (tx.wantNext < tx.wantEnd) {
+        if (nowMs - tx.phoneMs > LORA_BULK_PHONE_TIMEOUT_MS) {
+          stallTx(BULK_STALL_PHONE);
+        }
+        return;
+      }
+      if (radioBacklog >= LORA_BULK_BACKLOG) {
+        return;
+      }
+      uint16_t first = nextWanted(tx.cursor);
+      if (first >= tx.blocks) {
+        // Pass over without a poll on its last block (it was never sent)
+        sendOffer(nowMs);
+        tx.offered = false;
+        tx.polls = 0;
+        return;
+      }
+      uint16_t end = first + 1;
+      while (end < tx.blocks && end - first < LORA_BULK_WINDOW && wanted(end)) {
+        end++;
+      }
+      tx.wantNext = first;
+      tx.wantEnd = end;
+      tx.cursor = end;
+      tx.phoneMs = nowMs;
+
+      uint8_t need[4];
+      need[0] = tx.blockSize;
+      put16(need + 1, first);
+      need[3] = (uint8_t)(end - first);
+      sendNote(BULK_PHONE_NEED, tx.objectId, need, sizeof(need), BULK_NOTE_STATUS);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void bulkForget(const uint8_t* note, size_t len) {
+  if (len < LORA_BULK_NOTE_HEADER || note[1] != BULK_PHONE_DATA || !rx.active ||
+      get32(note + 2) != rx.objectId) {
+    return;
+  }
+  uint32_t offset = get32(note + 6);
+  uint32_t index = offset / rx.blockSize;
+  if (offset % rx.blockSize != 0 || index >= rx.blocks || !testBit(rx.have, (uint16_t)index)) {
+    return;
+  }
+  clearBit(rx.have, (uint16_t)index);
+  rx.received--;
+  rx.complete = false;
+  if (index < rx.base) {
+    rx.base = (uint16_t)index;
+  }
+}
+
+void bulkTrimCheckpoint(uint8_t* cp, size_t len) {
+  if (len != LORA_BULK_CHECKPOINT_SIZE || !(cp[0] & BULK_CP_ACTIVE) || !rx.active ||
+      cp[1] != rx.src || get32(cp + 4) != rx.objectId) {
+    return;
+  }
+  // Keep the blocks both the checkpoint and the live bitmap have
+  uint16_t oldBase = get16(cp + 12);
+  uint8_t window[LORA_BULK_STATUS_BYTES];
+  memcpy(window, cp + 14, sizeof(window));
+  uint32_t end = (uint32_t)oldBase + BULK_STATUS_SPAN;
+  if (end > rx.blocks) {
+    end = rx.blocks;
+  }
+  uint16_t base = 0;
+  while (base < end && testBit(rx.have, base) &&
+         (base < oldBase || testBit(window, (uint16_t)(base - oldBase)))) {
+    base++;
+  }
+  memset(cp + 14, 0, LORA_BULK_STATUS_BYTES);
+  for (uint32_t i = base + 1; i < end && i - base < BULK_STATUS_SPAN; i++) {
+    if (testBit(rx.have, (uint16_t)i) && (i < oldBase || testBit(window, (uint16_t)(i - oldBase)))) {
+      setBit(cp + 14, (uint16_t)(i - base));
+    }
+  }
+  put16(cp + 12, base);
+  if (!rx.complete) {
+    cp[0] &= (uint8_t)~BULK_CP_COMPLETE;
+  }
+}
+
+bool bulkIdle() {
+  return tx.state == BULK_TX_IDLE || tx.state == BULK_TX_PAUSED;
+}
+
+const BulkStats& bulkGetStats() {
+  bool sending = tx.state != BULK_TX_IDLE;
+  stats.txObject = sending ? tx.objectId : 0;
+  stats.txDelivered = sending ? tx.delivered : 0;
+  stats.txBlocks = sending ? tx.blocks : 0;
+  stats.rxObject = rx.active ? rx.objectId : 0;
+  stats.rxReceived = rx.active ? rx.received : 0;
+  stats.rxBlocks = rx.active ? rx.blocks : 0;
+  return stats;
+}
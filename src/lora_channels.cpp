@@ -0,0 +1,24 @@
+#include "lora_channels.h"
+#include "lora_frame.h"
+
+#if LORA_CHANNEL_COUNT < 1 || LORA_CHANNEL_COUNT > LORA_CHANNEL_MAX
+#error "LORA_CHANNEL_COUNT must be 1..8"
+#endif
+
+// 600 kHz apart: no overlap even at 500 kHz bandwidth
+const float LORA_CHANNEL_PLAN_MHZ[LORA_CHANNEL_MAX] = {
+  915.0f, 915.6f, 916.2f, 916.8f, 917.4f, 918.0f, 918.6f, 919.2f
+};
+
+uint8_t loraHomeChannel(uint8_t stationId) {
+  uint32_t h = (uint32_t)stationId * 0x9E3779B1u;
+  return (uint8_t)((h >> 24) % LORA_CHANNEL_COUNT);
+}
+
+uint8_t loraChannelMask(uint8_t nextHop, uint8_t dst) {
+  uint8_t to = (nextHop != LORA_BROADCAST_ID) ? nextHop : dst;
+  if (to == LORA_BROADCAST_ID) {
+    return LORA_CHANNEL_ALL;
+  }
+  return (uint8_t)(1u << loraHomeChannel(to));
+}
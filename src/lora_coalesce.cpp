@@ -0,0 +1,37 @@
+#include "lora_coalesce.h"
+#include <string.h>
+
+bool LoRaCoalescer::fits(size_t msgLen, size_t budget) const {
+  if (budget > sizeof(buf)) {
+    budget = sizeof(buf);
+  }
+  return count < LORA_COALESCE_MAX_MSGS && msgLen <= 0xFF && len + LORA_COALESCE_RECORD_HDR + msgLen <= budget;
+}
+
+void LoRaCoalescer::add(const uint8_t* msg, size_t msgLen) {
+  buf[len] = (uint8_t)msgLen;
+  memcpy(buf + len + LORA_COALESCE_RECORD_HDR, msg, msgLen);
+  len += LORA_COALESCE_RECORD_HDR + msgLen;
+  count++;
+}
+
+const uint8_t* LoRaCoalescer::first(size_t* msgLen) const {
+  *msgLen = buf[0];
+  return buf + LORA_COALESCE_RECORD_HDR;
+}
+
+bool loraCoalescedNext(const uint8_t* payload, size_t len, size_t* offset,
+                       const uint8_t** msg, size_t* msgLen) {
+  if (*offset + LORA_COALESCE_RECORD_HDR > len) {
+    return false;
+  }
+  size_t recordLen = payload[*offset];
+  size_t start = *offset + LORA_COALESCE_RECORD_HDR;
+  if (start + recordLen > len) {
+    return false;
+  }
+  *msg = payload + start;
+  *msgLen = recordLen;
+  *offset = start + recordLen;
+  return true;
+}
@@ -0,0 +1,166 @@
+#include "lora_compress.h"
+#include <string.h>
+
+// Grouped by first byte, longest first within a group, so the first hit
+// in a group is the longest match. At most 254 entries (0xFE/0xFF are
+// reserved); tuned for short English chat lines.
+static const char* const CODEBOOK[] = {
+  "\n", " on my way", " tomorrow", " battery", " message", " please",
+  " signal", " thanks", " about", " hello", " later", " there", " today",
+  " where", " back", " come", " from", " good", " have", " here", " home",
+  " just", " know", " like", " need", " okay", " soon", " sure", " that",
+  " this", " time", " wait", " want", " what", " when", " will", " with",
+  " your", " all", " and", " are", " but", " can", " for", " get", " hey",
+  " how", " not", " now", " one", " out", " see", " the", " was", " yes",
+  " you", " ? ", " I ", " a ", " at", " be", " ca", " co", " de", " do",
+  " go", " he", " hi", " i ", " if", " im", " in", " is", " it", " ma",
+  " me", " my", " no", " of", " ok", " on", " or", " re", " se", " sh",
+  " so", " st", " th", " to", " up", " we", " wh", " wi", " ", "! ", "!!",
+  "!", "'m ", "'t ", "'s", "'", ", ", ",", ". ", "..", ".", "0", "1", "2",
+  "3", "4", "5", "6", "7", "8", "9", ":)", "?? ", "? ", "?", "A", "B", "C",
+  "D", "E", "F", "G", "H", "I", "L", "M", "N", "O", "P", "R", "S", "T", "U",
+  "W", "Y", "ation", "and ", "ave", "al", "an", "ar", "as", "at", "ay", "a",
+  "be", "b", "ce", "ch", "ck", "co", "c", "d ", "de", "d", "ed ", "ent",
+  "er ", "ere", "es ", "e ", "ea", "ed", "ee", "en", "er", "es", "e", "f",
+  "g", "ha", "he", "hi", "h", "ight", "in ", "ing", "ion", "it ", "ith",
+  "ic", "in", "io", "is", "it", "i", "j", "k", "ll ", "lol", "ly ", "le",
+  "li", "ll", "l", "ma", "me", "m", "n ", "nd", "ne", "ng", "no", "nt", "n",
+  "ould", "ome", "our", "o ", "of", "ok", "om", "on", "oo", "or", "ou", "ow",
+  "o", "p", "q", "r ", "ra", "re", "ri", "ro", "r", "s ", "se", "si", "st",
+  "s", "the ", "to ", "t ", "te", "th", "ti", "t", "ur", "u", "ve", "v",
+  "wa", "w", "x", "you", "y ", "y", "z"
+};
+
+#define CODEBOOK_SIZE (sizeof(CODEBOOK) / sizeof(CODEBOOK[0]))
+
+static uint8_t entryLen[CODEBOOK_SIZE];
+static uint8_t groupStart[256];
+static uint8_t groupCount[256];
+static LoRaCompressStats stats = {};
+
+void loraCompressBegin() {
+  memset(groupCount, 0, sizeof(groupCount));
+  for (size_t i = 0; i < CODEBOOK_SIZE; i++) {
+    uint8_t first = (uint8_t)CODEBOOK[i][0];
+    entryLen[i] = (uint8_t)strlen(CODEBOOK[i]);
+    if (groupCount[first] == 0) {
+      groupStart[first] = (uint8_t)i;
+    }
+    groupCount[first]++;
+  }
+}
+
+// Emits pending literals as a single byte or a run
+static bool flushLiterals(const uint8_t* lit, size_t n, uint8_t* out, size_t capacity, size_t* pos) {
+  while (n > 0) {
+    size_t take = (n > LORA_COMPRESS_MAX_RUN) ? LORA_COMPRESS_MAX_RUN : n;
+    size_t need = (take == 1) ? 2 : take + 2;
+    if (*pos + need > capacity) {
+      return false;
+    }
+    if (take == 1) {
+      out[(*pos)++] = LORA_COMPRESS_LITERAL;
+    } else {
+      out[(*pos)++] = LORA_COMPRESS_RUN;
+      out[(*pos)++] = (uint8_t)(take - 1);
+    }
+    memcpy(out + *pos, lit, take);
+    *pos += take;
+    lit += take;
+    n -= take;
+  }
+  return true;
+}
+
+size_t loraCompress(const uint8_t* in, size_t len, uint8_t* out, size_t capacity) {
+  size_t pos = 0;
+  size_t litStart = 0;
+  size_t litLen = 0;
+  stats.messages++;
+
+  for (size_t i = 0; i < len; ) {
+    uint8_t c = in[i];
+    size_t match = CODEBOOK_SIZE;
+    for (uint8_t k = 0; k < groupCount[c]; k++) {
+      size_t e = groupStart[c] + k;
+      size_t n = entryLen[e];
+      if (n <= len - i && memcmp(in + i, CODEBOOK[e], n) == 0) {
+        match = e;
+        break;
+      }
+    }
+
+    if (match == CODEBOOK_SIZE) {
+      if (litLen == 0) {
+        litStart = i;
+      }
+      litLen++;
+      i++;
+      continue;
+    }
+
+    if (!flushLiterals(in + litStart, litLen, out, capacity, &pos) || pos >= capacity) {
+      return 0;
+    }
+    litLen = 0;
+    out[pos++] = (uint8_t)match;
+    i += entryLen[match];
+  }
+
+  if (!flushLiterals(in + litStart, litLen, out, capacity, &pos)) {
+    return 0;
+  }
+
+  stats.compressed++;
+  stats.bytesIn += len;
+  stats.bytesOut += pos;
+  return pos;
+}
+
+static bool inflate(const uint8_t* in, size_t len, uint8_t* out, size_t capacity,
+                    size_t* outLen) {
+  size_t pos = 0;
+  size_t i = 0;
+
+  while (i < len) {
+    uint8_t code = in[i++];
+    const uint8_t* src;
+    size_t n;
+
+    if (code == LORA_COMPRESS_LITERAL || code == LORA_COMPRESS_RUN) {
+      n = 1;
+      if (code == LORA_COMPRESS_RUN) {
+        if (i >= len) return false;
+        n = (size_t)in[i++] + 1;
+      }
+      if (n > len - i) return false;
+      src = in + i;
+      i += n;
+    } else {
+      if (code >= CODEBOOK_SIZE) return false;
+      src = (const uint8_t*)CODEBOOK[code];
+      n = entryLen[code];
+    }
+
+    if (n > capacity - pos) return false;
+    memcpy(out + pos, src, n);
+    pos += n;
+  }
+
+  *outLen = pos;
+  return true;
+}
+
+bool loraDecompress(const uint8_t* in, size_t len, uint8_t* out, size_t capacity,
+                    size_t* outLen) {
+  if (!inflate(in, len, out, capacity, outLen)) {
+    stats.inflateErrors++;
+    return false;
+  }
+  stats.inflated++;
+  return true;
+}
+
+const LoRaCompressStats& loraCompressGetStats() {
+  return stats;
+}
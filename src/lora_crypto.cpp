@@ -0,0 +1,312 @@
+#include "lora_crypto.h"
+#include "lora_frame.h"
+#include <string.h>
+
+#ifndef LORA_CRYPTO_SOFTWARE
+#ifdef ARDUINO
+#define LORA_CRYPTO_SOFTWARE 0    // mbedTLS on the AES accelerator
+#else
+#define LORA_CRYPTO_SOFTWARE 1
+#endif
+#endif
+
+#define CCM_BLOCK 16
+#define CCM_L     (15 - LORA_CRYPTO_NONCE_SIZE)   // Length field bytes: 2, frames are short
+
+static LoRaCryptoStats stats = {};
+
+#if LORA_CRYPTO_SOFTWARE
+
+// ===== Portable AES-128 (encryption only; CCM never decrypts a block) =====
+
+static const uint8_t SBOX[256] = {
+  0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+  0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+  0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+  0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+  0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+  0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+  0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+  0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+  0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+  0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+  0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+  0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+  0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+  0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+  0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+  0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+static uint8_t roundKeys[176];
+
+static uint8_t xtime(uint8_t x) {
+  return (uint8_t)((x << 1) ^ ((x & 0x80) ? 0x1b : 0));
+}
+
+static void expandKey(const uint8_t* key) {
+  memcpy(roundKeys, key, 16);
+  uint8_t rcon = 1;
+  for (uint8_t i = 16; i < 176; i += 4) {
+    uint8_t t[4];
+    memcpy(t, roundKeys + i - 4, 4);
+    if (i % 16 == 0) {
+      uint8_t first = t[0];
+      t[0] = (uint8_t)(SBOX[t[1]] ^ rcon);
+      t[1] = SBOX[t[2]];
+      t[2] = SBOX[t[3]];
+      t[3] = SBOX[first];
+      rcon = xtime(rcon);
+    }
+    for (uint8_t j = 0; j < 4; j++) {
+      roundKeys[i + j] = roundKeys[i + j - 16] ^ t[j];
+    }
+  }
+}
+
+static void aesEncrypt(const uint8_t* in, uint8_t* out) {
+  uint8_t s[16];
+  for (uint8_t i = 0; i < 16; i++) {
+    s[i] = in[i] ^ roundKeys[i];
+  }
+  for (uint8_t round = 1; round <= 10; round++) {
+    // SubBytes and ShiftRows together; state is column-major
+    uint8_t t[16];
+    for (uint8_t c = 0; c < 4; c++) {
+      for (uint8_t r = 0; r < 4; r++) {
+        t[c * 4 + r] = SBOX[s[((c + r) & 3) * 4 + r]];
+      }
+    }
+    if (round < 10) {
+      for (uint8_t c = 0; c < 4; c++) {
+        uint8_t* col = t + c * 4;
+        uint8_t all = col[0] ^ col[1] ^ col[2] ^ col[3];
+        uint8_t first = col[0];
+        col[0] ^= all ^ xtime(col[0] ^ col[1]);
+        col[1] ^= all ^ xtime(col[1] ^ col[2]);
+        col[2] ^= all ^ xtime(col[2] ^ col[3]);
+        col[3] ^= all ^ xtime(col[3] ^ first);
+      }
+    }
+    for (uint8_t i = 0; i < 16; i++) {
+      s[i] = t[i] ^ roundKeys[round * 16 + i];
+    }
+  }
+  memcpy(out, s, 16);
+}
+
+// ===== CCM (RFC 3610) over the software block cipher =====
+
+// Counter block A_i; i = 0 encrypts the tag
+static void ccmCounter(const uint8_t* nonce, uint16_t i, uint8_t* block) {
+  block[0] = CCM_L - 1;
+  memcpy(block + 1, nonce, LORA_CRYPTO_NONCE_SIZE);
+  block[14] = (uint8_t)(i >> 8);
+  block[15] = (uint8_t)(i & 0xFF);
+}
+
+static void ccmXorBlocks(uint8_t* x, const uint8_t* data, size_t len) {
+  uint8_t y[CCM_BLOCK];
+  for (size_t off = 0; off < len; off += CCM_BLOCK) {
+    size_t n = (len - off < CCM_BLOCK) ? len - off : CCM_BLOCK;
+    for (size_t k = 0; k < n; k++) {
+      x[k] ^= data[off + k];
+    }
+    aesEncrypt(x, y);
+    memcpy(x, y, CCM_BLOCK);
+  }
+}
+
+// CBC-MAC over B0, the associated data and the plaintext
+static void ccmMac(const uint8_t* nonce, const uint8_t* aad, size_t aadLen,
+                   const uint8_t* msg, size_t len, uint8_t* mac) {
+  uint8_t b[CCM_BLOCK];
+  b[0] = (uint8_t)((aadLen ? 0x40 : 0) | (((LORA_CRYPTO_TAG_SIZE - 2) / 2) << 3) | (CCM_L - 1));
+  memcpy(b + 1, nonce, LORA_CRYPTO_NONCE_SIZE);
+  b[14] = (uint8_t)(len >> 8);
+  b[15] = (uint8_t)(len & 0xFF);
+  aesEncrypt(b, mac);
+
+  // Associated data: [length, 16 bits BE][data], padded to blocks
+  if (aadLen > 0) {
+    uint8_t a[LORA_FRAME_MAX_HEADER + 2];
+    a[0] = (uint8_t)(aadLen >> 8);
+    a[1] = (uint8_t)(aadLen & 0xFF);
+    memcpy(a + 2, aad, aadLen);
+    ccmXorBlocks(mac, a, aadLen + 2);
+  }
+  ccmXorBlocks(mac, msg, len);
+}
+
+static void ccmCtr(const uint8_t* nonce, uint8_t* data, size_t len) {
+  uint8_t a[CCM_BLOCK];
+  uint8_t s[CCM_BLOCK];
+  uint16_t i = 1;
+  for (size_t off = 0; off < len; off += CCM_BLOCK, i++) {
+    ccmCounter(nonce, i, a);
+    aesEncrypt(a, s);
+    size_t n = (len - off < CCM_BLOCK) ? len - off : CCM_BLOCK;
+    for (size_t k = 0; k < n; k++) {
+      data[off + k] ^= s[k];
+    }
+  }
+}
+
+static void ccmTag(const uint8_t* nonce, const uint8_t* mac, uint8_t* tag) {
+  uint8_t a[CCM_BLOCK];
+  uint8_t s0[CCM_BLOCK];
+  ccmCounter(nonce, 0, a);
+  aesEncrypt(a, s0);
+  for (uint8_t k = 0; k < LORA_CRYPTO_TAG_SIZE; k++) {
+    tag[k] = mac[k] ^ s0[k];
+  }
+}
+
+static bool setKey(const uint8_t* key) {
+  expandKey(key);
+  return true;
+}
+
+static void encryptAndTag(const uint8_t* nonce, const uint8_t* aad, size_t aadLen,
+                          uint8_t* body, size_t len, uint8_t* tag) {
+  uint8_t mac[CCM_BLOCK];
+  ccmMac(nonce, aad, aadLen, body, len, mac);
+  ccmCtr(nonce, body, len);
+  ccmTag(nonce, mac, tag);
+}
+
+static bool authDecrypt(const uint8_t* nonce, const uint8_t* aad, size_t aadLen,
+                        uint8_t* body, size_t len, const uint8_t* tag) {
+  uint8_t mac[CCM_BLOCK];
+  uint8_t expected[LORA_CRYPTO_TAG_SIZE];
+  ccmCtr(nonce, body, len);
+  ccmMac(nonce, aad, aadLen, body, len, mac);
+  ccmTag(nonce, mac, expected);
+  uint8_t diff = 0;
+  for (uint8_t k = 0; k < LORA_CRYPTO_TAG_SIZE; k++) {
+    diff |= expected[k] ^ tag[k];
+  }
+  return diff == 0;
+}
+
+#else
+
+// ===== mbedTLS, backed by the ESP32 AES accelerator =====
+#include <Arduino.h>
+#include <mbedtls/ccm.h>
+
+static mbedtls_ccm_context ccm;
+static SemaphoreHandle_t cryptoMutex = NULL;   // Frames are sealed from the radio task and loop()
+
+static bool setKey(const uint8_t* key) {
+  if (cryptoMutex == NULL) {
+    cryptoMutex = xSemaphoreCreateMutex();
+    mbedtls_ccm_init(&ccm);
+  }
+  return cryptoMutex != NULL && mbedtls_ccm_setkey(&ccm, MBEDTLS_CIPHER_ID_AES, key, 128) == 0;
+}
+
+static void encryptAndTag(const uint8_t* nonce, const uint8_t* aad, size_t aadLen,
+                          uint8_t* body, size_t len, uint8_t* tag) {
+  xSemaphoreTake(cryptoMutex, portMAX_DELAY);
+  mbedtls_ccm_encrypt_and_tag(&ccm, len, nonce, LORA_CRYPTO_NONCE_SIZE, aad, aadLen,
+                              body, body, tag, LORA_CRYPTO_TAG_SIZE);
+  xSemaphoreGive(cryptoMutex);
+}
+
+static bool authDecrypt(const uint8_t* nonce, const uint8_t* aad, size_t aadLen,
+                        uint8_t* body, size_t len, const uint8_t* tag) {
+  xSemaphoreTake(cryptoMutex, portMAX_DELAY);
+  int ret = mbedtls_ccm_auth_decrypt(&ccm, len, nonce, LORA_CRYPTO_NONCE_SIZE, aad, aadLen,
+                                     body, body, tag, LORA_CRYPTO_TAG_SIZE);
+  xSemaphoreGive(cryptoMutex);
+  return ret == 0;
+}
+
+#endif
+
+static int hexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+bool loraCryptoBegin(const char* keyHex) {
+  uint8_t key[LORA_CRYPTO_KEY_SIZE];
+  if (strlen(keyHex) != 2 * LORA_CRYPTO_KEY_SIZE) {
+    return false;
+  }
+  for (uint8_t i = 0; i < LORA_CRYPTO_KEY_SIZE; i++) {
+    int hi = hexDigit(keyHex[2 * i]);
+    int lo = hexDigit(keyHex[2 * i + 1]);
+    if (hi < 0 || lo < 0) {
+      return false;
+    }
+    key[i] = (uint8_t)((hi << 4) | lo);
+  }
+  bool ok = setKey(key);
+  memset(key, 0, sizeof(key));
+  return ok;
+}
+
+// Header as associated data, minus the bit relays rewrite
+static size_t frameAad(const uint8_t* frame, size_t headerLen, uint8_t* aad) {
+  memcpy(aad, frame, headerLen);
+  aad[LORA_FRAME_FLAGS_OFFSET] &= (uint8_t)~FRAME_FLAG_SNIFF;
+  return headerLen;
+}
+
+// [src][epoch, LE][seq, LE] from the header, zero-padded
+static void frameNonce(const uint8_t* frame, uint16_t epoch, uint8_t* nonce) {
+  memset(nonce, 0, LORA_CRYPTO_NONCE_SIZE);
+  nonce[0] = frame[1];
+  nonce[1] = (uint8_t)(epoch & 0xFF);
+  nonce[2] = (uint8_t)(epoch >> 8);
+  nonce[3] = frame[3];
+  nonce[4] = frame[4];
+}
+
+bool loraCryptoSeal(uint8_t* frame, size_t headerLen, size_t clearLen, size_t bodyLen, uint16_t epoch) {
+  if (headerLen > LORA_FRAME_MAX_HEADER) {
+    return false;
+  }
+  uint8_t aad[LORA_FRAME_MAX_HEADER];
+  uint8_t nonce[LORA_CRYPTO_NONCE_SIZE];
+  size_t aadLen = frameAad(frame, headerLen, aad);
+  frameNonce(frame, epoch, nonce);
+
+  uint8_t* sealed = frame + headerLen + clearLen;
+  sealed[0] = (uint8_t)(epoch & 0xFF);
+  sealed[1] = (uint8_t)(epoch >> 8);
+  uint8_t* body = sealed + LORA_CRYPTO_EPOCH_SIZE;
+  encryptAndTag(nonce, aad, aadLen, body, bodyLen, body + bodyLen);
+  stats.sealed++;
+  return true;
+}
+
+bool loraCryptoOpen(uint8_t* frame, size_t headerLen, size_t clearLen, size_t sealedLen) {
+  if (headerLen > LORA_FRAME_MAX_HEADER || sealedLen < LORA_CRYPTO_EPOCH_SIZE + LORA_CRYPTO_TAG_SIZE) {
+    stats.rejected++;
+    return false;
+  }
+  uint8_t* sealed = frame + headerLen + clearLen;
+  uint16_t epoch = (uint16_t)(sealed[0] | (sealed[1] << 8));
+  uint8_t aad[LORA_FRAME_MAX_HEADER];
+  uint8_t nonce[LORA_CRYPTO_NONCE_SIZE];
+  size_t aadLen = frameAad(frame, headerLen, aad);
+  frameNonce(frame, epoch, nonce);
+
+  uint8_t* body = sealed + LORA_CRYPTO_EPOCH_SIZE;
+  size_t bodyLen = sealedLen - LORA_CRYPTO_EPOCH_SIZE - LORA_CRYPTO_TAG_SIZE;
+  if (!authDecrypt(nonce, aad, aadLen, body, bodyLen, body + bodyLen)) {
+    stats.rejected++;
+    return false;
+  }
+  stats.opened++;
+  return true;
+}
+
+const LoRaCryptoStats& loraCryptoGetStats() {
+  return stats;
+}
@@ -0,0 +1,115 @@
+#include "lora_dedup.h"
+#include <string.h>
+
+#define FILTER_BYTES  (LORA_DEDUP_FILTER_BITS / 8)
+#define FILTER_MASK   (LORA_DEDUP_FILTER_BITS - 1)
+
+static uint8_t filters[2][FILTER_BYTES];
+static uint8_t current = 0;
+static uint16_t generationIds = 0;
+static uint16_t previousIds = 0;      // Inserted in the previous generation
+static uint32_t generationStartMs = 0;
+
+static uint32_t ring[LORA_DEDUP_RING_SIZE];
+static uint8_t ringNext = 0;
+static uint8_t ringCount = 0;
+
+static LoRaDedupStats stats = {};
+
+// Murmur3 finalizer; cheap and mixes all input bits
+static uint32_t mix(uint32_t key) {
+  key ^= key >> 16;
+  key *= 0x85EBCA6B;
+  key ^= key >> 13;
+  key *= 0xC2B2AE35;
+  key ^= key >> 16;
+  return key;
+}
+
+// Double hashing: bit i = h1 + i * h2
+static uint16_t bitIndex(uint32_t hash, uint8_t i) {
+  uint16_t h1 = (uint16_t)hash;
+  uint16_t h2 = (uint16_t)(hash >> 16) | 1;
+  return (uint16_t)(h1 + i * h2) & FILTER_MASK;
+}
+
+static bool filterHas(const uint8_t* filter, uint32_t hash) {
+  for (uint8_t i = 0; i < LORA_DEDUP_HASHES; i++) {
+    uint16_t bit = bitIndex(hash, i);
+    if (!(filter[bit >> 3] & (1 << (bit & 7)))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void filterAdd(uint8_t* filter, uint32_t hash) {
+  for (uint8_t i = 0; i < LORA_DEDUP_HASHES; i++) {
+    uint16_t bit = bitIndex(hash, i);
+    filter[bit >> 3] |= (1 << (bit & 7));
+  }
+}
+
+static void rotate(uint32_t nowMs) {
+  current ^= 1;
+  memset(filters[current], 0, FILTER_BYTES);
+  previousIds = generationIds;
+  generationIds = 0;
+  generationStartMs = nowMs;
+  stats.rotations++;
+}
+
+void loraDedupBegin(uint32_t nowMs) {
+  memset(filters, 0, sizeof(filters));
+  current = 0;
+  generationIds = previousIds = 0;
+  generationStartMs = nowMs;
+  ringNext = ringCount = 0;
+}
+
+bool loraDedupCheck(uint8_t src, uint16_t seq, uint32_t nowMs) {
+  uint32_t key = ((uint32_t)src << 16) | seq;
+  uint32_t hash = mix(key);
+  stats.checked++;
+
+  if (generationIds >= LORA_DEDUP_GENERATION_IDS ||
+      nowMs - generationStartMs > LORA_DEDUP_GENERATION_MS) {
+    rotate(nowMs);
+  }
+
+  bool inCurrent = filterHas(filters[current], hash);
+  bool inPrevious = filterHas(filters[current ^ 1], hash);
+  if (inCurrent || inPrevious) {
+    for (uint8_t i = 0; i < ringCount; i++) {
+      if (ring[i] == key) {
+        stats.duplicates++;
+        stats.ringHits++;
+        return true;
+      }
+    }
+
+    // The ring holds the latest IDs. If everything the matching
+    // generation(s) took is still in it, the filter hit is false.
+    uint32_t since = inPrevious ? (uint32_t)generationIds + previousIds : generationIds;
+    if (since > LORA_DEDUP_RING_SIZE) {
+      stats.duplicates++;
+      stats.filterOnlyHits++;
+      return true;
+    }
+    stats.ringMisses++;
+  }
+
+  filterAdd(filters[current], hash);
+  generationIds++;
+
+  ring[ringNext] = key;
+  ringNext = (ringNext + 1) % LORA_DEDUP_RING_SIZE;
+  if (ringCount < LORA_DEDUP_RING_SIZE) {
+    ringCount++;
+  }
+  return false;
+}
+
+const LoRaDedupStats& loraDedupGetStats() {
+  return stats;
+}
@@ -0,0 +1,140 @@
+#include "lora_fec.h"
+#include "lora_fragment.h"
+#include <string.h>
+
+#define GF_POLY 0x11D     // x^8 + x^4 + x^3 + x^2 + 1, generator 2
+
+static_assert(LORA_FRAG_MAX_FRAGMENTS + LORA_FEC_MAX_REPAIR <= 256, "Cauchy points must be distinct field elements");
+
+static uint8_t gfExp[512];    // Doubled so a sum of two logs needs no modulo
+static uint8_t gfLog[256];
+
+void loraFecBegin() {
+  uint16_t x = 1;
+  for (uint16_t i = 0; i < 255; i++) {
+    gfExp[i] = (uint8_t)x;
+    gfLog[x] = (uint8_t)i;
+    x <<= 1;
+    if (x & 0x100) {
+      x ^= GF_POLY;
+    }
+  }
+  for (uint16_t i = 255; i < sizeof(gfExp); i++) {
+    gfExp[i] = gfExp[i - 255];
+  }
+  gfLog[0] = 0;
+}
+
+static uint8_t gfMul(uint8_t a, uint8_t b) {
+  return (a == 0 || b == 0) ? 0 : gfExp[gfLog[a] + gfLog[b]];
+}
+
+static uint8_t gfInv(uint8_t a) {
+  return gfExp[255 - gfLog[a]];
+}
+
+// Generator coefficient of data shard i in repair shard j
+static uint8_t cauchy(uint8_t j, uint8_t i) {
+  return gfInv((uint8_t)((LORA_FRAG_MAX_FRAGMENTS + j) ^ i));
+}
+
+// dst ^= c * src over n bytes
+static void mulAdd(uint8_t* dst, const uint8_t* src, uint8_t c, size_t n) {
+  if (c == 0) return;
+  const uint8_t* e = gfExp + gfLog[c];
+  for (size_t k = 0; k < n; k++) {
+    uint8_t s = src[k];
+    if (s != 0) {
+      dst[k] ^= e[gfLog[s]];
+    }
+  }
+}
+
+// row *= c over n bytes
+static void scale(uint8_t* row, uint8_t c, size_t n) {
+  const uint8_t* e = gfExp + gfLog[c];
+  for (size_t k = 0; k < n; k++) {
+    if (row[k] != 0) {
+      row[k] = e[gfLog[row[k]]];
+    }
+  }
+}
+
+uint8_t loraFecRepairCount(size_t dataCount) {
+  if (!LORA_FEC_ENABLED || dataCount == 0 || dataCount >= LORA_FRAG_MAX_FRAGMENTS) {
+    return 0;
+  }
+  size_t r = (dataCount * LORA_FEC_REPAIR_PCT + 99) / 100;
+  if (r < LORA_FEC_MIN_REPAIR) r = LORA_FEC_MIN_REPAIR;
+  if (r > LORA_FEC_MAX_REPAIR) r = LORA_FEC_MAX_REPAIR;
+  if (dataCount + r > LORA_FRAG_MAX_FRAGMENTS) r = LORA_FRAG_MAX_FRAGMENTS - dataCount;
+  return (uint8_t)r;
+}
+
+void loraFecEncode(const uint8_t* msg, size_t len, uint8_t dataCount, size_t chunk,
+                   uint8_t repair, uint8_t* out) {
+  memset(out, 0, chunk);
+  for (uint8_t i = 0; i < dataCount; i++) {
+    size_t offset = (size_t)i * chunk;
+    if (offset >= len) break;
+    size_t n = (len - offset < chunk) ? len - offset : chunk;
+    mulAdd(out, msg + offset, cauchy(repair, i), n);
+  }
+}
+
+bool loraFecDecode(uint8_t* rows, uint8_t dataCount, size_t chunk, const uint8_t* rowShard) {
+  uint8_t missing[LORA_FEC_MAX_REPAIR];   // Data shards to rebuild, in the rows of their repairs
+  uint8_t repairOf[LORA_FEC_MAX_REPAIR];
+  uint8_t e = 0;
+  uint16_t repairsSeen = 0;
+  for (uint8_t i = 0; i < dataCount; i++) {
+    if (rowShard[i] == i) continue;
+    uint8_t j = (uint8_t)(rowShard[i] - dataCount);
+    if (rowShard[i] < dataCount || j >= LORA_FEC_MAX_REPAIR || (repairsSeen & (1u << j))) {
+      return false;
+    }
+    repairsSeen |= (uint16_t)(1u << j);
+    missing[e] = i;
+    repairOf[e] = j;
+    e++;
+  }
+  if (e == 0) {
+    return true;
+  }
+
+  // Take the known data shards out of each repair: what is left is
+  // A * missing, with A[a][b] = C[repairOf[a]][missing[b]]
+  uint8_t a[LORA_FEC_MAX_REPAIR][LORA_FEC_MAX_REPAIR];
+  for (uint8_t r = 0; r < e; r++) {
+    uint8_t* row = rows + (size_t)missing[r] * chunk;
+    for (uint8_t i = 0; i < dataCount; i++) {
+      if (rowShard[i] == i) {
+        mulAdd(row, rows + (size_t)i * chunk, cauchy(repairOf[r], i), chunk);
+      }
+    }
+    for (uint8_t c = 0; c < e; c++) {
+      a[r][c] = cauchy(repairOf[r], missing[c]);
+    }
+  }
+
+  // Gauss-Jordan on A, applying each row operation to the shards too.
+  // Leading minors of a Cauchy matrix are never singular, so every pivot
+  // is nonzero where it stands.
+  for (uint8_t p = 0; p < e; p++) {
+    uint8_t* prow = rows + (size_t)missing[p] * chunk;
+    uint8_t inv = gfInv(a[p][p]);
+    for (uint8_t c = 0; c < e; c++) {
+      a[p][c] = gfMul(a[p][c], inv);
+    }
+    scale(prow, inv, chunk);
+    for (uint8_t r = 0; r < e; r++) {
+      uint8_t f = a[r][p];
+      if (r == p || f == 0) continue;
+      for (uint8_t c = 0; c < e; c++) {
+        a[r][c] ^= gfMul(f, a[p][c]);
+      }
+      mulAdd(rows + (size_t)missing[r] * chunk, prow, f, chunk);
+    }
+  }
+  return true;
+}
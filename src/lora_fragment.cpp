@@ -0,0 +1,235 @@
+#include "lora_fragment.h"
+#include <string.h>
+
+struct ReassemblySlot {
+  bool used;
+  bool done;            // FEC group decoded, waiting out its late fragments
+  uint8_t src;
+  uint8_t session;
+  uint8_t msgId;
+  uint8_t count;
+  uint8_t dataCount;
+  uint8_t chunk;
+  uint8_t lastLen;      // Known once the last data fragment arrives, or from the FEC header
+  uint8_t filled;       // Rows holding a fragment
+  uint16_t received;    // Bitmap of fragments seen
+  uint32_t startedMs;
+  uint8_t rowShard[LORA_FRAG_MAX_FRAGMENTS];    // Fragment in each chunk-sized row
+  uint8_t data[LORA_FRAG_MAX_MESSAGE + LORA_FRAME_MAX_SIZE];   // Room for the padded last row
+};
+
+static ReassemblySlot slots[LORA_REASM_SLOTS];
+static LoRaFragmentStats stats = {};
+
+uint8_t loraFragmentChunkForSF(uint8_t sf) {
+  // Frame payload limits in the spirit of the LoRaWAN dwell-time tables
+  uint8_t maxPayload;
+  if (sf <= 8) {
+    maxPayload = LORA_FRAME_MAX_PAYLOAD;
+  } else if (sf == 9) {
+    maxPayload = 115;
+  } else {
+    maxPayload = 51;
+  }
+  return maxPayload - LORA_FRAG_HEADER_SIZE;
+}
+
+size_t loraFragmentCount(size_t len, size_t chunk) {
+  return (len + chunk - 1) / chunk;
+}
+
+void loraFragmentWriteHeader(uint8_t* out, const LoRaFragmentHeader& hdr) {
+  out[0] = hdr.msgId;
+  out[1] = (uint8_t)((hdr.index << 4) | ((hdr.count - 1) & 0x0F));
+  out[2] = hdr.chunk;
+}
+
+bool loraFragmentReadHeader(const uint8_t* in, size_t len, LoRaFragmentHeader& hdr) {
+  if (len < LORA_FRAG_HEADER_SIZE) {
+    return false;
+  }
+  hdr.msgId = in[0];
+  hdr.index = in[1] >> 4;
+  hdr.count = (in[1] & 0x0F) + 1;
+  hdr.chunk = in[2];
+  hdr.dataCount = hdr.count;
+  hdr.lastLen = 0;
+  return hdr.index < hdr.count && hdr.chunk > 0;
+}
+
+void loraFragmentWriteFecHeader(uint8_t* out, const LoRaFragmentHeader& hdr) {
+  loraFragmentWriteHeader(out, hdr);
+  out[3] = (uint8_t)((hdr.dataCount - 1) & 0x0F);
+  out[4] = hdr.lastLen;
+}
+
+bool loraFragmentReadFecHeader(const uint8_t* in, size_t len, LoRaFragmentHeader& hdr) {
+  if (len < LORA_FRAG_FEC_HEADER_SIZE || !loraFragmentReadHeader(in, len, hdr)) {
+    return false;
+  }
+  hdr.dataCount = (in[3] & 0x0F) + 1;
+  hdr.lastLen = in[4];
+  return hdr.dataCount <= hdr.count && hdr.count - hdr.dataCount <= LORA_FEC_MAX_REPAIR &&
+         hdr.lastLen > 0 && hdr.lastLen <= hdr.chunk;
+}
+
+void loraFragmentNoteSent(bool firstOfMessage, bool repair) {
+  stats.fragmentsSent++;
+  if (firstOfMessage) {
+    stats.messagesFragmented++;
+  }
+  if (repair) {
+    stats.repairsSent++;
+  }
+}
+
+static void expireSlots(uint32_t nowMs) {
+  for (uint8_t i = 0; i < LORA_REASM_SLOTS; i++) {
+    if (slots[i].used && nowMs - slots[i].startedMs > LORA_REASM_TIMEOUT_MS) {
+      slots[i].used = false;
+      if (!slots[i].done) {
+        stats.messagesTimedOut++;
+      }
+    }
+  }
+}
+
+static void startSlot(ReassemblySlot* s, const LoRaFragmentHeader& hdr, uint32_t nowMs) {
+  s->done = false;
+  s->count = hdr.count;
+  s->dataCount = hdr.dataCount;
+  s->chunk = hdr.chunk;
+  s->lastLen = hdr.lastLen;
+  s->filled = 0;
+  s->received = 0;
+  s->startedMs = nowMs;
+  memset(s->rowShard, LORA_FEC_ROW_EMPTY, sizeof(s->rowShard));
+}
+
+static ReassemblySlot* findSlot(uint8_t src, uint8_t session, const LoRaFragmentHeader& hdr, uint32_t nowMs) {
+  ReassemblySlot* freeSlot = NULL;
+  ReassemblySlot* oldest = NULL;
+
+  for (uint8_t i = 0; i < LORA_REASM_SLOTS; i++) {
+    ReassemblySlot* s = &slots[i];
+    if (s->used && s->src == src && s->session == session && s->msgId == hdr.msgId) {
+      return s;
+    }
+    // Free slots first, then decoded groups, then evict the oldest
+    if (!s->used || s->done) {
+      if (freeSlot == NULL || (freeSlot->used && !s->used)) freeSlot = s;
+      continue;
+    }
+    if (oldest == NULL || (int32_t)(s->startedMs - oldest->startedMs) < 0) {
+      oldest = s;
+    }
+  }
+
+  ReassemblySlot* s = freeSlot;
+  if (s == NULL) {
+    s = oldest;
+    stats.messagesEvicted++;
+  }
+  s->used = true;
+  s->src = src;
+  s->session = session;
+  s->msgId = hdr.msgId;
+  startSlot(s, hdr, nowMs);
+  return s;
+}
+
+// Lowest row whose data fragment is still missing and not stood in for
+static uint8_t freeRow(const ReassemblySlot* s) {
+  uint8_t row = 0;
+  while (s->rowShard[row] != LORA_FEC_ROW_EMPTY) {
+    row++;
+  }
+  return row;
+}
+
+const uint8_t* loraReassemblyPush(uint8_t src, uint8_t session, const LoRaFragmentHeader& hdr,
+                                  const uint8_t* data, size_t len,
+                                  uint32_t nowMs, size_t* outLen) {
+  stats.fragmentsReceived++;
+  expireSlots(nowMs);
+
+  // Data fragments land in their own row; repairs are always a full chunk
+  bool repair = hdr.index >= hdr.dataCount;
+  bool last = (hdr.index == hdr.dataCount - 1);
+  size_t offset = (size_t)hdr.index * hdr.chunk;
+  bool fits = repair ? (len == hdr.chunk && (size_t)(hdr.dataCount - 1) * hdr.chunk < LORA_FRAG_MAX_MESSAGE)
+                     : (offset + len <= LORA_FRAG_MAX_MESSAGE);
+  bool sized = last ? (len <= hdr.chunk && (hdr.lastLen == 0 || len == hdr.lastLen)) : len == hdr.chunk;
+  if (!fits || !sized) {
+    stats.fragmentsDropped++;
+    return NULL;
+  }
+
+  ReassemblySlot* s = findSlot(src, session, hdr, nowMs);
+  uint16_t bit = (uint16_t)(1u << hdr.index);
+  bool reused = (session != LORA_FRAG_NO_SESSION) && ((s->received & bit) || s->done);
+  if (reused || s->count != hdr.count || s->chunk != hdr.chunk || s->dataCount != hdr.dataCount ||
+      (hdr.lastLen != 0 && s->lastLen != hdr.lastLen)) {
+    // Same ID reused for a different message: start over
+    startSlot(s, hdr, nowMs);
+  }
+
+  if ((s->received & bit) || s->done) {
+    stats.fragmentsDropped++;
+    return NULL;
+  }
+  s->received |= bit;
+
+  uint8_t row;
+  if (repair) {
+    row = freeRow(s);
+  } else {
+    row = hdr.index;
+    if (s->rowShard[row] != LORA_FEC_ROW_EMPTY) {
+      // A repair stood in for this fragment: move it to another gap
+      uint8_t gap = freeRow(s);
+      memcpy(s->data + (size_t)gap * s->chunk, s->data + offset, s->chunk);
+      s->rowShard[gap] = s->rowShard[row];
+    }
+  }
+  uint8_t* dst = s->data + (size_t)row * s->chunk;
+  memcpy(dst, data, len);
+  memset(dst + len, 0, s->chunk - len);
+  s->rowShard[row] = hdr.index;
+  s->filled++;
+  if (last) {
+    s->lastLen = (uint8_t)len;
+  }
+
+  if (s->filled < s->dataCount) {
+    return NULL;
+  }
+
+  // Enough fragments: rebuild the missing data from the repairs
+  uint8_t rebuilt = 0;
+  for (uint8_t i = 0; i < s->dataCount; i++) {
+    rebuilt += (s->rowShard[i] != i);
+  }
+  if (rebuilt > 0) {
+    if (!loraFecDecode(s->data, s->dataCount, s->chunk, s->rowShard)) {
+      s->used = false;
+      stats.fragmentsDropped++;
+      return NULL;
+    }
+    stats.messagesRecovered++;
+    stats.fragmentsRecovered += rebuilt;
+  }
+
+  // Complete: data stays readable until the next push. An FEC group
+  // keeps the slot until its remaining fragments have passed.
+  uint16_t all = (uint16_t)((1u << s->count) - 1);
+  s->done = true;
+  s->used = (s->received != all);
+  stats.messagesReassembled++;
+  *outLen = (size_t)(s->dataCount - 1) * s->chunk + s->lastLen;
+  return s->data;
+}
+
+const LoRaFragmentStats& loraFragmentGetStats() {
+  return stats;
+}
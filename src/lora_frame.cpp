@@ -0,0 +1,88 @@
+#include "lora_frame.h"
+#include <string.h>
+
+static size_t varintSize(uint32_t value) {
+  size_t n = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    n++;
+  }
+  return n;
+}
+
+size_t loraFrameHeaderSize(const LoRaFrameHeader& hdr) {
+  return LORA_FRAME_FIXED_SIZE + varintSize(hdr.tsDelta);
+}
+
+size_t loraFrameEncode(uint8_t* buf, size_t capacity,
+                       const LoRaFrameHeader& hdr, const uint8_t* payload) {
+  size_t headerSize = loraFrameHeaderSize(hdr);
+  size_t total = headerSize + hdr.length;
+  if (total > capacity || total > LORA_FRAME_MAX_SIZE) {
+    return 0;
+  }
+
+  // Move the payload first so a payload overlapping the header area is safe
+  uint8_t* body = buf + headerSize;
+  if (hdr.length > 0 && payload != body) {
+    memmove(body, payload, hdr.length);
+  }
+
+  uint8_t version = hdr.version ? hdr.version : LORA_FRAME_VERSION;
+  buf[0] = (uint8_t)((version << 4) | (hdr.type & 0x0F));
+  buf[1] = hdr.src;
+  buf[2] = hdr.dst;
+  buf[3] = (uint8_t)(hdr.seq & 0xFF);
+  buf[4] = (uint8_t)(hdr.seq >> 8);
+  buf[5] = hdr.flags;
+  buf[6] = hdr.length;
+
+  uint32_t ts = hdr.tsDelta;
+  uint8_t* p = buf + LORA_FRAME_FIXED_SIZE;
+  while (ts >= 0x80) {
+    *p++ = (uint8_t)(ts | 0x80);
+    ts >>= 7;
+  }
+  *p = (uint8_t)ts;
+
+  return total;
+}
+
+bool loraFrameDecode(const uint8_t* buf, size_t len,
+                     LoRaFrameHeader& hdr, const uint8_t** payload) {
+  if (len < LORA_FRAME_FIXED_SIZE + 1) {
+    return false;
+  }
+
+  hdr.version = buf[0] >> 4;
+  if (hdr.version != LORA_FRAME_VERSION && hdr.version != LORA_FRAME_VERSION_SEALED) {
+    return false;
+  }
+  hdr.type = buf[0] & 0x0F;
+  hdr.src = buf[1];
+  hdr.dst = buf[2];
+  hdr.seq = (uint16_t)(buf[3] | (buf[4] << 8));
+  hdr.flags = buf[5];
+  hdr.length = buf[6];
+
+  // Varint timestamp delta
+  uint32_t ts = 0;
+  size_t pos = LORA_FRAME_FIXED_SIZE;
+  for (uint8_t shift = 0; ; shift += 7) {
+    if (pos >= len || shift > 28) {
+      return false;
+    }
+    uint8_t b = buf[pos++];
+    ts |= (uint32_t)(b & 0x7F) << shift;
+    if ((b & 0x80) == 0) {
+      break;
+    }
+  }
+  hdr.tsDelta = ts;
+
+  if (pos + hdr.length > len) {
+    return false;
+  }
+  *payload = buf + pos;
+  return true;
+}
@@ -0,0 +1,204 @@
+#include "station_platform.h"
+#include "lora_mesh.h"
+#include "lora_frame.h"
+
+struct MeshRoute {
+  bool used;
+  uint8_t dst;
+  uint8_t via;
+  uint8_t hops;
+  uint32_t lastMs;
+};
+
+static uint8_t myId = 0;
+static MeshRoute routes[MESH_ROUTE_SLOTS];
+static LoRaMeshStats stats = {};
+static uint32_t sniffBits[256 / 32];  // Bit per station ID, set if it sniffs
+static uint8_t sniffingCount = 0;
+// Learned in the radio context, looked up by every sender
+STATION_LOCK(meshMux);
+
+static MeshRoute* findRoute(uint8_t dst) {
+  for (uint8_t i = 0; i < MESH_ROUTE_SLOTS; i++) {
+    if (routes[i].used && routes[i].dst == dst) {
+      return &routes[i];
+    }
+  }
+  return NULL;
+}
+
+static bool routeFresh(const MeshRoute* r, uint32_t nowMs) {
+  return r != NULL && nowMs - r->lastMs <= MESH_ROUTE_TIMEOUT_MS;
+}
+
+// Free or expired slot first, otherwise the least recently refreshed
+static MeshRoute* claimRoute(uint32_t nowMs) {
+  MeshRoute* oldest = &routes[0];
+  for (uint8_t i = 0; i < MESH_ROUTE_SLOTS; i++) {
+    if (!routes[i].used || !routeFresh(&routes[i], nowMs)) {
+      return &routes[i];
+    }
+    if (nowMs - routes[i].lastMs > nowMs - oldest->lastMs) {
+      oldest = &routes[i];
+    }
+  }
+  stats.routesEvicted++;
+  return oldest;
+}
+
+// Strictly shorter, or the same path again, or anything once the old one expired
+static void updateRoute(uint8_t dst, uint8_t via, uint8_t hops, uint32_t nowMs) {
+  if (dst == myId || dst == LORA_BROADCAST_ID) return;
+
+  MeshRoute* r = findRoute(dst);
+  if (r != NULL && routeFresh(r, nowMs) && r->via != via && hops >= r->hops) {
+    return;
+  }
+  if (r == NULL) {
+    r = claimRoute(nowMs);
+    r->used = true;
+    r->dst = dst;
+    stats.routeChanges++;
+  } else if (r->via != via) {
+    stats.routeChanges++;
+  }
+  r->via = via;
+  r->hops = hops;
+  r->lastMs = nowMs;
+}
+
+void meshBegin(uint8_t stationId) {
+  myId = stationId;
+  memset(routes, 0, sizeof(routes));
+  memset(sniffBits, 0, sizeof(sniffBits));
+  sniffingCount = 0;
+}
+
+void meshWriteHeader(uint8_t* out, const LoRaMeshHeader& hdr) {
+  out[0] = hdr.prevHop;
+  out[1] = hdr.nextHop;
+  out[2] = (uint8_t)((hdr.ttl << 4) | (hdr.hops & 0x0F));
+}
+
+bool meshReadHeader(const uint8_t* in, size_t len, LoRaMeshHeader& hdr) {
+  if (len < MESH_HEADER_SIZE) {
+    return false;
+  }
+  hdr.prevHop = in[0];
+  hdr.nextHop = in[1];
+  hdr.ttl = in[2] >> 4;
+  hdr.hops = in[2] & 0x0F;
+  return true;
+}
+
+LoRaMeshHeader meshOriginate(uint8_t dst, uint32_t nowMs) {
+  LoRaMeshHeader hdr;
+  hdr.prevHop = myId;
+  hdr.nextHop = meshNextHop(dst, nowMs);
+  hdr.ttl = MESH_DEFAULT_TTL;
+  hdr.hops = 0;
+  return hdr;
+}
+
+void meshLearn(uint8_t origin, const LoRaMeshHeader& hdr, uint32_t nowMs) {
+  STATION_ENTER(meshMux);
+  updateRoute(hdr.prevHop, hdr.prevHop, 1, nowMs);
+  updateRoute(origin, hdr.prevHop, hdr.hops + 1, nowMs);
+  STATION_EXIT(meshMux);
+}
+
+MeshDisposition meshClassify(uint8_t dst, const LoRaMeshHeader& hdr) {
+  if (dst == myId) {
+    return MESH_DELIVER;
+  }
+  if (dst == LORA_BROADCAST_ID) {
+    return (hdr.ttl > 0) ? MESH_DELIVER_AND_RELAY : MESH_DELIVER;
+  }
+  if (hdr.nextHop != myId && hdr.nextHop != LORA_BROADCAST_ID) {
+    stats.ignored++;
+    return MESH_IGNORE;
+  }
+  if (hdr.ttl == 0) {
+    stats.ttlExpired++;
+    return MESH_IGNORE;
+  }
+  return MESH_RELAY;
+}
+
+void meshPrepareRelay(uint8_t dst, LoRaMeshHeader& hdr, uint32_t nowMs) {
+  hdr.prevHop = myId;
+  hdr.nextHop = (dst == LORA_BROADCAST_ID) ? LORA_BROADCAST_ID : meshNextHop(dst, nowMs);
+  hdr.ttl--;
+  if (hdr.hops < MESH_MAX_TTL) {
+    hdr.hops++;
+  }
+  stats.relayed++;
+  if (hdr.nextHop == LORA_BROADCAST_ID) {
+    stats.flooded++;
+  }
+}
+
+uint8_t meshNextHop(uint8_t dst, uint32_t nowMs) {
+  uint8_t via = LORA_BROADCAST_ID;
+  STATION_ENTER(meshMux);
+  MeshRoute* r = findRoute(dst);
+  if (routeFresh(r, nowMs)) {
+    via = r->via;
+  }
+  STATION_EXIT(meshMux);
+  return via;
+}
+
+void meshForgetRoute(uint8_t dst) {
+  STATION_ENTER(meshMux);
+  MeshRoute* r = findRoute(dst);
+  if (r != NULL) {
+    r->used = false;
+  }
+  STATION_EXIT(meshMux);
+}
+
+// Only the radio context writes; senders read single words
+void meshNoteNeighbour(uint8_t hop, bool sniffs) {
+  uint32_t bit = 1u << (hop & 31);
+  uint32_t& word = sniffBits[hop >> 5];
+  if (hop == LORA_BROADCAST_ID || ((word & bit) != 0) == sniffs) {
+    return;
+  }
+  STATION_ENTER(meshMux);
+  if (sniffs) {
+    word |= bit;
+    sniffingCount++;
+  } else {
+    word &= ~bit;
+    sniffingCount--;
+  }
+  STATION_EXIT(meshMux);
+}
+
+bool meshNeighbourSniffs(uint8_t nextHop) {
+  if (nextHop == LORA_BROADCAST_ID) {
+    return sniffingCount > 0;
+  }
+  return (sniffBits[nextHop >> 5] & (1u << (nextHop & 31))) != 0;
+}
+
+uint8_t meshSniffingNeighbours() {
+  return sniffingCount;
+}
+
+uint8_t meshRouteCount(uint32_t nowMs) {
+  uint8_t count = 0;
+  STATION_ENTER(meshMux);
+  for (uint8_t i = 0; i < MESH_ROUTE_SLOTS; i++) {
+    if (routes[i].used && routeFresh(&routes[i], nowMs)) {
+      count++;
+    }
+  }
+  STATION_EXIT(meshMux);
+  return count;
+}
+
+const LoRaMeshStats& meshGetStats() {
+  return stats;
+}
@@ -0,0 +1,573 @@
+#include "lora_radio.h"
+#include <utility>
+
+static SX1262* radioDev = NULL;
+static LoRaRxHandler rxHandler = NULL;
+static QueueHandle_t txQueue = NULL;
+static volatile LoRaRadioState radioState = RADIO_STATE_IDLE;
+static LoRaRadioStats stats = {};
+static TaskHandle_t radioTask = NULL;
+static SemaphoreHandle_t serviceMutex = NULL;   // Held while the state machine runs
+static FrameHandle txInFlight;
+static_assert(FRAME_POOL_SIZE <= LORA_CONFIG_MARKER, "Pool indices and config barriers share the TX queue");
+
+static LoRaRadioConfig configSlots[LORA_CONFIG_SLOTS];   // Settings behind each queued barrier
+static uint16_t configGenerations[LORA_CONFIG_SLOTS];
+static uint8_t configSlotsUsed = 0;                       // Bit per slot
+static uint16_t configQueued = 0;                         // Last generation handed out
+static uint16_t configApplied = 0;                        // 0: the initial settings
+static portMUX_TYPE configMux = portMUX_INITIALIZER_UNLOCKED;
+static uint16_t rxSniffSymbols = 0;
+static uint16_t txPreamble = LORA_PREAMBLE_SYMBOLS;
+static uint32_t txStartUs = 0;
+
+// Channel plan: receive at home, hop out for each channel a frame names
+static uint8_t rxChannel = 0;
+static uint8_t tunedChannel = 0;
+static uint8_t txChannels = 0;         // Channels the held frame still goes out on
+static uint8_t txChannel = 0;
+static bool txFirst = false;           // Held frame not on air yet
+
+// Listen before talk: txInFlight is held until a CAD finds the channel free
+// and, with a duty-cycle limit, until its airtime fits the budget
+static uint32_t lbtSlotUs = 0;
+static uint32_t txDeadlineUs = 0;      // No CAD or transmission before this
+static uint8_t lbtBusyCount = 0;       // Busy CADs for the held frame
+static uint32_t lastRxUs = 0;
+static uint32_t lastTxUs = 0;          // End of our last frame
+static bool rxArriving = false;        // Last service found a frame coming in
+static uint32_t rxArrivingUs = 0;      // When it was first seen
+
+// A frame of a class with a larger share of the duty-cycle budget may go
+// past one the budget holds. The held frame waits here and goes next.
+static FrameHandle txParked;
+static uint8_t parkedChannels = 0;
+static bool parkedFirst = false;
+
+// Set by DIO1 for both RX-done and TX-done; the state tells them apart
+static volatile bool dio1Flag = false;
+static volatile uint32_t dio1Us = 0;
+IRAM_ATTR static void onDio1(void) {
+  dio1Us = micros();
+  dio1Flag = true;
+  if (radioTask != NULL) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(radioTask, &woken);
+    portYIELD_FROM_ISR(woken);
+  }
+}
+
+static void tune(uint8_t channel) {
+  if (channel == tunedChannel) {
+    return;
+  }
+  // Same band as the boot frequency: the image calibration still holds
+  radioDev->standby();
+  radioDev->setFrequency(LORA_CHANNEL_PLAN_MHZ[channel], false);
+  tunedChannel = channel;
+  stats.channelHops++;
+}
+
+// Continuous receive, or duty-cycled preamble sniffing, on the home channel.
+// Preamble and header detection are latched (not signalled on DIO1) so
+// frameArriving() can see them.
+static int startRx() {
+  tune(rxChannel);
+  uint16_t irqFlags = RADIOLIB_SX126X_IRQ_RX_DEFAULT | RADIOLIB_SX126X_IRQ_PREAMBLE_DETECTED |
+                     RADIOLIB_SX126X_IRQ_HEADER_VALID;
+  if (rxSniffSymbols > 0) {
+    return radioDev->startReceiveDutyCycleAuto(rxSniffSymbols, LORA_SNIFF_MIN_SYMBOLS, irqFlags,
+                                               RADIOLIB_SX126X_IRQ_RX_DONE);
+  }
+  return radioDev->startReceive(RADIOLIB_SX126X_RX_TIMEOUT_INF, irqFlags, RADIOLIB_SX126X_IRQ_RX_DONE);
+}
+
+// Modem settings in use, for the slot length and airtime estimates
+static uint8_t modemSf = 7;
+static float modemBwKHz = 125.0f;
+static void setModem(uint8_t sf, float bwKHz) {
+  modemSf = sf;
+  modemBwKHz = bwKHz;
+  lbtSlotUs = loraLbtSlotUs(sf, bwKHz);
+}
+
+// Longest a frame can take to arrive with the settings in use
+static uint32_t maxFrameUs() {
+  return loraTimeOnAirUs(modemSf, modemBwKHz, LORA_FRAME_MAX_SIZE, LORA_PREAMBLE_SYMBOLS);
+}
+
+// A frame is coming in: retuning for CAD or transmitting now would cut
+// it off. RX done on DIO1 ends it; a detection older than the longest
+// frame is stale (noise, or a header that failed), and restarting
+// receive clears it.
+static bool frameArriving() {
+  const uint16_t detected = RADIOLIB_SX126X_IRQ_PREAMBLE_DETECTED | RADIOLIB_SX126X_IRQ_HEADER_VALID;
+  if (radioState != RADIO_STATE_RX || !(radioDev->getIrqStatus() & detected)) {
+    return false;
+  }
+  if (!rxArriving) {
+    rxArrivingUs = micros();
+  }
+  if ((uint32_t)(micros() - rxArrivingUs) > maxFrameUs()) {
+    startRx();
+    return false;
+  }
+  return true;
+}
+
+// Waits a random number of slots out of a window of CW_MIN << exp, capped
+static void backoff(uint8_t exp) {
+  uint32_t waitUs = loraLbtBackoffUs(exp, esp_random(), lbtSlotUs);
+  txDeadlineUs = micros() + waitUs;
+  stats.backoffs++;
+  stats.totalBackoffUs += waitUs;
+  if (waitUs > stats.maxBackoffUs) {
+    stats.maxBackoffUs = waitUs;
+  }
+}
+
+#if LORA_RADIO_TASK
+// Sleeps until notified, or until a held frame's backoff runs out. While
+// a frame arrives, at most its longest airtime in case RX done never comes.
+static TickType_t serviceTimeout() {
+  if (!txInFlight.valid() || radioState == RADIO_STATE_TX || radioState == RADIO_STATE_CAD) {
+    return portMAX_DELAY;
+  }
+  if (rxArriving) {
+    return pdMS_TO_TICKS(maxFrameUs() / 1000) + 1;
+  }
+  int32_t leftUs = (int32_t)(txDeadlineUs - micros());
+  return (leftUs > 0) ? pdMS_TO_TICKS(leftUs / 1000) + 1 : 0;
+}
+
+static void radioTaskMain(void* arg) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, serviceTimeout());
+    loraRadioService();
+  }
+}
+#endif
+
+bool loraRadioBegin(SX1262* radio, LoRaRxHandler handler) {
+  radioDev = radio;
+  rxHandler = handler;
+
+  if (txQueue == NULL) {
+    txQueue = xQueueCreate(LORA_TX_QUEUE_DEPTH, sizeof(uint8_t));
+    serviceMutex = xSemaphoreCreateMutex();
+    if (txQueue == NULL || serviceMutex == NULL) {
+      return false;
+    }
+  }
+
+  radioDev->setDio1Action(onDio1);
+  radioState = RADIO_STATE_RX;
+  if (startRx() != RADIOLIB_ERR_NONE) {
+    return false;
+  }
+
+#if LORA_RADIO_TASK
+  if (radioTask == NULL) {
+    xTaskCreatePinnedToCore(radioTaskMain, "lora_radio", LORA_RADIO_TASK_STACK, NULL,
+                            LORA_RADIO_TASK_PRIO, &radioTask, LORA_RADIO_CORE);
+  }
+  return radioTask != NULL;
+#else
+  return true;
+#endif
+}
+
+void loraRadioSetInitialConfig(const LoRaRadioConfig& config) {
+  rxSniffSymbols = config.rxSniffSymbols;
+  rxChannel = tunedChannel = config.rxChannel;
+  setModem(config.sf, config.bwKHz);
+}
+
+bool loraRadioHoldIdle() {
+  if (serviceMutex == NULL || xSemaphoreTake(serviceMutex, 0) != pdTRUE) {
+    return false;
+  }
+  if (radioState == RADIO_STATE_RX && !dio1Flag && !txInFlight.valid() && !txParked.valid() &&
+      uxQueueMessagesWaiting(txQueue) == 0) {
+    return true;
+  }
+  xSemaphoreGive(serviceMutex);
+  return false;
+}
+
+void loraRadioResume(bool dio1High) {
+  if (dio1High && !dio1Flag) {
+    dio1Us = micros();
+    dio1Flag = true;
+  }
+  xSemaphoreGive(serviceMutex);
+  if (dio1High && radioTask != NULL) {
+    xTaskNotifyGive(radioTask);
+  }
+}
+
+bool loraRadioQueueFrame(FrameHandle&& frame) {
+  FrameHandle owned(std::move(frame));
+  if (txQueue == NULL || !owned.valid() || owned->len == 0) {
+    return false;
+  }
+
+  owned->stampUs = micros();
+  uint8_t index = owned.release();
+  if (xQueueSend(txQueue, &index, 0) != pdTRUE) {
+    FrameHandle::adopt(index);   // Dropped: back to the pool
+    stats.queueFull++;
+    return false;
+  }
+
+  stats.framesQueued++;
+  uint32_t depth = uxQueueMessagesWaiting(txQueue);
+  if (depth > stats.queueHighWater) {
+    stats.queueHighWater = depth;
+  }
+
+  // Wake the radio task so an idle radio starts transmitting right away
+  if (radioTask != NULL) {
+    xTaskNotifyGive(radioTask);
+  }
+  return true;
+}
+
+uint16_t loraRadioQueueConfig(const LoRaRadioConfig& config) {
+  if (txQueue == NULL) {
+    return 0;
+  }
+
+  // Every barrier carries its own slot, so frames queued between two
+  // reconfigurations still get the first one's settings
+  uint8_t slot = 0;
+  portENTER_CRITICAL(&configMux);
+  while (slot < LORA_CONFIG_SLOTS && (configSlotsUsed & (1u << slot))) {
+    slot++;
+  }
+  uint16_t generation = 0;
+  if (slot < LORA_CONFIG_SLOTS) {
+    configSlotsUsed |= (uint8_t)(1u << slot);
+    configSlots[slot] = config;
+    generation = ++configQueued;
+    if (generation == 0) {
+      generation = ++configQueued;
+    }
+    configGenerations[slot] = generation;
+  }
+  portEXIT_CRITICAL(&configMux);
+  if (slot == LORA_CONFIG_SLOTS) {
+    stats.queueFull++;
+    return 0;
+  }
+
+  uint8_t marker = LORA_CONFIG_MARKER + slot;
+  if (xQueueSend(txQueue, &marker, 0) != pdTRUE) {
+    portENTER_CRITICAL(&configMux);
+    configSlotsUsed &= (uint8_t)~(1u << slot);
+    portEXIT_CRITICAL(&configMux);
+    stats.queueFull++;
+    return 0;
+  }
+  if (radioTask != NULL) {
+    xTaskNotifyGive(radioTask);
+  }
+  return generation;
+}
+
+static void applyConfig(uint8_t slot) {
+  LoRaRadioConfig cfg;
+  portENTER_CRITICAL(&configMux);
+  cfg = configSlots[slot];
+  uint16_t generation = configGenerations[slot];
+  configSlotsUsed &= (uint8_t)~(1u << slot);
+  portEXIT_CRITICAL(&configMux);
+
+  radioDev->standby();
+  radioDev->setSpreadingFactor(cfg.sf);
+  radioDev->setBandwidth(cfg.bwKHz);
+  radioDev->setOutputPower(cfg.powerDbm);
+  rxSniffSymbols = cfg.rxSniffSymbols;
+  rxChannel = cfg.rxChannel;
+  setModem(cfg.sf, cfg.bwKHz);
+  configApplied = generation;
+  stats.reconfigurations++;
+  radioState = RADIO_STATE_IDLE;
+}
+
+static void handleTxDone(uint32_t irqUs) {
+  stats.txAirUs += irqUs - txStartUs;
+  airtimeRecord(txInFlight->priority, irqUs - txStartUs, millis());
+  statusRecord(STATUS_STAGE_AIRTIME, irqUs - txStartUs);
+  int state = radioDev->finishTransmit();
+  if (state == RADIOLIB_ERR_NONE) {
+    stats.framesSent++;
+    stats.txPerChannel[txChannel]++;
+  } else {
+    stats.txFailures++;
+  }
+  radioState = RADIO_STATE_IDLE;
+
+  // Swept frames stay held for the next channel, with a fresh CAD
+  txChannels &= ~(1u << txChannel);
+  if (txChannels != 0) {
+    lbtBusyCount = 0;
+    txDeadlineUs = micros();
+  } else {
+    txInFlight.reset();
+    lastTxUs = irqUs;
+  }
+}
+
+static void handleRxDone(uint32_t irqUs) {
+  FrameHandle frame = framePoolAlloc();
+  if (!frame.valid()) {
+    // Pool exhausted: drop the packet and re-arm reception
+    stats.rxFailures++;
+    radioState = RADIO_STATE_IDLE;
+    return;
+  }
+
+  size_t len = radioDev->getPacketLength();
+  if (len > sizeof(frame->data)) {
+    len = sizeof(frame->data);
+  }
+  int state = radioDev->readData(frame->data, len);
+
+  if (state == RADIOLIB_ERR_NONE && len > 0) {
+    stats.framesReceived++;
+    frame->len = (uint8_t)len;
+    frame->stampUs = irqUs;
+    frame->rssi = (int16_t)radioDev->getRSSI();
+    frame->snrQ = (int8_t)(radioDev->getSNR() * 4.0f);
+    frame->config = configApplied;
+    if (rxHandler != NULL) {
+      rxHandler(std::move(frame));
+    }
+    statusRecord(STATUS_STAGE_RX_TOTAL, micros() - irqUs);
+  } else {
+    stats.rxFailures++;
+    if (state == RADIOLIB_ERR_CRC_MISMATCH) {
+      stats.crcErrors++;
+    }
+  }
+  lastRxUs = irqUs;
+
+  // Re-arm reception unless a queued frame takes the radio next
+  radioState = RADIO_STATE_IDLE;
+}
+
+static uint16_t heldPreamble() {
+  return txInFlight->preamble ? txInFlight->preamble : LORA_PREAMBLE_SYMBOLS;
+}
+
+static bool transmitHeld() {
+  // Long preambles only for frames a sniffing receiver has to catch
+  uint16_t preamble = heldPreamble();
+  if (preamble != txPreamble) {
+    radioDev->standby();
+    radioDev->setPreambleLength(preamble);
+    txPreamble = preamble;
+    stats.preambleChanges++;
+  }
+
+  txStartUs = micros();
+  if (txFirst) {
+    statusRecord(STATUS_STAGE_QUEUE_WAIT, txStartUs - txInFlight->stampUs);
+    txFirst = false;
+  }
+  int state = radioDev->startTransmit(txInFlight->data, txInFlight->len);
+  if (state != RADIOLIB_ERR_NONE) {
+    stats.txFailures++;
+    txChannels = 0;
+    txInFlight.reset();
+    radioState = RADIO_STATE_IDLE;
+    return false;
+  }
+  radioState = RADIO_STATE_TX;
+  return true;
+}
+
+// Channel free: transmit with probability LORA_LBT_PERSISTENCE_PCT,
+// otherwise defer one slot. Busy: exponential backoff, and after
+// LORA_LBT_MAX_BUSY busy scans send anyway rather than starve.
+static void handleCadDone() {
+  int result = radioDev->getChannelScanResult();
+  radioState = RADIO_STATE_IDLE;
+
+  if (result == RADIOLIB_LORA_DETECTED) {
+    stats.cadBusy++;
+    if (++lbtBusyCount < LORA_LBT_MAX_BUSY) {
+      backoff(lbtBusyCount);
+      return;
+    }
+    stats.lbtForced++;
+  } else if ((esp_random() % 100) >= LORA_LBT_PERSISTENCE_PCT) {
+    stats.lbtDeferred++;
+    txDeadlineUs = micros() + lbtSlotUs;
+    return;
+  }
+  transmitHeld();
+}
+
+// Makes a frame taken off the queue the held frame
+static void holdFrame(uint8_t index) {
+  txInFlight = FrameHandle::adopt(index);
+  txFirst = true;
+  txChannels = txInFlight->channels & LORA_CHANNEL_ALL;
+  if (txChannels == 0) {
+    txChannels = (uint8_t)(1u << rxChannel);
+  }
+
+  uint32_t waitUs = micros() - txInFlight->stampUs;
+  stats.lastWaitUs = waitUs;
+  stats.totalWaitUs += waitUs;
+  if (waitUs > stats.maxWaitUs) {
+    stats.maxWaitUs = waitUs;
+  }
+
+  // Right after a reception everyone who heard it may answer at once
+  lbtBusyCount = 0;
+  txDeadlineUs = micros();
+  if (LORA_LBT_ENABLED && micros() - lastRxUs < LORA_LBT_CW_MIN * lbtSlotUs) {
+    backoff(0);
+  }
+
+  // Right after our own frame its receiver gets the first turn. We listen
+  // on home through the window it draws from, plus a slot to detect a
+  // preamble started in the last one; its CAD cannot see us on another
+  // channel, and half duplex, we would not hear it either.
+  uint32_t turnUs = (LORA_LBT_CW_MIN + 1) * lbtSlotUs;
+  if (LORA_LBT_ENABLED && micros() - lastTxUs < turnUs && (int32_t)(lastTxUs + turnUs - txDeadlineUs) > 0) {
+    txDeadlineUs = lastTxUs + turnUs;
+  }
+}
+
+// Called when the budget holds txInFlight. If the next frame in the queue
+// has a larger share, parks txInFlight and holds that one instead. Only
+// one frame is parked at a time, and never across a config barrier.
+static bool parkHeld() {
+  uint8_t index;
+  if (txParked.valid() || xQueuePeek(txQueue, &index, 0) != pdTRUE || index >= LORA_CONFIG_MARKER) {
+    return false;
+  }
+  FrameHandle next = FrameHandle::adopt(index);
+  bool passes = airtimeSharePct(next->priority) > airtimeSharePct(txInFlight->priority);
+  next.release();
+  if (!passes || xQueueReceive(txQueue, &index, 0) != pdTRUE) {
+    return false;
+  }
+
+  txParked = std::move(txInFlight);
+  parkedChannels = txChannels;
+  parkedFirst = txFirst;
+  stats.dutyBypassed++;
+  holdFrame(index);
+  return true;
+}
+
+// Takes the next frame off the queue (applying config barriers on the
+// way) and either transmits it or, with LBT, starts a channel scan once
+// its backoff is over. Each copy first has to fit the duty-cycle budget.
+static bool startNextTransmit() {
+  if (!txInFlight.valid() && txParked.valid()) {
+    // The frame that was passed goes before anything still queued
+    txInFlight = std::move(txParked);
+    txChannels = parkedChannels;
+    txFirst = parkedFirst;
+    lbtBusyCount = 0;
+    txDeadlineUs = micros();
+  }
+  if (!txInFlight.valid()) {
+    uint8_t index;
+    if (xQueueReceive(txQueue, &index, 0) != pdTRUE) {
+      return false;
+    }
+
+    // Config barriers are applied in queue order, then the next frame goes
+    while (index >= LORA_CONFIG_MARKER) {
+      applyConfig(index - LORA_CONFIG_MARKER);
+      if (xQueueReceive(txQueue, &index, 0) != pdTRUE) {
+        return false;
+      }
+    }
+    holdFrame(index);
+  }
+
+  if ((int32_t)(micros() - txDeadlineUs) < 0) {
+    return false;
+  }
+
+  // Out of budget: hold the frame until old airtime ages out, or shed it
+  // and move on to the next one
+  uint32_t waitMs;
+  uint32_t airUs = loraTimeOnAirUs(modemSf, modemBwKHz, txInFlight->len, heldPreamble());
+  AirtimeVerdict verdict = airtimeAdmit(txInFlight->priority, airUs, millis(), &waitMs);
+  if (verdict == AIRTIME_WAIT) {
+    if (parkHeld()) {
+      return startNextTransmit();
+    }
+    txDeadlineUs = micros() + (waitMs < LORA_DUTY_MAX_WAIT_MS ? waitMs : LORA_DUTY_MAX_WAIT_MS) * 1000;
+    return false;
+  }
+  if (verdict == AIRTIME_SHED) {
+    stats.dutyShed++;
+    txChannels = 0;
+    txInFlight.reset();
+    return startNextTransmit();
+  }
+
+  // Next channel still due after home, so a sweep ends back at home
+  txChannel = rxChannel;
+  do {
+    txChannel = (uint8_t)((txChannel + 1) % LORA_CHANNEL_COUNT);
+  } while (!(txChannels & (1u << txChannel)));
+  tune(txChannel);
+  if (!LORA_LBT_ENABLED) {
+    return transmitHeld();
+  }
+  radioDev->standby();
+  if (radioDev->startChannelScan() != RADIOLIB_ERR_NONE) {
+    return transmitHeld();
+  }
+  stats.cadScans++;
+  radioState = RADIO_STATE_CAD;
+  return true;
+}
+
+void loraRadioService() {
+  if (radioDev == NULL) return;
+  xSemaphoreTake(serviceMutex, portMAX_DELAY);
+
+  if (dio1Flag) {
+    dio1Flag = false;
+    if (radioState == RADIO_STATE_TX) {
+      handleTxDone(dio1Us);
+    } else if (radioState == RADIO_STATE_CAD) {
+      handleCadDone();
+    } else if (radioState == RADIO_STATE_RX) {
+      handleRxDone(dio1Us);
+    }
+  }
+
+  rxArriving = frameArriving();
+  if (radioState == RADIO_STATE_IDLE || (radioState == RADIO_STATE_RX && !rxArriving)) {
+    if (!startNextTransmit() && radioState != RADIO_STATE_RX) {
+      startRx();
+      radioState = RADIO_STATE_RX;
+    }
+  }
+  xSemaphoreGive(serviceMutex);
+}
+
+uint32_t loraRadioQueueDepth() {
+  return txQueue != NULL ? uxQueueMessagesWaiting(txQueue) : 0;
+}
+
+LoRaRadioState loraRadioGetState() {
+  return radioState;
+}
+
+const LoRaRadioStats& loraRadioGetStats() {
+  return stats;
+}
@@ -0,0 +1,93 @@
+#include <Arduino.h>
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include <driver/gpio.h>
+#include "low_power.h"
+#include "lora_radio.h"
+
+static LowPowerStats stats = {};
+static int64_t startUs = 0;
+
+void lowPowerBegin() {
+  memset(&stats, 0, sizeof(stats));
+  startUs = esp_timer_get_time();
+}
+
+float lowPowerSymbolMs(uint8_t sf, float bwKHz) {
+  return (float)(1UL << sf) / bwKHz;
+}
+
+// RadioLib's auto duty cycle sleeps for (preamble - 2 * min) symbols, so
+// this makes the radio sleep period about LOW_POWER_SNIFF_MS
+uint16_t lowPowerPreambleSymbols(uint8_t sf, float bwKHz) {
+  float symbolMs = lowPowerSymbolMs(sf, bwKHz);
+  uint32_t sleepSymbols = (uint32_t)(LOW_POWER_SNIFF_MS / symbolMs) + 1;
+  return (uint16_t)(sleepSymbols + 2 * LORA_SNIFF_MIN_SYMBOLS);
+}
+
+LowPowerWake lowPowerSleep(uint8_t dio1Pin, uint32_t maxMs) {
+  // The wakeup borrows the pin's interrupt type (level instead of the
+  // rising edge attachInterrupt set), so it is put back right after
+  gpio_wakeup_enable((gpio_num_t)dio1Pin, GPIO_INTR_HIGH_LEVEL);
+  esp_sleep_enable_gpio_wakeup();
+  esp_sleep_enable_timer_wakeup((uint64_t)maxMs * 1000);
+
+  int64_t before = esp_timer_get_time();
+  esp_err_t err = esp_light_sleep_start();
+  int64_t sleptUs = esp_timer_get_time() - before;
+
+  gpio_wakeup_disable((gpio_num_t)dio1Pin);
+  gpio_set_intr_type((gpio_num_t)dio1Pin, GPIO_INTR_POSEDGE);
+
+  if (err != ESP_OK) {
+    stats.rejected++;
+    return LOW_POWER_WAKE_REJECTED;
+  }
+  stats.sleeps++;
+  stats.sleepUs += sleptUs;
+
+  if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER) {
+    // Time past the programmed wakeup is what leaving sleep costs
+    int64_t overshootUs = sleptUs - (int64_t)maxMs * 1000;
+    stats.wakeLatency.record(overshootUs > 0 ? (uint32_t)overshootUs : 0);
+    stats.timerWakes++;
+    return LOW_POWER_WAKE_TIMER;
+  }
+  stats.radioWakes++;
+  return LOW_POWER_WAKE_RADIO;
+}
+
+void lowPowerNoteDelivered() {
+  stats.delivered++;
+}
+
+LowPowerEnergy lowPowerEstimate(uint64_t txAirUs, uint16_t rxSniffSymbols) {
+  LowPowerEnergy e = {};
+  float totalS = (esp_timer_get_time() - startUs) / 1e6f;
+  if (totalS <= 0.0f) {
+    return e;
+  }
+  float sleepS = stats.sleepUs / 1e6f;
+  float txS = txAirUs / 1e6f;
+  float rxS = (totalS > txS) ? totalS - txS : 0.0f;
+
+  // Sniffing: awake for about min + 1 symbols of every
+  // (preamble - min + 1), asleep for the rest
+  float rxDuty = 1.0f;
+  if (rxSniffSymbols > LORA_SNIFF_MIN_SYMBOLS) {
+    rxDuty = (float)(LORA_SNIFF_MIN_SYMBOLS + 1) / (rxSniffSymbols - LORA_SNIFF_MIN_SYMBOLS + 1);
+  }
+
+  float mAs = LOW_POWER_MCU_ACTIVE_MA * (totalS - sleepS) + LOW_POWER_MCU_SLEEP_MA * sleepS +
+              LOW_POWER_RADIO_TX_MA * txS +
+              rxS * (LOW_POWER_RADIO_RX_MA * rxDuty + LOW_POWER_RADIO_SLEEP_MA * (1.0f - rxDuty));
+  e.averageMa = mAs / totalS;
+  e.totalMj = mAs * LOW_POWER_SUPPLY_V;
+  e.perMessageMj = stats.delivered ? e.totalMj / stats.delivered : 0.0f;
+  e.sleepPct = (uint8_t)(100.0f * sleepS / totalS);
+  return e;
+}
+
+const LowPowerStats& lowPowerGetStats() {
+  return stats;
+}
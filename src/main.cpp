@@ -5,16 +5,160 @@
 #include <BLE2902.h>
 #include <RadioLib.h>
 #include <SPI.h>
-#include <ArduinoJson.h>
+#include <utility>
+#include "lora_frame.h"
+#include "frame_pool.h"
+#include "lora_radio.h"
+#include "lora_fragment.h"
+#include "lora_fec.h"
+#include "lora_crypto.h"
+#include "lora_coalesce.h"
+#include "link_adapt.h"
+#include "lora_arq.h"
+#include "lora_bulk.h"
+#include "lora_compress.h"
+#include "lora_dedup.h"
+#include "lora_mesh.h"
+#include "lora_channels.h"
+#include "lora_airtime.h"
+#include "station_config.h"
+#include "low_power.h"
+#include "station_status.h"
+#include "ble_segment.h"
+#include "msg_store.h"
+#include "station_log.h"
+#include "spsc_ring.h"
 
-// Station ID
+// Station ID, and where phone messages go (LORA_BROADCAST_ID: everyone).
+// One source for both stations: build with -DSTATION_ID=1 or 2 (env:m1, env:m2).
+#ifndef STATION_ID
 #define STATION_ID 2
-#define STATION_NAME "M2"
+#endif
+#ifndef STATION_PEER_ID
+#if STATION_ID == 1
+#define STATION_PEER_ID 2
+#else
+#define STATION_PEER_ID 1
+#endif
+#endif
+#define STATION_STR_(x) #x
+#define STATION_STR(x) STATION_STR_(x)
+#define STATION_NAME "M" STATION_STR(STATION_ID)
+#define STATION_PEER_NAME "M" STATION_STR(STATION_PEER_ID)
+
+// Boot: skip the wait for a serial monitor unless one is attached
+#ifndef FAST_BOOT
+#define FAST_BOOT 1
+#endif
+#define BOOT_SERIAL_WAIT_MS 2000
+
+// Hot-path log events (station_log.h), formatted by the log task
+enum LogEvent : uint16_t {
+  EV_PHONE_CONNECTED = 0,
+  EV_PHONE_DISCONNECTED,
+  EV_BLE_MTU,
+  EV_PHONE_MESSAGE,
+  EV_BAD_BLE_SEGMENT,
+  EV_SENT_TO_PHONE,
+  EV_RECEIPT,
+  EV_RECEIPT_FAILED,
+  EV_POOL_EXHAUSTED,
+  EV_TX_QUEUE_FULL,
+  EV_FRAME_QUEUED,
+  EV_ARQ_BUFFER_FULL,
+  EV_LORA_DOWN,
+  EV_NO_EPOCH,
+  EV_MESSAGE_TOO_LONG,
+  EV_FRAGMENTING,
+  EV_FEC_GROUP,
+  EV_BAD_COMPRESSED,
+  EV_STORED_FOR_PHONE,
+  EV_REPLAYED,
+  EV_RELAY_QUEUE_FULL,
+  EV_RELAYING,
+  EV_FRAME_RECEIVED,
+  EV_FIRST_FRAME,
+  EV_BAD_FRAME,
+  EV_AUTH_FAILED,
+  EV_DUPLICATE,
+  EV_BAD_MESH_HEADER,
+  EV_NOT_FOR_US,
+  EV_BAD_ACK,
+  EV_BAD_ARQ_HEADER,
+  EV_ARQ_DUPLICATE,
+  EV_COALESCED_RECEIVED,
+  EV_BAD_FRAGMENT,
+  EV_FRAGMENT_RECEIVED,
+  EV_MESSAGE_RECEIVED,
+  EV_RADIO_RING_FULL,
+  EV_PHONE_RING_FULL,
+  EV_BULK_OFFER,
+  EV_BULK_SENT,
+  EV_BULK_STALLED,
+  EV_BULK_INCOMING,
+  EV_BULK_COMPLETE,
+  EV_LINK_PROFILE,
+  EV_COUNT
+};
+
+static const char* const LOG_FORMATS[] = {
+  "📱 Phone connected to " STATION_NAME "\n",
+  "📱 Phone disconnected from " STATION_NAME "\n",
+  "📱 BLE MTU negotiated: %u\n",
+  "📱➡️ Received from phone: message %u, %u bytes\n",
+  "❌ Bad BLE segment from phone, message dropped\n",
+  "📱⬅️ Sent to phone (%u notif.): %u bytes\n",
+  "📬 Message %u delivered to peer\n",
+  "❌ Message %u not acknowledged, gave up\n",
+  "❌ Frame pool exhausted, frame dropped\n",
+  "❌ LoRa TX queue full, frame dropped\n",
+  "📡➡️ Queued for LoRa: seq=%u to %u, %u bytes on air, queue=%u\n",
+  "❌ ARQ send buffer full, frame dropped\n",
+  "❌ LoRa not initialized, message dropped\n",
+  "❌ No nonce epoch reserved, frame not sealed\n",
+  "❌ Message too long for LoRa (%u bytes), dropped\n",
+  "📡✂️ Fragmenting %u bytes into %u frames\n",
+  "📡✂️ Fragmenting %u bytes into %u frames + %u FEC repair frames\n",
+  "❌ Bad compressed message, dropped\n",
+  "💾 Stored for the phone (%u waiting)\n",
+  "📱⬅️💾 Replayed %u stored messages in one notification\n",
+  "❌ LoRa TX queue full, relay dropped\n",
+  "📡🔁 Relaying %u->%u (seq=%u) via %u\n",
+  "📡⬅️ Received via LoRa (%u bytes)\n",
+  "⏱️ First LoRa frame %u ms after boot\n",
+  "❌ Failed to decode LoRa frame\n",
+  "❌ Frame from %u (seq=%u) failed authentication, dropped\n",
+  "🔁 Duplicate frame from %u (seq=%u), dropped\n",
+  "❌ Truncated mesh header\n",
+  "⚠️ Message not for this station\n",
+  "❌ Truncated ARQ ACK\n",
+  "❌ Truncated ARQ header\n",
+  "🔁 Duplicate frame from %u (ARQ seq=%u), ignored\n",
+  "✅ Coalesced frame for " STATION_NAME " from %u (seq=%u), forwarding to phone\n",
+  "❌ Bad fragment header\n",
+  "🧩 Fragment %u/%u of message %u from %u\n",
+  "✅ Message for " STATION_NAME " from %u (seq=%u), forwarding to phone\n",
+  "❌ Phone->radio ring full, message %u dropped\n",
+  "❌ Radio->phone ring full, %u bytes dropped\n",
+  "📦➡️ Phone offers object %08x, %u bytes in blocks of %u\n",
+  "📦✅ Object %08x delivered to peer, %u B/s\n",
+  "⚠️ Object %08x stalled (reason %u)\n",
+  "📦⬅️ Incoming object %08x, %u bytes\n",
+  "📦✅ Object %08x received, %u bytes, %u B/s\n",
+  "📶 LoRa profile -> SF%u / %u kHz / %d dBm\n",
+};
+static_assert(sizeof(LOG_FORMATS) / sizeof(LOG_FORMATS[0]) == EV_COUNT, "one format per log event");
+static_assert(LORA_COALESCE_MAX_MSGS <= ARQ_MAX_FRAME_MSGS, "a coalesced batch must fit one ARQ frame's receipts");
+static_assert(LORA_REASM_SLOTS >= ARQ_WINDOW && LORA_REASM_TIMEOUT_MS >= ARQ_MAX_TRIES * ARQ_MAX_RTO_MS,
+              "acknowledged fragments must not be dropped while the sender still retries the rest");
 
 // Function declarations
-void sendLoRaMessage(String message);
-void sendBLEMessage(String message);
-void checkLoRaMessages();
+bool sendLoRaMessage(const uint8_t* data, size_t len, uint16_t msgNo);
+void sendBLEMessage(const uint8_t* data, size_t len);
+void handleLoRaFrame(FrameHandle frame);
+void sendDeliveryReceipts(const ArqReceipt* receipts, size_t count);
+template <uint32_t N>
+void queueReceipts(SpscRing<N>& ring, const ArqReceipt* receipts, size_t count);
 
 // BLE Configuration
 #define SERVICE_UUID        "6E400001-B5A3-F393-E0A9-E50E24DCCA9E"
@@ -33,146 +177,1450 @@ void checkLoRaMessages();
 // Global objects
 BLEServer* pServer = NULL;
 BLECharacteristic* pTxCharacteristic;
-bool deviceConnected = false;
+volatile bool deviceConnected = false;
 bool oldDeviceConnected = false;
+volatile uint16_t bleMtu = BLE_DEFAULT_MTU;   // Negotiated ATT MTU
+BleReassembler bleRx;                         // Multi-write phone messages
+uint32_t bleNotifications = 0;
+uint32_t phoneMessages = 0;
+BLECharacteristic* pStatusCharacteristic = NULL;   // Binary telemetry, read on demand
 SX1262 radio = new Module(LORA_CS, LORA_DIO1, LORA_RESET, LORA_BUSY);
 bool loraInitialized = false;
 
-// LoRa interrupt handling
-volatile bool receivedFlag = false;
-IRAM_ATTR void setFlag(void) {
-    receivedFlag = true;
+// Core split: the radio task and loop() run the LoRa side on
+// LORA_RADIO_CORE, BLE and the phone task run on PHONE_TASK_CORE. The two
+// sides only talk through SPSC rings, one per producer, so neither waits
+// for the other.
+#define PHONE_TASK_CORE     0
+#define PHONE_TASK_STACK    6144
+#define PHONE_TASK_PRIO     2
+#define PHONE_TASK_POLL_MS  50      // Replay and log maintenance without traffic
+#define PHONE_TO_RADIO_RING 4096
+#define RADIO_TO_PHONE_RING 8192
+#define LOOP_TO_PHONE_RING  256
+#define BLE_TO_PHONE_RING   256     // 32 refusals
+
+// Records on the ring to loop()
+enum RadioRecord : uint8_t {
+  RADIO_REC_MESSAGE = 0,        // [PHONE_TO_RADIO_PREFIX][message]
+  RADIO_REC_BULK                // Bulk command, marker stripped (lora_bulk.h)
+};
+
+// Records on the rings to the phone task
+enum PhoneRecord : uint8_t {
+  PHONE_REC_MESSAGE = 0,        // [PHONE_MESSAGE_PREFIX][message]; flags: PHONE_REC_COMPRESSED
+  PHONE_REC_RECEIPT,            // [message number, 16 bits]; flags: PHONE_REC_DELIVERED
+  PHONE_REC_BULK                // Bulk note; flags: BulkNoteKind
+};
+#define PHONE_REC_COMPRESSED 0x01
+#define PHONE_REC_DELIVERED  0x01
+#define PHONE_TO_RADIO_PREFIX 6   // [write time, us, 32 bits][message tag, 16 bits]
+#define PHONE_MESSAGE_PREFIX  4   // [decode time, us, 32 bits]
+
+SpscRing<PHONE_TO_RADIO_RING> phoneToRadio;   // onWrite (BLE) -> loop()
+SpscRing<RADIO_TO_PHONE_RING> radioToPhone;   // RX path -> phone task: messages, ACK receipts
+SpscRing<LOOP_TO_PHONE_RING> loopToPhone;     // loop() -> phone task: receipts from pumpArq()
+SpscRing<BLE_TO_PHONE_RING> bleToPhone;       // onWrite (BLE) -> phone task: receipts for refused messages
+TaskHandle_t phoneTask = NULL;
+TaskHandle_t loopTask = NULL;
+
+// LoRa framing state
+uint16_t txSequence = 0;
+unsigned long lastTxMillis = 0;
+portMUX_TYPE txSequenceMux = portMUX_INITIALIZER_UNLOCKED;
+uint16_t txEpoch = 0;                         // Nonce epoch of frames sealed now
+uint16_t txNextEpoch = 0;                     // Reserved for when txSequence wraps
+uint8_t txFragmentMsgId = 0;
+volatile uint8_t loraSpreadingFactor = LINK_PROFILES[LINK_DEFAULT_PROFILE].sf;
+volatile uint16_t loraSniffPreamble = 0;    // Preamble for sniffing neighbours on this profile
+
+// Adaptive data rate / power control (radio task and loop share it)
+SemaphoreHandle_t linkMutex = NULL;
+#define LINK_SAVE_PENDING 0x10000
+uint32_t linkToSave = 0;                        // LINK_SAVE_PENDING | power << 8 | profile, for loop() to store
+portMUX_TYPE linkSaveMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Coalescing of short phone messages into shared frames
+LoRaCoalescer coalescer;
+SemaphoreHandle_t coalesceMutex = NULL;
+TimerHandle_t coalesceTimer = NULL;
+uint16_t coalescedFirstMsg = ARQ_NO_MESSAGE;   // Phone messages in the batch
+uint16_t coalescedLastMsg = ARQ_NO_MESSAGE;
+uint8_t coalescedFlags = 0;                     // FRAME_FLAG_COMPRESSED or 0, same for the whole batch
+uint32_t coalescedFrames = 0;
+uint32_t coalescedMessages = 0;
+
+// Reliable delivery to the peer station
+SemaphoreHandle_t arqMutex = NULL;
+uint16_t msgTag = ARQ_NO_MESSAGE;               // Last tag ARQ and the log know a message by
+volatile uint32_t phoneConn = 0;                // First tag of this connection | messages since << 16
+uint32_t receiptsSent = 0;
+
+// Bulk transfers of binary objects (radio task, loop and phone task share it)
+SemaphoreHandle_t bulkMutex = NULL;
+
+// Store-and-forward log in flash: messages for an absent phone, and
+// phone messages until the peer acknowledges them
+SemaphoreHandle_t storeMutex = NULL;
+bool storeReady = false;
+unsigned long phoneConnectedMs = 0;
+uint16_t resendNextTag = ARQ_NO_MESSAGE;        // Logged messages from the last boot still to go out
+size_t resendLeft = 0;
+
+// Text compression cost, CPU cycles
+uint32_t compressCycles = 0;
+uint32_t compressedBytes = 0;
+uint32_t inflateCycles = 0;
+uint32_t inflatedBytes = 0;
+
+// Sealing/opening cost, us
+uint32_t sealUs = 0;
+uint32_t openUs = 0;
+
+// Boot phase timestamps, ms since the app started
+struct BootTimings {
+  uint32_t serialMs;
+  uint32_t configMs;
+  uint32_t radioMs;
+  uint32_t rxArmedMs;       // Time to first RX: the radio is listening
+  uint32_t bleMs;            // BLE bring-up duration
+  uint32_t readyMs;
+  uint32_t firstFrameMs;    // First frame actually received, 0 until then
+};
+BootTimings bootTimings = {};
+StationConfig stationConfig;
+
+// Tags skip ARQ_NO_MESSAGE and never restart, so a late receipt cannot
+// retire or confirm a newer message
+uint16_t nextMsgTag() {
+  if (++msgTag == ARQ_NO_MESSAGE) {
+    msgTag++;
+  }
+  return msgTag;
 }
 
-// Message queue
-String pendingMessage = "";
-bool messageReceived = false;
+// The phone numbers its messages from 1 on every connection, in step with
+// the tags. Tags from before this connection have no number it would
+// know: ARQ_NO_MESSAGE.
+uint16_t phoneNumberForTag(uint16_t tag) {
+  uint32_t conn = phoneConn;
+  uint16_t first = (uint16_t)(conn & 0xFFFF);
+  uint32_t sent = conn >> 16;
+  uint32_t k = ((uint32_t)tag + 0xFFFF - first) % 0xFFFF;
+  return (tag != ARQ_NO_MESSAGE && k < sent) ? (uint16_t)(k + 1) : ARQ_NO_MESSAGE;
+}
 
 class MyServerCallbacks: public BLEServerCallbacks {
     void onConnect(BLEServer* pServer) {
       deviceConnected = true;
-      Serial.println("📱 Phone connected to M2");
+      phoneConnectedMs = millis();
+      uint16_t first = (uint16_t)(msgTag + 1);
+      if (first == ARQ_NO_MESSAGE) {
+        first++;
+      }
+      phoneConn = first;
+      LOG_INFO(EV_PHONE_CONNECTED);
     };
 
     void onDisconnect(BLEServer* pServer) {
       deviceConnected = false;
-      Serial.println("📱 Phone disconnected from M2");
+      bleMtu = BLE_DEFAULT_MTU;
+      bleRx.reset();
+      LOG_INFO(EV_PHONE_DISCONNECTED);
+    }
+
+    void onMtuChanged(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
+      bleMtu = param->mtu.mtu;
+      LOG_INFO(EV_BLE_MTU, bleMtu);
     }
 };
 
 class MyCallbacks: public BLECharacteristicCallbacks {
     void onWrite(BLECharacteristic *pCharacteristic) {
-      std::string rxValue = pCharacteristic->getValue();
+      uint32_t writeUs = micros();
+      
+      // Read the characteristic buffer directly, no std::string/String copies
+      const uint8_t* data = pCharacteristic->getData();
+      size_t len = pCharacteristic->getLength();
 
-      if (rxValue.length() > 0) {
-        String message = String(rxValue.c_str());
-        Serial.println("📱➡️ Received from phone: " + message);
+      // Long messages arrive as several segmented writes
+      BleReassemblyResult result = bleRx.push(data, len);
+      if (result == BLE_REASM_COMPLETE && bleRx.length() > 1 && bleRx.message()[0] == BLE_BULK_MARKER) {
+        // Bulk commands are not chat messages: no number, no receipt, not logged
+        uint8_t* slot = phoneToRadio.claim(bleRx.length() - 1);
+        if (slot == NULL) {
+          LOG_ERROR(EV_RADIO_RING_FULL, 0);
+          return;
+        }
+        memcpy(slot, bleRx.message() + 1, bleRx.length() - 1);
+        phoneToRadio.commit(bleRx.length() - 1, RADIO_REC_BULK, 0);
+        if (loopTask != NULL) {
+          xTaskNotifyGive(loopTask);
+        }
+      } else if (result == BLE_REASM_COMPLETE) {
+        // Tagged so a delivery receipt can be matched to it, here and by the phone
+        uint16_t tag = nextMsgTag();
+        uint32_t conn = phoneConn;
+        if ((conn >> 16) < 0xFFFF) {
+          phoneConn = conn + 0x10000;
+        }
+        LOG_INFO(EV_PHONE_MESSAGE, tag, bleRx.length());
         
-        // Send via LoRa to other station
-        sendLoRaMessage(message);
+        // Hand over to loop(), which logs a copy until it is acknowledged
+        uint8_t* slot = phoneToRadio.claim(PHONE_TO_RADIO_PREFIX + bleRx.length());
+        if (slot == NULL) {
+          // The phone task reports it: the BLE callback never waits for
+          // the log or notifies
+          LOG_ERROR(EV_RADIO_RING_FULL, tag);
+          ArqReceipt failed = { tag, false };
+          queueReceipts(bleToPhone, &failed, 1);
+          return;
+        }
+        memcpy(slot, &writeUs, sizeof(writeUs));
+        slot[4] = (uint8_t)(tag & 0xFF);
+        slot[5] = (uint8_t)(tag >> 8);
+        memcpy(slot + PHONE_TO_RADIO_PREFIX, bleRx.message(), bleRx.length());
+        phoneToRadio.commit(PHONE_TO_RADIO_PREFIX + bleRx.length(), RADIO_REC_MESSAGE, 0);
+        if (loopTask != NULL) {
+          xTaskNotifyGive(loopTask);
+        }
+        phoneMessages++;
+      } else if (result == BLE_REASM_ERROR) {
+        LOG_WARN(EV_BAD_BLE_SEGMENT);
       }
     }
 };
 
-void sendBLEMessage(String message) {
+// Counter table for the status snapshot, in StatusCounter order
+void fillStatusCounters(uint32_t* c) {
+  const LoRaRadioStats& rs = loraRadioGetStats();
+  const ArqStats& as = arqGetStats();
+  const FramePoolStats& ps = framePoolGetStats();
+  c[STATUS_CTR_PHONE_MESSAGES] = phoneMessages;
+  c[STATUS_CTR_BLE_NOTIFICATIONS] = bleNotifications;
+  c[STATUS_CTR_FRAMES_QUEUED] = rs.framesQueued;
+  c[STATUS_CTR_FRAMES_SENT] = rs.framesSent;
+  c[STATUS_CTR_FRAMES_RECEIVED] = rs.framesReceived;
+  c[STATUS_CTR_TX_FAILURES] = rs.txFailures;
+  c[STATUS_CTR_RX_FAILURES] = rs.rxFailures;
+  c[STATUS_CTR_CRC_ERRORS] = rs.crcErrors;
+  c[STATUS_CTR_QUEUE_FULL] = rs.queueFull;
+  c[STATUS_CTR_CAD_BUSY] = rs.cadBusy;
+  c[STATUS_CTR_BACKOFFS] = rs.backoffs;
+  c[STATUS_CTR_ARQ_RETRANSMISSIONS] = as.retransmissions;
+  c[STATUS_CTR_ARQ_ACKED] = as.acked;
+  c[STATUS_CTR_ARQ_FAILED] = as.failed;
+  c[STATUS_CTR_DUPLICATES] = loraDedupGetStats().duplicates;
+  c[STATUS_CTR_RELAYED] = meshGetStats().relayed;
+  c[STATUS_CTR_POOL_FAILURES] = ps.allocFailures;
+  c[STATUS_CTR_POOL_HIGH_WATER] = ps.highWater;
+}
+
+// The snapshot is built only when the phone reads the characteristic
+class StatusCallbacks: public BLECharacteristicCallbacks {
+    void onRead(BLECharacteristic *pCharacteristic) {
+      static uint8_t snapshot[STATUS_SNAPSHOT_SIZE];
+      uint32_t counters[STATUS_CTR_COUNT];
+      fillStatusCounters(counters);
+      size_t len = statusBuildSnapshot(snapshot, sizeof(snapshot), STATION_ID, millis(), counters);
+      pCharacteristic->setValue(snapshot, len);
+    }
+};
+
+void sendBLEMessage(const uint8_t* data, size_t len) {
   if (deviceConnected) {
-    pTxCharacteristic->setValue(message.c_str());
-    pTxCharacteristic->notify();
-    Serial.println("📱⬅️ Sent to phone: " + message);
+    // Split across notifications sized to the negotiated MTU
+    uint8_t chunk[BLE_PREFERRED_MTU];
+    BleSegmenter seg;
+    seg.begin(data, len, bleMtu);
+    
+    size_t n;
+    while ((n = seg.next(chunk)) > 0) {
+      pTxCharacteristic->setValue(chunk, n);
+      pTxCharacteristic->notify();
+      bleNotifications++;
+    }
+    LOG_INFO(EV_SENT_TO_PHONE, seg.index ? seg.index : 1, len);
   }
 }
 
-void sendLoRaMessage(String message) {
-  if (!loraInitialized) {
-    Serial.println("❌ LoRa not initialized, message dropped");
-    return;
+// Tells the phone whether its messages reached the other station (phone side)
+void sendDeliveryReceipts(const ArqReceipt* receipts, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    uint16_t phoneNo = phoneNumberForTag(receipts[i].msgNo);
+    // Delivered or given up: either way ARQ is done with it
+    if (storeReady) {
+      xSemaphoreTake(storeMutex, portMAX_DELAY);
+      msgStoreRetireTag(MSG_STORE_OUTBOUND, receipts[i].msgNo);
+      xSemaphoreGive(storeMutex);
+    }
+    if (receipts[i].delivered) {
+      LOG_INFO(EV_RECEIPT, receipts[i].msgNo);
+    } else {
+      LOG_WARN(EV_RECEIPT_FAILED, receipts[i].msgNo);
+    }
+    if (deviceConnected && phoneNo != ARQ_NO_MESSAGE) {
+      uint8_t note[BLE_RECEIPT_SIZE];
+      note[0] = receipts[i].delivered ? BLE_RECEIPT_DELIVERED : BLE_RECEIPT_FAILED;
+      note[1] = (uint8_t)(phoneNo & 0xFF);
+      note[2] = (uint8_t)(phoneNo >> 8);
+      pTxCharacteristic->setValue(note, sizeof(note));
+      pTxCharacteristic->notify();
+      receiptsSent++;
+    }
+  }
+}
+
+// Receipts from the LoRa side go to the phone task on the producer's own ring
+template <uint32_t N>
+void queueReceipts(SpscRing<N>& ring, const ArqReceipt* receipts, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    uint8_t* p = ring.claim(2);
+    if (p == NULL) {
+      LOG_ERROR(EV_PHONE_RING_FULL, 2);
+      continue;
+    }
+    p[0] = (uint8_t)(receipts[i].msgNo & 0xFF);
+    p[1] = (uint8_t)(receipts[i].msgNo >> 8);
+    ring.commit(2, PHONE_REC_RECEIPT, receipts[i].delivered ? PHONE_REC_DELIVERED : 0);
+  }
+  if (count > 0 && phoneTask != NULL) {
+    xTaskNotifyGive(phoneTask);
+  }
+}
+
+// A phone message that will never go out is reported failed like one ARQ
+// gave up on, which also retires its log record (loop() only)
+void failPhoneMessage(uint16_t msgNo) {
+  if (msgNo == ARQ_NO_MESSAGE) return;
+  ArqReceipt receipt = { msgNo, false };
+  queueReceipts(loopToPhone, &receipt, 1);
+}
+
+// Time on air of a normal-preamble frame, rounded up to whole ms
+uint32_t frameAirtimeMs(const LoRaProfile& profile, size_t len) {
+  return loraTimeOnAirUs(profile.sf, profile.bwKHz, len, LORA_PREAMBLE_SYMBOLS) / 1000 + 1;
+}
+
+// Retransmission timeouts never go below one frame plus its ACK on air
+void updateArqAirtime(const LoRaProfile& profile) {
+  xSemaphoreTake(arqMutex, portMAX_DELAY);
+  arqSetAirtime(frameAirtimeMs(profile, LORA_FRAME_MAX_SIZE),
+                frameAirtimeMs(profile, LORA_FRAME_FIXED_SIZE + 1 + ARQ_ACK_SIZE));
+  xSemaphoreGive(arqMutex);
+  if (bulkMutex != NULL) {
+    xSemaphoreTake(bulkMutex, portMAX_DELAY);
+    bulkSetAirtime(frameAirtimeMs(profile, LORA_FRAME_MAX_SIZE),
+                   frameAirtimeMs(profile, LORA_FRAME_FIXED_SIZE + MESH_HEADER_SIZE + LORA_CRYPTO_OVERHEAD +
+                                           LORA_BULK_STATUS_SIZE));
+    xSemaphoreGive(bulkMutex);
+  }
+}
+
+// Fresh nonce epochs from NVS. 0 if none could be reserved: NVS failed,
+// or every 16-bit epoch has been handed out under this key.
+uint16_t reserveEpochs(uint32_t count) {
+  uint32_t first = stationConfigReserveEpochs(count);
+  return (first != 0 && first + count - 1 <= 0xFFFF) ? (uint16_t)first : 0;
+}
+
+// Duty-cycle class of a frame type: ACKs and link control keep the link
+// alive when the budget runs low; bulk transfers give way to everything
+// else
+uint8_t airtimePriorityFor(uint8_t type) {
+  if (type == FRAME_TYPE_BULK) {
+    return AIRTIME_PRIO_BULK;
+  }
+  return type == FRAME_TYPE_DATA ? AIRTIME_PRIO_DATA : AIRTIME_PRIO_CONTROL;
+}
+
+// Encodes one frame (optional prefix + data) for dst into a pool buffer and
+// queues it. Everything but link control is routed through the mesh, and a
+// pending ARQ acknowledgement for dst rides along whenever there is room.
+bool queueLoRaFrame(uint8_t dst, uint8_t type, uint8_t flags, const uint8_t* prefix, size_t prefixLen,
+                    const uint8_t* data, size_t len) {
+  FrameHandle frame = framePoolAlloc();
+  if (!frame.valid()) {
+    LOG_ERROR(EV_POOL_EXHAUSTED);
+    return false;
   }
   
-  // Create JSON message
-  JsonDocument doc;
-  doc["from"] = STATION_ID;
-  doc["to"] = (STATION_ID == 1) ? 2 : 1;
-  doc["msg"] = message;
-  doc["timestamp"] = millis();
+  // Build binary frame in place: payload goes straight behind the header
+  unsigned long now = millis();
+  LoRaFrameHeader hdr = {};
+  hdr.type = type;
+  hdr.src = STATION_ID;
+  hdr.dst = dst;
+  hdr.flags = flags;
   
-  String jsonString;
-  serializeJson(doc, jsonString);
+  uint8_t mesh[MESH_HEADER_SIZE];
+  size_t meshLen = 0;
+  uint8_t hop = dst;
+  if (type != FRAME_TYPE_CTRL) {
+    LoRaMeshHeader route = meshOriginate(dst, now);
+    meshWriteHeader(mesh, route);
+    meshLen = MESH_HEADER_SIZE;
+    hop = route.nextHop;
+    hdr.flags |= FRAME_FLAG_MESH;
+  }
   
-  Serial.println("📡➡️ Sending via LoRa: " + jsonString);
-  int state = radio.transmit(jsonString);
+  // Neighbours learn from this whether we need long preambles, and we
+  // stretch ours for the next hop if it sniffs
+  if (LOW_POWER_MODE) {
+    hdr.flags |= FRAME_FLAG_SNIFF;
+  }
+  if (meshNeighbourSniffs(hop)) {
+    frame->preamble = loraSniffPreamble;
+  }
+  frame->channels = loraChannelMask(hop, dst);
   
-  if (state == RADIOLIB_ERR_NONE) {
-    Serial.println("✅ LoRa transmission successful");
+  frame->priority = airtimePriorityFor(type);
+  
+  if (meshLen + LORA_CRYPTO_OVERHEAD + prefixLen + len > LORA_FRAME_MAX_PAYLOAD) {
+    LOG_ERROR(EV_MESSAGE_TOO_LONG, len);
+    return false;
+  }
+  uint8_t ack[ARQ_ACK_SIZE];
+  size_t ackLen = 0;
+  if (arqMutex != NULL && meshLen + LORA_CRYPTO_OVERHEAD + prefixLen + len + ARQ_ACK_SIZE <= LORA_FRAME_MAX_PAYLOAD) {
+    xSemaphoreTake(arqMutex, portMAX_DELAY);
+    if (arqAckPending(dst)) {
+      arqWriteAck(dst, ack);
+      ackLen = ARQ_ACK_SIZE;
+      hdr.flags |= FRAME_FLAG_ACK;
+    }
+    xSemaphoreGive(arqMutex);
+  }
+  hdr.length = (uint8_t)(meshLen + LORA_CRYPTO_OVERHEAD + ackLen + prefixLen + len);
+  
+  // Several tasks send; sequence, timestamp and nonce epoch must stay
+  // consistent. A wrapped sequence moves on to the next epoch. The clock
+  // is read inside too, or a task preempted before it could stamp an
+  // older time than the frame ahead of it and wrap tsDelta.
+  portENTER_CRITICAL(&txSequenceMux);
+  unsigned long stamp = millis();
+  hdr.seq = txSequence++;
+  hdr.tsDelta = stamp - lastTxMillis;
+  lastTxMillis = stamp;
+  uint16_t epoch = txEpoch;
+  if (txSequence == 0) {
+    txEpoch = txNextEpoch;
+    txNextEpoch = 0;
+  }
+  bool epochMissing = (txEpoch == 0 || txNextEpoch == 0);
+  portEXIT_CRITICAL(&txSequenceMux);
+#if LORA_CRYPTO_ENABLED
+  // Reserve the epoch for the next wrap, or one to use now if the last
+  // reservation failed. A frame without an epoch is not sent: any other
+  // epoch could reuse a nonce.
+  if (epochMissing) {
+    uint16_t fresh = reserveEpochs(1);
+    portENTER_CRITICAL(&txSequenceMux);
+    if (txEpoch == 0) {
+      txEpoch = fresh;
+    } else if (txNextEpoch == 0) {
+      txNextEpoch = fresh;
+    }
+    portEXIT_CRITICAL(&txSequenceMux);
+  }
+  if (epoch == 0) {
+    LOG_ERROR(EV_NO_EPOCH);
+    return false;
+  }
+#else
+  (void)epochMissing;
+#endif
+  
+  // Sealed frames: the mesh header stays in clear, the rest is encrypted
+  // where it lies once the header is written
+  size_t headerLen = loraFrameHeaderSize(hdr);
+  uint8_t* body = frame->data + headerLen;
+  uint8_t* inner = body + meshLen + (LORA_CRYPTO_ENABLED ? LORA_CRYPTO_EPOCH_SIZE : 0);
+  memcpy(body, mesh, meshLen);
+  memcpy(inner, ack, ackLen);
+  memcpy(inner + ackLen, prefix, prefixLen);
+  memcpy(inner + ackLen + prefixLen, data, len);
+  hdr.version = LORA_CRYPTO_ENABLED ? LORA_FRAME_VERSION_SEALED : LORA_FRAME_VERSION;
+  frame->len = (uint8_t)loraFrameEncode(frame->data, sizeof(frame->data), hdr, body);
+#if LORA_CRYPTO_ENABLED
+  uint32_t sealStart = micros();
+  loraCryptoSeal(frame->data, headerLen, meshLen, ackLen + prefixLen + len, epoch);
+  sealUs += micros() - sealStart;
+#else
+  (void)epoch;
+#endif
+  
+  // Hand off to the radio driver; transmission completes asynchronously
+  unsigned frameLen = frame->len;
+  if (!loraRadioQueueFrame(std::move(frame))) {
+    LOG_ERROR(EV_TX_QUEUE_FULL);
+    return false;
+  }
+  if (dst == STATION_PEER_ID && hop == STATION_PEER_ID) {
+    linkAdaptCountSent();
+  }
+  LOG_DEBUG(EV_FRAME_QUEUED, hdr.seq, dst, frameLen, loraRadioQueueDepth());
+  return true;
+}
+
+// Link adaptation control frames, never relayed (called with linkMutex held)
+bool sendLinkControl(const uint8_t* ctrl, size_t len) {
+  return queueLoRaFrame(STATION_PEER_ID, FRAME_TYPE_CTRL, 0, NULL, 0, ctrl, len);
+}
+
+// Bulk transfer frames for the peer, outside ARQ (called with bulkMutex held)
+bool sendBulkFrame(uint8_t dst, const uint8_t* hdr, size_t hdrLen, const uint8_t* data, size_t len) {
+  return queueLoRaFrame(dst, FRAME_TYPE_BULK, 0, hdr, hdrLen, data, len);
+}
+
+// Largest bulk block one frame holds on the current profile
+uint8_t bulkBlockSize() {
+  return loraFragmentChunkForSF(loraSpreadingFactor) + LORA_FRAG_HEADER_SIZE - MESH_HEADER_SIZE -
+         LORA_CRYPTO_OVERHEAD - LORA_BULK_HEADER_SIZE;
+}
+
+// New profile/power: queued behind frames already waiting for the radio
+uint16_t applyLinkProfile(const LoRaProfile& profile, int8_t powerDbm) {
+  LoRaRadioConfig cfg;
+  cfg.sf = profile.sf;
+  cfg.bwKHz = profile.bwKHz;
+  cfg.powerDbm = powerDbm;
+  loraSniffPreamble = lowPowerPreambleSymbols(profile.sf, profile.bwKHz);
+  cfg.rxSniffSymbols = LOW_POWER_MODE ? loraSniffPreamble : 0;
+  cfg.rxChannel = loraHomeChannel(STATION_ID);
+  loraSpreadingFactor = profile.sf;
+  uint16_t generation = loraRadioQueueConfig(cfg);
+  updateArqAirtime(profile);
+  
+  // The NVS write can stall for an erase; loop() does it, not the radio task
+  portENTER_CRITICAL(&linkSaveMux);
+  linkToSave = LINK_SAVE_PENDING | ((uint32_t)(uint8_t)powerDbm << 8) | linkAdaptProfileIndex();
+  portEXIT_CRITICAL(&linkSaveMux);
+  if (loopTask != NULL) {
+    xTaskNotifyGive(loopTask);
+  }
+  LOG_INFO(EV_LINK_PROFILE, profile.sf, (unsigned)profile.bwKHz, (uint32_t)powerDbm);
+  return generation;
+}
+
+// Moves due ARQ frames (new ones inside the window, expired retransmissions)
+// to the radio, keeping only a short backlog so RTT samples stay honest.
+// loop() only: it is the one producer of loopToPhone.
+void pumpArq() {
+  if (arqMutex == NULL) return;
+  
+  // Mid profile switch the peer may still be on the old settings: frames
+  // sent now would only burn tries. They go once it is confirmed or undone.
+  if (linkAdaptState() == LINK_VERIFYING) return;
+  
+  ArqOutFrame out;
+  ArqReceipt receipts[ARQ_MAX_FRAME_MSGS];
+  while (loraRadioQueueDepth() < ARQ_RADIO_BACKLOG) {
+    size_t count = 0;
+    xSemaphoreTake(arqMutex, portMAX_DELAY);
+    bool due = arqNextTransmit(millis(), &out, receipts, &count, ARQ_MAX_FRAME_MSGS);
+    xSemaphoreGive(arqMutex);
+    
+    queueReceipts(loopToPhone, receipts, count);
+    if (!due) {
+      if (count > 0) {
+        continue;   // Dropped a frame; there may be more
+      }
+      break;
+    }
+    // Repeated losses: the learned route may be gone, flood instead
+    if (out.attempt == MESH_FLOOD_AFTER_TRIES) {
+      meshForgetRoute(STATION_PEER_ID);
+    }
+    if (!queueLoRaFrame(STATION_PEER_ID, FRAME_TYPE_DATA, out.flags, out.header, sizeof(out.header),
+                        out.body, out.len)) {
+      break;
+    }
+  }
+}
+
+// Data frame for the peer: buffered for reliable delivery when ARQ is on
+// and the peer is a single station. msgFirst..msgLast are the phone
+// messages it carries; last marks the frame holding the end of msgLast.
+bool sendDataFrame(uint8_t flags, const uint8_t* prefix, size_t prefixLen,
+                   const uint8_t* data, size_t len, uint16_t msgFirst, uint16_t msgLast, bool last) {
+  if (!LORA_ARQ_ENABLED || STATION_PEER_ID == LORA_BROADCAST_ID) {
+    return queueLoRaFrame(STATION_PEER_ID, FRAME_TYPE_DATA, flags, prefix, prefixLen, data, len);
+  }
+  
+  uint8_t body[ARQ_MAX_BODY];
+  if (prefixLen + len > sizeof(body)) {
+    return false;
+  }
+  memcpy(body, prefix, prefixLen);
+  memcpy(body + prefixLen, data, len);
+  
+  xSemaphoreTake(arqMutex, portMAX_DELAY);
+  bool accepted = arqSubmit(flags, body, prefixLen + len, msgFirst, msgLast, last);
+  xSemaphoreGive(arqMutex);
+  if (!accepted) {
+    LOG_ERROR(EV_ARQ_BUFFER_FULL);
+    return false;
+  }
+  if (loopTask != NULL) {
+    xTaskNotifyGive(loopTask);
+  }
+  return true;
+}
+
+// Whether sendDataFrame() can take this many frames now; without ARQ
+// there is nothing to reserve
+bool dataFramesFit(size_t frames) {
+  if (!LORA_ARQ_ENABLED || STATION_PEER_ID == LORA_BROADCAST_ID) {
+    return true;
+  }
+  xSemaphoreTake(arqMutex, portMAX_DELAY);
+  size_t space = arqFreeSlots();
+  xSemaphoreGive(arqMutex);
+  return frames <= space;
+}
+
+// Long message as an FEC group: data fragments, then repair fragments.
+// Through ARQ the group must take consecutive ARQ sequence numbers,
+// because the receiver derives those of the fragments it rebuilt from
+// them; the caller holds off other senders. Returns false, having sent
+// nothing, when no repairs fit and plain fragments should be used.
+bool sendFecGroup(uint8_t flags, const uint8_t* data, size_t len, size_t chunk, uint16_t msgNo) {
+  chunk -= LORA_FEC_HEADER_SIZE;
+  size_t dataCount = loraFragmentCount(len, chunk);
+  if (len > LORA_FRAG_MAX_MESSAGE || dataCount > LORA_FRAG_MAX_FRAGMENTS) {
+    return false;
+  }
+  size_t repairs = loraFecRepairCount(dataCount);
+  
+  // The whole group is buffered at once, or the receiver could count a
+  // later message's frames as part of it
+  if (LORA_ARQ_ENABLED && STATION_PEER_ID != LORA_BROADCAST_ID && repairs > 0) {
+    xSemaphoreTake(arqMutex, portMAX_DELAY);
+    size_t space = arqFreeSlots();
+    xSemaphoreGive(arqMutex);
+    if (dataCount + repairs > space) {
+      repairs = (space > dataCount) ? space - dataCount : 0;
+    }
+  }
+  if (repairs == 0) {
+    return false;
+  }
+  
+  LoRaFragmentHeader frag;
+  frag.msgId = txFragmentMsgId++;
+  frag.count = (uint8_t)(dataCount + repairs);
+  frag.dataCount = (uint8_t)dataCount;
+  frag.chunk = (uint8_t)chunk;
+  frag.lastLen = (uint8_t)(len - (dataCount - 1) * chunk);
+  
+  LOG_INFO(EV_FEC_GROUP, len, dataCount, repairs);
+  uint8_t repair[LORA_FRAME_MAX_PAYLOAD];
+  for (uint8_t i = 0; i < frag.count; i++) {
+    const uint8_t* shard = repair;
+    size_t take = chunk;
+    if (i < dataCount) {
+      shard = data + (size_t)i * chunk;
+      take = (i + 1u == dataCount) ? frag.lastLen : chunk;
+    } else {
+      loraFecEncode(data, len, frag.dataCount, chunk, (uint8_t)(i - dataCount), repair);
+    }
+    uint8_t fragHeader[LORA_FRAG_FEC_HEADER_SIZE];
+    frag.index = i;
+    loraFragmentWriteFecHeader(fragHeader, frag);
+    
+    if (!sendDataFrame(flags | FRAME_FLAG_FRAGMENT | FRAME_FLAG_FEC, fragHeader, sizeof(fragHeader),
+                       shard, take, msgNo, msgNo, i + 1u == frag.count)) {
+      // Only the radio queue can refuse part of a group: ARQ had room
+      failPhoneMessage(msgNo);
+      break;
+    }
+    loraFragmentNoteSent(i == 0, i >= dataCount);
+  }
+  return true;
+}
+
+// Sends whatever is batched; caller holds coalesceMutex. A batch that
+// could not be buffered is kept for the next try.
+bool flushCoalescedLocked() {
+  if (coalescer.empty()) return true;
+  
+  bool sent;
+  if (coalescer.count == 1) {
+    size_t n;
+    const uint8_t* msg = coalescer.first(&n);
+    sent = sendDataFrame(coalescedFlags, NULL, 0, msg, n, coalescedFirstMsg, coalescedLastMsg, true);
   } else {
-    Serial.printf("❌ LoRa transmission failed: %d\n", state);
+    sent = sendDataFrame(coalescedFlags | FRAME_FLAG_COALESCED, NULL, 0, coalescer.buf, coalescer.len,
+                         coalescedFirstMsg, coalescedLastMsg, true);
+    if (sent) {
+      coalescedFrames++;
+      coalescedMessages += coalescer.count;
+    }
+  }
+  if (!sent) {
+    return false;
+  }
+  coalescer.clear();
+  coalescedFirstMsg = coalescedLastMsg = ARQ_NO_MESSAGE;
+  return true;
+}
+
+// Coalescing window expired (runs in the FreeRTOS timer task)
+void onCoalesceTimer(TimerHandle_t timer) {
+  xSemaphoreTake(coalesceMutex, portMAX_DELAY);
+  if (!flushCoalescedLocked()) {
+    xTimerStart(timer, 0);
   }
+  xSemaphoreGive(coalesceMutex);
+}
+
+// Puts a message that fits the ARQ buffer on its way; caller holds
+// coalesceMutex if there is one. Returns false if it has to wait.
+bool sendMessageFrames(uint8_t flags, const uint8_t* data, size_t len, size_t chunk, size_t count,
+                       uint16_t msgNo) {
+  size_t framePayload = chunk + LORA_FRAG_HEADER_SIZE;
   
-  // IMPORTANT: Put radio back in receive mode after transmission
-  radio.startReceive();
+  // Short messages: batch them for the coalescing window
+  if (coalesceTimer != NULL && len < framePayload) {
+    size_t budget = (LORA_COALESCE_BUDGET < framePayload) ? LORA_COALESCE_BUDGET : framePayload;
+    if (!coalescer.fits(len, budget) || (!coalescer.empty() && coalescedFlags != flags)) {
+      if (!flushCoalescedLocked()) {
+        return false;
+      }
+    }
+    if (!coalescer.fits(len, budget)) {
+      return sendDataFrame(flags, NULL, 0, data, len, msgNo, msgNo, true);
+    }
+    coalescer.add(data, len);
+    coalescedFlags = flags;
+    if (msgNo != ARQ_NO_MESSAGE) {
+      if (coalescedFirstMsg == ARQ_NO_MESSAGE) {
+        coalescedFirstMsg = msgNo;
+      }
+      coalescedLastMsg = msgNo;
+    }
+    if (coalescer.count == 1) {
+      xTimerStart(coalesceTimer, 0);
+    }
+    return true;
+  }
+  
+  // Keep ordering: anything batched goes out before this message
+  if (!flushCoalescedLocked()) {
+    return false;
+  }
+  if (LORA_FEC_ENABLED && len > framePayload && sendFecGroup(flags, data, len, chunk, msgNo)) {
+    return true;
+  }
+  
+  // Messages that fit go out as a single frame
+  if (len <= framePayload) {
+    return sendDataFrame(flags, NULL, 0, data, len, msgNo, msgNo, true);
+  }
+  
+  // Long messages are split into fragments sized for the current profile
+  LoRaFragmentHeader frag;
+  frag.msgId = txFragmentMsgId++;
+  frag.count = (uint8_t)count;
+  frag.chunk = (uint8_t)chunk;
+  
+  LOG_INFO(EV_FRAGMENTING, len, count);
+  for (uint8_t i = 0; i < count; i++) {
+    size_t offset = (size_t)i * chunk;
+    size_t take = (len - offset < chunk) ? len - offset : chunk;
+    uint8_t fragHeader[LORA_FRAG_HEADER_SIZE];
+    frag.index = i;
+    loraFragmentWriteHeader(fragHeader, frag);
+    
+    if (!sendDataFrame(flags | FRAME_FLAG_FRAGMENT, fragHeader, sizeof(fragHeader), data + offset, take,
+                       msgNo, msgNo, (size_t)(i + 1) == count)) {
+      // Only the radio queue can refuse part of a group: ARQ had room
+      failPhoneMessage(msgNo);
+      return true;
+    }
+    loraFragmentNoteSent(i == 0);
+  }
+  return true;
+}
+
+// Sends a phone message to the peer, all of its frames or none. Returns
+// false while there is no room, for the caller to keep it and try again;
+// a message that can never go out is reported failed (loop() only).
+bool sendLoRaMessage(const uint8_t* data, size_t len, uint16_t msgNo) {
+  if (!loraInitialized) {
+    LOG_ERROR(EV_LORA_DOWN);
+    failPhoneMessage(msgNo);
+    return true;
+  }
+  
+  // Short chat text goes out compressed when that saves bytes. The
+  // message length limit applies to the original text.
+  uint8_t flags = 0;
+#if LORA_COMPRESS_ENABLED
+  uint8_t packed[LORA_COMPRESS_MAX_MESSAGE];
+  if (len > 1 && len <= sizeof(packed)) {
+    uint32_t start = ESP.getCycleCount();
+    size_t packedLen = loraCompress(data, len, packed, len - 1);
+    if (packedLen > 0) {
+      compressCycles += ESP.getCycleCount() - start;
+      compressedBytes += len;
+      data = packed;
+      len = packedLen;
+      flags = FRAME_FLAG_COMPRESSED;
+    }
+  }
+#endif
+  
+  // Room for the mesh header, and for reliable frames an ARQ header and
+  // possibly an ACK block
+  size_t chunk = loraFragmentChunkForSF(loraSpreadingFactor) - MESH_HEADER_SIZE -
+                 (LORA_ARQ_ENABLED ? ARQ_FRAME_OVERHEAD : 0) - LORA_CRYPTO_OVERHEAD;
+  size_t framePayload = chunk + LORA_FRAG_HEADER_SIZE;
+  size_t count = (len <= framePayload) ? 1 : loraFragmentCount(len, chunk);
+  if (len > framePayload && (len > LORA_FRAG_MAX_MESSAGE || count > LORA_FRAG_MAX_FRAGMENTS)) {
+    LOG_ERROR(EV_MESSAGE_TOO_LONG, len);
+    failPhoneMessage(msgNo);
+    return true;
+  }
+  
+  // Room is checked for the whole message, and for a pending batch's own
+  // frame, with the lock held: the timer cannot flush in between, or into
+  // the middle of an FEC group. FEC repairs take only what is left over.
+  if (coalesceTimer != NULL) {
+    xSemaphoreTake(coalesceMutex, portMAX_DELAY);
+  }
+  bool sent = dataFramesFit(count + (coalescer.empty() ? 0 : 1)) &&
+              sendMessageFrames(flags, data, len, chunk, count, msgNo);
+  if (coalesceTimer != NULL) {
+    xSemaphoreGive(coalesceMutex);
+  }
+  return sent;
+}
+
+// Hands a received message to the phone task; the RX path never waits
+// for BLE or flash. decodedUs goes along for the RX_DELIVER stage.
+void forwardToPhone(const uint8_t* msg, size_t len, bool compressed, uint32_t decodedUs) {
+  uint8_t* slot = radioToPhone.claim(PHONE_MESSAGE_PREFIX + len);
+  if (slot == NULL) {
+    LOG_ERROR(EV_PHONE_RING_FULL, len);
+    return;
+  }
+  memcpy(slot, &decodedUs, sizeof(decodedUs));
+  memcpy(slot + PHONE_MESSAGE_PREFIX, msg, len);
+  radioToPhone.commit(PHONE_MESSAGE_PREFIX + len, PHONE_REC_MESSAGE, compressed ? PHONE_REC_COMPRESSED : 0);
+  if (phoneTask != NULL) {
+    xTaskNotifyGive(phoneTask);
+  }
+}
+
+// Bulk notes go to the phone task on the caller's own ring: loop() polls
+// and handles phone commands, the RX path handles frames
+template <uint32_t N>
+bool queueBulkNote(SpscRing<N>& ring, const uint8_t* note, size_t len, BulkNoteKind kind) {
+  uint8_t* slot = ring.claim(len);
+  if (slot == NULL) {
+    LOG_ERROR(EV_PHONE_RING_FULL, len);
+    return false;
+  }
+  memcpy(slot, note, len);
+  ring.commit(len, PHONE_REC_BULK, kind);
+  if (phoneTask != NULL) {
+    xTaskNotifyGive(phoneTask);
+  }
+  return true;
 }
 
-void checkLoRaMessages() {
-  if (!loraInitialized) return;
+bool bulkToPhone(const uint8_t* note, size_t len, BulkNoteKind kind) {
+  if (kind != BULK_NOTE_CHECKPOINT && len >= 6) {
+    unsigned id = (unsigned)(note[2] | (note[3] << 8) | (note[4] << 16) | ((uint32_t)note[5] << 24));
+    unsigned arg = (len >= 10) ? (unsigned)(note[6] | (note[7] << 8) | (note[8] << 16) | ((uint32_t)note[9] << 24)) : 0;
+    if (note[1] == BULK_PHONE_SENT) {
+      LOG_INFO(EV_BULK_SENT, id, (unsigned)bulkGetStats().txBytesPerSec);
+    } else if (note[1] == BULK_PHONE_STALLED && len >= 7) {
+      LOG_WARN(EV_BULK_STALLED, id, note[6]);
+    } else if (note[1] == BULK_PHONE_INCOMING) {
+      LOG_INFO(EV_BULK_INCOMING, id, arg);
+    } else if (note[1] == BULK_PHONE_COMPLETE) {
+      LOG_INFO(EV_BULK_COMPLETE, id, arg, (unsigned)bulkGetStats().rxBytesPerSec);
+    }
+  }
+  if (LORA_RADIO_TASK && xTaskGetCurrentTaskHandle() == loopTask) {
+    return queueBulkNote(loopToPhone, note, len, kind);
+  }
+  return queueBulkNote(radioToPhone, note, len, kind);
+}
+
+// A received block has somewhere to go: straight to a connected phone
+// with nothing queued ahead of it, or the log while it keeps room for chat
+bool bulkHasRoom() {
+  if (!storeReady) {
+    return deviceConnected;
+  }
+  xSemaphoreTake(storeMutex, portMAX_DELAY);
+  size_t pending = msgStorePending(MSG_STORE_INBOUND);
+  xSemaphoreGive(storeMutex);
+  return (deviceConnected && pending == 0) || pending + LORA_BULK_STORE_RESERVE < MSG_STORE_INDEX_SIZE;
+}
+
+// Inflates compressed text before it goes to the phone. Only the phone
+// task calls this, so one static buffer is enough. False if the message
+// could neither be sent nor stored. A message received at decodedUs (0
+// for none) that goes straight to the phone ends its RX_DELIVER stage.
+bool deliverToPhone(const uint8_t* msg, size_t len, bool compressed, uint32_t decodedUs) {
+  if (compressed) {
+    static uint8_t text[LORA_COMPRESS_MAX_MESSAGE];
+    size_t textLen;
+    uint32_t start = ESP.getCycleCount();
+    if (!loraDecompress(msg, len, text, sizeof(text), &textLen)) {
+      LOG_WARN(EV_BAD_COMPRESSED);
+      return false;
+    }
+    inflateCycles += ESP.getCycleCount() - start;
+    inflatedBytes += textLen;
+    msg = text;
+    len = textLen;
+  }
   
-  // Check if we received a packet via interrupt
-  if (receivedFlag) {
-    receivedFlag = false; // Reset flag
+  // No phone, or older messages still waiting: keep it for the replay
+  if (storeReady) {
+    xSemaphoreTake(storeMutex, portMAX_DELAY);
+    bool store = !deviceConnected || msgStorePending(MSG_STORE_INBOUND) > 0;
+    if (store && msgStoreAppend(MSG_STORE_INBOUND, msg, len, 0) != MSG_STORE_NONE) {
+      xSemaphoreGive(storeMutex);
+      LOG_INFO(EV_STORED_FOR_PHONE, msgStorePending(MSG_STORE_INBOUND));
+      return true;
+    }
+    xSemaphoreGive(storeMutex);
+  }
+  if (!deviceConnected) {
+    return false;
+  }
+  lowPowerNoteDelivered();
+  sendBLEMessage(msg, len);
+  if (decodedUs != 0) {
+    statusRecord(STATUS_STAGE_RX_DELIVER, micros() - decodedUs);
+  }
+  return true;
+}
+
+// Bulk notes: received blocks like messages, progress only to a connected
+// phone, checkpoints to NVS once the blocks before them are handled
+void deliverBulkNote(const uint8_t* note, size_t len, uint8_t kind) {
+  if (kind == BULK_NOTE_CHECKPOINT) {
+    uint8_t checkpoint[LORA_BULK_CHECKPOINT_SIZE];
+    if (len != sizeof(checkpoint)) {
+      return;
+    }
+    memcpy(checkpoint, note, len);
+    xSemaphoreTake(bulkMutex, portMAX_DELAY);
+    bulkTrimCheckpoint(checkpoint, len);
+    xSemaphoreGive(bulkMutex);
+    stationConfigSaveBulk(checkpoint, len);
+  } else if (kind == BULK_NOTE_KEEP) {
+    if (!deliverToPhone(note, len, false, 0)) {
+      xSemaphoreTake(bulkMutex, portMAX_DELAY);
+      bulkForget(note, len);
+      xSemaphoreGive(bulkMutex);
+    }
+  } else if (deviceConnected) {
+    sendBLEMessage(note, len);
+  }
+}
+
+// Only messages ARQ reports on can be retired from the log
+void storeOutbound(const uint8_t* data, size_t len, uint16_t msgNo) {
+  if (!storeReady || !LORA_ARQ_ENABLED || STATION_PEER_ID == LORA_BROADCAST_ID || !loraInitialized) {
+    return;
+  }
+  xSemaphoreTake(storeMutex, portMAX_DELAY);
+  msgStoreAppend(MSG_STORE_OUTBOUND, data, len, msgNo);
+  xSemaphoreGive(storeMutex);
+}
+
+// Phone messages a reboot interrupted. They get fresh tags, all of them
+// before BLE is up, so their receipts cannot match a message from the
+// phone; resendStoredOutbound() sends them as ARQ makes room.
+void retagStoredOutbound() {
+  uint8_t msg[MSG_STORE_MAX_MESSAGE];
+  xSemaphoreTake(storeMutex, portMAX_DELAY);
+  size_t count = msgStorePending(MSG_STORE_OUTBOUND);
+  for (size_t i = 0; i < count; i++) {
+    size_t len;
+    uint16_t tag;
+    uint32_t id = msgStoreGet(MSG_STORE_OUTBOUND, 0, msg, sizeof(msg), &len, &tag);
+    if (id == MSG_STORE_NONE) {
+      break;
+    }
+    uint16_t msgNo = nextMsgTag();
+    if (resendLeft == 0) {
+      resendNextTag = msgNo;
+    }
+    msgStoreRetire(id);
+    msgStoreAppend(MSG_STORE_OUTBOUND, msg, len, msgNo);
+    resendLeft++;
+  }
+  xSemaphoreGive(storeMutex);
+  if (count > 0) {
+    Serial.printf("💾 %u stored phone messages to resend\n", (unsigned)resendLeft);
+  }
+}
+
+// Re-tagged messages go out oldest first, as many as ARQ has room for;
+// the rest wait for the next pass (loop() only)
+void resendStoredOutbound() {
+  static uint8_t msg[MSG_STORE_MAX_MESSAGE];
+  while (resendLeft > 0) {
+    // Ahead of it in the log are only resent messages not yet acknowledged
+    size_t len = 0;
+    uint16_t tag;
+    uint32_t id = MSG_STORE_NONE;
+    xSemaphoreTake(storeMutex, portMAX_DELAY);
+    for (size_t i = 0; msgStoreGet(MSG_STORE_OUTBOUND, i, msg, 0, &len, &tag) != MSG_STORE_NONE; i++) {
+      if (tag == resendNextTag) {
+        id = msgStoreGet(MSG_STORE_OUTBOUND, i, msg, sizeof(msg), &len, &tag);
+        break;
+      }
+    }
+    xSemaphoreGive(storeMutex);
+    if (id != MSG_STORE_NONE && !sendLoRaMessage(msg, len, resendNextTag)) {
+      return;
+    }
+    if (++resendNextTag == ARQ_NO_MESSAGE) {
+      resendNextTag++;
+    }
+    if (--resendLeft == 0) {
+      Serial.println("💾 Stored phone messages all resent");
+    }
+  }
+}
+
+// Stored messages go to a reconnected phone, short ones packed several
+// to a notification, a few notifications per pass
+void replayStoredInbound() {
+  if (!storeReady || !deviceConnected || millis() - phoneConnectedMs < MSG_STORE_REPLAY_DELAY_MS) {
+    return;
+  }
+  static uint8_t msg[MSG_STORE_MAX_MESSAGE];
+  for (uint8_t n = 0; n < MSG_STORE_REPLAY_BATCHES; n++) {
+    BleBatch batch;
+    batch.begin(bleMtu);
+    uint32_t ids[32];
+    size_t len;
+    uint16_t tag;
     
-    // Use String for more reliable reception
-    String receivedMessage;
-    int state = radio.readData(receivedMessage);
+    xSemaphoreTake(storeMutex, portMAX_DELAY);
+    uint32_t id = msgStoreGet(MSG_STORE_INBOUND, 0, msg, sizeof(msg), &len, &tag);
+    if (id == MSG_STORE_NONE) {
+      xSemaphoreGive(storeMutex);
+      return;
+    }
+    if (!batch.add(msg, len)) {
+      // Too long to share a notification: on its own, segmented
+      msgStoreRetire(id);
+      xSemaphoreGive(storeMutex);
+      lowPowerNoteDelivered();
+      sendBLEMessage(msg, len);
+      continue;
+    }
+    ids[0] = id;
+    while (batch.count < sizeof(ids) / sizeof(ids[0]) &&
+           (id = msgStoreGet(MSG_STORE_INBOUND, batch.count, msg, sizeof(msg), &len, &tag)) != MSG_STORE_NONE &&
+           batch.add(msg, len)) {
+      ids[batch.count - 1] = id;
+    }
+    for (uint8_t i = 0; i < batch.count; i++) {
+      msgStoreRetire(ids[i]);
+    }
+    xSemaphoreGive(storeMutex);
     
-    if (state == RADIOLIB_ERR_NONE) {
-      if (receivedMessage.length() > 0) {
-        Serial.print("📡⬅️ Received via LoRa (");
-        Serial.print(receivedMessage.length());
-        Serial.print(" bytes): ");
-        Serial.println(receivedMessage);
-        
-        // Parse JSON
-        JsonDocument doc;
-        DeserializationError error = deserializeJson(doc, receivedMessage);
-        
-        if (!error) {
-          int from = doc["from"];
-          int to = doc["to"];
-          String msg = doc["msg"];
-          
-          // Check if message is for this station
-          if (to == STATION_ID) {
-            Serial.println("✅ Message for M2, forwarding to phone");
-            sendBLEMessage(msg);
-          } else {
-            Serial.println("⚠️ Message not for this station");
-          }
-        } else {
-          Serial.println("❌ Failed to parse LoRa JSON message");
+    pTxCharacteristic->setValue(batch.buf, batch.len);
+    pTxCharacteristic->notify();
+    bleNotifications++;
+    for (uint8_t i = 0; i < batch.count; i++) {
+      lowPowerNoteDelivered();
+    }
+    LOG_INFO(EV_REPLAYED, batch.count);
+  }
+}
+
+// Phone messages handed over by onWrite: logged off the BLE callback, then sent
+void drainPhoneMessages() {
+  static uint16_t storedMsgNo = ARQ_NO_MESSAGE;   // Logged, still waiting for room
+  const uint8_t* p;
+  size_t len;
+  uint8_t type, flags;
+  while ((p = phoneToRadio.peek(&len, &type, &flags)) != NULL) {
+    uint32_t writeUs;
+    if (type == RADIO_REC_BULK) {
+      if (bulkMutex != NULL) {
+        if (p[0] == BULK_PHONE_OFFER && len >= 9) {
+          LOG_INFO(EV_BULK_OFFER, (unsigned)(p[1] | (p[2] << 8) | (p[3] << 16) | ((uint32_t)p[4] << 24)),
+                   (unsigned)(p[5] | (p[6] << 8) | (p[7] << 16) | ((uint32_t)p[8] << 24)), bulkBlockSize());
         }
+        xSemaphoreTake(bulkMutex, portMAX_DELAY);
+        bulkOnPhone(p, len, bulkBlockSize(), millis());
+        xSemaphoreGive(bulkMutex);
       }
+      phoneToRadio.release();
+      continue;
+    }
+    memcpy(&writeUs, p, sizeof(writeUs));
+    uint16_t msgNo = (uint16_t)(p[4] | (p[5] << 8));
+    if (msgNo != storedMsgNo) {
+      storeOutbound(p + PHONE_TO_RADIO_PREFIX, len - PHONE_TO_RADIO_PREFIX, msgNo);
+      storedMsgNo = msgNo;
+    }
+    // No room in ARQ: the message waits in the ring, and the phone sees
+    // the ring fill up rather than messages vanish
+    if (!sendLoRaMessage(p + PHONE_TO_RADIO_PREFIX, len - PHONE_TO_RADIO_PREFIX, msgNo)) {
+      break;
+    }
+    phoneToRadio.release();
+    statusRecord(STATUS_STAGE_BLE_INGEST, micros() - writeUs);
+  }
+}
+
+// Messages and receipts from the LoRa side, in the order they were queued
+template <uint32_t N>
+void drainToPhone(SpscRing<N>& ring) {
+  const uint8_t* p;
+  size_t len;
+  uint8_t type, flags;
+  while ((p = ring.peek(&len, &type, &flags)) != NULL) {
+    if (type == PHONE_REC_RECEIPT) {
+      ArqReceipt receipt = { (uint16_t)(p[0] | (p[1] << 8)), (flags & PHONE_REC_DELIVERED) != 0 };
+      sendDeliveryReceipts(&receipt, 1);
+    } else if (type == PHONE_REC_BULK) {
+      deliverBulkNote(p, len, flags);
     } else {
-      Serial.print("❌ LoRa read error: ");
-      Serial.println(state);
+      uint32_t decodedUs;
+      memcpy(&decodedUs, p, sizeof(decodedUs));
+      deliverToPhone(p + PHONE_MESSAGE_PREFIX, len - PHONE_MESSAGE_PREFIX, flags & PHONE_REC_COMPRESSED, decodedUs);
+    }
+    ring.release();
+  }
+}
+
+// Everything that talks to the phone or the message log, on the BLE core
+void phoneTaskMain(void* arg) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(PHONE_TASK_POLL_MS));
+    drainToPhone(radioToPhone);
+    drainToPhone(loopToPhone);
+    drainToPhone(bleToPhone);
+    
+    // Stored messages for a reconnected phone; erase ahead in the log
+    if (storeReady) {
+      replayStoredInbound();
+      xSemaphoreTake(storeMutex, portMAX_DELAY);
+      msgStoreMaintain();
+      xSemaphoreGive(storeMutex);
+    }
+  }
+}
+
+// Forwards a routed frame toward its destination straight from the radio
+// context; only the per-hop header is rewritten, in place
+void relayLoRaFrame(FrameHandle frame, const LoRaFrameHeader& hdr, size_t meshOffset,
+                    LoRaMeshHeader mesh) {
+  meshPrepareRelay(hdr.dst, mesh, millis());
+  meshWriteHeader(frame->data + meshOffset, mesh);
+  
+  // The sniff flag describes whoever puts this copy on air: us now
+  uint8_t& flags = frame->data[LORA_FRAME_FLAGS_OFFSET];
+  flags = LOW_POWER_MODE ? (flags | FRAME_FLAG_SNIFF) : (flags & ~FRAME_FLAG_SNIFF);
+  frame->preamble = meshNeighbourSniffs(mesh.nextHop) ? loraSniffPreamble : 0;
+  frame->channels = loraChannelMask(mesh.nextHop, hdr.dst);
+  // A relayed ACK keeps the link alive just like our own
+  frame->priority = airtimePriorityFor(hdr.type);
+  if (!loraRadioQueueFrame(std::move(frame))) {
+    LOG_ERROR(EV_RELAY_QUEUE_FULL);
+    return;
+  }
+  lowPowerNoteDelivered();
+  LOG_INFO(EV_RELAYING, hdr.src, hdr.dst, hdr.seq, mesh.nextHop);
+}
+
+void handleLoRaFrame(FrameHandle frame) {
+  LOG_DEBUG(EV_FRAME_RECEIVED, frame->len);
+  if (bootTimings.firstFrameMs == 0) {
+    bootTimings.firstFrameMs = millis();
+    LOG_INFO(EV_FIRST_FRAME, bootTimings.firstFrameMs);
+  }
+  
+  // Decode binary frame in place
+  LoRaFrameHeader hdr;
+  const uint8_t* payload;
+  
+  if (!loraFrameDecode(frame->data, frame->len, hdr, &payload)) {
+    LOG_WARN(EV_BAD_FRAME);
+    return;
+  }
+  
+  // Our own frames relayed back to us
+  if (hdr.src == STATION_ID) {
+    return;
+  }
+  
+  // Routed frames carry the per-hop mesh header in clear
+  size_t payloadLen = hdr.length;
+  bool routed = (hdr.flags & FRAME_FLAG_MESH) != 0;
+  LoRaMeshHeader mesh = {};
+  MeshDisposition disposition = MESH_DELIVER;
+  size_t meshOffset = payload - frame->data;
+  if (routed) {
+    if (!meshReadHeader(payload, payloadLen, mesh)) {
+      LOG_WARN(EV_BAD_MESH_HEADER);
+      return;
+    }
+    disposition = meshClassify(hdr.dst, mesh);
+    payload += MESH_HEADER_SIZE;
+    payloadLen -= MESH_HEADER_SIZE;
+  }
+  
+  // A relayed frame goes on exactly as it arrived. When we read it too,
+  // or have to open it to authenticate it, the relay sends a copy.
+  FrameHandle relayed;
+  if (disposition == MESH_DELIVER_AND_RELAY || (LORA_CRYPTO_ENABLED && disposition == MESH_RELAY)) {
+    relayed = framePoolAlloc();
+    if (relayed.valid()) {
+      memcpy(relayed->data, frame->data, frame->len);
+      relayed->len = frame->len;
+    } else if (disposition == MESH_RELAY) {
+      LOG_ERROR(EV_POOL_EXHAUSTED);
+      return;
+    }
+  }
+  
+  // Authenticate and decrypt in place before anything trusts the header:
+  // a forged frame must not poison dedup, routes or neighbour state.
+  // With crypto on, frames in clear are refused.
+  if ((hdr.version == LORA_FRAME_VERSION_SEALED) != (bool)LORA_CRYPTO_ENABLED) {
+    LOG_WARN(EV_AUTH_FAILED, hdr.src, hdr.seq);
+    return;
+  }
+#if LORA_CRYPTO_ENABLED
+  uint32_t openStart = micros();
+  size_t clearLen = hdr.length - payloadLen;
+  if (!loraCryptoOpen(frame->data, payload - clearLen - frame->data, clearLen, payloadLen)) {
+    LOG_WARN(EV_AUTH_FAILED, hdr.src, hdr.seq);
+    return;
+  }
+  openUs += micros() - openStart;
+  payload += LORA_CRYPTO_EPOCH_SIZE;
+  payloadLen -= LORA_CRYPTO_EPOCH_SIZE + LORA_CRYPTO_TAG_SIZE;
+#endif
+  
+  // Repeats and echoes stop here, before any payload handling
+  if (loraDedupCheck(hdr.src, hdr.seq, millis())) {
+    LOG_DEBUG(EV_DUPLICATE, hdr.src, hdr.seq);
+    return;
+  }
+  uint32_t decodedUs = micros();
+  statusRecord(STATUS_STAGE_RX_DECODE, decodedUs - frame->stampUs);
+  
+  // Routed frames: learn the way back to the originator, relay if asked
+  bool direct = true;
+  if (routed) {
+    meshLearn(hdr.src, mesh, millis());
+    meshNoteNeighbour(mesh.prevHop, hdr.flags & FRAME_FLAG_SNIFF);
+    direct = (mesh.hops == 0);
+    if (disposition == MESH_IGNORE) {
+      return;
+    }
+    if (disposition == MESH_RELAY) {
+      relayLoRaFrame(relayed.valid() ? std::move(relayed) : std::move(frame), hdr, meshOffset, mesh);
+      return;
+    }
+    if (relayed.valid()) {
+      relayLoRaFrame(std::move(relayed), hdr, meshOffset, mesh);
+    }
+  } else {
+    meshNoteNeighbour(hdr.src, hdr.flags & FRAME_FLAG_SNIFF);
+    if (hdr.dst != STATION_ID && hdr.dst != LORA_BROADCAST_ID) {
+      LOG_DEBUG(EV_NOT_FOR_US);
+      return;
+    }
+  }
+  
+  // Piggybacked or standalone ACK for our reliable frames
+  if (hdr.flags & FRAME_FLAG_ACK) {
+    if (payloadLen < ARQ_ACK_SIZE) {
+      LOG_WARN(EV_BAD_ACK);
+      return;
+    }
+    if (hdr.src == STATION_PEER_ID) {
+      ArqReceipt receipts[ARQ_MAX_FRAME_MSGS];
+      bool more;
+      do {
+        size_t count = 0;
+        xSemaphoreTake(arqMutex, portMAX_DELAY);
+        more = arqOnAck(payload, millis(), receipts, &count, ARQ_MAX_FRAME_MSGS);
+        xSemaphoreGive(arqMutex);
+        queueReceipts(radioToPhone, receipts, count);
+      } while (more);
+      
+      // The window moved: loop() sends what it let through
+      if (loopTask != NULL) {
+        xTaskNotifyGive(loopTask);
+      }
+    }
+    payload += ARQ_ACK_SIZE;
+    payloadLen -= ARQ_ACK_SIZE;
+  }
+  
+  // Link quality only from frames the peer put on air itself; control
+  // frames stop here. Loss counts only what the peer sent to us.
+  if (direct && hdr.src == STATION_PEER_ID) {
+    xSemaphoreTake(linkMutex, portMAX_DELAY);
+    linkAdaptOnFrame(hdr.src, hdr.dst == STATION_ID, frame->rssi, frame->snrQ / 4.0f, frame->config, millis());
+    if (hdr.type == FRAME_TYPE_CTRL) {
+      linkAdaptOnControl(hdr.src, payload, payloadLen, millis());
+    }
+    xSemaphoreGive(linkMutex);
+  }
+  if (LORA_BULK_ENABLED && hdr.type == FRAME_TYPE_BULK && hdr.dst == STATION_ID) {
+    xSemaphoreTake(bulkMutex, portMAX_DELAY);
+    bulkOnFrame(hdr.src, payload, payloadLen, millis());
+    xSemaphoreGive(bulkMutex);
+    return;
+  }
+  if (hdr.type != FRAME_TYPE_DATA) {
+    return;
+  }
+  
+  // Reliable frames are acknowledged even when they turn out to be repeats
+  const uint8_t* arqHeader = NULL;
+  if (hdr.flags & FRAME_FLAG_RELIABLE) {
+    if (payloadLen < ARQ_HEADER_SIZE) {
+      LOG_WARN(EV_BAD_ARQ_HEADER);
+      return;
+    }
+    // An acknowledged frame is a delivered message for the sender's phone.
+    // Without ring room for whatever this frame can complete, it stays
+    // unacknowledged and ARQ sends it again.
+    size_t need = PHONE_MESSAGE_PREFIX + payloadLen;
+    if (hdr.flags & FRAME_FLAG_FRAGMENT) {
+      need = PHONE_MESSAGE_PREFIX + LORA_FRAG_MAX_MESSAGE;
+    } else if (hdr.flags & FRAME_FLAG_COALESCED) {
+      need = payloadLen + LORA_COALESCE_MAX_MSGS * (SPSC_RECORD_HEADER + PHONE_MESSAGE_PREFIX + 3);
+    }
+    if (!radioToPhone.hasRoom(need)) {
+      LOG_ERROR(EV_PHONE_RING_FULL, need);
+      return;
+    }
+    xSemaphoreTake(arqMutex, portMAX_DELAY);
+    ArqRxResult rx = arqOnReceive(hdr.src, payload, millis());
+    xSemaphoreGive(arqMutex);
+    if (rx == ARQ_RX_DUPLICATE) {
+      LOG_DEBUG(EV_ARQ_DUPLICATE, hdr.src, payload[1]);
+      return;
+    }
+    arqHeader = payload;
+    payload += ARQ_HEADER_SIZE;
+    payloadLen -= ARQ_HEADER_SIZE;
+  }
+  
+  // Several short messages packed into one frame
+  if (hdr.flags & FRAME_FLAG_COALESCED) {
+    size_t offset = 0;
+    const uint8_t* msg;
+    size_t msgLen;
+    LOG_INFO(EV_COALESCED_RECEIVED, hdr.src, hdr.seq);
+    while (loraCoalescedNext(payload, payloadLen, &offset, &msg, &msgLen)) {
+      forwardToPhone(msg, msgLen, hdr.flags & FRAME_FLAG_COMPRESSED, decodedUs);
+    }
+    return;
+  }
+  
+  const uint8_t* message = payload;
+  size_t messageLen = payloadLen;
+  
+  if (hdr.flags & FRAME_FLAG_FRAGMENT) {
+    LoRaFragmentHeader frag;
+    bool fec = hdr.flags & FRAME_FLAG_FEC;
+    size_t fragHeaderLen = fec ? LORA_FRAG_FEC_HEADER_SIZE : LORA_FRAG_HEADER_SIZE;
+    if (!(fec ? loraFragmentReadFecHeader(payload, payloadLen, frag)
+              : loraFragmentReadHeader(payload, payloadLen, frag))) {
+      LOG_WARN(EV_BAD_FRAGMENT);
+      return;
+    }
+    uint8_t session = (arqHeader != NULL) ? arqHeader[0] : LORA_FRAG_NO_SESSION;
+    message = loraReassemblyPush(hdr.src, session, frag, payload + fragHeaderLen,
+                                 payloadLen - fragHeaderLen, millis(), &messageLen);
+    if (message == NULL) {
+      LOG_DEBUG(EV_FRAGMENT_RECEIVED, frag.index + 1, frag.count, frag.msgId, hdr.src);
+      return;
     }
     
-    // Restart reception
-    radio.startReceive();
+    // The group went out on consecutive ARQ numbers: acknowledge the
+    // fragments FEC made unnecessary so they are not sent again
+    if (fec && arqHeader != NULL) {
+      xSemaphoreTake(arqMutex, portMAX_DELAY);
+      for (uint8_t i = 0; i < frag.count; i++) {
+        arqMarkReceived(hdr.src, arqHeader[0], (uint8_t)(arqHeader[1] - frag.index + i));
+      }
+      xSemaphoreGive(arqMutex);
+    }
   }
+  
+  LOG_INFO(EV_MESSAGE_RECEIVED, hdr.src, hdr.seq);
+  forwardToPhone(message, messageLen, hdr.flags & FRAME_FLAG_COMPRESSED, decodedUs);
+}
+
+// Nothing for loop() to do until the radio or a timer needs it: no phone,
+// nothing queued, batched or in a ring, no ARQ frame or ACK outstanding
+bool stationIdle() {
+  if (deviceConnected || loraRadioQueueDepth() > 0 || resendLeft > 0) {
+    return false;
+  }
+  if (!phoneToRadio.empty() || !radioToPhone.empty() || !loopToPhone.empty() || !bleToPhone.empty()) {
+    return false;
+  }
+  if (coalesceTimer != NULL) {
+    xSemaphoreTake(coalesceMutex, portMAX_DELAY);
+    bool empty = coalescer.empty();
+    xSemaphoreGive(coalesceMutex);
+    if (!empty) {
+      return false;
+    }
+  }
+  xSemaphoreTake(arqMutex, portMAX_DELAY);
+  bool idle = arqIdle();
+  xSemaphoreGive(arqMutex);
+  if (idle && bulkMutex != NULL) {
+    xSemaphoreTake(bulkMutex, portMAX_DELAY);
+    idle = bulkIdle();
+    xSemaphoreGive(bulkMutex);
+  }
+  return idle;
 }
 
 void handleSerialInput() {
   if (Serial.available()) {
-    String message = Serial.readString();
-    message.trim(); // Remove newline characters
+    char message[LORA_FRAME_MAX_PAYLOAD];
+    size_t len = Serial.readBytesUntil('\n', message, sizeof(message));
+    
+    // Remove trailing CR/whitespace
+    while (len > 0 && isspace((unsigned char)message[len - 1])) {
+      len--;
+    }
     
-    if (message.length() > 0) {
-      Serial.println("🔧 TEST MESSAGE from M2: " + message);
-      sendLoRaMessage(message);
+    if (len > 0) {
+      Serial.printf("🔧 TEST MESSAGE from " STATION_NAME ": %.*s\n", (int)len, message);
+      if (!sendLoRaMessage((const uint8_t*)message, len, ARQ_NO_MESSAGE)) {
+        Serial.println("⚠️ ARQ buffer full, test message not sent");
+      }
     }
   }
 }
 
 void initBLE() {
-  BLEDevice::init("M2-LoRa-Bridge");
+  BLEDevice::init(STATION_NAME "-LoRa-Bridge");
+  
+  // Ask for the largest ATT MTU; the phone picks the final value
+  BLEDevice::setMTU(BLE_PREFERRED_MTU);
   
   // Create BLE Server
   pServer = BLEDevice::createServer();
@@ -195,74 +1643,191 @@ void initBLE() {
                       );
 
   pRxCharacteristic->setCallbacks(new MyCallbacks());
+  
+  // Latency histograms and counters, binary (include/station_status.h)
+  pStatusCharacteristic = pService->createCharacteristic(
+                            STATUS_CHARACTERISTIC_UUID,
+                            BLECharacteristic::PROPERTY_READ
+                          );
+  pStatusCharacteristic->setCallbacks(new StatusCallbacks());
 
   // Start the service
   pService->start();
 
-  // Start advertising
+  // Start advertising; battery stations advertise slowly
+#if LOW_POWER_MODE
+  uint16_t advInterval = LOW_POWER_ADV_INTERVAL_MS * 8 / 5;   // 0.625 ms units
+  pServer->getAdvertising()->setMinInterval(advInterval);
+  pServer->getAdvertising()->setMaxInterval(advInterval);
+#endif
   pServer->getAdvertising()->start();
-  Serial.println("✅ BLE service started - M2 ready for phone connection");
+  Serial.println("✅ BLE service started - " STATION_NAME " ready for phone connection");
 }
 
 void initLoRa() {
+#if LORA_CRYPTO_ENABLED
+  // Network key, and fresh nonce epochs: one now, one for the first wrap
+  if (!loraCryptoBegin(LORA_CRYPTO_KEY)) {
+    Serial.println("❌ LORA_CRYPTO_KEY must be 32 hex digits, LoRa disabled");
+    loraInitialized = false;
+    return;
+  }
+  if (strcmp(LORA_CRYPTO_KEY, LORA_CRYPTO_DEFAULT_KEY) == 0) {
+    Serial.println("⚠️ Encrypting with the default network key; set LORA_CRYPTO_KEY");
+  }
+  txEpoch = reserveEpochs(2);
+  txNextEpoch = txEpoch ? txEpoch + 1 : 0;
+  if (txEpoch == 0) {
+    Serial.println("⚠️ No nonce epoch reserved in NVS; frames are not sent until one is");
+  }
+#endif
+  
   Serial.print("📡 Initializing LoRa... ");
   
   // Initialize SPI
   SPI.begin(LORA_SCK, LORA_MISO, LORA_MOSI, LORA_CS);
   
-  // Initialize LoRa like working test - simple begin first
-  int state = radio.begin();
+  // One begin() with the full configuration: our home channel, and the
+  // profile the link was last using or the boot profile
+  const LoRaProfile& profile = LINK_PROFILES[stationConfig.profile];
+  uint8_t home = loraHomeChannel(STATION_ID);
+  int state = radio.begin(LORA_CHANNEL_PLAN_MHZ[home], profile.bwKHz, profile.sf, 5,
+                          RADIOLIB_SX126X_SYNC_WORD_PRIVATE, stationConfig.powerDbm);
+  bootTimings.radioMs = millis();
   
   if (state == RADIOLIB_ERR_NONE) {
-    // Configure step by step like working test
-    radio.setFrequency(915.0);
-    radio.setBandwidth(125.0);
-    radio.setSpreadingFactor(7);
-    radio.setCodingRate(5);
-    radio.setOutputPower(14);
-  }
-  
-  if (state == RADIOLIB_ERR_NONE) {
-    Serial.println("SUCCESS ✅");
-    loraInitialized = true;
+    Serial.printf("SUCCESS ✅ (%.1f MHz, channel %u/%u, SF%u / %.0f kHz / %d dBm%s)\n",
+                  LORA_CHANNEL_PLAN_MHZ[home], home, LORA_CHANNEL_COUNT, profile.sf, profile.bwKHz,
+                  stationConfig.powerDbm, stationConfig.restored ? ", restored" : "");
+    loraSpreadingFactor = profile.sf;
+    loraSniffPreamble = lowPowerPreambleSymbols(profile.sf, profile.bwKHz);
     
-    // Set interrupt handler for DIO1
-    radio.setDio1Action(setFlag);
+    lowPowerBegin();
+    airtimeBegin();
+    loraCompressBegin();
+    loraFecBegin();
+    loraDedupBegin(millis());
+    meshBegin(STATION_ID);
     
-    // Set radio to receive mode
-    radio.startReceive();
+    // New session every boot so the peer can tell our reboot from stale
+    // repeats; never 0, which reassembly reads as a fragment without ARQ
+    arqMutex = xSemaphoreCreateMutex();
+    uint8_t session = (uint8_t)stationConfig.bootCount;
+    arqBegin(session != 0 ? session : (uint8_t)(1 + esp_random() % 255), esp_random());
+    
+    // Bulk transfers, and an incoming one a reboot interrupted
+    if (LORA_BULK_ENABLED) {
+      bulkMutex = xSemaphoreCreateMutex();
+      bulkBegin(STATION_PEER_ID, sendBulkFrame, bulkToPhone, bulkHasRoom);
+      uint8_t checkpoint[LORA_BULK_CHECKPOINT_SIZE];
+      size_t n = stationConfigLoadBulk(checkpoint, sizeof(checkpoint));
+      bulkRestore(checkpoint, n, millis());
+    }
+    updateArqAirtime(profile);
+    
+    // Late fragments of a decoded FEC group are recognised by message ID,
+    // so do not restart the IDs where the last boot began
+    txFragmentMsgId = (uint8_t)esp_random();
+    
+    // Attach DIO1 interrupt, start TX queue and enter receive mode
+    linkMutex = xSemaphoreCreateMutex();
+    linkAdaptBegin(STATION_ID, sendLinkControl, applyLinkProfile, millis());
+    linkAdaptRestore(stationConfig.profile, stationConfig.powerDbm);
+    LoRaRadioConfig radioCfg;
+    radioCfg.sf = profile.sf;
+    radioCfg.bwKHz = profile.bwKHz;
+    radioCfg.powerDbm = stationConfig.powerDbm;
+    radioCfg.rxSniffSymbols = LOW_POWER_MODE ? loraSniffPreamble : 0;
+    radioCfg.rxChannel = home;
+    loraRadioSetInitialConfig(radioCfg);
+    loraInitialized = loraRadioBegin(&radio, handleLoRaFrame);
+    bootTimings.rxArmedMs = millis();
+    
+    // Batch short messages arriving within the coalescing window
+    if (LORA_COALESCE_WINDOW_MS > 0) {
+      coalescer.clear();
+      coalesceMutex = xSemaphoreCreateMutex();
+      coalesceTimer = xTimerCreate("coalesce", pdMS_TO_TICKS(LORA_COALESCE_WINDOW_MS),
+                                   pdFALSE, NULL, onCoalesceTimer);
+    }
+    
+    // Phone messages a reboot cut off go out again, the first of them now
+    if (storeReady && loraInitialized) {
+      retagStoredOutbound();
+      resendStoredOutbound();
+    }
     
   } else {
     Serial.printf("FAILED ❌ (Error: %d)\n", state);
-    Serial.println("⚠️ M2 running in BLE-only mode");
+    Serial.println("⚠️ " STATION_NAME " running in BLE-only mode");
     loraInitialized = false;
   }
 }
 
 void setup() {
+  loopTask = xTaskGetCurrentTaskHandle();
   Serial.begin(115200);
-  delay(2000);
+  logBegin(LOG_FORMATS, EV_COUNT);
+#if FAST_BOOT
+  // USB CDC reports whether a host has the port open; nobody to wait for otherwise
+  if (Serial) {
+    delay(BOOT_SERIAL_WAIT_MS);
+  }
+#else
+  delay(BOOT_SERIAL_WAIT_MS);
+#endif
+  bootTimings.serialMs = millis();
   
   Serial.println("\n╔════════════════════════════════════════╗");
-  Serial.println("║              STATION M2                ║");
-  Serial.println("║        Phone ↔ BLE ↔ LoRa ↔ M1        ║");
+  Serial.println("║              STATION " STATION_NAME "                ║");
+  Serial.println("║        Phone ↔ BLE ↔ LoRa ↔ " STATION_PEER_NAME "        ║");
   Serial.println("╚════════════════════════════════════════╝");
   Serial.println();
   
-  Serial.println("🚀 Starting M2 Station...");
+  Serial.println("🚀 Starting " STATION_NAME " Station...");
   
-  // Initialize BLE
-  initBLE();
+  // Last link settings from NVS
+  stationConfigLoad(STATION_ID, stationConfig);
+  bootTimings.configMs = millis();
   
-  // Initialize LoRa
+  // Store-and-forward log: rebuilt from flash before anything uses it
+#if MSG_STORE_ENABLED
+  storeMutex = xSemaphoreCreateMutex();
+  storeReady = storeMutex != NULL && msgStoreBeginPartition();
+  const MsgStoreStats& ms = msgStoreGetStats();
+  Serial.printf("💾 Message log %s: %u sectors, %u inbound / %u outbound pending\n",
+                storeReady ? "ready" : "unavailable", (unsigned)ms.sectors,
+                (unsigned)msgStorePending(MSG_STORE_INBOUND), (unsigned)msgStorePending(MSG_STORE_OUTBOUND));
+#endif
+  
+  // Phone side on the BLE core, up before anything can reach it
+  xTaskCreatePinnedToCore(phoneTaskMain, "phone", PHONE_TASK_STACK, NULL, PHONE_TASK_PRIO,
+                          &phoneTask, PHONE_TASK_CORE);
+  
+  // LoRa first: the station should be listening before BLE comes up
   initLoRa();
   
+  // Initialize BLE, unless this is a relay-only battery station
+#if !LOW_POWER_MODE || LOW_POWER_BLE
+  uint32_t bleStart = millis();
+  initBLE();
+  bootTimings.bleMs = millis() - bleStart;
+#else
+  Serial.println("🔋 Low-power relay: BLE disabled");
+#endif
+  
   Serial.println();
-  Serial.println("✅ M2 Station ready!");
-  Serial.println("📱 Connect phone to 'M2-LoRa-Bridge'");
+  Serial.println("✅ " STATION_NAME " Station ready!");
+  Serial.println("📱 Connect phone to '" STATION_NAME "-LoRa-Bridge'");
   if (loraInitialized) {
-    Serial.println("📡 LoRa ready for M1 communication");
+    Serial.println("📡 LoRa ready for " STATION_PEER_NAME " communication");
   }
+  bootTimings.readyMs = millis();
+  Serial.printf("⏱️ Boot #%u: serial %u ms, config +%u, radio +%u, RX armed at %u ms, BLE %u ms, ready at %u ms\n",
+                (unsigned)stationConfig.bootCount, (unsigned)bootTimings.serialMs,
+                (unsigned)(bootTimings.configMs - bootTimings.serialMs),
+                (unsigned)(bootTimings.radioMs - bootTimings.configMs), (unsigned)bootTimings.rxArmedMs,
+                (unsigned)bootTimings.bleMs, (unsigned)bootTimings.readyMs);
   Serial.println();
 }
 
@@ -279,9 +1844,50 @@ void loop() {
     oldDeviceConnected = deviceConnected;
   }
   
-  // Check for incoming LoRa messages
+  // Phone messages from the BLE core, behind any from before the reboot
+  resendStoredOutbound();
+  drainPhoneMessages();
+  
+#if !LORA_RADIO_TASK
+  // Service the radio: completed TX, received frames, next queued frame
+  if (loraInitialized) {
+    loraRadioService();
+  }
+#endif
+  
+  // Rate/power decisions, switch timeouts and keepalives
   if (loraInitialized) {
-    checkLoRaMessages();
+    xSemaphoreTake(linkMutex, portMAX_DELAY);
+    linkAdaptPoll(millis());
+    xSemaphoreGive(linkMutex);
+    
+    // Settings the link switched to, kept for the next boot
+    portENTER_CRITICAL(&linkSaveMux);
+    uint32_t save = linkToSave;
+    linkToSave = 0;
+    portEXIT_CRITICAL(&linkSaveMux);
+    if (save & LINK_SAVE_PENDING) {
+      stationConfigSaveLink((uint8_t)save, (int8_t)(save >> 8));
+    }
+  }
+  
+  // ARQ retransmissions and ACKs with no reverse traffic to ride on
+  if (loraInitialized) {
+    pumpArq();
+    uint8_t ackPeer;
+    xSemaphoreTake(arqMutex, portMAX_DELAY);
+    bool ackDue = arqAckDue(millis(), &ackPeer);
+    xSemaphoreGive(arqMutex);
+    if (ackDue && queueLoRaFrame(ackPeer, FRAME_TYPE_ACK, 0, NULL, 0, NULL, 0)) {
+      arqNoteStandaloneAck();
+    }
+  }
+  
+  // Bulk blocks from the phone while the radio has room, and poll timeouts
+  if (loraInitialized && bulkMutex != NULL) {
+    xSemaphoreTake(bulkMutex, portMAX_DELAY);
+    bulkPoll(millis(), loraRadioQueueDepth());
+    xSemaphoreGive(bulkMutex);
   }
   
   // Handle serial input for testing
@@ -290,11 +1896,170 @@ void loop() {
   // Heartbeat
   static unsigned long lastHeartbeat = 0;
   if (millis() - lastHeartbeat > 5000) {
-    Serial.printf("💓 M2: BLE=%s, LoRa=%s (Type message + Enter to test)\n", 
+    Serial.printf("💓 " STATION_NAME ": BLE=%s, LoRa=%s (Type message + Enter to test)\n", 
                   deviceConnected ? "Connected" : "Waiting", 
                   loraInitialized ? "Ready" : "Failed");
+    if (loraInitialized) {
+      const LoRaRadioStats& rs = loraRadioGetStats();
+      Serial.printf("   TX queue=%u (max %u, full %u), sent=%u, rx=%u, wait last/avg/max=%u/%u/%u us\n",
+                    (unsigned)loraRadioQueueDepth(), (unsigned)rs.queueHighWater, (unsigned)rs.queueFull,
+                    (unsigned)rs.framesSent, (unsigned)rs.framesReceived, (unsigned)rs.lastWaitUs,
+                    (unsigned)(rs.framesSent ? rs.totalWaitUs / rs.framesSent : 0), (unsigned)rs.maxWaitUs);
+      if (LORA_LBT_ENABLED) {
+        Serial.printf("   LBT: CAD=%u busy=%u deferred=%u forced=%u, backoffs=%u avg/max=%u/%u ms, CRC errors=%u\n",
+                      (unsigned)rs.cadScans, (unsigned)rs.cadBusy, (unsigned)rs.lbtDeferred, (unsigned)rs.lbtForced,
+                      (unsigned)rs.backoffs, (unsigned)(rs.backoffs ? rs.totalBackoffUs / rs.backoffs / 1000 : 0),
+                      (unsigned)(rs.maxBackoffUs / 1000), (unsigned)rs.crcErrors);
+      }
+      if (LORA_CHANNEL_COUNT > 1) {
+        char perChannel[LORA_CHANNEL_MAX * 11 + 1];
+        size_t n = 0;
+        for (uint8_t c = 0; c < LORA_CHANNEL_COUNT; c++) {
+          n += snprintf(perChannel + n, sizeof(perChannel) - n, "%s%u", c ? "/" : "", (unsigned)rs.txPerChannel[c]);
+        }
+        Serial.printf("   Channels: home %u of %u, TX per channel %s, hops=%u\n", loraHomeChannel(STATION_ID),
+                      LORA_CHANNEL_COUNT, perChannel, (unsigned)rs.channelHops);
+      }
+      const AirtimeStats& as = airtimeGetStats();
+      Serial.printf("   Airtime: %u%% of %u.%u%% budget (%u/%u ms per %u min%s), waits=%u (max %u ms), passed=%u, shed data/bulk=%u/%u\n",
+                    airtimeUtilizationPct(millis()), LORA_DUTY_CYCLE_PERMILLE / 10, LORA_DUTY_CYCLE_PERMILLE % 10,
+                    (unsigned)(airtimeUsedUs(millis()) / 1000), (unsigned)(LORA_DUTY_BUDGET_US / 1000),
+                    (unsigned)(LORA_DUTY_WINDOW_MS / 60000), LORA_DUTY_CYCLE_ENABLED ? "" : ", not enforced",
+                    (unsigned)as.waits, (unsigned)as.maxWaitMs, (unsigned)rs.dutyBypassed, (unsigned)as.shed[AIRTIME_PRIO_DATA],
+                    (unsigned)as.shed[AIRTIME_PRIO_BULK]);
+      const LatencyHistogram& lat = statusHistogram(STATUS_STAGE_RX_TOTAL);
+      Serial.printf("   RX handler (%s): n=%u avg=%u p50<%u p99<%u max=%u us\n",
+                    LORA_RADIO_TASK ? "task" : "polled", (unsigned)lat.count, (unsigned)lat.averageUs(),
+                    (unsigned)lat.percentileUs(50), (unsigned)lat.percentileUs(99), (unsigned)lat.maxUs);
+      Serial.printf("   Stages p50 (us): ingest<%u queue<%u air<%u decode<%u deliver<%u\n",
+                    (unsigned)statusHistogram(STATUS_STAGE_BLE_INGEST).percentileUs(50),
+                    (unsigned)statusHistogram(STATUS_STAGE_QUEUE_WAIT).percentileUs(50),
+                    (unsigned)statusHistogram(STATUS_STAGE_AIRTIME).percentileUs(50),
+                    (unsigned)statusHistogram(STATUS_STAGE_RX_DECODE).percentileUs(50),
+                    (unsigned)statusHistogram(STATUS_STAGE_RX_DELIVER).percentileUs(50));
+    }
+    if (deviceConnected) {
+      Serial.printf("   BLE: MTU=%u, notifications=%u\n", bleMtu, (unsigned)bleNotifications);
+    }
+    if (loraInitialized) {
+      const LinkAdaptStats& ls = linkAdaptGetStats();
+      const LoRaProfile& lp = LINK_PROFILES[linkAdaptProfileIndex()];
+      Serial.printf("   Link: SF%u/%.0fkHz %ddBm, SNR=%.1f RSSI=%.0f loss=%u%% peerSNR=%.1f, switches=%u reverts=%u fallbacks=%u\n",
+                    lp.sf, lp.bwKHz, linkAdaptPower(), ls.snrAvg, ls.rssiAvg, ls.lossPct, ls.peerSnr,
+                    (unsigned)ls.switches, (unsigned)ls.reverts, (unsigned)ls.silenceFallbacks);
+    }
+    if (loraInitialized) {
+      const ArqStats& as = arqGetStats();
+      Serial.printf("   ARQ: in flight=%u, sent=%u retx=%u acked=%u failed=%u full=%u, rx=%u dup=%u acks=%u, srtt=%u rto=%u ms, receipts=%u\n",
+                    as.inFlight, (unsigned)as.transmissions, (unsigned)as.retransmissions, (unsigned)as.acked,
+                    (unsigned)as.failed, (unsigned)as.bufferFull, (unsigned)as.received, (unsigned)as.duplicates,
+                    (unsigned)as.acksSent, (unsigned)as.srttMs, (unsigned)as.rtoMs, (unsigned)receiptsSent);
+    }
+    if (loraInitialized) {
+      const LoRaMeshStats& ms = meshGetStats();
+      Serial.printf("   Mesh: peer=%u, routes=%u (changes %u, evicted %u), relayed=%u flooded=%u ttl expired=%u ignored=%u\n",
+                    STATION_PEER_ID, meshRouteCount(millis()), (unsigned)ms.routeChanges, (unsigned)ms.routesEvicted,
+                    (unsigned)ms.relayed, (unsigned)ms.flooded, (unsigned)ms.ttlExpired, (unsigned)ms.ignored);
+    }
+    if (loraInitialized) {
+      const LowPowerStats& lps = lowPowerGetStats();
+      const LoRaProfile& lp = LINK_PROFILES[linkAdaptProfileIndex()];
+      LowPowerEnergy e = lowPowerEstimate(loraRadioGetStats().txAirUs, LOW_POWER_MODE ? loraSniffPreamble : 0);
+      Serial.printf("   Power (%s): est. %.1f mA avg, %.1f mJ/message (%u delivered), sleep=%u%% (wakes radio %u timer %u, refused %u), wake p50<%u max=%u us, sniff preamble=%u sym (+%u ms), sniffing neighbours=%u\n",
+                    LOW_POWER_MODE ? "sniff" : "continuous", e.averageMa, e.perMessageMj, (unsigned)lps.delivered,
+                    e.sleepPct, (unsigned)lps.radioWakes, (unsigned)lps.timerWakes, (unsigned)lps.rejected,
+                    (unsigned)lps.wakeLatency.percentileUs(50), (unsigned)lps.wakeLatency.maxUs,
+                    loraSniffPreamble, (unsigned)((loraSniffPreamble - LORA_PREAMBLE_SYMBOLS) * lowPowerSymbolMs(lp.sf, lp.bwKHz)),
+                    meshSniffingNeighbours());
+    }
+    const LoRaDedupStats& ds = loraDedupGetStats();
+    if (ds.duplicates > 0) {
+      Serial.printf("   Dedup: checked=%u duplicates=%u (exact %u, filter only %u), rotations=%u\n",
+                    (unsigned)ds.checked, (unsigned)ds.duplicates, (unsigned)ds.ringHits,
+                    (unsigned)ds.filterOnlyHits, (unsigned)ds.rotations);
+    }
+    const LoRaCompressStats& cs = loraCompressGetStats();
+    if (cs.compressed || cs.inflated) {
+      Serial.printf("   Compression: %u/%u messages, %u -> %u bytes (%u%%), %u cycles/byte; inflated=%u (%u cycles/byte), errors=%u\n",
+                    (unsigned)cs.compressed, (unsigned)cs.messages, (unsigned)cs.bytesIn, (unsigned)cs.bytesOut,
+                    (unsigned)(cs.bytesIn ? 100u * cs.bytesOut / cs.bytesIn : 0),
+                    (unsigned)(compressedBytes ? compressCycles / compressedBytes : 0), (unsigned)cs.inflated,
+                    (unsigned)(inflatedBytes ? inflateCycles / inflatedBytes : 0), (unsigned)cs.inflateErrors);
+    }
+    if (coalescedFrames > 0) {
+      Serial.printf("   Coalescing (%u ms): %u messages in %u frames\n", LORA_COALESCE_WINDOW_MS,
+                    (unsigned)coalescedMessages, (unsigned)coalescedFrames);
+    }
+    const LoRaFragmentStats& fs = loraFragmentGetStats();
+    if (fs.fragmentsSent || fs.fragmentsReceived) {
+      Serial.printf("   Fragments: sent=%u rx=%u, messages reassembled=%u, dropped=%u (timeout %u, evicted %u, bad frags %u)\n",
+                    (unsigned)fs.fragmentsSent, (unsigned)fs.fragmentsReceived, (unsigned)fs.messagesReassembled,
+                    (unsigned)(fs.messagesTimedOut + fs.messagesEvicted), (unsigned)fs.messagesTimedOut,
+                    (unsigned)fs.messagesEvicted, (unsigned)fs.fragmentsDropped);
+    }
+    if (LORA_FEC_ENABLED && (fs.repairsSent || fs.messagesRecovered)) {
+      Serial.printf("   FEC (%u%%): repairs sent=%u, messages recovered=%u (%u fragments), ARQ frames skipped=%u\n",
+                    LORA_FEC_REPAIR_PCT, (unsigned)fs.repairsSent, (unsigned)fs.messagesRecovered,
+                    (unsigned)fs.fragmentsRecovered, (unsigned)arqGetStats().skipped);
+    }
+    Serial.printf("   Boot #%u: RX armed at %u ms, first frame at %u ms\n", (unsigned)stationConfig.bootCount,
+                  (unsigned)bootTimings.rxArmedMs, (unsigned)bootTimings.firstFrameMs);
+    if (storeReady) {
+      const MsgStoreStats& ms = msgStoreGetStats();
+      Serial.printf("   Store: pending in/out=%u/%u, appended=%u retired=%u lost=%u, %u KB written, erases=%u/%u sectors\n",
+                    (unsigned)msgStorePending(MSG_STORE_INBOUND), (unsigned)msgStorePending(MSG_STORE_OUTBOUND),
+                    (unsigned)ms.appended, (unsigned)ms.retired, (unsigned)ms.lost,
+                    (unsigned)(ms.bytesWritten / 1024), (unsigned)ms.erases, (unsigned)ms.sectors);
+    }
+    Serial.printf("   Cores: radio %u, phone %u; rings to radio/phone/receipts/refusals high water %u/%u/%u/%u bytes, "
+                  "dropped %u/%u/%u/%u\n",
+                  LORA_RADIO_CORE, PHONE_TASK_CORE, (unsigned)phoneToRadio.highWaterBytes(),
+                  (unsigned)radioToPhone.highWaterBytes(), (unsigned)loopToPhone.highWaterBytes(),
+                  (unsigned)bleToPhone.highWaterBytes(), (unsigned)phoneToRadio.dropCount(),
+                  (unsigned)radioToPhone.dropCount(), (unsigned)loopToPhone.dropCount(),
+                  (unsigned)bleToPhone.dropCount());
+    if (bulkMutex != NULL) {
+      xSemaphoreTake(bulkMutex, portMAX_DELAY);
+      BulkStats bs = bulkGetStats();
+      xSemaphoreGive(bulkMutex);
+      if (bs.blocksSent || bs.blocksReceived || bs.txObject || bs.rxObject) {
+        Serial.printf("   Bulk: out %08x %u/%u, in %08x %u/%u blocks; sent=%u resent=%u rx=%u dup=%u held=%u, objects out/in=%u/%u (%u/%u B/s), resumes=%u (%u blocks skipped), checkpoints=%u, state %u bytes\n",
+                      (unsigned)bs.txObject, bs.txDelivered, bs.txBlocks, (unsigned)bs.rxObject, bs.rxReceived,
+                      bs.rxBlocks, (unsigned)bs.blocksSent, (unsigned)bs.blocksResent, (unsigned)bs.blocksReceived,
+                      (unsigned)bs.blocksDuplicate, (unsigned)bs.blocksHeld, (unsigned)bs.objectsSent,
+                      (unsigned)bs.objectsReceived, (unsigned)bs.txBytesPerSec, (unsigned)bs.rxBytesPerSec,
+                      (unsigned)bs.resumes, (unsigned)bs.resumeSkipped, (unsigned)bs.checkpoints,
+                      (unsigned)bs.stateBytes);
+      }
+    }
+    if (LORA_CRYPTO_ENABLED) {
+      const LoRaCryptoStats& ks = loraCryptoGetStats();
+      Serial.printf("   Crypto (AES-CCM, %u-byte tag): sealed=%u opened=%u rejected=%u, epoch=%u, %u/%u us per frame seal/open\n",
+                    LORA_CRYPTO_TAG_SIZE, (unsigned)ks.sealed, (unsigned)ks.opened, (unsigned)ks.rejected, txEpoch,
+                    (unsigned)(ks.sealed ? sealUs / ks.sealed : 0), (unsigned)(ks.opened ? openUs / ks.opened : 0));
+    }
+    LogStats ls = logGetStats();
+    Serial.printf("   Log: %u events, %u dropped, ring high water %u/%u\n", (unsigned)ls.written,
+                  (unsigned)ls.dropped, (unsigned)ls.highWater, LOG_RING_SIZE);
+    const FramePoolStats& ps = framePoolGetStats();
+    Serial.printf("   Frame pool: in use=%u/%u, high water=%u, alloc failures=%u\n",
+                  (unsigned)ps.inUse, FRAME_POOL_SIZE, (unsigned)ps.highWater, (unsigned)ps.allocFailures);
     lastHeartbeat = millis();
   }
   
-  delay(100);
+#if LOW_POWER_MODE
+  // Light-sleep until DIO1 or the next housekeeping poll; a frame that
+  // arrived during sleep is handed to the radio task on the way out
+  if (loraInitialized && stationIdle() && loraRadioHoldIdle()) {
+    LowPowerWake wake = lowPowerSleep(LORA_DIO1, LOW_POWER_MAX_SLEEP_MS);
+    loraRadioResume(digitalRead(LORA_DIO1) == HIGH);
+    if (wake != LOW_POWER_WAKE_REJECTED) {
+      return;
+    }
+  }
+#endif
+  
+  // Short enough for the ARQ ACK delay and retransmission timers; a
+  // phone message wakes it early
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(20));
 }
\ No newline at end of file
@@ -0,0 +1,384 @@
+#include "station_platform.h"
+#include "msg_store.h"
+#ifdef ARDUINO
+#include <esp_partition.h>
+#endif
+
+#define STORE_MAGIC         0x4C47534DUL    // "MSGL"
+#define STATE_ERASED        0xFF
+#define STATE_LIVE          0xFE
+#define STATE_RETIRED       0xFC            // Only clears a bit of STATE_LIVE
+
+struct IndexEntry {
+  uint32_t offset;    // MSG_STORE_NONE once retired
+  uint16_t tag;
+};
+
+struct StoreIndex {
+  IndexEntry entries[MSG_STORE_INDEX_SIZE];
+  uint8_t first;
+  uint8_t used;       // Entries from first, retired ones included
+  uint8_t pending;
+};
+
+static MsgStoreBackend flash = {};
+static bool ready = false;
+static uint32_t sectorCount = 0;
+static uint32_t headSector = 0;
+static uint32_t headOffset = 0;     // Next free byte in the head sector
+static uint32_t headSeq = 0;
+static bool nextErased = false;     // Sector after the head already blank
+static StoreIndex indexes[MSG_STORE_KINDS];
+static MsgStoreStats stats = {};
+static uint8_t record[MSG_STORE_HEADER_SIZE + MSG_STORE_MAX_MESSAGE];
+
+static uint16_t crc16(uint16_t crc, const uint8_t* data, size_t len) {
+  while (len--) {
+    crc ^= (uint16_t)(*data++) << 8;
+    for (uint8_t b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+static uint32_t alignedSize(size_t len) {
+  return (MSG_STORE_HEADER_SIZE + len + 3) & ~3u;
+}
+
+static IndexEntry& entryAt(StoreIndex& idx, uint8_t i) {
+  return idx.entries[(idx.first + i) % MSG_STORE_INDEX_SIZE];
+}
+
+// Retired entries at the front leave the ring right away
+static void trimFront(StoreIndex& idx) {
+  while (idx.used > 0 && idx.entries[idx.first].offset == MSG_STORE_NONE) {
+    idx.first = (idx.first + 1) % MSG_STORE_INDEX_SIZE;
+    idx.used--;
+  }
+}
+
+static void markRetired(uint32_t offset) {
+  uint8_t state = STATE_RETIRED;
+  flash.write(flash.ctx, offset, &state, 1);
+}
+
+static void indexPush(uint8_t kind, uint32_t offset, uint16_t tag) {
+  StoreIndex& idx = indexes[kind];
+  if (idx.used == MSG_STORE_INDEX_SIZE) {
+    // Full: the oldest pending message makes room
+    IndexEntry& oldest = idx.entries[idx.first];
+    markRetired(oldest.offset);
+    oldest.offset = MSG_STORE_NONE;
+    idx.pending--;
+    stats.lost++;
+    trimFront(idx);
+  }
+  IndexEntry& e = entryAt(idx, idx.used);
+  e.offset = offset;
+  e.tag = tag;
+  idx.used++;
+  idx.pending++;
+}
+
+static bool sectorHasPending(uint32_t sector) {
+  for (uint8_t k = 0; k < MSG_STORE_KINDS; k++) {
+    StoreIndex& idx = indexes[k];
+    for (uint8_t i = 0; i < idx.used; i++) {
+      uint32_t offset = entryAt(idx, i).offset;
+      if (offset != MSG_STORE_NONE && offset / MSG_STORE_SECTOR_SIZE == sector) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Drops whatever is still pending in a sector the log is about to reuse.
+// It is the oldest one, so its records sit at the front of each index.
+static void dropSector(uint32_t sector) {
+  for (uint8_t k = 0; k < MSG_STORE_KINDS; k++) {
+    StoreIndex& idx = indexes[k];
+    while (idx.used > 0 && idx.entries[idx.first].offset / MSG_STORE_SECTOR_SIZE == sector) {
+      idx.entries[idx.first].offset = MSG_STORE_NONE;
+      idx.pending--;
+      stats.lost++;
+      trimFront(idx);
+    }
+  }
+}
+
+static bool startSector(uint32_t sector) {
+  if (!nextErased) {
+    if (!flash.erase(flash.ctx, sector * MSG_STORE_SECTOR_SIZE)) {
+      return false;
+    }
+    stats.erases++;
+  }
+  uint32_t header[2] = { STORE_MAGIC, ++headSeq };
+  if (!flash.write(flash.ctx, sector * MSG_STORE_SECTOR_SIZE, header, sizeof(header))) {
+    return false;
+  }
+  headSector = sector;
+  headOffset = sizeof(header);
+  nextErased = false;
+  return true;
+}
+
+static bool advanceSector() {
+  uint32_t next = (headSector + 1) % sectorCount;
+  dropSector(next);
+  return startSector(next);
+}
+
+// Walks one sector's records into the index. Returns the end of the
+// valid records; *torn is set if a bad record cut the walk short.
+static uint32_t scanSector(uint32_t sector, bool* torn) {
+  uint32_t base = sector * MSG_STORE_SECTOR_SIZE;
+  uint32_t off = 8;
+  *torn = false;
+  while (off + MSG_STORE_HEADER_SIZE <= MSG_STORE_SECTOR_SIZE) {
+    uint8_t* hdr = record;
+    if (!flash.read(flash.ctx, base + off, hdr, MSG_STORE_HEADER_SIZE) || hdr[0] == STATE_ERASED) {
+      break;
+    }
+    uint16_t len = hdr[2] | (hdr[3] << 8);
+    uint16_t crc = hdr[4] | (hdr[5] << 8);
+    uint16_t tag = hdr[6] | (hdr[7] << 8);
+    if ((hdr[0] != STATE_LIVE && hdr[0] != STATE_RETIRED) || hdr[1] >= MSG_STORE_KINDS ||
+        len > MSG_STORE_MAX_MESSAGE || off + alignedSize(len) > MSG_STORE_SECTOR_SIZE ||
+        !flash.read(flash.ctx, base + off + MSG_STORE_HEADER_SIZE, record + MSG_STORE_HEADER_SIZE, len) ||
+        crc16(crc16(0xFFFF, hdr + 1, 3), record + 6, 2 + len) != crc) {
+      stats.corrupt++;
+      *torn = true;
+      break;
+    }
+    if (hdr[0] == STATE_LIVE) {
+      indexPush(hdr[1], base + off, tag);
+      stats.recovered++;
+    }
+    off += alignedSize(len);
+  }
+  return off;
+}
+
+bool msgStoreBegin(const MsgStoreBackend& backend) {
+  flash = backend;
+  ready = false;
+  memset(indexes, 0, sizeof(indexes));
+  memset(&stats, 0, sizeof(stats));
+  sectorCount = flash.size / MSG_STORE_SECTOR_SIZE;
+  stats.sectors = sectorCount;
+  nextErased = false;
+  if (sectorCount < 2) {
+    return false;
+  }
+
+  // The newest sector is the head; the ones after it, circularly, are
+  // the oldest
+  bool found = false;
+  headSeq = 0;
+  for (uint32_t s = 0; s < sectorCount; s++) {
+    uint32_t header[2];
+    if (flash.read(flash.ctx, s * MSG_STORE_SECTOR_SIZE, header, sizeof(header)) &&
+        header[0] == STORE_MAGIC && (!found || header[1] > headSeq)) {
+      headSeq = header[1];
+      headSector = s;
+      found = true;
+    }
+  }
+  if (!found) {
+    ready = startSector(0);
+    return ready;
+  }
+
+  bool torn = false;
+  for (uint32_t n = 1; n <= sectorCount; n++) {
+    uint32_t s = (headSector + n) % sectorCount;
+    uint32_t header[2];
+    if (!flash.read(flash.ctx, s * MSG_STORE_SECTOR_SIZE, header, sizeof(header)) ||
+        header[0] != STORE_MAGIC) {
+      continue;
+    }
+    headOffset = scanSector(s, &torn);
+  }
+
+  // Never append behind a torn record: its length cannot be trusted
+  ready = !torn || advanceSector();
+  return ready;
+}
+
+#ifdef ARDUINO
+static bool partitionRead(void* ctx, uint32_t offset, void* buf, size_t len) {
+  return esp_partition_read((const esp_partition_t*)ctx, offset, buf, len) == ESP_OK;
+}
+
+static bool partitionWrite(void* ctx, uint32_t offset, const void* buf, size_t len) {
+  return esp_partition_write((const esp_partition_t*)ctx, offset, buf, len) == ESP_OK;
+}
+
+static bool partitionErase(void* ctx, uint32_t offset) {
+  return esp_partition_erase_range((const esp_partition_t*)ctx, offset, MSG_STORE_SECTOR_SIZE) == ESP_OK;
+}
+
+bool msgStoreBeginPartition() {
+  const esp_partition_t* part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                         (esp_partition_subtype_t)MSG_STORE_SUBTYPE,
+                                                         MSG_STORE_PARTITION);
+  if (part == NULL) {
+    return false;
+  }
+  MsgStoreBackend backend;
+  backend.read = partitionRead;
+  backend.write = partitionWrite;
+  backend.erase = partitionErase;
+  backend.ctx = (void*)part;
+  backend.size = part->size - part->size % MSG_STORE_SECTOR_SIZE;
+  return msgStoreBegin(backend);
+}
+#endif
+
+static bool ramRead(void* ctx, uint32_t offset, void* buf, size_t len) {
+  memcpy(buf, (uint8_t*)ctx + offset, len);
+  return true;
+}
+
+// Programming can only clear bits
+static bool ramWrite(void* ctx, uint32_t offset, const void* buf, size_t len) {
+  uint8_t* mem = (uint8_t*)ctx + offset;
+  const uint8_t* src = (const uint8_t*)buf;
+  for (size_t i = 0; i < len; i++) {
+    mem[i] &= src[i];
+  }
+  return true;
+}
+
+static bool ramErase(void* ctx, uint32_t offset) {
+  memset((uint8_t*)ctx + offset, 0xFF, MSG_STORE_SECTOR_SIZE);
+  return true;
+}
+
+MsgStoreBackend msgStoreRamBackend(uint8_t* mem, uint32_t size) {
+  MsgStoreBackend backend;
+  backend.read = ramRead;
+  backend.write = ramWrite;
+  backend.erase = ramErase;
+  backend.ctx = mem;
+  backend.size = size - size % MSG_STORE_SECTOR_SIZE;
+  return backend;
+}
+
+uint32_t msgStoreAppend(uint8_t kind, const uint8_t* msg, size_t len, uint16_t tag) {
+  if (!ready || kind >= MSG_STORE_KINDS || len > MSG_STORE_MAX_MESSAGE) {
+    return MSG_STORE_NONE;
+  }
+  uint32_t size = alignedSize(len);
+  if (headOffset + size > MSG_STORE_SECTOR_SIZE && !advanceSector()) {
+    return MSG_STORE_NONE;
+  }
+
+  // Header and message go to flash in one write
+  record[0] = STATE_LIVE;
+  record[1] = kind;
+  record[2] = (uint8_t)(len & 0xFF);
+  record[3] = (uint8_t)(len >> 8);
+  record[6] = (uint8_t)(tag & 0xFF);
+  record[7] = (uint8_t)(tag >> 8);
+  memcpy(record + MSG_STORE_HEADER_SIZE, msg, len);
+  uint16_t crc = crc16(crc16(0xFFFF, record + 1, 3), record + 6, 2 + len);
+  record[4] = (uint8_t)(crc & 0xFF);
+  record[5] = (uint8_t)(crc >> 8);
+  memset(record + MSG_STORE_HEADER_SIZE + len, 0xFF, size - MSG_STORE_HEADER_SIZE - len);
+
+  uint32_t offset = headSector * MSG_STORE_SECTOR_SIZE + headOffset;
+  if (!flash.write(flash.ctx, offset, record, size)) {
+    // Whatever landed there is torn; continue in a fresh sector
+    advanceSector();
+    return MSG_STORE_NONE;
+  }
+  headOffset += size;
+  indexPush(kind, offset, tag);
+  stats.appended++;
+  stats.bytesWritten += size;
+  return offset;
+}
+
+size_t msgStorePending(uint8_t kind) {
+  return kind < MSG_STORE_KINDS ? indexes[kind].pending : 0;
+}
+
+uint32_t msgStoreGet(uint8_t kind, size_t i, uint8_t* buf, size_t cap, size_t* len, uint16_t* tag) {
+  if (kind >= MSG_STORE_KINDS) {
+    return MSG_STORE_NONE;
+  }
+  StoreIndex& idx = indexes[kind];
+  for (uint8_t n = 0; n < idx.used; n++) {
+    IndexEntry& e = entryAt(idx, n);
+    if (e.offset == MSG_STORE_NONE || i-- > 0) {
+      continue;
+    }
+    uint8_t hdr[MSG_STORE_HEADER_SIZE];
+    if (!flash.read(flash.ctx, e.offset, hdr, sizeof(hdr))) {
+      return MSG_STORE_NONE;
+    }
+    size_t stored = hdr[2] | (hdr[3] << 8);
+    *len = (stored < cap) ? stored : cap;
+    *tag = e.tag;
+    if (!flash.read(flash.ctx, e.offset + MSG_STORE_HEADER_SIZE, buf, *len)) {
+      return MSG_STORE_NONE;
+    }
+    return e.offset;
+  }
+  return MSG_STORE_NONE;
+}
+
+void msgStoreRetire(uint32_t id) {
+  for (uint8_t k = 0; k < MSG_STORE_KINDS; k++) {
+    StoreIndex& idx = indexes[k];
+    for (uint8_t i = 0; i < idx.used; i++) {
+      IndexEntry& e = entryAt(idx, i);
+      if (e.offset == id) {
+        markRetired(id);
+        e.offset = MSG_STORE_NONE;
+        idx.pending--;
+        stats.retired++;
+        trimFront(idx);
+        return;
+      }
+    }
+  }
+}
+
+bool msgStoreRetireTag(uint8_t kind, uint16_t tag) {
+  if (kind >= MSG_STORE_KINDS) {
+    return false;
+  }
+  StoreIndex& idx = indexes[kind];
+  for (uint8_t i = 0; i < idx.used; i++) {
+    IndexEntry& e = entryAt(idx, i);
+    if (e.offset != MSG_STORE_NONE && e.tag == tag) {
+      msgStoreRetire(e.offset);
+      return true;
+    }
+  }
+  return false;
+}
+
+void msgStoreMaintain() {
+  if (!ready || nextErased || headOffset < MSG_STORE_SECTOR_SIZE / 2) {
+    return;
+  }
+  // Pending records in the next sector are kept until the log really wraps
+  uint32_t next = (headSector + 1) % sectorCount;
+  if (sectorHasPending(next)) {
+    return;
+  }
+  if (flash.erase(flash.ctx, next * MSG_STORE_SECTOR_SIZE)) {
+    stats.erases++;
+    nextErased = true;
+  }
+}
+
+const MsgStoreStats& msgStoreGetStats() {
+  return stats;
+}
@@ -0,0 +1,83 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include "station_config.h"
+#include "link_adapt.h"
+
+static Preferences prefs;
+static uint8_t savedProfile = LINK_DEFAULT_PROFILE;
+static int8_t savedPower = LINK_DEFAULT_POWER;
+
+void stationConfigLoad(uint8_t stationId, StationConfig& cfg) {
+  cfg.stationId = stationId;
+  cfg.profile = LINK_DEFAULT_PROFILE;
+  cfg.powerDbm = LINK_DEFAULT_POWER;
+  cfg.bootCount = 0;
+  cfg.restored = false;
+
+  if (!prefs.begin(STATION_CONFIG_NAMESPACE, false)) {
+    return;
+  }
+
+  if (prefs.getUChar("id", 0) == stationId) {
+    uint8_t profile = prefs.getUChar("profile", LINK_DEFAULT_PROFILE);
+    int8_t power = prefs.getChar("power", LINK_DEFAULT_POWER);
+    if (profile < LINK_PROFILE_COUNT && power >= LINK_MIN_POWER && power <= LINK_MAX_POWER) {
+      cfg.profile = profile;
+      cfg.powerDbm = power;
+      cfg.restored = true;
+    }
+  } else {
+    prefs.putUChar("id", stationId);
+    prefs.putUChar("profile", LINK_DEFAULT_PROFILE);
+    prefs.putChar("power", LINK_DEFAULT_POWER);
+  }
+
+  cfg.bootCount = prefs.getUInt("boots", 0) + 1;
+  prefs.putUInt("boots", cfg.bootCount);
+  prefs.end();
+
+  savedProfile = cfg.profile;
+  savedPower = cfg.powerDbm;
+}
+
+void stationConfigSaveLink(uint8_t profile, int8_t powerDbm) {
+  if (profile == savedProfile && powerDbm == savedPower) {
+    return;
+  }
+  if (!prefs.begin(STATION_CONFIG_NAMESPACE, false)) {
+    return;
+  }
+  prefs.putUChar("profile", profile);
+  prefs.putChar("power", powerDbm);
+  prefs.end();
+  savedProfile = profile;
+  savedPower = powerDbm;
+}
+
+uint32_t stationConfigReserveEpochs(uint32_t count) {
+  if (!prefs.begin(STATION_CONFIG_NAMESPACE, false)) {
+    return 0;
+  }
+  // Handed out only once the reservation is in flash
+  uint32_t first = prefs.getUInt("epoch", 0) + 1;
+  bool saved = prefs.putUInt("epoch", first + count - 1) != 0;
+  prefs.end();
+  return saved ? first : 0;
+}
+
+void stationConfigSaveBulk(const uint8_t* checkpoint, size_t len) {
+  if (!prefs.begin(STATION_CONFIG_NAMESPACE, false)) {
+    return;
+  }
+  prefs.putBytes("bulk", checkpoint, len);
+  prefs.end();
+}
+
+size_t stationConfigLoadBulk(uint8_t* checkpoint, size_t cap) {
+  if (!prefs.begin(STATION_CONFIG_NAMESPACE, true)) {
+    return 0;
+  }
+  size_t len = prefs.getBytes("bulk", checkpoint, cap);
+  prefs.end();
+  return len;
+}
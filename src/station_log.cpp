@@ -0,0 +1,94 @@
+#include <Arduino.h>
+#include <atomic>
+#include "station_log.h"
+
+static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "LOG_RING_SIZE must be a power of two");
+
+struct LogEntry {
+  std::atomic<uint32_t> ready;    // Position + 1 once the entry is complete
+  uint16_t event;
+  uint32_t args[LOG_MAX_ARGS];
+};
+
+static LogEntry ring[LOG_RING_SIZE];
+static std::atomic<uint32_t> head(0);        // Next position to reserve
+static std::atomic<uint32_t> tail(0);        // Next position to drain
+static std::atomic<uint32_t> dropped(0);
+static uint32_t highWater = 0;
+static const char* const* formats = NULL;
+static size_t formatCount = 0;
+static TaskHandle_t logTask = NULL;
+
+// Reserve a position with a CAS on head, fill the slot, then publish it
+IRAM_ATTR void logWrite(uint16_t event, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3) {
+  uint32_t pos = head.load(std::memory_order_relaxed);
+  do {
+    if (pos - tail.load(std::memory_order_acquire) >= LOG_RING_SIZE) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  } while (!head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed));
+
+  LogEntry& e = ring[pos & (LOG_RING_SIZE - 1)];
+  e.event = event;
+  e.args[0] = a0;
+  e.args[1] = a1;
+  e.args[2] = a2;
+  e.args[3] = a3;
+  e.ready.store(pos + 1, std::memory_order_release);
+}
+
+// Formats in order; stops at an entry whose writer has not published it yet
+static void drain() {
+  uint32_t pos = tail.load(std::memory_order_relaxed);
+  uint32_t waiting = head.load(std::memory_order_relaxed) - pos;
+  if (waiting > highWater) {
+    highWater = waiting;
+  }
+  for (;;) {
+    LogEntry& e = ring[pos & (LOG_RING_SIZE - 1)];
+    if (e.ready.load(std::memory_order_acquire) != pos + 1) {
+      break;
+    }
+    uint16_t event = e.event;
+    uint32_t args[LOG_MAX_ARGS];
+    memcpy(args, e.args, sizeof(args));
+    tail.store(++pos, std::memory_order_release);
+
+    if (event < formatCount && formats[event] != NULL) {
+      Serial.printf(formats[event], args[0], args[1], args[2], args[3]);
+    } else {
+      Serial.printf("log event %u: %u %u %u %u\n", event, (unsigned)args[0], (unsigned)args[1],
+                    (unsigned)args[2], (unsigned)args[3]);
+    }
+  }
+}
+
+static void logTaskMain(void* arg) {
+  uint32_t reported = 0;
+  for (;;) {
+    drain();
+    uint32_t lost = dropped.load(std::memory_order_relaxed);
+    if (lost != reported) {
+      Serial.printf("⚠️ Log ring full: %u entries dropped\n", (unsigned)(lost - reported));
+      reported = lost;
+    }
+    vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_MS));
+  }
+}
+
+void logBegin(const char* const* eventFormats, size_t count) {
+  formats = eventFormats;
+  formatCount = count;
+  if (LOG_LEVEL > LOG_LEVEL_NONE && logTask == NULL) {
+    xTaskCreate(logTaskMain, "log", LOG_TASK_STACK, NULL, LOG_TASK_PRIO, &logTask);
+  }
+}
+
+LogStats logGetStats() {
+  LogStats s;
+  s.written = head.load(std::memory_order_relaxed);
+  s.dropped = dropped.load(std::memory_order_relaxed);
+  s.highWater = highWater;
+  return s;
+}
@@ -0,0 +1,52 @@
+#include "station_status.h"
+
+static_assert(STATUS_SNAPSHOT_SIZE <= 512, "status snapshot exceeds the ATT attribute limit");
+
+static LatencyHistogram stages[STATUS_STAGE_COUNT];
+
+void statusRecord(StatusStage stage, uint32_t us) {
+  stages[stage].record(us);
+}
+
+const LatencyHistogram& statusHistogram(StatusStage stage) {
+  return stages[stage];
+}
+
+static uint8_t* putU32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+  return p + 4;
+}
+
+size_t statusBuildSnapshot(uint8_t* out, size_t cap, uint8_t stationId, uint32_t uptimeMs,
+                           const uint32_t counters[STATUS_CTR_COUNT]) {
+  if (cap < STATUS_SNAPSHOT_SIZE) {
+    return 0;
+  }
+
+  uint8_t* p = out;
+  *p++ = STATUS_FORMAT_VERSION;
+  *p++ = stationId;
+  *p++ = STATUS_STAGE_COUNT;
+  *p++ = LATENCY_BUCKETS;
+  *p++ = STATUS_CTR_COUNT;
+  *p++ = 0;
+  p = putU32(p, uptimeMs);
+
+  for (uint8_t i = 0; i < STATUS_CTR_COUNT; i++) {
+    p = putU32(p, counters[i]);
+  }
+
+  for (uint8_t s = 0; s < STATUS_STAGE_COUNT; s++) {
+    const LatencyHistogram& h = stages[s];
+    p = putU32(p, h.count);
+    p = putU32(p, h.maxUs);
+    p = putU32(p, h.averageUs());
+    for (uint8_t b = 0; b < LATENCY_BUCKETS; b++) {
+      p = putU32(p, h.buckets[b]);
+    }
+  }
+  return p - out;
+}
@@ -0,0 +1,143 @@
+#include <unity.h>
+#include <string.h>
+#include "ble_segment.h"
+
+void setUp() {}
+void tearDown() {}
+
+static uint8_t message[BLE_MESSAGE_MAX];
+
+static void fillMessage() {
+  for (size_t i = 0; i < sizeof(message); i++) {
+    message[i] = (uint8_t)('a' + i % 26);
+  }
+}
+
+// Segments len bytes at mtu, checks every write fits, and feeds them to a
+// reassembler; returns the number of writes
+static size_t roundTrip(uint16_t mtu, size_t len) {
+  size_t chunk = (mtu < BLE_DEFAULT_MTU ? BLE_DEFAULT_MTU : mtu) - BLE_ATT_OVERHEAD;
+  BleSegmenter seg;
+  seg.begin(message, len, mtu);
+  BleReassembler rx;
+  rx.reset();
+  uint8_t out[BLE_PREFERRED_MTU];
+  size_t writes = 0;
+  size_t n;
+  BleReassemblyResult result = BLE_REASM_PENDING;
+  while ((n = seg.next(out)) > 0) {
+    TEST_ASSERT_LESS_OR_EQUAL(chunk, n);
+    TEST_ASSERT_EQUAL_MESSAGE(BLE_REASM_PENDING, result, "segment after the message completed");
+    result = rx.push(out, n);
+    TEST_ASSERT_NOT_EQUAL(BLE_REASM_ERROR, result);
+    writes++;
+  }
+  TEST_ASSERT_EQUAL(BLE_REASM_COMPLETE, result);
+  TEST_ASSERT_EQUAL(len, rx.length());
+  TEST_ASSERT_EQUAL_MEMORY(message, rx.message(), len);
+  return writes;
+}
+
+void test_round_trip_at_each_mtu() {
+  static const uint16_t mtus[] = { 0, BLE_DEFAULT_MTU, 24, 64, 185, 247, BLE_PREFERRED_MTU };
+  fillMessage();
+  for (size_t m = 0; m < sizeof(mtus) / sizeof(mtus[0]); m++) {
+    size_t chunk = (mtus[m] < BLE_DEFAULT_MTU ? BLE_DEFAULT_MTU : mtus[m]) - BLE_ATT_OVERHEAD;
+    size_t room = chunk - BLE_SEG_HEADER_SIZE;
+    const size_t lens[] = { 1, chunk - 1, chunk, chunk + 1, 2 * room, 2 * room + 1, BLE_MESSAGE_MAX };
+    for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+      size_t len = lens[l] > BLE_MESSAGE_MAX ? BLE_MESSAGE_MAX : lens[l];
+      size_t expected = len <= chunk ? 1 : (len + room - 1) / room;
+      TEST_ASSERT_EQUAL(expected, roundTrip(mtus[m], len));
+    }
+  }
+}
+
+// A message that fits goes out untouched, so plain-text clients work
+void test_short_message_unchanged() {
+  const uint8_t text[] = "hello";
+  BleSegmenter seg;
+  seg.begin(text, 5, BLE_DEFAULT_MTU);
+  uint8_t out[BLE_PREFERRED_MTU];
+  TEST_ASSERT_EQUAL(5, seg.next(out));
+  TEST_ASSERT_EQUAL_MEMORY(text, out, 5);
+  TEST_ASSERT_EQUAL(0, seg.next(out));
+}
+
+void test_reassembly_errors() {
+  fillMessage();
+  BleSegmenter seg;
+  seg.begin(message, 100, BLE_DEFAULT_MTU);
+  uint8_t s0[BLE_PREFERRED_MTU], s1[BLE_PREFERRED_MTU], s2[BLE_PREFERRED_MTU];
+  size_t n0 = seg.next(s0), n1 = seg.next(s1), n2 = seg.next(s2);
+
+  // Skipped segment
+  BleReassembler rx;
+  rx.reset();
+  TEST_ASSERT_EQUAL(BLE_REASM_PENDING, rx.push(s0, n0));
+  TEST_ASSERT_EQUAL(BLE_REASM_ERROR, rx.push(s2, n2));
+
+  // Continuation without a first segment
+  rx.reset();
+  TEST_ASSERT_EQUAL(BLE_REASM_ERROR, rx.push(s1, n1));
+
+  // A new first segment restarts a half-received message
+  rx.reset();
+  TEST_ASSERT_EQUAL(BLE_REASM_PENDING, rx.push(s0, n0));
+  TEST_ASSERT_EQUAL(BLE_REASM_PENDING, rx.push(s0, n0));
+  TEST_ASSERT_EQUAL(BLE_REASM_PENDING, rx.push(s1, n1));
+
+  // A plain write in between is a message of its own and drops the rest
+  TEST_ASSERT_EQUAL(BLE_REASM_COMPLETE, rx.push((const uint8_t*)"hi", 2));
+  TEST_ASSERT_EQUAL(2, rx.length());
+  TEST_ASSERT_EQUAL(BLE_REASM_ERROR, rx.push(s2, n2));
+
+  // Header only, and more than fits
+  uint8_t marker = BLE_SEG_MARKER | BLE_SEG_FIRST;
+  TEST_ASSERT_EQUAL(BLE_REASM_ERROR, rx.push(&marker, 1));
+  uint8_t big[BLE_PREFERRED_MTU];
+  memset(big, 'x', sizeof(big));
+  big[0] = BLE_SEG_MARKER | BLE_SEG_FIRST;
+  big[1] = 0;
+  rx.reset();
+  BleReassemblyResult result = BLE_REASM_PENDING;
+  for (uint8_t i = 0; result == BLE_REASM_PENDING; i++) {
+    result = rx.push(big, sizeof(big));
+    big[0] = BLE_SEG_MARKER;
+    big[1] = (uint8_t)(i + 1);
+  }
+  TEST_ASSERT_EQUAL(BLE_REASM_ERROR, result);
+}
+
+void test_batch_packing() {
+  BleBatch batch;
+  batch.begin(BLE_DEFAULT_MTU);
+  TEST_ASSERT_TRUE(batch.add((const uint8_t*)"abc", 3));
+  TEST_ASSERT_TRUE(batch.add((const uint8_t*)"0123456789", 10));
+  TEST_ASSERT_FALSE(batch.add((const uint8_t*)"toolong", 7));    // 1 + 4 + 11 + 8 > 20
+  TEST_ASSERT_TRUE(batch.add((const uint8_t*)"xyz", 3));
+  TEST_ASSERT_EQUAL(3, batch.count);
+  TEST_ASSERT_EQUAL(1 + 4 + 11 + 4, batch.len);
+  TEST_ASSERT_EQUAL(BLE_BATCH_MARKER, batch.buf[0]);
+  TEST_ASSERT_EQUAL(3, batch.buf[1]);
+  TEST_ASSERT_EQUAL_MEMORY("abc", batch.buf + 2, 3);
+  TEST_ASSERT_EQUAL(10, batch.buf[5]);
+
+  // Capped by the buffer at large MTUs, and by the length byte
+  batch.begin(BLE_PREFERRED_MTU + 100);
+  TEST_ASSERT_EQUAL(sizeof(batch.buf), batch.cap);
+  fillMessage();
+  TEST_ASSERT_FALSE(batch.add(message, BLE_BATCH_MAX_MESSAGE + 1));
+  TEST_ASSERT_TRUE(batch.add(message, BLE_BATCH_MAX_MESSAGE));
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip_at_each_mtu);
+  RUN_TEST(test_short_message_unchanged);
+  RUN_TEST(test_reassembly_errors);
+  RUN_TEST(test_batch_packing);
+  return UNITY_END();
+}
@@ -0,0 +1,242 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <utility>
+#include "frame_pool.h"
+#include "lora_coalesce.h"
+#include "lora_compress.h"
+#include "lora_fragment.h"
+#include "lora_frame.h"
+
+// Every heap allocation in this binary, to show the message path makes none
+static size_t heapAllocations = 0;
+
+void* operator new(size_t size) {
+  heapAllocations++;
+  void* p = malloc(size == 0 ? 1 : size);
+  if (p == NULL) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t size) noexcept {
+  (void)size;
+  free(p);
+}
+
+#ifdef __GLIBC__
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* p, size_t size);
+
+extern "C" void* malloc(size_t size) {
+  heapAllocations++;
+  return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+  heapAllocations++;
+  return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* p, size_t size) {
+  heapAllocations++;
+  return __libc_realloc(p, size);
+}
+#endif
+
+void setUp() {}
+void tearDown() {}
+
+// Takes the whole pool, fails cleanly once it is empty, and gets every
+// buffer back when the handles go out of scope
+void test_exhaustion_and_release() {
+  uint32_t failures = framePoolGetStats().allocFailures;
+  {
+    FrameHandle held[FRAME_POOL_SIZE];
+    bool seen[FRAME_POOL_SIZE] = {};
+    for (size_t i = 0; i < FRAME_POOL_SIZE; i++) {
+      held[i] = framePoolAlloc();
+      TEST_ASSERT_TRUE(held[i].valid());
+      uint8_t index = held[i].release();
+      TEST_ASSERT_LESS_THAN(FRAME_POOL_SIZE, index);
+      TEST_ASSERT_FALSE(seen[index]);
+      seen[index] = true;
+      held[i] = FrameHandle::adopt(index);
+    }
+    TEST_ASSERT_EQUAL(FRAME_POOL_SIZE, framePoolGetStats().inUse);
+    TEST_ASSERT_EQUAL(FRAME_POOL_SIZE, framePoolGetStats().highWater);
+
+    FrameHandle extra = framePoolAlloc();
+    TEST_ASSERT_FALSE(extra.valid());
+    TEST_ASSERT_EQUAL(failures + 1, framePoolGetStats().allocFailures);
+
+    // One back, one out again
+    held[3].reset();
+    TEST_ASSERT_EQUAL(FRAME_POOL_SIZE - 1, framePoolGetStats().inUse);
+    extra = framePoolAlloc();
+    TEST_ASSERT_TRUE(extra.valid());
+    TEST_ASSERT_FALSE(framePoolAlloc().valid());
+  }
+  TEST_ASSERT_EQUAL(0, framePoolGetStats().inUse);
+  TEST_ASSERT_EQUAL(failures + 2, framePoolGetStats().allocFailures);
+}
+
+void test_move_transfers_ownership() {
+  FrameHandle a = framePoolAlloc();
+  a->len = 42;
+  FrameHandle b(std::move(a));
+  TEST_ASSERT_FALSE(a.valid());
+  TEST_ASSERT_TRUE(b.valid());
+  TEST_ASSERT_EQUAL(42, b->len);
+  TEST_ASSERT_EQUAL(1, framePoolGetStats().inUse);
+
+  // Assigning over a live handle returns its old buffer
+  FrameHandle c = framePoolAlloc();
+  TEST_ASSERT_EQUAL(2, framePoolGetStats().inUse);
+  c = std::move(b);
+  TEST_ASSERT_EQUAL(1, framePoolGetStats().inUse);
+  TEST_ASSERT_EQUAL(42, c->len);
+  c.reset();
+  TEST_ASSERT_EQUAL(0, framePoolGetStats().inUse);
+}
+
+// A reused buffer does not carry metadata over from its last frame
+void test_alloc_clears_metadata() {
+  const FrameBuffer* used;
+  {
+    FrameHandle f = framePoolAlloc();
+    f->len = 200;
+    f->stampUs = 1234;
+    f->rssi = -90;
+    f->snrQ = 12;
+    f->preamble = 64;
+    f->channels = 0x0F;
+    f->priority = 2;
+    used = &*f;
+  }
+  FrameHandle f = framePoolAlloc();
+  TEST_ASSERT_TRUE(&*f == used);
+  TEST_ASSERT_EQUAL(0, f->len);
+  TEST_ASSERT_EQUAL(0, f->stampUs);
+  TEST_ASSERT_EQUAL(0, f->rssi);
+  TEST_ASSERT_EQUAL(0, f->snrQ);
+  TEST_ASSERT_EQUAL(0, f->preamble);
+  TEST_ASSERT_EQUAL(0, f->channels);
+  TEST_ASSERT_EQUAL(0, f->priority);
+}
+
+// One frame through the pool: encoded into a buffer, handed on by index
+// as through a queue, decoded on the other side
+static const uint8_t* airFrame(FrameHandle& f, uint8_t flags, const uint8_t* payload, size_t len,
+                               LoRaFrameHeader& out) {
+  LoRaFrameHeader hdr = {};
+  hdr.type = FRAME_TYPE_DATA;
+  hdr.src = 1;
+  hdr.dst = 2;
+  hdr.flags = flags;
+  hdr.length = (uint8_t)len;
+  hdr.tsDelta = 1500;
+  f = framePoolAlloc();
+  TEST_ASSERT_TRUE(f.valid());
+  f->len = (uint8_t)loraFrameEncode(f->data, sizeof(f->data), hdr, payload);
+  TEST_ASSERT_NOT_EQUAL(0, f->len);
+  f = FrameHandle::adopt(f.release());
+  const uint8_t* body = NULL;
+  TEST_ASSERT_TRUE(loraFrameDecode(f->data, f->len, out, &body));
+  return body;
+}
+
+// Short messages compressed and coalesced into one frame, and a long one
+// split into fragments and reassembled, all without touching the heap
+static void messagePath(uint8_t msgId) {
+  static const char* const lines[] = { "on my way", "see you at the north camp", "ok copy" };
+  LoRaCoalescer batch;
+  batch.clear();
+  uint8_t packed[LORA_COMPRESS_MAX_MESSAGE];
+  for (const char* line : lines) {
+    size_t n = loraCompress((const uint8_t*)line, strlen(line), packed, strlen(line) - 1);
+    TEST_ASSERT_NOT_EQUAL(0, n);
+    TEST_ASSERT_TRUE(batch.fits(n, LORA_COALESCE_BUDGET));
+    batch.add(packed, n);
+  }
+  FrameHandle f;
+  LoRaFrameHeader hdr;
+  const uint8_t* body = airFrame(f, FRAME_FLAG_COALESCED | FRAME_FLAG_COMPRESSED, batch.buf, batch.len, hdr);
+  size_t offset = 0;
+  const uint8_t* msg;
+  size_t msgLen;
+  size_t count = 0;
+  while (loraCoalescedNext(body, hdr.length, &offset, &msg, &msgLen)) {
+    uint8_t text[LORA_COMPRESS_MAX_MESSAGE];
+    size_t textLen = 0;
+    TEST_ASSERT_TRUE(loraDecompress(msg, msgLen, text, sizeof(text), &textLen));
+    TEST_ASSERT_EQUAL(strlen(lines[count]), textLen);
+    TEST_ASSERT_EQUAL_MEMORY(lines[count], text, textLen);
+    count++;
+  }
+  TEST_ASSERT_EQUAL(3, count);
+
+  uint8_t longMsg[LORA_FRAG_MAX_MESSAGE];
+  for (size_t i = 0; i < sizeof(longMsg); i++) {
+    longMsg[i] = (uint8_t)(i * 7 + msgId);
+  }
+  size_t chunk = loraFragmentChunkForSF(7);
+  LoRaFragmentHeader frag = {};
+  frag.msgId = msgId;
+  frag.count = (uint8_t)loraFragmentCount(sizeof(longMsg), chunk);
+  frag.chunk = (uint8_t)chunk;
+  const uint8_t* whole = NULL;
+  size_t wholeLen = 0;
+  for (uint8_t i = 0; i < frag.count; i++) {
+    uint8_t payload[LORA_FRAME_MAX_PAYLOAD];
+    size_t take = sizeof(longMsg) - i * chunk < chunk ? sizeof(longMsg) - i * chunk : chunk;
+    frag.index = i;
+    loraFragmentWriteHeader(payload, frag);
+    memcpy(payload + LORA_FRAG_HEADER_SIZE, longMsg + i * chunk, take);
+    body = airFrame(f, FRAME_FLAG_FRAGMENT, payload, LORA_FRAG_HEADER_SIZE + take, hdr);
+    LoRaFragmentHeader in;
+    TEST_ASSERT_TRUE(loraFragmentReadHeader(body, hdr.length, in));
+    whole = loraReassemblyPush(hdr.src, LORA_FRAG_NO_SESSION, in, body + LORA_FRAG_HEADER_SIZE,
+                               hdr.length - LORA_FRAG_HEADER_SIZE, 1000, &wholeLen);
+  }
+  TEST_ASSERT_NOT_NULL(whole);
+  TEST_ASSERT_EQUAL(sizeof(longMsg), wholeLen);
+  TEST_ASSERT_EQUAL_MEMORY(longMsg, whole, wholeLen);
+}
+
+void test_message_path_does_not_allocate() {
+  // The counters see this binary's allocations
+  size_t before = heapAllocations;
+  void* volatile probe = malloc(16);
+  free(probe);
+  probe = ::operator new(16);
+  ::operator delete(probe);
+  TEST_ASSERT_GREATER_THAN(before, heapAllocations);
+
+  loraCompressBegin();
+  messagePath(0);
+  before = heapAllocations;
+  for (uint8_t msgId = 1; msgId <= 100; msgId++) {
+    messagePath(msgId);
+  }
+  TEST_ASSERT_EQUAL(before, heapAllocations);
+  TEST_ASSERT_EQUAL(0, framePoolGetStats().inUse);
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_exhaustion_and_release);
+  RUN_TEST(test_move_transfers_ownership);
+  RUN_TEST(test_alloc_clears_metadata);
+  RUN_TEST(test_message_path_does_not_allocate);
+  return UNITY_END();
+}
@@ -0,0 +1,205 @@
+#include <unity.h>
+#include "link_adapt.h"
+
+#define ME          1
+#define PEER        2
+#define GOOD_SNR    10.0f     // Margin for every faster profile
+#define T0          100000    // Each test starts clear of the last one's timers
+
+// The radio and the air, as link_adapt sees them: control frames it
+// sends are recorded (and may be lost), reconfigurations numbered
+static uint8_t sentOps[32];
+static uint8_t sentProfiles[32];
+static uint8_t sentIds[32];
+static size_t sentCount;
+static uint8_t applied[8];
+static size_t applyCount;
+static uint16_t generation;
+static uint16_t peerSent;
+
+static bool sendCtrl(const uint8_t* ctrl, size_t len) {
+  TEST_ASSERT_EQUAL(LINK_CTRL_SIZE, len);
+  if (sentCount < sizeof(sentOps)) {
+    sentOps[sentCount] = ctrl[0];
+    sentProfiles[sentCount] = ctrl[1];
+    sentIds[sentCount] = ctrl[2];
+    sentCount++;
+  }
+  return true;
+}
+
+static uint16_t applyProfile(const LoRaProfile& profile, int8_t powerDbm) {
+  (void)powerDbm;
+  for (uint8_t i = 0; i < LINK_PROFILE_COUNT; i++) {
+    if (&LINK_PROFILES[i] == &profile && applyCount < sizeof(applied)) {
+      applied[applyCount++] = i;
+    }
+  }
+  return ++generation;
+}
+
+void setUp() {
+  sentCount = 0;
+  applyCount = 0;
+  linkAdaptBegin(ME, sendCtrl, applyProfile, T0);
+}
+void tearDown() {}
+
+// A frame from the peer, taken in with radio settings config
+static void hear(uint16_t config, uint32_t nowMs) {
+  peerSent++;
+  linkAdaptOnFrame(PEER, true, -80.0f, GOOD_SNR, config, nowMs);
+}
+
+static void control(LinkCtrlOpcode op, uint8_t profile, uint8_t id, uint16_t config, uint32_t nowMs) {
+  hear(config, nowMs);
+  uint8_t ctrl[LINK_CTRL_SIZE] = { op, profile, id, (uint8_t)(int8_t)(GOOD_SNR * 4), (uint8_t)peerSent,
+                                   (uint8_t)(peerSent >> 8) };
+  linkAdaptOnControl(PEER, ctrl, sizeof(ctrl), nowMs);
+}
+
+static bool sent(LinkCtrlOpcode op, uint8_t profile) {
+  for (size_t i = 0; i < sentCount; i++) {
+    if (sentOps[i] == op && sentProfiles[i] == profile) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Enough good frames, then the decision timer: we propose the next
+// profile up. Returns the proposal's switch ID.
+static uint8_t proposeFaster(uint32_t* nowMs) {
+  for (int i = 0; i < LINK_MIN_SAMPLES; i++) {
+    hear(generation, *nowMs);
+  }
+  *nowMs += LINK_DECIDE_MS + 1;
+  linkAdaptPoll(*nowMs);
+  TEST_ASSERT_EQUAL(LINK_PROPOSED, linkAdaptState());
+  TEST_ASSERT_EQUAL(LINK_OP_PROPOSE, sentOps[sentCount - 1]);
+  TEST_ASSERT_EQUAL(LINK_DEFAULT_PROFILE + 1, sentProfiles[sentCount - 1]);
+  return sentIds[sentCount - 1];
+}
+
+// The peer's ACCEPT is lost: the proposer gives up and never touches the radio
+void test_proposer_lost_accept() {
+  uint32_t now = T0;
+  proposeFaster(&now);
+  now += LINK_PROPOSE_TIMEOUT_MS + 1;
+  linkAdaptPoll(now);
+  TEST_ASSERT_EQUAL(LINK_STABLE, linkAdaptState());
+  TEST_ASSERT_EQUAL(LINK_DEFAULT_PROFILE, linkAdaptProfileIndex());
+  TEST_ASSERT_EQUAL(0, applyCount);
+}
+
+// Our ACCEPT is lost, so no PROBE comes: the responder stays where it is
+void test_responder_lost_accept() {
+  uint32_t now = T0;
+  uint8_t faster = LINK_DEFAULT_PROFILE + 1;
+  for (int i = 0; i < LINK_MIN_SAMPLES; i++) {
+    hear(generation, now);
+  }
+  control(LINK_OP_PROPOSE, faster, 7, generation, now);
+  TEST_ASSERT_TRUE(sent(LINK_OP_ACCEPT, faster));
+  TEST_ASSERT_EQUAL(LINK_ACCEPTED, linkAdaptState());
+  TEST_ASSERT_EQUAL(0, applyCount);
+
+  now += LINK_PROPOSE_TIMEOUT_MS + 1;
+  linkAdaptPoll(now);
+  TEST_ASSERT_EQUAL(LINK_STABLE, linkAdaptState());
+  TEST_ASSERT_EQUAL(LINK_DEFAULT_PROFILE, linkAdaptProfileIndex());
+  TEST_ASSERT_EQUAL(0, applyCount);
+
+  // A late PROBE for that proposal does not switch it
+  control(LINK_OP_PROBE, faster, 7, generation, now);
+  TEST_ASSERT_EQUAL(0, applyCount);
+}
+
+// The responder switches on the proposer's PROBE, and only a frame heard
+// on the new settings confirms it
+void test_responder_switches_on_probe() {
+  uint32_t now = T0;
+  uint8_t faster = LINK_DEFAULT_PROFILE + 1;
+  for (int i = 0; i < LINK_MIN_SAMPLES; i++) {
+    hear(generation, now);
+  }
+  control(LINK_OP_PROPOSE, faster, 8, generation, now);
+  uint16_t old = generation;
+  control(LINK_OP_PROBE, faster, 8, old, now + 100);
+  TEST_ASSERT_EQUAL(1, applyCount);
+  TEST_ASSERT_EQUAL(faster, applied[0]);
+  TEST_ASSERT_EQUAL(LINK_VERIFYING, linkAdaptState());
+  TEST_ASSERT_TRUE(sent(LINK_OP_PROBE, faster));
+
+  hear(old, now + 200);
+  TEST_ASSERT_EQUAL(LINK_VERIFYING, linkAdaptState());
+  hear(generation, now + 300);
+  TEST_ASSERT_EQUAL(LINK_STABLE, linkAdaptState());
+  TEST_ASSERT_EQUAL(faster, linkAdaptProfileIndex());
+
+  // Back to the boot profile for the tests after this one
+  now += LINK_SILENCE_MS + 1000;
+  linkAdaptPoll(now);
+  TEST_ASSERT_EQUAL(LINK_DEFAULT_PROFILE, linkAdaptProfileIndex());
+}
+
+// The proposer commits with a PROBE on the old profile, then switches.
+// Frames the radio took in before the new settings applied do not count;
+// with nothing heard after them it reverts.
+void test_proposer_reverts_without_peer() {
+  uint32_t now = T0;
+  uint8_t faster = LINK_DEFAULT_PROFILE + 1;
+  uint8_t id = proposeFaster(&now);
+  uint16_t old = generation;
+  control(LINK_OP_ACCEPT, faster, (uint8_t)(id - 1), old, now);   // A stale proposal's
+  TEST_ASSERT_EQUAL(LINK_PROPOSED, linkAdaptState());
+  control(LINK_OP_ACCEPT, faster, id, old, now);
+  TEST_ASSERT_EQUAL(1, applyCount);
+  TEST_ASSERT_EQUAL(faster, applied[0]);
+  TEST_ASSERT_EQUAL(LINK_VERIFYING, linkAdaptState());
+  TEST_ASSERT_EQUAL(LINK_OP_PROBE, sentOps[sentCount - 3]);   // Commit, old profile
+  TEST_ASSERT_EQUAL(LINK_OP_PROBE, sentOps[sentCount - 2]);
+  TEST_ASSERT_EQUAL(LINK_OP_PROBE, sentOps[sentCount - 1]);   // First on the new one
+
+  hear(old, now + 100);
+  TEST_ASSERT_EQUAL(LINK_VERIFYING, linkAdaptState());
+
+  // PROBE repeats while verifying, then the old profile comes back
+  size_t before = sentCount;
+  linkAdaptPoll(now + LINK_PROBE_MS);
+  TEST_ASSERT_EQUAL(before + 1, sentCount);
+  TEST_ASSERT_EQUAL(LINK_OP_PROBE, sentOps[sentCount - 1]);
+  linkAdaptPoll(now + LINK_VERIFY_MS + 1);
+  TEST_ASSERT_EQUAL(LINK_STABLE, linkAdaptState());
+  TEST_ASSERT_EQUAL(LINK_DEFAULT_PROFILE, linkAdaptProfileIndex());
+  TEST_ASSERT_EQUAL(2, applyCount);
+  TEST_ASSERT_EQUAL(LINK_DEFAULT_PROFILE, applied[1]);
+  TEST_ASSERT_EQUAL(1, linkAdaptGetStats().reverts);
+}
+
+// Margin enough to stay on the boot profile but not the hysteresis on
+// top to leave it: no proposal
+void test_no_step_up_at_the_margin() {
+  uint32_t now = T0;
+  float snr = LINK_PROFILES[LINK_DEFAULT_PROFILE + 1].requiredSnrDb + LINK_MARGIN_DB + 1;
+  for (int i = 0; i < LINK_MIN_SAMPLES; i++) {
+    peerSent++;
+    linkAdaptOnFrame(PEER, true, -80.0f, snr, generation, now);
+  }
+  now += LINK_DECIDE_MS + 1;
+  linkAdaptPoll(now);
+  TEST_ASSERT_EQUAL(LINK_STABLE, linkAdaptState());
+  TEST_ASSERT_FALSE(sent(LINK_OP_PROPOSE, LINK_DEFAULT_PROFILE + 1));
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_proposer_lost_accept);
+  RUN_TEST(test_responder_lost_accept);
+  RUN_TEST(test_responder_switches_on_probe);
+  RUN_TEST(test_proposer_reverts_without_peer);
+  RUN_TEST(test_no_step_up_at_the_margin);
+  return UNITY_END();
+}
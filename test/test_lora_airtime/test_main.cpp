@@ -0,0 +1,138 @@
+#include <unity.h>
+#include "lora_airtime.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Window: CW_MIN doubling per busy scan, never past CW_MAX, whatever the
+// exponent the driver passes
+void test_backoff_window() {
+  TEST_ASSERT_EQUAL(LORA_LBT_CW_MIN, loraLbtWindow(0));
+  TEST_ASSERT_EQUAL(2 * LORA_LBT_CW_MIN, loraLbtWindow(1));
+  uint32_t last = 0;
+  for (uint8_t exp = 0; exp < 255; exp++) {
+    uint32_t window = loraLbtWindow(exp);
+    TEST_ASSERT_GREATER_OR_EQUAL(last, window);
+    TEST_ASSERT_LESS_OR_EQUAL(LORA_LBT_CW_MAX, window);
+    last = window;
+  }
+  TEST_ASSERT_EQUAL(LORA_LBT_CW_MAX, loraLbtWindow(LORA_LBT_MAX_BUSY - 1));
+}
+
+// Every draw is a whole number of slots below the window, and the
+// extremes of the random source reach both ends
+void test_backoff_bounds() {
+  const uint32_t slotUs = loraLbtSlotUs(7, 125.0f);
+  static const uint32_t draws[] = { 0, 1, 7, 8, 127, 128, 0x7FFFFFFF, 0xFFFFFFFF };
+  for (uint8_t exp = 0; exp < LORA_LBT_MAX_BUSY; exp++) {
+    uint32_t window = loraLbtWindow(exp);
+    for (size_t i = 0; i < sizeof(draws) / sizeof(draws[0]); i++) {
+      uint32_t us = loraLbtBackoffUs(exp, draws[i], slotUs);
+      TEST_ASSERT_EQUAL(0, us % slotUs);
+      TEST_ASSERT_LESS_THAN(window * slotUs, us);
+    }
+    TEST_ASSERT_EQUAL(0, loraLbtBackoffUs(exp, 0, slotUs));
+    TEST_ASSERT_EQUAL((window - 1) * slotUs, loraLbtBackoffUs(exp, window - 1, slotUs));
+  }
+}
+
+// A slot is LORA_LBT_SLOT_SYMBOLS symbols of the profile in use
+void test_slot_length() {
+  TEST_ASSERT_EQUAL(LORA_LBT_SLOT_SYMBOLS * 1024, loraLbtSlotUs(7, 125.0f));
+  TEST_ASSERT_EQUAL(LORA_LBT_SLOT_SYMBOLS * 32768, loraLbtSlotUs(12, 125.0f));
+  TEST_ASSERT_EQUAL(LORA_LBT_SLOT_SYMBOLS * 512, loraLbtSlotUs(7, 250.0f));
+
+  // Longest single backoff on the slowest profile
+  TEST_ASSERT_EQUAL((LORA_LBT_CW_MAX - 1) * LORA_LBT_SLOT_SYMBOLS * 32768,
+                    loraLbtBackoffUs(LORA_LBT_MAX_BUSY, LORA_LBT_CW_MAX - 1, loraLbtSlotUs(12, 125.0f)));
+}
+
+// Time on air against the Semtech LoRa calculator: CR 4/5, 8 preamble
+// symbols, explicit header, CRC
+void test_time_on_air_table() {
+  TEST_ASSERT_EQUAL(41216, loraTimeOnAirUs(7, 125.0f, 10, 8));
+  TEST_ASSERT_EQUAL(102656, loraTimeOnAirUs(7, 125.0f, 51, 8));
+  TEST_ASSERT_EQUAL(20608, loraTimeOnAirUs(7, 250.0f, 10, 8));
+  TEST_ASSERT_EQUAL(144384, loraTimeOnAirUs(9, 125.0f, 10, 8));
+  TEST_ASSERT_EQUAL(288768, loraTimeOnAirUs(10, 125.0f, 10, 8));
+  TEST_ASSERT_EQUAL(577536, loraTimeOnAirUs(11, 125.0f, 10, 8));
+  TEST_ASSERT_EQUAL(991232, loraTimeOnAirUs(12, 125.0f, 10, 8));
+
+  // Low data rate optimisation from 16 ms symbols on
+  TEST_ASSERT_FALSE(loraLowDataRate(10, 125.0f));
+  TEST_ASSERT_TRUE(loraLowDataRate(11, 125.0f));
+  TEST_ASSERT_FALSE(loraLowDataRate(11, 250.0f));
+}
+
+// Control may fill the budget, data leaves room for it, bulk the least;
+// an unknown class is treated as data
+void test_share_table() {
+  TEST_ASSERT_EQUAL(100, airtimeSharePct(AIRTIME_PRIO_CONTROL));
+  TEST_ASSERT_EQUAL(LORA_DUTY_DATA_PCT, airtimeSharePct(AIRTIME_PRIO_DATA));
+  TEST_ASSERT_EQUAL(LORA_DUTY_BULK_PCT, airtimeSharePct(AIRTIME_PRIO_BULK));
+  TEST_ASSERT_EQUAL(LORA_DUTY_DATA_PCT, airtimeSharePct(AIRTIME_PRIO_COUNT));
+  TEST_ASSERT_GREATER_THAN(airtimeSharePct(AIRTIME_PRIO_DATA), airtimeSharePct(AIRTIME_PRIO_CONTROL));
+  TEST_ASSERT_GREATER_THAN(airtimeSharePct(AIRTIME_PRIO_BULK), airtimeSharePct(AIRTIME_PRIO_DATA));
+}
+
+// Buckets leave the window whole; the wait is until the oldest bucket
+// that makes room has gone
+void test_ledger_window() {
+  AirtimeLedger ledger = {};
+  ledger.record(0, 1000);
+  ledger.record(LORA_DUTY_BUCKET_MS, 2000);
+  ledger.record(LORA_DUTY_BUCKET_MS + 1, 500);
+  TEST_ASSERT_EQUAL(3500, ledger.usedUs(LORA_DUTY_BUCKET_MS));
+  TEST_ASSERT_EQUAL(3500, ledger.usedUs(LORA_DUTY_WINDOW_MS - 1));
+  TEST_ASSERT_EQUAL(2500, ledger.usedUs(LORA_DUTY_WINDOW_MS));
+  TEST_ASSERT_EQUAL(0, ledger.usedUs(LORA_DUTY_WINDOW_MS + LORA_DUTY_BUCKET_MS));
+
+  TEST_ASSERT_EQUAL(0, ledger.waitMs(LORA_DUTY_BUCKET_MS, 500, 4000));
+  TEST_ASSERT_EQUAL(LORA_DUTY_WINDOW_MS - LORA_DUTY_BUCKET_MS,
+                    ledger.waitMs(LORA_DUTY_BUCKET_MS, 1000, 4000));
+  TEST_ASSERT_EQUAL(LORA_DUTY_WINDOW_MS, ledger.waitMs(LORA_DUTY_BUCKET_MS, 3000, 4000));
+  TEST_ASSERT_EQUAL(UINT32_MAX, ledger.waitMs(0, 5000, 4000));
+}
+
+// What each class does once the window is nearly full
+void test_admit_verdicts() {
+  const uint32_t fullUs = (uint32_t)(LORA_DUTY_BUDGET_US * LORA_DUTY_DATA_PCT / 100) - 1000;
+  uint32_t waitMs;
+  airtimeBegin();
+  airtimeRecord(AIRTIME_PRIO_DATA, fullUs, 0);
+#if LORA_DUTY_CYCLE_ENABLED
+  const uint32_t nearExpiryMs = LORA_DUTY_WINDOW_MS - LORA_DUTY_MAX_WAIT_MS / 2;
+  TEST_ASSERT_EQUAL(AIRTIME_SEND, airtimeAdmit(AIRTIME_PRIO_CONTROL, 100000, 1000, &waitMs));
+  TEST_ASSERT_EQUAL(AIRTIME_SHED, airtimeAdmit(AIRTIME_PRIO_BULK, 1000, 1000, &waitMs));
+  TEST_ASSERT_EQUAL(AIRTIME_SHED, airtimeAdmit(AIRTIME_PRIO_DATA, 100000, 1000, &waitMs));
+  TEST_ASSERT_EQUAL(AIRTIME_WAIT, airtimeAdmit(AIRTIME_PRIO_DATA, 100000, nearExpiryMs, &waitMs));
+  TEST_ASSERT_EQUAL(LORA_DUTY_WINDOW_MS - nearExpiryMs, waitMs);
+  TEST_ASSERT_EQUAL(AIRTIME_SEND, airtimeAdmit(AIRTIME_PRIO_DATA, 1000, 1000, &waitMs));
+  TEST_ASSERT_EQUAL(1, airtimeGetStats().shed[AIRTIME_PRIO_DATA]);
+  TEST_ASSERT_EQUAL(1, airtimeGetStats().shed[AIRTIME_PRIO_BULK]);
+  TEST_ASSERT_EQUAL(1, airtimeGetStats().waits);
+#else
+  // Not enforced: everything goes, the ledger only reports
+  for (uint8_t priority = 0; priority < AIRTIME_PRIO_COUNT; priority++) {
+    TEST_ASSERT_EQUAL(AIRTIME_SEND, airtimeAdmit(priority, 100000, 1000, &waitMs));
+    TEST_ASSERT_EQUAL(0, waitMs);
+  }
+  TEST_ASSERT_EQUAL(AIRTIME_PRIO_COUNT, airtimeGetStats().admitted);
+#endif
+  TEST_ASSERT_EQUAL(fullUs, airtimeUsedUs(1000));
+  TEST_ASSERT_EQUAL(0, airtimeUsedUs(LORA_DUTY_WINDOW_MS));
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_backoff_window);
+  RUN_TEST(test_backoff_bounds);
+  RUN_TEST(test_slot_length);
+  RUN_TEST(test_time_on_air_table);
+  RUN_TEST(test_share_table);
+  RUN_TEST(test_ledger_window);
+  RUN_TEST(test_admit_verdicts);
+  return UNITY_END();
+}
@@ -0,0 +1,304 @@
+#include <unity.h>
+#include <string.h>
+#include "lora_arq.h"
+
+void setUp() {}
+void tearDown() {}
+
+#define SENDER      2         // Frames loop back to this module as if from station 2
+#define LATER_MS    60000     // Past any RTO
+
+static ArqReceipt receipts[ARQ_MAX_FRAME_MSGS];
+static size_t receiptCount;
+
+static void submit(uint16_t msgNo) {
+  uint8_t body[4] = { (uint8_t)msgNo };
+  TEST_ASSERT_TRUE(arqSubmit(0, body, sizeof(body), msgNo, msgNo, true));
+}
+
+static ArqOutFrame transmit(uint32_t nowMs) {
+  ArqOutFrame out;
+  receiptCount = 0;
+  TEST_ASSERT_TRUE(arqNextTransmit(nowMs, &out, receipts, &receiptCount, 8));
+  return out;
+}
+
+static void acknowledge(uint32_t nowMs) {
+  uint8_t block[ARQ_ACK_SIZE];
+  arqWriteAck(SENDER, block);
+  receiptCount = 0;
+  arqOnAck(block, nowMs, receipts, &receiptCount, 8);
+}
+
+// One piece of a message spread over several frames
+static void submitPart(uint16_t msgNo, bool last) {
+  uint8_t body[4] = { (uint8_t)msgNo };
+  TEST_ASSERT_TRUE(arqSubmit(0, body, sizeof(body), msgNo, msgNo, last));
+}
+
+static uint8_t failures[32];
+static uint8_t deliveries[32];
+
+static void tally() {
+  for (size_t i = 0; i < receiptCount; i++) {
+    (receipts[i].delivered ? deliveries : failures)[receipts[i].msgNo % 32]++;
+  }
+}
+
+// Sends everything buffered and loses every try, until the sender gives
+// all of it up; receipts go into the tallies
+static uint32_t loseAll(uint32_t nowMs) {
+  for (int round = 0; round <= ARQ_MAX_TRIES; round++, nowMs += LATER_MS) {
+    ArqOutFrame out;
+    bool sent;
+    do {
+      receiptCount = 0;
+      sent = arqNextTransmit(nowMs, &out, receipts, &receiptCount, 8);
+      tally();
+    } while (sent || receiptCount > 0);
+  }
+  TEST_ASSERT_TRUE(arqIdle());
+  return nowMs;
+}
+
+static bool hasReceipt(uint16_t msgNo, bool delivered) {
+  for (size_t i = 0; i < receiptCount; i++) {
+    if (receipts[i].msgNo == msgNo && receipts[i].delivered == delivered) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// The first frames of a session are lost: the receiver must wait for
+// them instead of starting its window at the first frame it hears
+void test_lost_first_frame_not_acknowledged() {
+  arqBegin(1, 0);
+  submit(1);
+  submit(2);
+  submit(3);
+  transmit(0);
+  ArqOutFrame second = transmit(0);
+  ArqOutFrame third = transmit(0);
+  TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqOnReceive(SENDER, second.header, 0));
+  TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqOnReceive(SENDER, third.header, 0));
+
+  acknowledge(10);
+  TEST_ASSERT_TRUE(hasReceipt(2, true));
+  TEST_ASSERT_TRUE(hasReceipt(3, true));
+  TEST_ASSERT_FALSE(hasReceipt(1, true));
+
+  ArqOutFrame retry = transmit(LATER_MS);
+  TEST_ASSERT_EQUAL(2, retry.attempt);
+  TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqOnReceive(SENDER, retry.header, LATER_MS));
+  acknowledge(LATER_MS);
+  TEST_ASSERT_TRUE(hasReceipt(1, true));
+  TEST_ASSERT_TRUE(arqIdle());
+}
+
+// A retransmission after a lost ACK is a duplicate, and is acknowledged again
+void test_duplicate_after_lost_ack() {
+  arqBegin(2, 0);
+  submit(4);
+  ArqOutFrame first = transmit(0);
+  TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqOnReceive(SENDER, first.header, 0));
+  uint8_t lost[ARQ_ACK_SIZE];
+  arqWriteAck(SENDER, lost);
+
+  ArqOutFrame retry = transmit(LATER_MS);
+  TEST_ASSERT_EQUAL(ARQ_RX_DUPLICATE, arqOnReceive(SENDER, retry.header, LATER_MS));
+  TEST_ASSERT_TRUE(arqAckPending(SENDER));
+  acknowledge(LATER_MS);
+  TEST_ASSERT_TRUE(hasReceipt(4, true));
+}
+
+// The sender gives up on a frame the receiver never got; the receiver
+// moves past it from the base the next frame carries, and the message is
+// reported failed, never delivered
+void test_given_up_frame_skipped() {
+  arqBegin(3, 0);
+  submit(5);
+  submit(6);
+  transmit(0);
+  ArqOutFrame second = transmit(0);
+  TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqOnReceive(SENDER, second.header, 0));
+  acknowledge(10);
+  TEST_ASSERT_TRUE(hasReceipt(6, true));
+
+  // Every retry of the first frame is lost
+  uint32_t now = 0;
+  bool failed = false;
+  for (int i = 0; i < ARQ_MAX_TRIES + 1 && !failed; i++) {
+    now += LATER_MS;
+    ArqOutFrame out;
+    receiptCount = 0;
+    if (!arqNextTransmit(now, &out, receipts, &receiptCount, 8)) {
+      failed = hasReceipt(5, false);
+    }
+  }
+  TEST_ASSERT_TRUE(failed);
+
+  submit(7);
+  ArqOutFrame next = transmit(now);
+  TEST_ASSERT_EQUAL(2, next.header[2]);
+  TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqOnReceive(SENDER, next.header, now));
+  uint8_t block[ARQ_ACK_SIZE];
+  arqWriteAck(SENDER, block);
+  TEST_ASSERT_EQUAL(3, block[1]);
+  receiptCount = 0;
+  arqOnAck(block, now, receipts, &receiptCount, 8);
+  TEST_ASSERT_TRUE(hasReceipt(7, true));
+  TEST_ASSERT_FALSE(hasReceipt(5, true));
+}
+
+// First retry time for a fresh session seeded with seed
+static uint32_t firstRetryMs(uint8_t session, uint32_t seed) {
+  arqBegin(session, seed);
+  submit(7);
+  transmit(0);
+  ArqOutFrame out;
+  for (uint32_t now = 1; now < LATER_MS; now++) {
+    receiptCount = 0;
+    if (arqNextTransmit(now, &out, receipts, &receiptCount, 8)) {
+      return now;
+    }
+  }
+  return LATER_MS;
+}
+
+// Retries wait the RTO plus up to a quarter, and stations seeded apart
+// do not retry in step
+void test_retry_jitter() {
+  uint32_t a = firstRetryMs(4, 0x12345678);
+  uint32_t b = firstRetryMs(5, 0x9abcdef0);
+  TEST_ASSERT_UINT32_WITHIN(125, 1125, a);
+  TEST_ASSERT_UINT32_WITHIN(125, 1125, b);
+  TEST_ASSERT_NOT_EQUAL(a, b);
+}
+
+// One ACK completing more messages than the receipt buffer holds hands
+// them over in turns, losing none
+void test_ack_receipts_in_turns() {
+  arqBegin(6, 0);
+  uint8_t body[4] = {};
+  uint16_t msg = 1;
+  for (int f = 0; f < 3; f++, msg += ARQ_MAX_FRAME_MSGS - 1) {
+    TEST_ASSERT_TRUE(arqSubmit(0, body, sizeof(body), msg, msg + ARQ_MAX_FRAME_MSGS - 2, true));
+  }
+  TEST_ASSERT_FALSE(arqSubmit(0, body, sizeof(body), msg, msg + ARQ_MAX_FRAME_MSGS, true));
+  for (int f = 0; f < 3; f++) {
+    ArqOutFrame out = transmit(0);
+    arqOnReceive(SENDER, out.header, 0);
+  }
+
+  uint8_t block[ARQ_ACK_SIZE];
+  arqWriteAck(SENDER, block);
+  bool seen[3 * (ARQ_MAX_FRAME_MSGS - 1) + 1] = {};
+  size_t total = 0;
+  int turns = 0;
+  bool more;
+  do {
+    receiptCount = 0;
+    more = arqOnAck(block, 10, receipts, &receiptCount, ARQ_MAX_FRAME_MSGS);
+    for (size_t i = 0; i < receiptCount; i++) {
+      TEST_ASSERT_TRUE(receipts[i].delivered);
+      TEST_ASSERT_FALSE(seen[receipts[i].msgNo]);
+      seen[receipts[i].msgNo] = true;
+      total++;
+    }
+    turns++;
+  } while (more && turns < 10);
+  TEST_ASSERT_EQUAL(3 * (ARQ_MAX_FRAME_MSGS - 1), total);
+  TEST_ASSERT_EQUAL(3, turns);
+}
+
+// Two messages, each split over two frames, interleaved. The first
+// pieces of both are given up; the last pieces then arrive. Neither
+// message may be reported delivered after being reported failed.
+void test_failed_message_never_delivered() {
+  arqBegin(7, 0);
+  memset(failures, 0, sizeof(failures));
+  memset(deliveries, 0, sizeof(deliveries));
+  submitPart(10, false);
+  submitPart(11, false);
+  uint32_t now = loseAll(0);
+  TEST_ASSERT_EQUAL(1, failures[10]);
+  TEST_ASSERT_EQUAL(1, failures[11]);
+
+  submitPart(10, true);
+  submitPart(11, true);
+  for (int f = 0; f < 2; f++) {
+    ArqOutFrame out = transmit(now);
+    TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqOnReceive(SENDER, out.header, now));
+  }
+  acknowledge(now);
+  tally();
+  TEST_ASSERT_EQUAL(0, deliveries[10]);
+  TEST_ASSERT_EQUAL(0, deliveries[11]);
+  TEST_ASSERT_TRUE(arqIdle());
+}
+
+// The same, with the last pieces given up too: one failure each
+void test_failed_message_reported_once() {
+  arqBegin(8, 0);
+  memset(failures, 0, sizeof(failures));
+  memset(deliveries, 0, sizeof(deliveries));
+  submitPart(10, false);
+  submitPart(11, false);
+  uint32_t now = loseAll(0);
+  submitPart(10, true);
+  submitPart(11, true);
+  loseAll(now);
+  TEST_ASSERT_EQUAL(1, failures[10]);
+  TEST_ASSERT_EQUAL(1, failures[11]);
+  TEST_ASSERT_EQUAL(0, deliveries[10]);
+  TEST_ASSERT_EQUAL(0, deliveries[11]);
+}
+
+// Message tags skip ARQ_NO_MESSAGE when they wrap, so a frame carrying
+// 0xFFFE..2 holds four messages, and no receipt is ever for tag 0,
+// delivered or failed
+void test_receipts_skip_no_message_tag() {
+  arqBegin(9, 0);
+  memset(failures, 0, sizeof(failures));
+  submit(5);
+  uint32_t now = loseAll(0);
+  TEST_ASSERT_EQUAL(1, failures[5]);
+
+  uint8_t body[4] = {};
+  TEST_ASSERT_TRUE(arqSubmit(0, body, sizeof(body), 0xFFFE, 2, true));
+  ArqOutFrame out = transmit(now);
+  TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqOnReceive(SENDER, out.header, now));
+  acknowledge(now);
+  TEST_ASSERT_EQUAL(4, receiptCount);
+  TEST_ASSERT_TRUE(hasReceipt(0xFFFE, true));
+  TEST_ASSERT_TRUE(hasReceipt(0xFFFF, true));
+  TEST_ASSERT_TRUE(hasReceipt(1, true));
+  TEST_ASSERT_TRUE(hasReceipt(2, true));
+  TEST_ASSERT_FALSE(hasReceipt(ARQ_NO_MESSAGE, true));
+
+  memset(failures, 0, sizeof(failures));
+  memset(deliveries, 0, sizeof(deliveries));
+  TEST_ASSERT_TRUE(arqSubmit(0, body, sizeof(body), 0xFFFF, 3, true));
+  loseAll(now);
+  TEST_ASSERT_EQUAL(1, failures[0xFFFF % 32]);
+  TEST_ASSERT_EQUAL(1, failures[1]);
+  TEST_ASSERT_EQUAL(1, failures[2]);
+  TEST_ASSERT_EQUAL(1, failures[3]);
+  TEST_ASSERT_EQUAL(0, failures[ARQ_NO_MESSAGE]);
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_lost_first_frame_not_acknowledged);
+  RUN_TEST(test_duplicate_after_lost_ack);
+  RUN_TEST(test_given_up_frame_skipped);
+  RUN_TEST(test_retry_jitter);
+  RUN_TEST(test_ack_receipts_in_turns);
+  RUN_TEST(test_failed_message_never_delivered);
+  RUN_TEST(test_failed_message_reported_once);
+  RUN_TEST(test_receipts_skip_no_message_tag);
+  return UNITY_END();
+}
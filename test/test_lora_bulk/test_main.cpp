@@ -0,0 +1,422 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "ble_segment.h"
+#include "lora_bulk.h"
+#include "lora_frame.h"
+
+// Two stations in one process: the module compiled once more per side,
+// the way the simulator builds each station (sim/sim_station.h)
+namespace sender {
+#include "../../src/lora_bulk.cpp"
+}
+namespace receiver {
+#include "../../src/lora_bulk.cpp"
+}
+
+#define SENDER_ID     1
+#define RECEIVER_ID   2
+#define OBJECT_ID     0x0B1EC7u
+#define BLOCK_SIZE    200
+#define BLOCKS        300
+#define OBJECT_SIZE   (BLOCKS * BLOCK_SIZE - 77)
+#define STEP_MS       100
+#define MAX_STEPS     20000
+#define AIR_FRAMES    64
+#define PHONE_NOTES   64
+#define NOTE_MAX      (LORA_BULK_NOTE_HEADER + LORA_FRAME_MAX_PAYLOAD)
+
+struct AirFrame {
+  uint8_t src;
+  uint8_t len;
+  uint8_t data[LORA_FRAME_MAX_PAYLOAD];
+};
+
+struct PhoneNote {
+  uint8_t kind;
+  uint16_t len;
+  uint8_t data[NOTE_MAX];
+};
+
+// The channel: frames in the order they were sent, all delivered within
+// one step unless lost
+static AirFrame air[AIR_FRAMES];
+static size_t airHead, airCount;
+static uint8_t loseOnce[LORA_BULK_MAX_BLOCKS / 8];   // DATA blocks lost the first time
+static bool linkDown;
+static uint32_t nowMs;
+
+// Sending phone: answers NEED with BLOCK writes while connected
+static bool senderConnected;
+static uint16_t needFirst, needCount;
+static bool sent;
+static uint8_t stallReason;
+
+// Receiving phone: handles notes in order once a step, unless held back
+static PhoneNote notes[PHONE_NOTES];
+static size_t notesHead, notesCount;
+static bool holdNotes;
+static int failBlock;                    // DATA note that can be neither delivered nor stored
+static uint8_t object[OBJECT_SIZE];
+static uint16_t deliveries[BLOCKS];
+static bool complete;
+static uint8_t savedCheckpoint[LORA_BULK_CHECKPOINT_SIZE];
+static size_t savedLen;
+
+static uint8_t objectByte(uint32_t offset) {
+  return (uint8_t)(offset * 31 + (offset >> 8));
+}
+
+static uint16_t get16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+  return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+  for (int k = 0; k < 4; k++) {
+    p[k] = (uint8_t)(v >> (8 * k));
+  }
+}
+
+static bool queueFrame(uint8_t src, const uint8_t* hdr, size_t hdrLen, const uint8_t* data, size_t len) {
+  if (airCount == AIR_FRAMES || hdrLen + len > LORA_FRAME_MAX_PAYLOAD) {
+    return false;
+  }
+  AirFrame& f = air[(airHead + airCount++) % AIR_FRAMES];
+  f.src = src;
+  f.len = (uint8_t)(hdrLen + len);
+  memcpy(f.data, hdr, hdrLen);
+  if (len > 0) {
+    memcpy(f.data + hdrLen, data, len);
+  }
+  return true;
+}
+
+static bool senderSend(uint8_t dst, const uint8_t* hdr, size_t hdrLen, const uint8_t* data, size_t len) {
+  TEST_ASSERT_EQUAL(RECEIVER_ID, dst);
+  return queueFrame(SENDER_ID, hdr, hdrLen, data, len);
+}
+
+static bool receiverSend(uint8_t dst, const uint8_t* hdr, size_t hdrLen, const uint8_t* data, size_t len) {
+  TEST_ASSERT_EQUAL(SENDER_ID, dst);
+  return queueFrame(RECEIVER_ID, hdr, hdrLen, data, len);
+}
+
+static bool senderPhone(const uint8_t* note, size_t len, BulkNoteKind kind) {
+  TEST_ASSERT_EQUAL(BULK_NOTE_STATUS, kind);
+  TEST_ASSERT_EQUAL_HEX8(BLE_BULK_MARKER, note[0]);
+  if (!senderConnected) {
+    return false;
+  }
+  if (note[1] == BULK_PHONE_NEED && len == 10) {
+    TEST_ASSERT_EQUAL(BLOCK_SIZE, note[6]);
+    needFirst = get16(note + 7);
+    needCount = note[9];
+  } else if (note[1] == BULK_PHONE_SENT) {
+    sent = true;
+  } else if (note[1] == BULK_PHONE_STALLED) {
+    stallReason = note[6];
+  }
+  return true;
+}
+
+static bool receiverPhone(const uint8_t* note, size_t len, BulkNoteKind kind) {
+  if (notesCount == PHONE_NOTES || len > NOTE_MAX) {
+    return false;
+  }
+  PhoneNote& n = notes[(notesHead + notesCount++) % PHONE_NOTES];
+  n.kind = kind;
+  n.len = (uint16_t)len;
+  memcpy(n.data, note, len);
+  return true;
+}
+
+// What the phone task does with each note (deliverBulkNote in main.cpp)
+static void drainReceiverPhone() {
+  while (notesCount > 0) {
+    PhoneNote& n = notes[notesHead];
+    notesHead = (notesHead + 1) % PHONE_NOTES;
+    notesCount--;
+    if (n.kind == BULK_NOTE_CHECKPOINT) {
+      receiver::bulkTrimCheckpoint(n.data, n.len);
+      memcpy(savedCheckpoint, n.data, n.len);
+      savedLen = n.len;
+      continue;
+    }
+    TEST_ASSERT_EQUAL_HEX8(BLE_BULK_MARKER, n.data[0]);
+    TEST_ASSERT_EQUAL(OBJECT_ID, get32(n.data + 2));
+    if (n.data[1] == BULK_PHONE_COMPLETE) {
+      complete = true;
+    } else if (n.data[1] == BULK_PHONE_DATA) {
+      uint32_t offset = get32(n.data + 6);
+      size_t dataLen = n.len - LORA_BULK_NOTE_HEADER;
+      TEST_ASSERT_EQUAL(0, offset % BLOCK_SIZE);
+      TEST_ASSERT_TRUE(offset + dataLen <= OBJECT_SIZE);
+      if ((int)(offset / BLOCK_SIZE) == failBlock) {
+        failBlock = -1;
+        receiver::bulkForget(n.data, n.len);
+        continue;
+      }
+      memcpy(object + offset, n.data + LORA_BULK_NOTE_HEADER, dataLen);
+      deliveries[offset / BLOCK_SIZE]++;
+    }
+  }
+}
+
+static void offer() {
+  uint8_t msg[9] = { BULK_PHONE_OFFER };
+  put32(msg + 1, OBJECT_ID);
+  put32(msg + 5, OBJECT_SIZE);
+  sender::bulkOnPhone(msg, sizeof(msg), BLOCK_SIZE, nowMs);
+}
+
+static void writeNeededBlocks() {
+  uint8_t msg[7 + BLOCK_SIZE] = { BULK_PHONE_BLOCK };
+  put32(msg + 1, OBJECT_ID);
+  for (; needCount > 0 && senderConnected; needCount--, needFirst++) {
+    uint32_t offset = (uint32_t)needFirst * BLOCK_SIZE;
+    size_t len = (OBJECT_SIZE - offset < BLOCK_SIZE) ? OBJECT_SIZE - offset : BLOCK_SIZE;
+    msg[5] = (uint8_t)needFirst;
+    msg[6] = (uint8_t)(needFirst >> 8);
+    for (size_t k = 0; k < len; k++) {
+      msg[7 + k] = objectByte(offset + (uint32_t)k);
+    }
+    sender::bulkOnPhone(msg, 7 + len, BLOCK_SIZE, nowMs);
+  }
+}
+
+static bool lost(const AirFrame& f) {
+  if (linkDown) {
+    return true;
+  }
+  if (f.src != SENDER_ID || (f.data[0] & BULK_OP_MASK) != BULK_OP_DATA) {
+    return false;
+  }
+  uint16_t block = get16(f.data + 2);
+  if (loseOnce[block >> 3] & (1u << (block & 7))) {
+    loseOnce[block >> 3] &= (uint8_t)~(1u << (block & 7));
+    return true;
+  }
+  return false;
+}
+
+static void deliverFrames() {
+  while (airCount > 0) {
+    AirFrame f = air[airHead];
+    airHead = (airHead + 1) % AIR_FRAMES;
+    airCount--;
+    if (lost(f)) {
+      continue;
+    }
+    if (f.src == SENDER_ID) {
+      receiver::bulkOnFrame(SENDER_ID, f.data, f.len, nowMs);
+    } else {
+      sender::bulkOnFrame(RECEIVER_ID, f.data, f.len, nowMs);
+    }
+  }
+}
+
+static void step() {
+  nowMs += STEP_MS;
+  sender::bulkPoll(nowMs, 0);
+  writeNeededBlocks();
+  deliverFrames();
+  if (!holdNotes) {
+    drainReceiverPhone();
+  }
+}
+
+// Steps until the sending phone hears SENT, or until stop() holds
+static uint32_t run(bool (*stop)() = NULL) {
+  uint32_t steps = 0;
+  while (!sent && steps < MAX_STEPS && (stop == NULL || !stop())) {
+    step();
+    steps++;
+  }
+  return steps;
+}
+
+static void loseBlock(uint16_t block) {
+  loseOnce[block >> 3] |= (uint8_t)(1u << (block & 7));
+}
+
+static void expectObjectDelivered() {
+  TEST_ASSERT_TRUE(sent);
+  TEST_ASSERT_TRUE(complete);
+  for (uint32_t k = 0; k < OBJECT_SIZE; k++) {
+    if (object[k] != objectByte(k)) {
+      TEST_ASSERT_EQUAL_HEX8(objectByte(k), object[k]);
+    }
+  }
+  for (uint16_t i = 0; i < BLOCKS; i++) {
+    TEST_ASSERT_GREATER_OR_EQUAL(1, deliveries[i]);
+  }
+}
+
+static void report(const char* what, uint32_t steps) {
+  const BulkStats& tx = sender::bulkGetStats();
+  const BulkStats& rx = receiver::bulkGetStats();
+  char line[160];
+  snprintf(line, sizeof(line), "%s: %u blocks sent, %u resent, %u skipped on resume, %u duplicate, %u checkpoints, last leg %u ms",
+           what, (unsigned)tx.blocksSent, (unsigned)tx.blocksResent, (unsigned)tx.resumeSkipped,
+           (unsigned)rx.blocksDuplicate, (unsigned)rx.checkpoints, (unsigned)(steps * STEP_MS));
+  TEST_MESSAGE(line);
+}
+
+void setUp() {
+  sender::bulkBegin(RECEIVER_ID, senderSend, senderPhone, NULL);
+  receiver::bulkBegin(SENDER_ID, receiverSend, receiverPhone, NULL);
+  airHead = airCount = 0;
+  notesHead = notesCount = 0;
+  memset(loseOnce, 0, sizeof(loseOnce));
+  memset(object, 0, sizeof(object));
+  memset(deliveries, 0, sizeof(deliveries));
+  linkDown = holdNotes = sent = complete = false;
+  senderConnected = true;
+  needCount = 0;
+  stallReason = 0;
+  failBlock = -1;
+  savedLen = 0;
+}
+void tearDown() {}
+
+// Every block once, each handed to the phone as it arrives: the state
+// of both sides is a small fraction of the object
+void test_clean_transfer() {
+  offer();
+  uint32_t steps = run([]() { return deliveries[0] > 0; });
+  TEST_ASSERT_LESS_OR_EQUAL(LORA_BULK_WINDOW, receiver::bulkGetStats().rxReceived);
+
+  steps += run();
+  expectObjectDelivered();
+  TEST_ASSERT_EQUAL(BLOCKS, sender::bulkGetStats().blocksSent);
+  TEST_ASSERT_EQUAL(0, sender::bulkGetStats().blocksResent);
+  TEST_ASSERT_EQUAL(1, receiver::bulkGetStats().objectsReceived);
+  report("clean", steps);
+
+  uint32_t state = receiver::bulkGetStats().stateBytes;
+  char line[96];
+  snprintf(line, sizeof(line), "state %u bytes per station for a %u-byte object", (unsigned)state,
+           (unsigned)OBJECT_SIZE);
+  TEST_MESSAGE(line);
+  TEST_ASSERT_LESS_THAN(OBJECT_SIZE / 20, state);
+}
+
+// Lost blocks come back through the bitmap, each sent once more,
+// including the last block of the pass with its poll
+void test_lost_blocks_resent() {
+  const uint16_t lose[] = { 3, 17, 18, 100, 101, 250, BLOCKS - 1 };
+  for (size_t i = 0; i < sizeof(lose) / sizeof(lose[0]); i++) {
+    loseBlock(lose[i]);
+  }
+  offer();
+  uint32_t steps = run();
+  expectObjectDelivered();
+  TEST_ASSERT_EQUAL(sizeof(lose) / sizeof(lose[0]), sender::bulkGetStats().blocksResent);
+  TEST_ASSERT_EQUAL(0, receiver::bulkGetStats().blocksDuplicate);
+  report("7 lost", steps);
+}
+
+static bool receivedHalf() {
+  return receiver::bulkGetStats().rxReceived >= BLOCKS / 2;
+}
+
+// The receiver reboots mid-transfer and restores its last checkpoint:
+// only the blocks since then come again
+void test_resume_after_receiver_reboot() {
+  offer();
+  run(receivedHalf);
+  TEST_ASSERT_EQUAL(LORA_BULK_CHECKPOINT_SIZE, savedLen);
+  uint16_t had = receiver::bulkGetStats().rxReceived;
+  airCount = 0;
+  receiver::bulkBegin(SENDER_ID, receiverSend, receiverPhone, NULL);
+  receiver::bulkRestore(savedCheckpoint, savedLen, nowMs);
+  uint16_t restored = receiver::bulkGetStats().rxReceived;
+  TEST_ASSERT_GREATER_OR_EQUAL(BLOCKS / 2 - LORA_BULK_CHECKPOINT_BLOCKS, restored);
+
+  uint32_t steps = run();
+  expectObjectDelivered();
+  TEST_ASSERT_EQUAL(had - restored, sender::bulkGetStats().blocksResent);
+  TEST_ASSERT_EQUAL(0, receiver::bulkGetStats().blocksDuplicate);
+  report("receiver reboot", steps);
+}
+
+// The sending phone drops off BLE, the transfer stalls waiting for its
+// blocks, and the phone offers the object again when it is back
+void test_resume_after_ble_drop() {
+  offer();
+  run(receivedHalf);
+  senderConnected = false;
+  for (uint32_t t = 0; t < 2 * LORA_BULK_PHONE_TIMEOUT_MS; t += STEP_MS) {
+    step();
+  }
+  TEST_ASSERT_TRUE(sender::bulkIdle());
+  TEST_ASSERT_EQUAL(1, sender::bulkGetStats().stalls);
+
+  senderConnected = true;
+  needCount = 0;
+  offer();
+  uint32_t steps = run();
+  expectObjectDelivered();
+  TEST_ASSERT_EQUAL(1, sender::bulkGetStats().resumes);
+  TEST_ASSERT_GREATER_OR_EQUAL(BLOCKS / 2, sender::bulkGetStats().resumeSkipped);
+  TEST_ASSERT_EQUAL(0, receiver::bulkGetStats().blocksDuplicate);
+  report("BLE drop", steps);
+}
+
+// The sending station reboots: the phone offers again, and the
+// receiver's bitmap keeps the blocks it has from being sent twice
+void test_resume_after_sender_reboot() {
+  offer();
+  run(receivedHalf);
+  airCount = 0;
+  uint16_t had = receiver::bulkGetStats().rxReceived;
+  sender::bulkBegin(RECEIVER_ID, senderSend, senderPhone, NULL);
+  needCount = 0;
+  offer();
+  uint32_t steps = run();
+  expectObjectDelivered();
+  TEST_ASSERT_EQUAL(had, sender::bulkGetStats().resumeSkipped);
+  TEST_ASSERT_EQUAL(BLOCKS - had, sender::bulkGetStats().blocksSent);
+  report("sender reboot", steps);
+}
+
+// A block the phone side could neither deliver nor store is forgotten:
+// it is asked for again, and a checkpoint queued behind it is trimmed
+// so a reboot does not count it as received
+void test_forgotten_block() {
+  holdNotes = true;
+  failBlock = 5;
+  offer();
+  run([]() { return receiver::bulkGetStats().checkpoints >= 2; });
+  drainReceiverPhone();
+  holdNotes = false;
+  TEST_ASSERT_EQUAL(-1, failBlock);
+  TEST_ASSERT_EQUAL(LORA_BULK_CHECKPOINT_SIZE, savedLen);
+  TEST_ASSERT_EQUAL(5, get16(savedCheckpoint + 12));
+
+  // The receiver reboots onto the trimmed checkpoint
+  airCount = 0;
+  receiver::bulkBegin(SENDER_ID, receiverSend, receiverPhone, NULL);
+  receiver::bulkRestore(savedCheckpoint, savedLen, nowMs);
+  uint32_t steps = run();
+  expectObjectDelivered();
+  TEST_ASSERT_EQUAL(1, deliveries[5]);
+  report("forgotten block", steps);
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_clean_transfer);
+  RUN_TEST(test_lost_blocks_resent);
+  RUN_TEST(test_resume_after_receiver_reboot);
+  RUN_TEST(test_resume_after_ble_drop);
+  RUN_TEST(test_resume_after_sender_reboot);
+  RUN_TEST(test_forgotten_block);
+  return UNITY_END();
+}
@@ -0,0 +1,69 @@
+#include <unity.h>
+#include "lora_channels.h"
+#include "lora_frame.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Every station ID lands on a channel of the plan, and the IDs spread
+// evenly: no channel holds more than 10% over its share
+void test_home_channel_balance() {
+  uint32_t perChannel[LORA_CHANNEL_MAX] = {};
+  for (uint16_t id = 0; id < LORA_BROADCAST_ID; id++) {
+    uint8_t home = loraHomeChannel((uint8_t)id);
+    TEST_ASSERT_LESS_THAN(LORA_CHANNEL_COUNT, home);
+    perChannel[home]++;
+  }
+  uint32_t share = LORA_BROADCAST_ID / LORA_CHANNEL_COUNT;
+  for (uint8_t c = 0; c < LORA_CHANNEL_COUNT; c++) {
+    TEST_ASSERT_GREATER_OR_EQUAL(share - share / 10, perChannel[c]);
+    TEST_ASSERT_LESS_OR_EQUAL(share + share / 10, perChannel[c]);
+  }
+}
+
+// With the default plan consecutive IDs, and so each odd/even pair such
+// as M1 and M2, never share a receive channel; odd and even IDs alone
+// still cover every channel
+void test_consecutive_ids_spread() {
+#if LORA_CHANNEL_COUNT == 4
+  for (uint16_t id = 1; id < LORA_BROADCAST_ID - 1; id++) {
+    TEST_ASSERT_NOT_EQUAL(loraHomeChannel((uint8_t)id), loraHomeChannel((uint8_t)(id + 1)));
+  }
+#endif
+  uint8_t odd = 0, even = 0;
+  for (uint16_t id = 1; id < LORA_BROADCAST_ID; id++) {
+    (id & 1 ? odd : even) |= (uint8_t)(1u << loraHomeChannel((uint8_t)id));
+  }
+  TEST_ASSERT_EQUAL_HEX8(LORA_CHANNEL_ALL, odd);
+  TEST_ASSERT_EQUAL_HEX8(LORA_CHANNEL_ALL, even);
+}
+
+// A frame goes to its next hop's channel, to the destination's when it is
+// flooded, and is swept over every channel only when it is a broadcast
+void test_channel_mask() {
+  TEST_ASSERT_EQUAL_HEX8(LORA_CHANNEL_ALL, loraChannelMask(LORA_BROADCAST_ID, LORA_BROADCAST_ID));
+  for (uint16_t id = 0; id < LORA_BROADCAST_ID; id++) {
+    uint8_t home = (uint8_t)(1u << loraHomeChannel((uint8_t)id));
+    TEST_ASSERT_EQUAL_HEX8(home, loraChannelMask((uint8_t)id, 7));
+    TEST_ASSERT_EQUAL_HEX8(home, loraChannelMask((uint8_t)id, LORA_BROADCAST_ID));
+    TEST_ASSERT_EQUAL_HEX8(home, loraChannelMask(LORA_BROADCAST_ID, (uint8_t)id));
+  }
+}
+
+// Neighbouring channels do not overlap at the widest bandwidth (500 kHz)
+void test_plan_spacing() {
+  for (uint8_t c = 1; c < LORA_CHANNEL_MAX; c++) {
+    TEST_ASSERT_TRUE(LORA_CHANNEL_PLAN_MHZ[c] - LORA_CHANNEL_PLAN_MHZ[c - 1] >= 0.5f);
+  }
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_home_channel_balance);
+  RUN_TEST(test_consecutive_ids_spread);
+  RUN_TEST(test_channel_mask);
+  RUN_TEST(test_plan_spacing);
+  return UNITY_END();
+}
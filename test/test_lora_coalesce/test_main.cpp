@@ -0,0 +1,89 @@
+#include <unity.h>
+#include <string.h>
+#include "lora_coalesce.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const char* const MESSAGES[] = { "ok", "on my way", "", "meet at the north ridge camp", "x" };
+#define MESSAGE_COUNT (sizeof(MESSAGES) / sizeof(MESSAGES[0]))
+
+void test_pack_unpack() {
+  LoRaCoalescer batch;
+  batch.clear();
+  TEST_ASSERT_TRUE(batch.empty());
+  size_t expectedLen = 0;
+  for (size_t i = 0; i < MESSAGE_COUNT; i++) {
+    size_t n = strlen(MESSAGES[i]);
+    TEST_ASSERT_TRUE(batch.fits(n, LORA_COALESCE_BUDGET));
+    batch.add((const uint8_t*)MESSAGES[i], n);
+    expectedLen += LORA_COALESCE_RECORD_HDR + n;
+  }
+  TEST_ASSERT_EQUAL(MESSAGE_COUNT, batch.count);
+  TEST_ASSERT_EQUAL(expectedLen, batch.len);
+
+  size_t offset = 0;
+  const uint8_t* msg;
+  size_t msgLen;
+  for (size_t i = 0; i < MESSAGE_COUNT; i++) {
+    TEST_ASSERT_TRUE(loraCoalescedNext(batch.buf, batch.len, &offset, &msg, &msgLen));
+    TEST_ASSERT_EQUAL(strlen(MESSAGES[i]), msgLen);
+    TEST_ASSERT_EQUAL_MEMORY(MESSAGES[i], msg, msgLen);
+  }
+  TEST_ASSERT_FALSE(loraCoalescedNext(batch.buf, batch.len, &offset, &msg, &msgLen));
+  TEST_ASSERT_EQUAL(batch.len, offset);
+}
+
+void test_single_message_unwrapped() {
+  LoRaCoalescer batch;
+  batch.clear();
+  batch.add((const uint8_t*)"hello", 5);
+  size_t len;
+  const uint8_t* msg = batch.first(&len);
+  TEST_ASSERT_EQUAL(5, len);
+  TEST_ASSERT_EQUAL_MEMORY("hello", msg, 5);
+}
+
+// Records fill the budget exactly and never go past it
+void test_budget() {
+  uint8_t msg[LORA_FRAME_MAX_PAYLOAD] = {};
+  LoRaCoalescer batch;
+  batch.clear();
+  const size_t budget = 60;
+  TEST_ASSERT_TRUE(batch.fits(budget - LORA_COALESCE_RECORD_HDR, budget));
+  TEST_ASSERT_FALSE(batch.fits(budget, budget));
+  while (batch.fits(9, budget)) {
+    batch.add(msg, 9);
+  }
+  TEST_ASSERT_EQUAL(6, batch.count);
+  TEST_ASSERT_EQUAL(budget, batch.len);
+  TEST_ASSERT_FALSE(batch.fits(0, budget));
+
+  // The buffer caps a larger budget, and a record length is one byte
+  batch.clear();
+  TEST_ASSERT_FALSE(batch.fits(0x100, 1000));
+  TEST_ASSERT_FALSE(batch.fits(sizeof(batch.buf), 1000));
+  TEST_ASSERT_TRUE(batch.fits(sizeof(batch.buf) - LORA_COALESCE_RECORD_HDR, 1000));
+}
+
+void test_truncated_record() {
+  const uint8_t payload[] = { 2, 'o', 'k', 5, 'a', 'b' };
+  size_t offset = 0;
+  const uint8_t* msg;
+  size_t msgLen;
+  TEST_ASSERT_TRUE(loraCoalescedNext(payload, sizeof(payload), &offset, &msg, &msgLen));
+  TEST_ASSERT_EQUAL(2, msgLen);
+  TEST_ASSERT_FALSE(loraCoalescedNext(payload, sizeof(payload), &offset, &msg, &msgLen));
+  TEST_ASSERT_EQUAL(3, offset);
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_pack_unpack);
+  RUN_TEST(test_single_message_unwrapped);
+  RUN_TEST(test_budget);
+  RUN_TEST(test_truncated_record);
+  return UNITY_END();
+}
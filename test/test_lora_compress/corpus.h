@@ -0,0 +1,71 @@
+// Chat lines of the kind the stations carry: short messages between two
+// people out of phone range, with times, places, numbers and the odd typo.
+// Not tuned to the codebook; lines are kept once they are written.
+#ifndef TEST_CORPUS_H
+#define TEST_CORPUS_H
+
+static const char* const CORPUS[] = {
+  "ok",
+  "yes",
+  "on my way",
+  "where are you?",
+  "I'm at the hut, come over when you can",
+  "battery at 40%, switching the phone off until tonight",
+  "can you see the lake from where you are?",
+  "signal is bad here, will try again from the ridge",
+  "thanks! see you at the car park at 5",
+  "Did you get my last message?",
+  "no, nothing since 11:20",
+  "we are going down the north trail, it's faster",
+  "wait for me at the bridge please",
+  "how long until you get back?",
+  "about an hour, maybe less if the snow holds",
+  "The path is closed after the second lake, take the left one",
+  "all good here, just had lunch",
+  "bring water, the spring is dry",
+  "copy that",
+  "lol no",
+  "weather is turning, clouds coming in from the west",
+  "let's meet at the junction at 14:30",
+  "do you have the first aid kit?",
+  "yes it's in my bag",
+  "Tom is slow today, knee is bad again",
+  "we'll wait at the shelter",
+  "GPS 46.5197N 6.6323E",
+  "is the road open? someone said there was a slide",
+  "I think so, the bus went through this morning",
+  "happy birthday!! :)",
+  "can't talk now, call you later",
+  "going to sleep, wake me at 6",
+  "the stove is not working, do you have a spare lighter?",
+  "sorry, only matches",
+  "that will do",
+  "found the key, it was in the tent",
+  "great, we are leaving now",
+  "ETA 20 min",
+  "stuck behind a herd of cows haha",
+  "hey, are we still on for tomorrow?",
+  "sure, same time, same place",
+  "please tell Anna I'm fine",
+  "what time does the last cable car go down?",
+  "17:45 I think, check the sign at the top",
+  "the radio works really well from up here",
+  "test test 1 2 3",
+  "message received, over",
+  "snow up to the knees after 2400m",
+  "turn back if it gets worse, not worth it",
+  "agreed, we're turning around",
+  "good call. soup is ready when you get here",
+  "need anything from the village?",
+  "bread and cheese, and batteries for the headlamp",
+  "ok will get them",
+  "just saw a marmot!",
+  "I left the map at the hut, can you take a photo of yours?",
+  "no phone signal to send photos, I'll describe it",
+  "follow the red and white marks until the cairn, then go right",
+  "got it, thanks",
+  "home safe, good night everyone",
+};
+#define CORPUS_LINES (sizeof(CORPUS) / sizeof(CORPUS[0]))
+
+#endif // TEST_CORPUS_H
@@ -0,0 +1,174 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include "lora_compress.h"
+#include "corpus.h"
+
+#define BENCH_PASSES    2000
+#define CORPUS_MAX_RATIO 0.7    // Bytes sent / bytes written, over the corpus
+
+void setUp() {}
+void tearDown() {}
+
+static const char* const LINES[] = {
+  "ok",
+  "on my way, see you at the trailhead in ten minutes",
+  "Are you there? Nothing since this morning",
+  "thanks for letting me know, I'll bring the other radio",
+  "GPS 46.5197N 6.6323E alt 2310m",
+};
+#define LINE_COUNT (sizeof(LINES) / sizeof(LINES[0]))
+
+// Compresses and inflates, checking the result matches; returns the
+// compressed length, 0 if not compressed
+static size_t roundTrip(const uint8_t* in, size_t len, size_t capacity) {
+  uint8_t packed[2 * LORA_COMPRESS_MAX_MESSAGE + 8];
+  uint8_t out[LORA_COMPRESS_MAX_MESSAGE + LORA_COMPRESS_MAX_RUN];
+  size_t packedLen = loraCompress(in, len, packed, capacity);
+  if (packedLen == 0) {
+    return 0;
+  }
+  TEST_ASSERT_LESS_OR_EQUAL(capacity, packedLen);
+  size_t outLen = 0;
+  TEST_ASSERT_TRUE(loraDecompress(packed, packedLen, out, sizeof(out), &outLen));
+  TEST_ASSERT_EQUAL(len, outLen);
+  TEST_ASSERT_EQUAL_MEMORY(in, out, len);
+  return packedLen;
+}
+
+void test_chat_text_shrinks() {
+  size_t in = 0, out = 0;
+  for (size_t i = 0; i < LINE_COUNT; i++) {
+    size_t len = strlen(LINES[i]);
+    size_t packed = roundTrip((const uint8_t*)LINES[i], len, 2 * LORA_COMPRESS_MAX_MESSAGE);
+    TEST_ASSERT_NOT_EQUAL(0, packed);
+    in += len;
+    out += packed;
+  }
+  // Codebook hits pay for the escapes: the set as a whole gets shorter
+  TEST_ASSERT_LESS_THAN(in, out);
+}
+
+// Binary input, including the escape byte values themselves
+void test_binary_round_trip() {
+  uint8_t all[256];
+  for (size_t i = 0; i < sizeof(all); i++) {
+    all[i] = (uint8_t)(255 - i);
+  }
+  TEST_ASSERT_NOT_EQUAL(0, roundTrip(all, sizeof(all), 2 * LORA_COMPRESS_MAX_MESSAGE));
+
+  const uint8_t escapes[] = { LORA_COMPRESS_LITERAL, 'a', LORA_COMPRESS_RUN, LORA_COMPRESS_RUN, 0 };
+  TEST_ASSERT_NOT_EQUAL(0, roundTrip(escapes, sizeof(escapes), 2 * LORA_COMPRESS_MAX_MESSAGE));
+  TEST_ASSERT_NOT_EQUAL(0, roundTrip(escapes, 1, 2 * LORA_COMPRESS_MAX_MESSAGE));
+}
+
+// Literal runs longer than one run code can hold are split
+void test_long_literal_run() {
+  uint8_t noise[LORA_COMPRESS_MAX_RUN + 40];
+  for (size_t i = 0; i < sizeof(noise); i++) {
+    noise[i] = (uint8_t)(0x80 + (i * 7) % 0x70);
+  }
+  size_t packed = roundTrip(noise, sizeof(noise), 2 * LORA_COMPRESS_MAX_MESSAGE);
+  TEST_ASSERT_EQUAL(sizeof(noise) + 4, packed);
+}
+
+// The capacity the firmware passes (len - 1) keeps only real savings
+void test_capacity_limit() {
+  const uint8_t* text = (const uint8_t*)LINES[1];
+  size_t len = strlen(LINES[1]);
+  size_t packed = roundTrip(text, len, len - 1);
+  TEST_ASSERT_NOT_EQUAL(0, packed);
+  TEST_ASSERT_EQUAL(packed, roundTrip(text, len, packed));
+  TEST_ASSERT_EQUAL(0, roundTrip(text, len, packed - 1));
+
+  const uint8_t noise[] = { 0x81, 0x92, 0xA3, 0xB4 };
+  TEST_ASSERT_EQUAL(0, roundTrip(noise, sizeof(noise), sizeof(noise) - 1));
+}
+
+void test_malformed_input_rejected() {
+  uint8_t out[LORA_COMPRESS_MAX_RUN];
+  size_t outLen;
+  uint32_t errors = loraCompressGetStats().inflateErrors;
+
+  const uint8_t literalCut[] = { LORA_COMPRESS_LITERAL };
+  const uint8_t runNoLength[] = { LORA_COMPRESS_RUN };
+  const uint8_t runCut[] = { LORA_COMPRESS_RUN, 4, 'a', 'b' };
+  TEST_ASSERT_FALSE(loraDecompress(literalCut, sizeof(literalCut), out, sizeof(out), &outLen));
+  TEST_ASSERT_FALSE(loraDecompress(runNoLength, sizeof(runNoLength), out, sizeof(out), &outLen));
+  TEST_ASSERT_FALSE(loraDecompress(runCut, sizeof(runCut), out, sizeof(out), &outLen));
+
+  // More output than the buffer holds
+  uint8_t run[2 + LORA_COMPRESS_MAX_RUN];
+  run[0] = LORA_COMPRESS_RUN;
+  run[1] = LORA_COMPRESS_MAX_RUN - 1;
+  memset(run + 2, 'x', LORA_COMPRESS_MAX_RUN);
+  TEST_ASSERT_FALSE(loraDecompress(run, sizeof(run), out, LORA_COMPRESS_MAX_RUN - 1, &outLen));
+  TEST_ASSERT_TRUE(loraDecompress(run, sizeof(run), out, LORA_COMPRESS_MAX_RUN, &outLen));
+  TEST_ASSERT_EQUAL(LORA_COMPRESS_MAX_RUN, outLen);
+
+  TEST_ASSERT_EQUAL(errors + 4, loraCompressGetStats().inflateErrors);
+}
+
+// Ratio over the committed corpus as the firmware sends it (a line that
+// would not shrink goes as-is), and the coder's speed both ways
+void test_corpus_ratio_and_speed() {
+  static uint8_t packed[CORPUS_LINES][LORA_COMPRESS_MAX_MESSAGE];
+  static size_t packedLen[CORPUS_LINES];
+  size_t in = 0;
+  size_t sent = 0;
+  for (size_t i = 0; i < CORPUS_LINES; i++) {
+    size_t len = strlen(CORPUS[i]);
+    packedLen[i] = roundTrip((const uint8_t*)CORPUS[i], len, len - 1);
+    in += len;
+    sent += packedLen[i] != 0 ? packedLen[i] : len;
+  }
+  double ratio = (double)sent / in;
+  TEST_ASSERT_TRUE(ratio <= CORPUS_MAX_RATIO);
+
+  size_t sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t pass = 0; pass < BENCH_PASSES; pass++) {
+    for (size_t i = 0; i < CORPUS_LINES; i++) {
+      sink += loraCompress((const uint8_t*)CORPUS[i], strlen(CORPUS[i]), packed[i], sizeof(packed[i]));
+    }
+  }
+  double encodeNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+  uint8_t out[LORA_COMPRESS_MAX_MESSAGE];
+  start = std::chrono::steady_clock::now();
+  for (uint32_t pass = 0; pass < BENCH_PASSES; pass++) {
+    for (size_t i = 0; i < CORPUS_LINES; i++) {
+      size_t outLen = 0;
+      if (packedLen[i] != 0 && loraDecompress(packed[i], packedLen[i], out, sizeof(out), &outLen)) {
+        sink += outLen;
+      }
+    }
+  }
+  double decodeNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  TEST_ASSERT_NOT_EQUAL(0, sink);
+
+  size_t inflated = 0;
+  for (size_t i = 0; i < CORPUS_LINES; i++) {
+    inflated += packedLen[i] != 0 ? strlen(CORPUS[i]) : 0;
+  }
+  char line[160];
+  snprintf(line, sizeof(line), "%u lines, %u bytes: sent %u (ratio %.3f); encode %.1f ns/byte, decode %.1f ns/byte",
+           (unsigned)CORPUS_LINES, (unsigned)in, (unsigned)sent, ratio, encodeNs / BENCH_PASSES / in,
+           decodeNs / BENCH_PASSES / inflated);
+  TEST_MESSAGE(line);
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  loraCompressBegin();
+  UNITY_BEGIN();
+  RUN_TEST(test_chat_text_shrinks);
+  RUN_TEST(test_binary_round_trip);
+  RUN_TEST(test_long_literal_run);
+  RUN_TEST(test_capacity_limit);
+  RUN_TEST(test_malformed_input_rejected);
+  RUN_TEST(test_corpus_ratio_and_speed);
+  return UNITY_END();
+}
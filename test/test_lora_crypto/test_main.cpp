@@ -0,0 +1,160 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include "lora_crypto.h"
+#include "lora_frame.h"
+#include "lora_mesh.h"
+
+#define SEAL_OVERHEAD   (LORA_CRYPTO_EPOCH_SIZE + LORA_CRYPTO_TAG_SIZE)
+#define BENCH_FRAMES    20000
+
+struct SealedFrame {
+  uint8_t data[LORA_FRAME_MAX_SIZE];
+  size_t len;
+  size_t headerLen;
+  size_t bodyLen;
+};
+
+void setUp() {
+  TEST_ASSERT_TRUE(loraCryptoBegin(LORA_CRYPTO_DEFAULT_KEY));
+}
+void tearDown() {}
+
+// A routed frame from station 1 with bodyLen message bytes, sealed
+static void seal(SealedFrame& f, size_t bodyLen, uint16_t seq, uint16_t epoch) {
+  LoRaFrameHeader hdr = {};
+  hdr.version = LORA_FRAME_VERSION_SEALED;
+  hdr.type = FRAME_TYPE_DATA;
+  hdr.src = 1;
+  hdr.dst = 2;
+  hdr.seq = seq;
+  hdr.flags = FRAME_FLAG_MESH;
+  hdr.length = (uint8_t)(MESH_HEADER_SIZE + SEAL_OVERHEAD + bodyLen);
+  hdr.tsDelta = 1000;
+
+  uint8_t payload[LORA_FRAME_MAX_PAYLOAD];
+  LoRaMeshHeader mesh = { 1, 2, MESH_DEFAULT_TTL, 0 };
+  meshWriteHeader(payload, mesh);
+  for (size_t k = 0; k < bodyLen; k++) {
+    payload[MESH_HEADER_SIZE + LORA_CRYPTO_EPOCH_SIZE + k] = (uint8_t)k;
+  }
+  f.headerLen = loraFrameHeaderSize(hdr);
+  f.bodyLen = bodyLen;
+  f.len = loraFrameEncode(f.data, sizeof(f.data), hdr, payload);
+  TEST_ASSERT_NOT_EQUAL(0, f.len);
+  TEST_ASSERT_TRUE(loraCryptoSeal(f.data, f.headerLen, MESH_HEADER_SIZE, bodyLen, epoch));
+}
+
+static bool open(SealedFrame& f) {
+  return loraCryptoOpen(f.data, f.headerLen, MESH_HEADER_SIZE, f.bodyLen + SEAL_OVERHEAD);
+}
+
+static const uint8_t* body(const SealedFrame& f) {
+  return f.data + f.headerLen + MESH_HEADER_SIZE + LORA_CRYPTO_EPOCH_SIZE;
+}
+
+void test_round_trip() {
+  SealedFrame f;
+  seal(f, 40, 7, 3);
+  TEST_ASSERT_EQUAL_HEX8(3, f.data[f.headerLen + MESH_HEADER_SIZE]);
+  TEST_ASSERT_NOT_EQUAL(1, body(f)[1]);
+  TEST_ASSERT_TRUE(open(f));
+  for (size_t k = 0; k < f.bodyLen; k++) {
+    TEST_ASSERT_EQUAL_HEX8((uint8_t)k, body(f)[k]);
+  }
+
+  // An empty body is just the tag
+  seal(f, 0, 8, 3);
+  TEST_ASSERT_TRUE(open(f));
+}
+
+// Another epoch or sequence number is another nonce
+void test_nonce_changes_ciphertext() {
+  SealedFrame a, b, c;
+  seal(a, 32, 7, 3);
+  seal(b, 32, 7, 4);
+  seal(c, 32, 8, 3);
+  TEST_ASSERT_TRUE(memcmp(body(a), body(b), 32) != 0);
+  TEST_ASSERT_TRUE(memcmp(body(a), body(c), 32) != 0);
+}
+
+// Any change to the header, epoch, ciphertext or tag is refused; the
+// mesh header and sniff flag, which relays rewrite, are not covered
+void test_tampering_rejected() {
+  SealedFrame f;
+  seal(f, 24, 7, 3);
+  uint32_t rejected = loraCryptoGetStats().rejected;
+  size_t covered[] = { 1, 3, 4, f.headerLen - 1 };
+  for (size_t i = 0; i < sizeof(covered) / sizeof(covered[0]); i++) {
+    seal(f, 24, 7, 3);
+    f.data[covered[i]] ^= 0x01;
+    TEST_ASSERT_FALSE(open(f));
+  }
+  for (size_t off = f.headerLen + MESH_HEADER_SIZE; off < f.len; off++) {
+    seal(f, 24, 7, 3);
+    f.data[off] ^= 0x80;
+    TEST_ASSERT_FALSE(open(f));
+  }
+  TEST_ASSERT_EQUAL(rejected + 4 + SEAL_OVERHEAD + 24, loraCryptoGetStats().rejected);
+
+  seal(f, 24, 7, 3);
+  f.data[LORA_FRAME_FLAGS_OFFSET] |= FRAME_FLAG_SNIFF;
+  f.data[f.headerLen + MESH_HEADER_SIZE - 1] ^= 0xFF;
+  TEST_ASSERT_TRUE(open(f));
+
+  // Too short to hold epoch and tag
+  TEST_ASSERT_FALSE(loraCryptoOpen(f.data, f.headerLen, MESH_HEADER_SIZE, SEAL_OVERHEAD - 1));
+}
+
+void test_key_parsing() {
+  TEST_ASSERT_FALSE(loraCryptoBegin("0001"));
+  TEST_ASSERT_FALSE(loraCryptoBegin("000102030405060708090a0b0c0d0e0g"));
+  TEST_ASSERT_TRUE(loraCryptoBegin("000102030405060708090A0B0C0D0E0F"));
+
+  // A frame sealed under another key does not open
+  SealedFrame f;
+  seal(f, 16, 7, 3);
+  TEST_ASSERT_TRUE(loraCryptoBegin("0f0e0d0c0b0a09080706050403020100"));
+  TEST_ASSERT_FALSE(open(f));
+}
+
+// Cost of sealing and of opening a full-size frame
+void test_benchmark_seal_open() {
+  const size_t bodyLen = LORA_FRAME_MAX_PAYLOAD - MESH_HEADER_SIZE - SEAL_OVERHEAD;
+  SealedFrame f;
+  seal(f, bodyLen, 0, 1);
+  SealedFrame sealed = f;
+
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+    loraCryptoSeal(f.data, f.headerLen, MESH_HEADER_SIZE, bodyLen, 1);
+  }
+  double sealUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+  uint32_t opened = 0;
+  start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+    memcpy(f.data, sealed.data, sealed.len);
+    opened += open(f);
+  }
+  double openUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  TEST_ASSERT_EQUAL(BENCH_FRAMES, opened);
+
+  char line[96];
+  snprintf(line, sizeof(line), "%u-byte body: %.2f us per seal, %.2f us per open",
+           (unsigned)bodyLen, sealUs / BENCH_FRAMES, openUs / BENCH_FRAMES);
+  TEST_MESSAGE(line);
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_nonce_changes_ciphertext);
+  RUN_TEST(test_tampering_rejected);
+  RUN_TEST(test_key_parsing);
+  RUN_TEST(test_benchmark_seal_open);
+  return UNITY_END();
+}
@@ -0,0 +1,102 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include "lora_dedup.h"
+
+void setUp() {}
+void tearDown() {}
+
+#define SOURCES       8
+#define STREAM_IDS    200000
+
+// New frames dropped as duplicates, out of count unique IDs from SOURCES
+// stations, one every gapMs
+static uint32_t falseDrops(uint32_t count, uint32_t gapMs) {
+  loraDedupBegin(0);
+  uint32_t drops = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    if (loraDedupCheck((uint8_t)(1 + i % SOURCES), (uint16_t)(i / SOURCES), i * gapMs)) {
+      drops++;
+    }
+  }
+  return drops;
+}
+
+void test_exact_duplicates() {
+  loraDedupBegin(0);
+  uint32_t ringHits = loraDedupGetStats().ringHits;
+  TEST_ASSERT_FALSE(loraDedupCheck(1, 100, 0));
+  TEST_ASSERT_FALSE(loraDedupCheck(2, 100, 0));
+  TEST_ASSERT_TRUE(loraDedupCheck(1, 100, 10));
+  TEST_ASSERT_TRUE(loraDedupCheck(2, 100, 10));
+  TEST_ASSERT_EQUAL(ringHits + 2, loraDedupGetStats().ringHits);
+}
+
+// A repeat that has left the ring is still caught by the filters, until
+// its generations are retired
+void test_older_duplicate() {
+  loraDedupBegin(0);
+  uint32_t filterOnly = loraDedupGetStats().filterOnlyHits;
+  TEST_ASSERT_FALSE(loraDedupCheck(1, 7, 0));
+  for (uint16_t seq = 1000; seq < 1000 + 2 * LORA_DEDUP_RING_SIZE; seq++) {
+    loraDedupCheck(2, seq, 1);
+  }
+  TEST_ASSERT_TRUE(loraDedupCheck(1, 7, 2));
+  TEST_ASSERT_EQUAL(filterOnly + 1, loraDedupGetStats().filterOnlyHits);
+
+  // Two time-based rotations forget it
+  loraDedupCheck(3, 1, LORA_DEDUP_GENERATION_MS + 10);
+  loraDedupCheck(3, 2, 2 * LORA_DEDUP_GENERATION_MS + 20);
+  TEST_ASSERT_FALSE(loraDedupCheck(1, 7, 2 * LORA_DEDUP_GENERATION_MS + 30));
+}
+
+// While the ring covers both generations, a filter hit alone never drops
+// a frame: one frame a second stays below LORA_DEDUP_RING_SIZE
+void test_no_false_drops_at_low_rate() {
+  uint32_t misses = loraDedupGetStats().ringMisses;
+  TEST_ASSERT_EQUAL(0, falseDrops(20000, 1000));
+  TEST_ASSERT_GREATER_THAN(misses, loraDedupGetStats().ringMisses);
+}
+
+// Back-to-back frames fill generations by count. Drops stay under the
+// filter's own false-positive rate (the bound in lora_dedup.h).
+void test_false_drop_rate_at_high_rate() {
+  double fill = 1.0 - exp(-(double)LORA_DEDUP_HASHES * LORA_DEDUP_GENERATION_IDS / LORA_DEDUP_FILTER_BITS);
+  double bound = 2.0 * pow(fill, LORA_DEDUP_HASHES);
+  uint32_t drops = falseDrops(STREAM_IDS, 1);
+  double rate = (double)drops / STREAM_IDS;
+
+  char line[96];
+  snprintf(line, sizeof(line), "false drops %u of %u (%.3f%%), filter bound %.3f%%",
+           (unsigned)drops, (unsigned)STREAM_IDS, 100.0 * rate, 100.0 * bound);
+  TEST_MESSAGE(line);
+  TEST_ASSERT_TRUE(rate < bound);
+}
+
+// Cost of one check with the filters loaded, frames back to back
+void test_benchmark_check() {
+  loraDedupBegin(0);
+  auto start = std::chrono::steady_clock::now();
+  uint32_t dropped = 0;
+  for (uint32_t i = 0; i < STREAM_IDS; i++) {
+    dropped += loraDedupCheck((uint8_t)(1 + i % SOURCES), (uint16_t)(i / SOURCES), i);
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+  char line[64];
+  snprintf(line, sizeof(line), "%.1f ns per check (%u dropped)", ns / STREAM_IDS, (unsigned)dropped);
+  TEST_MESSAGE(line);
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_exact_duplicates);
+  RUN_TEST(test_older_duplicate);
+  RUN_TEST(test_no_false_drops_at_low_rate);
+  RUN_TEST(test_false_drop_rate_at_high_rate);
+  RUN_TEST(test_benchmark_check);
+  return UNITY_END();
+}
@@ -0,0 +1,216 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "lora_fec.h"
+#include "lora_fragment.h"
+
+#define CHUNK     40
+#define BENCH_GROUPS  2000
+
+static uint8_t msg[LORA_FRAG_MAX_FRAGMENTS * CHUNK];
+static uint8_t repairs[LORA_FEC_MAX_REPAIR][CHUNK];
+static uint8_t rows[LORA_FRAG_MAX_FRAGMENTS * CHUNK];
+
+void setUp() {
+  loraFecBegin();
+}
+void tearDown() {}
+
+static uint8_t repairsFor(uint8_t dataCount) {
+  uint8_t r = LORA_FRAG_MAX_FRAGMENTS - dataCount;
+  return r < LORA_FEC_MAX_REPAIR ? r : LORA_FEC_MAX_REPAIR;
+}
+
+// A random message of dataCount shards whose last shard is short, with
+// all the repair shards the group can carry
+static size_t encodeGroup(uint8_t dataCount) {
+  size_t len = (size_t)dataCount * CHUNK - (size_t)(rand() % CHUNK);
+  for (size_t k = 0; k < len; k++) {
+    msg[k] = (uint8_t)rand();
+  }
+  for (uint8_t j = 0; j < repairsFor(dataCount); j++) {
+    loraFecEncode(msg, len, dataCount, CHUNK, j, repairs[j]);
+  }
+  return len;
+}
+
+// Loses the data shards in lostMask, puts the repair shards listed in
+// useRepair in their rows, decodes and checks every byte of the message
+static void expectRebuilt(uint8_t dataCount, size_t len, uint32_t lostMask, const uint8_t* useRepair) {
+  uint8_t rowShard[LORA_FRAG_MAX_FRAGMENTS];
+  uint8_t next = 0;
+  memset(rows, 0, sizeof(rows));
+  for (uint8_t i = 0; i < dataCount; i++) {
+    uint8_t* row = rows + (size_t)i * CHUNK;
+    if (lostMask & (1u << i)) {
+      memcpy(row, repairs[useRepair[next]], CHUNK);
+      rowShard[i] = (uint8_t)(dataCount + useRepair[next++]);
+    } else {
+      size_t offset = (size_t)i * CHUNK;
+      memcpy(row, msg + offset, (len - offset < CHUNK) ? len - offset : CHUNK);
+      rowShard[i] = i;
+    }
+  }
+  TEST_ASSERT_TRUE(loraFecDecode(rows, dataCount, CHUNK, rowShard));
+  TEST_ASSERT_EQUAL_MEMORY(msg, rows, len);
+
+  // The padding of the last shard comes back as zeros
+  for (size_t k = len; k < (size_t)dataCount * CHUNK; k++) {
+    TEST_ASSERT_EQUAL_HEX8(0, rows[k]);
+  }
+}
+
+static uint8_t bitCount(uint32_t mask) {
+  uint8_t n = 0;
+  for (; mask != 0; mask &= mask - 1) {
+    n++;
+  }
+  return n;
+}
+
+// Every pattern of lost data shards the repairs can cover, for a group
+// with as many repairs as data shards
+void test_all_erasure_patterns() {
+  const uint8_t dataCount = LORA_FRAG_MAX_FRAGMENTS / 2;
+  srand(1);
+  size_t len = encodeGroup(dataCount);
+  uint8_t first[LORA_FEC_MAX_REPAIR];
+  uint8_t last[LORA_FEC_MAX_REPAIR];
+  for (uint8_t j = 0; j < LORA_FEC_MAX_REPAIR; j++) {
+    first[j] = j;
+    last[j] = (uint8_t)(repairsFor(dataCount) - 1 - j);
+  }
+  for (uint32_t lostMask = 0; lostMask < (1u << dataCount); lostMask++) {
+    if (bitCount(lostMask) <= repairsFor(dataCount)) {
+      expectRebuilt(dataCount, len, lostMask, first);
+      expectRebuilt(dataCount, len, lostMask, last);
+    }
+  }
+}
+
+// Random losses and random surviving repairs, for every group size
+void test_random_erasures() {
+  srand(2);
+  for (uint8_t dataCount = 1; dataCount < LORA_FRAG_MAX_FRAGMENTS; dataCount++) {
+    uint8_t r = repairsFor(dataCount);
+    for (uint16_t trial = 0; trial < 200; trial++) {
+      size_t len = encodeGroup(dataCount);
+      uint8_t lost = (uint8_t)(1 + rand() % (r < dataCount ? r : dataCount));
+      uint32_t lostMask = 0;
+      while (bitCount(lostMask) < lost) {
+        lostMask |= 1u << (rand() % dataCount);
+      }
+      uint8_t order[LORA_FEC_MAX_REPAIR];
+      for (uint8_t j = 0; j < r; j++) {
+        order[j] = j;
+      }
+      for (uint8_t j = r - 1; j > 0; j--) {
+        uint8_t k = (uint8_t)(rand() % (j + 1));
+        uint8_t t = order[j];
+        order[j] = order[k];
+        order[k] = t;
+      }
+      expectRebuilt(dataCount, len, lostMask, order);
+    }
+  }
+}
+
+void test_inconsistent_rows() {
+  uint8_t rowShard[4] = { 0, 1, 2, 3 };
+  TEST_ASSERT_TRUE(loraFecDecode(rows, 4, CHUNK, rowShard));
+
+  // The same repair standing in twice
+  rowShard[1] = 4;
+  rowShard[2] = 4;
+  TEST_ASSERT_FALSE(loraFecDecode(rows, 4, CHUNK, rowShard));
+
+  // A data shard in the wrong row, or a repair that does not exist
+  rowShard[2] = 3;
+  TEST_ASSERT_FALSE(loraFecDecode(rows, 4, CHUNK, rowShard));
+  rowShard[2] = 4 + LORA_FEC_MAX_REPAIR;
+  TEST_ASSERT_FALSE(loraFecDecode(rows, 4, CHUNK, rowShard));
+}
+
+void test_repair_count() {
+#if LORA_FEC_ENABLED
+  TEST_ASSERT_EQUAL(0, loraFecRepairCount(0));
+  TEST_ASSERT_EQUAL(LORA_FEC_MIN_REPAIR, loraFecRepairCount(1));
+  for (size_t k = 1; k < LORA_FRAG_MAX_FRAGMENTS; k++) {
+    uint8_t r = loraFecRepairCount(k);
+    TEST_ASSERT_GREATER_OR_EQUAL(LORA_FEC_MIN_REPAIR, r);
+    TEST_ASSERT_LESS_OR_EQUAL(LORA_FEC_MAX_REPAIR, r);
+    TEST_ASSERT_LESS_OR_EQUAL(LORA_FRAG_MAX_FRAGMENTS, k + r);
+  }
+  TEST_ASSERT_EQUAL(0, loraFecRepairCount(LORA_FRAG_MAX_FRAGMENTS));
+#else
+  for (size_t k = 0; k <= LORA_FRAG_MAX_FRAGMENTS; k++) {
+    TEST_ASSERT_EQUAL(0, loraFecRepairCount(k));
+  }
+#endif
+}
+
+// Time to compute the repairs of one group, and to rebuild it with as
+// many data shards lost as it has repairs, in full-size SF7 fragments
+void test_benchmark_group() {
+  static uint8_t big[LORA_FRAG_MAX_FRAGMENTS * 255];
+  static uint8_t bigRepairs[LORA_FEC_MAX_REPAIR][255];
+  static uint8_t bigRows[LORA_FRAG_MAX_FRAGMENTS * 255];
+  const size_t chunk = loraFragmentChunkForSF(7) - LORA_FEC_HEADER_SIZE;
+  const uint8_t sizes[] = { 4, 8, 12 };
+  srand(3);
+  for (size_t k = 0; k < sizeof(big); k++) {
+    big[k] = (uint8_t)rand();
+  }
+
+  for (uint8_t n = 0; n < sizeof(sizes); n++) {
+    uint8_t dataCount = sizes[n];
+    uint8_t r = (uint8_t)((dataCount * LORA_FEC_REPAIR_PCT + 99) / 100);
+    size_t len = (size_t)dataCount * chunk;
+    uint8_t rowShard[LORA_FRAG_MAX_FRAGMENTS];
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t g = 0; g < BENCH_GROUPS; g++) {
+      for (uint8_t j = 0; j < r; j++) {
+        loraFecEncode(big, len, dataCount, chunk, j, bigRepairs[j]);
+      }
+    }
+    double encodeNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    double decodeNs = 0;
+    for (uint32_t g = 0; g < BENCH_GROUPS; g++) {
+      memcpy(bigRows, big, len);
+      for (uint8_t i = 0; i < dataCount; i++) {
+        rowShard[i] = i;
+      }
+      // Lose every other data shard from the front
+      for (uint8_t j = 0; j < r; j++) {
+        memcpy(bigRows + (size_t)(2 * j) * chunk, bigRepairs[j], chunk);
+        rowShard[2 * j] = (uint8_t)(dataCount + j);
+      }
+      start = std::chrono::steady_clock::now();
+      TEST_ASSERT_TRUE(loraFecDecode(bigRows, dataCount, chunk, rowShard));
+      decodeNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+    TEST_ASSERT_EQUAL_MEMORY(big, bigRows, len);
+
+    char line[96];
+    snprintf(line, sizeof(line), "%2u+%u shards of %u bytes: encode %.1f us, decode %u lost %.1f us per group",
+             (unsigned)dataCount, (unsigned)r, (unsigned)chunk, encodeNs / BENCH_GROUPS / 1000,
+             (unsigned)r, decodeNs / BENCH_GROUPS / 1000);
+    TEST_MESSAGE(line);
+  }
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_all_erasure_patterns);
+  RUN_TEST(test_random_erasures);
+  RUN_TEST(test_inconsistent_rows);
+  RUN_TEST(test_repair_count);
+  RUN_TEST(test_benchmark_group);
+  return UNITY_END();
+}
@@ -0,0 +1,260 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lora_fec.h"
+#include "lora_fragment.h"
+
+#define CHUNK     40
+#define SRC       1
+
+static uint8_t msg[LORA_FRAG_MAX_MESSAGE];
+static uint32_t nowMs = 0;
+static size_t outLen;        // Length of the message a push completed
+
+// Every test starts past the timeout, so slots left by the last one
+// expire at its first push
+void setUp() {
+  loraFecBegin();
+  nowMs += LORA_REASM_TIMEOUT_MS + 1;
+}
+void tearDown() {}
+
+static void fill(size_t len, uint8_t seed) {
+  for (size_t k = 0; k < len; k++) {
+    msg[k] = (uint8_t)(seed + k * 7);
+  }
+}
+
+static LoRaFragmentHeader header(uint8_t msgId, uint8_t count) {
+  LoRaFragmentHeader hdr = {};
+  hdr.msgId = msgId;
+  hdr.count = count;
+  hdr.dataCount = count;
+  hdr.chunk = CHUNK;
+  return hdr;
+}
+
+// Fragment index of the len-byte message in msg, as a plain fragment
+static const uint8_t* push(uint8_t session, uint8_t msgId, size_t len, uint8_t index) {
+  LoRaFragmentHeader hdr = header(msgId, (uint8_t)loraFragmentCount(len, CHUNK));
+  hdr.index = index;
+  size_t offset = (size_t)index * CHUNK;
+  size_t take = (len - offset < CHUNK) ? len - offset : CHUNK;
+  return loraReassemblyPush(SRC, session, hdr, msg + offset, take, nowMs, &outLen);
+}
+
+// Fragment index of an FEC group of the message in msg with one repair
+static const uint8_t* pushFec(uint8_t session, uint8_t msgId, size_t len, uint8_t index) {
+  uint8_t dataCount = (uint8_t)loraFragmentCount(len, CHUNK);
+  LoRaFragmentHeader hdr = header(msgId, dataCount + 1);
+  hdr.dataCount = dataCount;
+  hdr.lastLen = (uint8_t)(len - (size_t)(dataCount - 1) * CHUNK);
+  hdr.index = index;
+  if (index == dataCount) {
+    uint8_t repair[CHUNK];
+    loraFecEncode(msg, len, dataCount, CHUNK, 0, repair);
+    return loraReassemblyPush(SRC, session, hdr, repair, CHUNK, nowMs, &outLen);
+  }
+  size_t take = (index + 1u == dataCount) ? hdr.lastLen : CHUNK;
+  return loraReassemblyPush(SRC, session, hdr, msg + (size_t)index * CHUNK, take, nowMs, &outLen);
+}
+
+static void expectMessage(const uint8_t* out, size_t len) {
+  TEST_ASSERT_NOT_NULL(out);
+  TEST_ASSERT_EQUAL(len, outLen);
+  TEST_ASSERT_EQUAL_MEMORY(msg, out, len);
+}
+
+void test_header_round_trip() {
+  LoRaFragmentHeader hdr = header(200, 12);
+  hdr.index = 11;
+  uint8_t buf[LORA_FRAG_FEC_HEADER_SIZE];
+  loraFragmentWriteHeader(buf, hdr);
+  LoRaFragmentHeader back;
+  TEST_ASSERT_TRUE(loraFragmentReadHeader(buf, LORA_FRAG_HEADER_SIZE, back));
+  TEST_ASSERT_EQUAL(200, back.msgId);
+  TEST_ASSERT_EQUAL(11, back.index);
+  TEST_ASSERT_EQUAL(12, back.count);
+  TEST_ASSERT_EQUAL(CHUNK, back.chunk);
+  TEST_ASSERT_FALSE(loraFragmentReadHeader(buf, LORA_FRAG_HEADER_SIZE - 1, back));
+
+  hdr.dataCount = 10;
+  hdr.lastLen = 9;
+  loraFragmentWriteFecHeader(buf, hdr);
+  TEST_ASSERT_TRUE(loraFragmentReadFecHeader(buf, sizeof(buf), back));
+  TEST_ASSERT_EQUAL(10, back.dataCount);
+  TEST_ASSERT_EQUAL(9, back.lastLen);
+}
+
+void test_malformed_headers_rejected() {
+  LoRaFragmentHeader hdr;
+  uint8_t zeroChunk[] = { 1, 0x01, 0 };
+  TEST_ASSERT_FALSE(loraFragmentReadHeader(zeroChunk, sizeof(zeroChunk), hdr));
+  uint8_t indexPastCount[] = { 1, 0x21, CHUNK };
+  TEST_ASSERT_FALSE(loraFragmentReadHeader(indexPastCount, sizeof(indexPastCount), hdr));
+
+  // More data fragments than the group, too many repairs, a last
+  // fragment longer than the chunk
+  uint8_t moreData[] = { 1, 0x01, CHUNK, 0x02, 5 };
+  TEST_ASSERT_FALSE(loraFragmentReadFecHeader(moreData, sizeof(moreData), hdr));
+  uint8_t repairs = LORA_FEC_MAX_REPAIR + 1;
+  uint8_t manyRepairs[] = { 1, (uint8_t)repairs, CHUNK, 0x00, 5 };
+  TEST_ASSERT_FALSE(loraFragmentReadFecHeader(manyRepairs, sizeof(manyRepairs), hdr));
+  uint8_t longLast[] = { 1, 0x02, CHUNK, 0x01, CHUNK + 1 };
+  TEST_ASSERT_FALSE(loraFragmentReadFecHeader(longLast, sizeof(longLast), hdr));
+}
+
+void test_out_of_order() {
+  const size_t len = 4 * CHUNK + 13;
+  fill(len, 1);
+  uint32_t reassembled = loraFragmentGetStats().messagesReassembled;
+  const uint8_t order[] = { 4, 2, 0, 3 };
+  for (size_t i = 0; i < sizeof(order); i++) {
+    TEST_ASSERT_NULL(push(LORA_FRAG_NO_SESSION, 10, len, order[i]));
+  }
+  expectMessage(push(LORA_FRAG_NO_SESSION, 10, len, 1), len);
+  TEST_ASSERT_EQUAL(reassembled + 1, loraFragmentGetStats().messagesReassembled);
+}
+
+// Without ARQ a repeated fragment is dropped, and the message still
+// completes once
+void test_duplicates_dropped() {
+  const size_t len = 3 * CHUNK;
+  fill(len, 2);
+  uint32_t dropped = loraFragmentGetStats().fragmentsDropped;
+  TEST_ASSERT_NULL(push(LORA_FRAG_NO_SESSION, 11, len, 0));
+  TEST_ASSERT_NULL(push(LORA_FRAG_NO_SESSION, 11, len, 0));
+  TEST_ASSERT_NULL(push(LORA_FRAG_NO_SESSION, 11, len, 1));
+  expectMessage(push(LORA_FRAG_NO_SESSION, 11, len, 2), len);
+  TEST_ASSERT_EQUAL(dropped + 1, loraFragmentGetStats().fragmentsDropped);
+}
+
+void test_timeout() {
+  const size_t len = 2 * CHUNK;
+  fill(len, 3);
+  uint32_t timedOut = loraFragmentGetStats().messagesTimedOut;
+  TEST_ASSERT_NULL(push(LORA_FRAG_NO_SESSION, 12, len, 0));
+
+  // The second half, too late: it starts over and waits for the first
+  nowMs += LORA_REASM_TIMEOUT_MS + 1;
+  TEST_ASSERT_NULL(push(LORA_FRAG_NO_SESSION, 12, len, 1));
+  TEST_ASSERT_EQUAL(timedOut + 1, loraFragmentGetStats().messagesTimedOut);
+  expectMessage(push(LORA_FRAG_NO_SESSION, 12, len, 0), len);
+}
+
+// With every slot busy the oldest message goes; the rest complete
+void test_eviction() {
+  const size_t len = 2 * CHUNK;
+  fill(len, 4);
+  uint32_t evicted = loraFragmentGetStats().messagesEvicted;
+  for (uint8_t id = 0; id <= LORA_REASM_SLOTS; id++) {
+    TEST_ASSERT_NULL(push(LORA_FRAG_NO_SESSION, (uint8_t)(20 + id), len, 0));
+    nowMs++;
+  }
+  TEST_ASSERT_EQUAL(evicted + 1, loraFragmentGetStats().messagesEvicted);
+
+  for (uint8_t id = 1; id <= LORA_REASM_SLOTS; id++) {
+    expectMessage(push(LORA_FRAG_NO_SESSION, (uint8_t)(20 + id), len, 1), len);
+  }
+  TEST_ASSERT_NULL(push(LORA_FRAG_NO_SESSION, 20, len, 1));
+}
+
+void test_bad_lengths_dropped() {
+  fill(LORA_FRAG_MAX_MESSAGE, 5);
+  uint32_t dropped = loraFragmentGetStats().fragmentsDropped;
+
+  // Past the per-message cap
+  LoRaFragmentHeader hdr = header(30, LORA_FRAG_MAX_FRAGMENTS);
+  hdr.chunk = 255;
+  hdr.index = LORA_FRAG_MAX_FRAGMENTS - 1;
+  TEST_ASSERT_NULL(loraReassemblyPush(SRC, LORA_FRAG_NO_SESSION, hdr, msg, 10, nowMs, &outLen));
+
+  // A middle fragment shorter than its chunk, a last one longer
+  hdr = header(31, 3);
+  hdr.index = 1;
+  TEST_ASSERT_NULL(loraReassemblyPush(SRC, LORA_FRAG_NO_SESSION, hdr, msg, CHUNK - 1, nowMs, &outLen));
+  hdr.index = 2;
+  TEST_ASSERT_NULL(loraReassemblyPush(SRC, LORA_FRAG_NO_SESSION, hdr, msg, CHUNK + 1, nowMs, &outLen));
+
+  // An FEC last fragment that disagrees with its header, a short repair
+  hdr.dataCount = 2;
+  hdr.lastLen = 10;
+  hdr.index = 1;
+  TEST_ASSERT_NULL(loraReassemblyPush(SRC, LORA_FRAG_NO_SESSION, hdr, msg, 11, nowMs, &outLen));
+  hdr.index = 2;
+  TEST_ASSERT_NULL(loraReassemblyPush(SRC, LORA_FRAG_NO_SESSION, hdr, msg, CHUNK - 1, nowMs, &outLen));
+  TEST_ASSERT_EQUAL(dropped + 5, loraFragmentGetStats().fragmentsDropped);
+}
+
+void test_fec_late_fragment_dropped() {
+  const size_t len = 2 * CHUNK + 7;
+  fill(len, 6);
+  uint32_t recovered = loraFragmentGetStats().fragmentsRecovered;
+  TEST_ASSERT_NULL(pushFec(LORA_FRAG_NO_SESSION, 40, len, 0));
+  TEST_ASSERT_NULL(pushFec(LORA_FRAG_NO_SESSION, 40, len, 3));
+  expectMessage(pushFec(LORA_FRAG_NO_SESSION, 40, len, 2), len);
+  TEST_ASSERT_EQUAL(recovered + 1, loraFragmentGetStats().fragmentsRecovered);
+
+  // The fragment the repair stood in for arrives after all
+  uint32_t dropped = loraFragmentGetStats().fragmentsDropped;
+  TEST_ASSERT_NULL(pushFec(LORA_FRAG_NO_SESSION, 40, len, 1));
+  TEST_ASSERT_EQUAL(dropped + 1, loraFragmentGetStats().fragmentsDropped);
+}
+
+// A sender that reboots, or wraps its IDs, sends a new message under an
+// ID still held in a slot: the new message arrives intact
+void test_id_reuse() {
+  const size_t len = 2 * CHUNK + 7;
+
+  // A decoded FEC group waiting for its last fragment, then the same
+  // shape of message under the same ID from the next boot
+  fill(len, 7);
+  TEST_ASSERT_NULL(pushFec(5, 50, len, 0));
+  TEST_ASSERT_NULL(pushFec(5, 50, len, 1));
+  expectMessage(pushFec(5, 50, len, 2), len);
+  fill(len, 8);
+  TEST_ASSERT_NULL(pushFec(6, 50, len, 0));
+  TEST_ASSERT_NULL(pushFec(6, 50, len, 1));
+  expectMessage(pushFec(6, 50, len, 2), len);
+
+  // The same within one boot, after the ID wrapped: ARQ let it through,
+  // so it is no late fragment
+  fill(len, 9);
+  TEST_ASSERT_NULL(pushFec(6, 50, len, 0));
+  TEST_ASSERT_NULL(pushFec(6, 50, len, 1));
+  expectMessage(pushFec(6, 50, len, 2), len);
+
+  // A partly received message, then a new one under its ID, from the
+  // next boot and from the same one: never a mix of the two
+  fill(len, 10);
+  TEST_ASSERT_NULL(push(6, 51, len, 0));
+  TEST_ASSERT_NULL(push(6, 51, len, 1));
+  fill(len, 11);
+  TEST_ASSERT_NULL(push(7, 51, len, 1));
+  TEST_ASSERT_NULL(push(7, 51, len, 0));
+  expectMessage(push(7, 51, len, 2), len);
+
+  fill(len, 12);
+  TEST_ASSERT_NULL(push(6, 51, len, 0));
+  TEST_ASSERT_NULL(push(6, 51, len, 1));
+  fill(len, 13);
+  TEST_ASSERT_NULL(push(6, 51, len, 1));
+  TEST_ASSERT_NULL(push(6, 51, len, 0));
+  expectMessage(push(6, 51, len, 2), len);
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_header_round_trip);
+  RUN_TEST(test_malformed_headers_rejected);
+  RUN_TEST(test_out_of_order);
+  RUN_TEST(test_duplicates_dropped);
+  RUN_TEST(test_timeout);
+  RUN_TEST(test_eviction);
+  RUN_TEST(test_bad_lengths_dropped);
+  RUN_TEST(test_fec_late_fragment_dropped);
+  RUN_TEST(test_id_reuse);
+  return UNITY_END();
+}
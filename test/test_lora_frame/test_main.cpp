@@ -0,0 +1,224 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include "lora_airtime.h"
+#include "lora_frame.h"
+
+#define BENCH_FRAMES    100000
+#define BENCH_PREAMBLE  8       // LORA_PREAMBLE_SYMBOLS
+
+void setUp() {}
+void tearDown() {}
+
+static LoRaFrameHeader header(uint32_t tsDelta, uint8_t length) {
+  LoRaFrameHeader hdr = {};
+  hdr.type = FRAME_TYPE_DATA;
+  hdr.src = 1;
+  hdr.dst = 2;
+  hdr.seq = 0xBEEF;
+  hdr.flags = FRAME_FLAG_RELIABLE | FRAME_FLAG_MESH;
+  hdr.length = length;
+  hdr.tsDelta = tsDelta;
+  return hdr;
+}
+
+// Every varint length, on both sides of each 7-bit boundary
+void test_varint_round_trip() {
+  static const uint32_t values[] = {
+    0, 1, 0x7F, 0x80, 0x3FFF, 0x4000, 0x1FFFFF, 0x200000, 0xFFFFFFF, 0x10000000, 0xFFFFFFFF
+  };
+  static const size_t sizes[] = { 1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5 };
+  const uint8_t payload[] = "hello";
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+    LoRaFrameHeader hdr = header(values[i], sizeof(payload));
+    TEST_ASSERT_EQUAL(LORA_FRAME_FIXED_SIZE + sizes[i], loraFrameHeaderSize(hdr));
+
+    uint8_t buf[LORA_FRAME_MAX_SIZE];
+    size_t len = loraFrameEncode(buf, sizeof(buf), hdr, payload);
+    TEST_ASSERT_EQUAL(LORA_FRAME_FIXED_SIZE + sizes[i] + sizeof(payload), len);
+
+    LoRaFrameHeader out;
+    const uint8_t* body = NULL;
+    TEST_ASSERT_TRUE(loraFrameDecode(buf, len, out, &body));
+    TEST_ASSERT_EQUAL_UINT32(values[i], out.tsDelta);
+    TEST_ASSERT_EQUAL(LORA_FRAME_VERSION, out.version);
+    TEST_ASSERT_EQUAL(FRAME_TYPE_DATA, out.type);
+    TEST_ASSERT_EQUAL(1, out.src);
+    TEST_ASSERT_EQUAL(2, out.dst);
+    TEST_ASSERT_EQUAL_HEX16(0xBEEF, out.seq);
+    TEST_ASSERT_EQUAL_HEX8(FRAME_FLAG_RELIABLE | FRAME_FLAG_MESH, out.flags);
+    TEST_ASSERT_EQUAL(sizeof(payload), out.length);
+    TEST_ASSERT_EQUAL_MEMORY(payload, body, sizeof(payload));
+  }
+}
+
+// The firmware writes the payload behind the header first, then encodes
+void test_in_place_payload() {
+  LoRaFrameHeader hdr = header(300, 4);
+  hdr.version = LORA_FRAME_VERSION_SEALED;
+  uint8_t buf[LORA_FRAME_MAX_SIZE];
+  uint8_t* body = buf + loraFrameHeaderSize(hdr);
+  memcpy(body, "\x01\x02\x03\x04", 4);
+  size_t len = loraFrameEncode(buf, sizeof(buf), hdr, body);
+  TEST_ASSERT_EQUAL(LORA_FRAME_FIXED_SIZE + 2 + 4, len);
+
+  LoRaFrameHeader out;
+  const uint8_t* payload = NULL;
+  TEST_ASSERT_TRUE(loraFrameDecode(buf, len, out, &payload));
+  TEST_ASSERT_EQUAL(LORA_FRAME_VERSION_SEALED, out.version);
+  TEST_ASSERT_EQUAL_UINT32(300, out.tsDelta);
+  TEST_ASSERT_EQUAL_MEMORY("\x01\x02\x03\x04", payload, 4);
+}
+
+void test_encode_rejects_oversize() {
+  uint8_t payload[LORA_FRAME_MAX_SIZE] = {};
+  uint8_t buf[LORA_FRAME_MAX_SIZE];
+  LoRaFrameHeader fits = header(0, LORA_FRAME_MAX_SIZE - LORA_FRAME_FIXED_SIZE - 1);
+  TEST_ASSERT_EQUAL(LORA_FRAME_MAX_SIZE, loraFrameEncode(buf, sizeof(buf), fits, payload));
+  LoRaFrameHeader tooLong = header(0x80, LORA_FRAME_MAX_SIZE - LORA_FRAME_FIXED_SIZE - 1);
+  TEST_ASSERT_EQUAL(0, loraFrameEncode(buf, sizeof(buf), tooLong, payload));
+  LoRaFrameHeader small = header(0, 10);
+  TEST_ASSERT_EQUAL(0, loraFrameEncode(buf, LORA_FRAME_FIXED_SIZE + 10, small, payload));
+}
+
+void test_decode_rejects_bad_frames() {
+  const uint8_t payload[] = "abc";
+  uint8_t buf[LORA_FRAME_MAX_SIZE];
+  LoRaFrameHeader hdr = header(0x12345, sizeof(payload));
+  size_t len = loraFrameEncode(buf, sizeof(buf), hdr, payload);
+  LoRaFrameHeader out;
+  const uint8_t* body;
+
+  // Every truncation fails: inside the fixed header, the varint or the payload
+  for (size_t cut = 0; cut < len; cut++) {
+    TEST_ASSERT_FALSE(loraFrameDecode(buf, cut, out, &body));
+  }
+
+  uint8_t bad[LORA_FRAME_MAX_SIZE];
+  memcpy(bad, buf, len);
+  bad[0] = (uint8_t)((7 << 4) | FRAME_TYPE_DATA);
+  TEST_ASSERT_FALSE(loraFrameDecode(bad, len, out, &body));
+
+  // A varint that never ends
+  memcpy(bad, buf, LORA_FRAME_FIXED_SIZE);
+  memset(bad + LORA_FRAME_FIXED_SIZE, 0xFF, 8);
+  TEST_ASSERT_FALSE(loraFrameDecode(bad, LORA_FRAME_FIXED_SIZE + 8, out, &body));
+}
+
+// The envelope this format replaced, as ArduinoJson wrote it into a
+// String: {"from":1,"to":2,"msg":"...","timestamp":<millis()>}. This
+// stand-in allocates and escapes the same way but skips ArduinoJson's
+// document pool, so it flatters the old path.
+static std::string jsonEncode(int from, int to, const char* msg, uint32_t timestamp) {
+  std::string out = "{\"from\":" + std::to_string(from) + ",\"to\":" + std::to_string(to) + ",\"msg\":\"";
+  for (const char* p = msg; *p; p++) {
+    if (*p == '"' || *p == '\\') {
+      out += '\\';
+    }
+    out += *p;
+  }
+  out += "\",\"timestamp\":" + std::to_string(timestamp) + "}";
+  return out;
+}
+
+static bool jsonDecode(const std::string& json, int* from, int* to, std::string* msg, uint32_t* timestamp) {
+  size_t f = json.find("\"from\":");
+  size_t t = json.find("\"to\":");
+  size_t m = json.find("\"msg\":\"");
+  size_t ts = json.find("\"timestamp\":");
+  if (f == std::string::npos || t == std::string::npos || m == std::string::npos || ts == std::string::npos) {
+    return false;
+  }
+  *from = atoi(json.c_str() + f + 7);
+  *to = atoi(json.c_str() + t + 5);
+  *timestamp = (uint32_t)strtoul(json.c_str() + ts + 12, NULL, 10);
+  msg->clear();
+  for (size_t i = m + 7; i < json.size() && json[i] != '"'; i++) {
+    if (json[i] == '\\' && i + 1 < json.size()) {
+      i++;
+    }
+    *msg += json[i];
+  }
+  return true;
+}
+
+// Bytes and time on air at SF7/125 kHz, and encode/decode cost, against
+// the JSON envelope for the same chat message
+void test_benchmark_against_json() {
+  static const char* const messages[] = {
+    "hello",
+    "on my way, see you at the north camp",
+    "weather is clear, wind low, battery good; meet at the ridge trail in ten minutes, copy?"
+  };
+  const uint32_t uptimeMs = 3600000;      // JSON carries millis(), the frame a delta
+  const uint32_t deltaMs = 1500;
+  for (const char* msg : messages) {
+    size_t msgLen = strlen(msg);
+    std::string json = jsonEncode(1, 2, msg, uptimeMs);
+    uint8_t buf[LORA_FRAME_MAX_SIZE];
+    LoRaFrameHeader hdr = header(deltaMs, (uint8_t)msgLen);
+    size_t frameLen = loraFrameEncode(buf, sizeof(buf), hdr, (const uint8_t*)msg);
+    TEST_ASSERT_EQUAL(LORA_FRAME_FIXED_SIZE + 2 + msgLen, frameLen);
+    TEST_ASSERT_LESS_THAN(json.size(), frameLen);
+
+    int from = 0;
+    int to = 0;
+    uint32_t timestamp = 0;
+    std::string text;
+    TEST_ASSERT_TRUE(jsonDecode(json, &from, &to, &text, &timestamp));
+    TEST_ASSERT_EQUAL_STRING(msg, text.c_str());
+    TEST_ASSERT_EQUAL_UINT32(uptimeMs, timestamp);
+
+    size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+      hdr.seq = (uint16_t)i;
+      sink += loraFrameEncode(buf, sizeof(buf), hdr, (const uint8_t*)msg);
+    }
+    double frameEncNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    LoRaFrameHeader out;
+    const uint8_t* body = NULL;
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+      buf[3] = (uint8_t)i;
+      sink += loraFrameDecode(buf, frameLen, out, &body) ? out.length : 0;
+    }
+    double frameDecNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+      sink += jsonEncode(1, 2, msg, uptimeMs + i).size();
+    }
+    double jsonEncNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+      json[json.size() - 2] = (char)('0' + i % 10);
+      sink += jsonDecode(json, &from, &to, &text, &timestamp) ? text.size() : 0;
+    }
+    double jsonDecNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    TEST_ASSERT_EQUAL(BENCH_FRAMES * (frameLen + json.size() + 2 * msgLen), sink);
+
+    char line[200];
+    snprintf(line, sizeof(line),
+             "%u-char message: frame %u bytes (%.1f ms on air), JSON %u bytes (%.1f ms); "
+             "encode %.0f vs %.0f ns, decode %.0f vs %.0f ns",
+             (unsigned)msgLen, (unsigned)frameLen, loraTimeOnAirUs(7, 125.0f, frameLen, BENCH_PREAMBLE) / 1e3,
+             (unsigned)json.size(), loraTimeOnAirUs(7, 125.0f, json.size(), BENCH_PREAMBLE) / 1e3,
+             frameEncNs / BENCH_FRAMES, jsonEncNs / BENCH_FRAMES, frameDecNs / BENCH_FRAMES, jsonDecNs / BENCH_FRAMES);
+    TEST_MESSAGE(line);
+  }
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_varint_round_trip);
+  RUN_TEST(test_in_place_payload);
+  RUN_TEST(test_encode_rejects_oversize);
+  RUN_TEST(test_decode_rejects_bad_frames);
+  RUN_TEST(test_benchmark_against_json);
+  return UNITY_END();
+}
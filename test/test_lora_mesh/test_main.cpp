@@ -0,0 +1,147 @@
+#include <unity.h>
+#include "lora_mesh.h"
+#include "lora_frame.h"
+
+#define ME  10
+
+void setUp() {
+  meshBegin(ME);
+}
+void tearDown() {}
+
+static LoRaMeshHeader heard(uint8_t prevHop, uint8_t hops) {
+  LoRaMeshHeader hdr = {};
+  hdr.prevHop = prevHop;
+  hdr.nextHop = LORA_BROADCAST_ID;
+  hdr.ttl = MESH_DEFAULT_TTL;
+  hdr.hops = hops;
+  return hdr;
+}
+
+void test_header_round_trip() {
+  LoRaMeshHeader hdr = { 3, 4, MESH_MAX_TTL, 9 };
+  uint8_t buf[MESH_HEADER_SIZE];
+  meshWriteHeader(buf, hdr);
+  LoRaMeshHeader out;
+  TEST_ASSERT_TRUE(meshReadHeader(buf, sizeof(buf), out));
+  TEST_ASSERT_EQUAL(3, out.prevHop);
+  TEST_ASSERT_EQUAL(4, out.nextHop);
+  TEST_ASSERT_EQUAL(MESH_MAX_TTL, out.ttl);
+  TEST_ASSERT_EQUAL(9, out.hops);
+  TEST_ASSERT_FALSE(meshReadHeader(buf, MESH_HEADER_SIZE - 1, out));
+}
+
+// A relayed frame teaches the route to its origin and to the relay
+void test_learn_from_relayed_frame() {
+  TEST_ASSERT_EQUAL(LORA_BROADCAST_ID, meshNextHop(1, 0));
+  meshLearn(1, heard(2, 1), 0);
+  TEST_ASSERT_EQUAL(2, meshNextHop(1, 0));
+  TEST_ASSERT_EQUAL(2, meshNextHop(2, 0));
+  TEST_ASSERT_EQUAL(2, meshRouteCount(0));
+
+  // Never a route to ourselves or to the broadcast address
+  meshLearn(ME, heard(2, 0), 0);
+  meshLearn(LORA_BROADCAST_ID, heard(2, 0), 0);
+  TEST_ASSERT_EQUAL(2, meshRouteCount(0));
+}
+
+// While a route is fresh only a strictly shorter path replaces it; the
+// same next hop refreshes it at any cost
+void test_route_preference() {
+  meshLearn(1, heard(2, 2), 0);
+  meshLearn(1, heard(3, 2), 100);
+  TEST_ASSERT_EQUAL(2, meshNextHop(1, 100));
+  meshLearn(1, heard(3, 1), 200);
+  TEST_ASSERT_EQUAL(3, meshNextHop(1, 200));
+  meshLearn(1, heard(1, 0), 300);
+  TEST_ASSERT_EQUAL(1, meshNextHop(1, 300));
+
+  // Heard directly (cost 1): a relay path at cost 1 is not shorter
+  meshLearn(1, heard(4, 0), 400);
+  TEST_ASSERT_EQUAL(1, meshNextHop(1, 400));
+}
+
+void test_route_expiry() {
+  meshLearn(1, heard(2, 1), 0);
+  TEST_ASSERT_EQUAL(2, meshNextHop(1, MESH_ROUTE_TIMEOUT_MS));
+  TEST_ASSERT_EQUAL(LORA_BROADCAST_ID, meshNextHop(1, MESH_ROUTE_TIMEOUT_MS + 1));
+  TEST_ASSERT_EQUAL(0, meshRouteCount(MESH_ROUTE_TIMEOUT_MS + 1));
+
+  // Once expired, a longer path is taken
+  meshLearn(1, heard(5, 3), MESH_ROUTE_TIMEOUT_MS + 2);
+  TEST_ASSERT_EQUAL(5, meshNextHop(1, MESH_ROUTE_TIMEOUT_MS + 2));
+
+  meshForgetRoute(1);
+  TEST_ASSERT_EQUAL(LORA_BROADCAST_ID, meshNextHop(1, MESH_ROUTE_TIMEOUT_MS + 2));
+}
+
+// A full table gives up the least recently refreshed route
+void test_eviction() {
+  uint32_t evicted = meshGetStats().routesEvicted;
+  for (uint8_t i = 0; i < MESH_ROUTE_SLOTS; i++) {
+    meshLearn(20 + i, heard(20 + i, 0), i);
+  }
+  TEST_ASSERT_EQUAL(MESH_ROUTE_SLOTS, meshRouteCount(100));
+  meshLearn(20, heard(20, 0), 100);
+  meshLearn(50, heard(50, 0), 101);
+  TEST_ASSERT_EQUAL(evicted + 1, meshGetStats().routesEvicted);
+  TEST_ASSERT_EQUAL(50, meshNextHop(50, 101));
+  TEST_ASSERT_EQUAL(20, meshNextHop(20, 101));
+  TEST_ASSERT_EQUAL(LORA_BROADCAST_ID, meshNextHop(21, 101));
+}
+
+void test_classify_and_relay() {
+  LoRaMeshHeader hdr = heard(2, 0);
+  TEST_ASSERT_EQUAL(MESH_DELIVER, meshClassify(ME, hdr));
+  TEST_ASSERT_EQUAL(MESH_DELIVER_AND_RELAY, meshClassify(LORA_BROADCAST_ID, hdr));
+  TEST_ASSERT_EQUAL(MESH_RELAY, meshClassify(7, hdr));
+
+  // Another relay's job, or nothing left to spend
+  hdr.nextHop = 3;
+  TEST_ASSERT_EQUAL(MESH_IGNORE, meshClassify(7, hdr));
+  hdr.nextHop = ME;
+  hdr.ttl = 0;
+  TEST_ASSERT_EQUAL(MESH_IGNORE, meshClassify(7, hdr));
+  TEST_ASSERT_EQUAL(MESH_DELIVER, meshClassify(LORA_BROADCAST_ID, hdr));
+
+  // Relayed toward the learned next hop, or flooded without one
+  meshLearn(7, heard(8, 1), 0);
+  hdr = heard(2, 0);
+  meshPrepareRelay(7, hdr, 0);
+  TEST_ASSERT_EQUAL(ME, hdr.prevHop);
+  TEST_ASSERT_EQUAL(8, hdr.nextHop);
+  TEST_ASSERT_EQUAL(MESH_DEFAULT_TTL - 1, hdr.ttl);
+  TEST_ASSERT_EQUAL(1, hdr.hops);
+  uint32_t flooded = meshGetStats().flooded;
+  hdr = heard(2, 0);
+  meshPrepareRelay(9, hdr, 0);
+  TEST_ASSERT_EQUAL(LORA_BROADCAST_ID, hdr.nextHop);
+  TEST_ASSERT_EQUAL(flooded + 1, meshGetStats().flooded);
+}
+
+void test_sniffing_neighbours() {
+  TEST_ASSERT_FALSE(meshNeighbourSniffs(LORA_BROADCAST_ID));
+  meshNoteNeighbour(40, true);
+  meshNoteNeighbour(40, true);
+  TEST_ASSERT_TRUE(meshNeighbourSniffs(40));
+  TEST_ASSERT_FALSE(meshNeighbourSniffs(41));
+  TEST_ASSERT_TRUE(meshNeighbourSniffs(LORA_BROADCAST_ID));
+  TEST_ASSERT_EQUAL(1, meshSniffingNeighbours());
+  meshNoteNeighbour(40, false);
+  TEST_ASSERT_EQUAL(0, meshSniffingNeighbours());
+  TEST_ASSERT_FALSE(meshNeighbourSniffs(LORA_BROADCAST_ID));
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_header_round_trip);
+  RUN_TEST(test_learn_from_relayed_frame);
+  RUN_TEST(test_route_preference);
+  RUN_TEST(test_route_expiry);
+  RUN_TEST(test_eviction);
+  RUN_TEST(test_classify_and_relay);
+  RUN_TEST(test_sniffing_neighbours);
+  return UNITY_END();
+}
@@ -0,0 +1,174 @@
+#include <unity.h>
+#include <string.h>
+#include "msg_store.h"
+
+#define SECTORS       4
+#define MESSAGE_LEN   200     // 19 records to a sector
+
+static uint8_t mem[SECTORS * MSG_STORE_SECTOR_SIZE];
+
+void setUp() {}
+void tearDown() {}
+
+static void blank() {
+  memset(mem, 0xFF, sizeof(mem));
+  TEST_ASSERT_TRUE(msgStoreBegin(msgStoreRamBackend(mem, sizeof(mem))));
+}
+
+static void reboot() {
+  TEST_ASSERT_TRUE(msgStoreBegin(msgStoreRamBackend(mem, sizeof(mem))));
+}
+
+static uint32_t append(uint8_t kind, uint16_t tag) {
+  uint8_t msg[MESSAGE_LEN];
+  memset(msg, (uint8_t)tag, sizeof(msg));
+  return msgStoreAppend(kind, msg, sizeof(msg), tag);
+}
+
+// The i-th pending message carries the expected tag, and its body was
+// written for that tag
+static void expectPending(uint8_t kind, size_t i, uint16_t tag) {
+  uint8_t buf[MESSAGE_LEN];
+  size_t len = 0;
+  uint16_t got = 0;
+  TEST_ASSERT_NOT_EQUAL(MSG_STORE_NONE, msgStoreGet(kind, i, buf, sizeof(buf), &len, &got));
+  TEST_ASSERT_EQUAL(tag, got);
+  TEST_ASSERT_EQUAL(MESSAGE_LEN, len);
+  TEST_ASSERT_EQUAL_HEX8((uint8_t)tag, buf[0]);
+  TEST_ASSERT_EQUAL_HEX8((uint8_t)tag, buf[MESSAGE_LEN - 1]);
+}
+
+void test_append_and_retire() {
+  blank();
+  uint32_t first = append(MSG_STORE_INBOUND, 1);
+  append(MSG_STORE_OUTBOUND, 2);
+  append(MSG_STORE_OUTBOUND, 3);
+  TEST_ASSERT_EQUAL(1, msgStorePending(MSG_STORE_INBOUND));
+  TEST_ASSERT_EQUAL(2, msgStorePending(MSG_STORE_OUTBOUND));
+  expectPending(MSG_STORE_OUTBOUND, 1, 3);
+
+  TEST_ASSERT_TRUE(msgStoreRetireTag(MSG_STORE_OUTBOUND, 2));
+  TEST_ASSERT_FALSE(msgStoreRetireTag(MSG_STORE_OUTBOUND, 2));
+  TEST_ASSERT_FALSE(msgStoreRetireTag(MSG_STORE_INBOUND, 3));
+  msgStoreRetire(first);
+  TEST_ASSERT_EQUAL(0, msgStorePending(MSG_STORE_INBOUND));
+  expectPending(MSG_STORE_OUTBOUND, 0, 3);
+  TEST_ASSERT_EQUAL(2, msgStoreGetStats().retired);
+}
+
+// After a reboot exactly the pending records come back, oldest first
+void test_replay_after_reboot() {
+  blank();
+  for (uint16_t tag = 0; tag < 30; tag++) {
+    append(MSG_STORE_OUTBOUND, tag);
+  }
+  for (uint16_t tag = 0; tag < 30; tag += 3) {
+    TEST_ASSERT_TRUE(msgStoreRetireTag(MSG_STORE_OUTBOUND, tag));
+  }
+  reboot();
+  TEST_ASSERT_EQUAL(20, msgStoreGetStats().recovered);
+  TEST_ASSERT_EQUAL(20, msgStorePending(MSG_STORE_OUTBOUND));
+  size_t i = 0;
+  for (uint16_t tag = 0; tag < 30; tag++) {
+    if (tag % 3 != 0) {
+      expectPending(MSG_STORE_OUTBOUND, i++, tag);
+    }
+  }
+
+  // Appending carries on behind them
+  append(MSG_STORE_OUTBOUND, 30);
+  reboot();
+  expectPending(MSG_STORE_OUTBOUND, 20, 30);
+}
+
+// Wrapping into a sector drops what it still holds; what is left is the
+// newest records, in order, before and after a reboot
+void test_wrap_drops_oldest() {
+  blank();
+  const uint16_t count = 5 * SECTORS * MSG_STORE_SECTOR_SIZE / MESSAGE_LEN / 2;
+  for (uint16_t tag = 0; tag < count; tag++) {
+    TEST_ASSERT_NOT_EQUAL(MSG_STORE_NONE, append(MSG_STORE_INBOUND, tag));
+  }
+  const MsgStoreStats& stats = msgStoreGetStats();
+  size_t pending = msgStorePending(MSG_STORE_INBOUND);
+  TEST_ASSERT_GREATER_THAN(0, stats.lost);
+  TEST_ASSERT_EQUAL(count, pending + stats.lost);
+  TEST_ASSERT_LESS_THAN(SECTORS * MSG_STORE_SECTOR_SIZE / MESSAGE_LEN, pending);
+  for (size_t i = 0; i < pending; i++) {
+    expectPending(MSG_STORE_INBOUND, i, (uint16_t)(count - pending + i));
+  }
+
+  reboot();
+  TEST_ASSERT_EQUAL(pending, msgStorePending(MSG_STORE_INBOUND));
+  TEST_ASSERT_EQUAL(0, msgStoreGetStats().corrupt);
+  for (size_t i = 0; i < pending; i++) {
+    expectPending(MSG_STORE_INBOUND, i, (uint16_t)(count - pending + i));
+  }
+}
+
+// A record torn by a reset is skipped, the ones before it survive, and
+// appending moves on to a fresh sector
+void test_torn_record() {
+  blank();
+  append(MSG_STORE_OUTBOUND, 1);
+  uint32_t torn = append(MSG_STORE_OUTBOUND, 2);
+  mem[torn + 20] = 0x00;
+  reboot();
+  TEST_ASSERT_EQUAL(1, msgStoreGetStats().corrupt);
+  TEST_ASSERT_EQUAL(1, msgStorePending(MSG_STORE_OUTBOUND));
+  expectPending(MSG_STORE_OUTBOUND, 0, 1);
+
+  uint32_t next = append(MSG_STORE_OUTBOUND, 3);
+  TEST_ASSERT_EQUAL(torn / MSG_STORE_SECTOR_SIZE + 1, next / MSG_STORE_SECTOR_SIZE);
+  reboot();
+  TEST_ASSERT_EQUAL(2, msgStorePending(MSG_STORE_OUTBOUND));
+  expectPending(MSG_STORE_OUTBOUND, 1, 3);
+}
+
+// Maintenance erases the next sector once the head is half full, so the
+// append that crosses into it does not erase
+void test_maintain_erases_ahead() {
+  blank();
+  uint16_t tag = 0;
+  msgStoreMaintain();
+  uint32_t erases = msgStoreGetStats().erases;
+  TEST_ASSERT_EQUAL(1, erases);
+  while (append(MSG_STORE_INBOUND, tag) / MSG_STORE_SECTOR_SIZE == 0 && tag < 100) {
+    tag++;
+    msgStoreMaintain();
+  }
+  TEST_ASSERT_EQUAL(erases + 1, msgStoreGetStats().erases);
+  TEST_ASSERT_EQUAL(tag + 1, msgStorePending(MSG_STORE_INBOUND));
+}
+
+// A full index gives up the oldest pending message
+void test_full_index() {
+  static uint8_t big[(MSG_STORE_INDEX_SIZE / 16 + 2) * MSG_STORE_SECTOR_SIZE];
+  memset(big, 0xFF, sizeof(big));
+  TEST_ASSERT_TRUE(msgStoreBegin(msgStoreRamBackend(big, sizeof(big))));
+  uint8_t msg[8] = {};
+  for (uint16_t tag = 0; tag <= MSG_STORE_INDEX_SIZE; tag++) {
+    msgStoreAppend(MSG_STORE_OUTBOUND, msg, sizeof(msg), tag);
+  }
+  TEST_ASSERT_EQUAL(MSG_STORE_INDEX_SIZE, msgStorePending(MSG_STORE_OUTBOUND));
+  TEST_ASSERT_EQUAL(1, msgStoreGetStats().lost);
+  TEST_ASSERT_FALSE(msgStoreRetireTag(MSG_STORE_OUTBOUND, 0));
+  TEST_ASSERT_TRUE(msgStoreRetireTag(MSG_STORE_OUTBOUND, 1));
+
+  // The dropped record is retired in flash too
+  TEST_ASSERT_TRUE(msgStoreBegin(msgStoreRamBackend(big, sizeof(big))));
+  TEST_ASSERT_EQUAL(MSG_STORE_INDEX_SIZE - 1, msgStorePending(MSG_STORE_OUTBOUND));
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_append_and_retire);
+  RUN_TEST(test_replay_after_reboot);
+  RUN_TEST(test_wrap_drops_oldest);
+  RUN_TEST(test_torn_record);
+  RUN_TEST(test_maintain_erases_ahead);
+  RUN_TEST(test_full_index);
+  return UNITY_END();
+}
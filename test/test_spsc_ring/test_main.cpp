@@ -0,0 +1,201 @@
+#include <unity.h>
+#include <string.h>
+#include <thread>
+#include "spsc_ring.h"
+
+#define STRESS_RING     1024
+#define STRESS_RECORDS  100000
+#define MAX_RECORD      200
+
+void setUp() {}
+void tearDown() {}
+
+// Record seq: its length, type and flags, and every payload byte follow
+// from the number, so the consumer can check it without a copy
+static size_t lengthFor(uint32_t seq) {
+  return 4 + (seq * 37) % (MAX_RECORD - 4);
+}
+
+static uint8_t byteFor(uint32_t seq, size_t k) {
+  return (uint8_t)(seq * 7 + k);
+}
+
+template <uint32_t N>
+static bool produce(SpscRing<N>& ring, uint32_t seq) {
+  size_t len = lengthFor(seq);
+  uint8_t* p = ring.claim(len);
+  if (p == NULL) {
+    return false;
+  }
+  memcpy(p, &seq, sizeof(seq));
+  for (size_t k = sizeof(seq); k < len; k++) {
+    p[k] = byteFor(seq, k);
+  }
+  ring.commit(len, (uint8_t)seq, (uint8_t)(seq >> 8));
+  return true;
+}
+
+// Takes the next record if there is one; counts it as bad unless it is
+// record *expected, whole
+template <uint32_t N>
+static bool consume(SpscRing<N>& ring, uint32_t* expected, uint32_t* bad) {
+  size_t len;
+  uint8_t type, flags;
+  const uint8_t* p = ring.peek(&len, &type, &flags);
+  if (p == NULL) {
+    return false;
+  }
+  uint32_t seq;
+  memcpy(&seq, p, sizeof(seq));
+  bool ok = seq == *expected && len == lengthFor(seq) && type == (uint8_t)seq && flags == (uint8_t)(seq >> 8);
+  for (size_t k = sizeof(seq); ok && k < len; k++) {
+    ok = p[k] == byteFor(seq, k);
+  }
+  if (!ok) {
+    (*bad)++;
+  }
+  ring.release();
+  (*expected)++;
+  return true;
+}
+
+void test_records_in_order() {
+  static SpscRing<1024> ring;
+  uint32_t expected = 0, bad = 0;
+  TEST_ASSERT_TRUE(ring.empty());
+  TEST_ASSERT_FALSE(consume(ring, &expected, &bad));
+  for (uint32_t seq = 0; seq < 3; seq++) {
+    TEST_ASSERT_TRUE(produce(ring, seq));
+  }
+  TEST_ASSERT_FALSE(ring.empty());
+  while (consume(ring, &expected, &bad)) {
+  }
+  TEST_ASSERT_EQUAL(3, expected);
+  TEST_ASSERT_EQUAL(0, bad);
+  TEST_ASSERT_TRUE(ring.empty());
+}
+
+// A record that does not fit before the end goes to the start, behind a
+// wrap marker the consumer steps over
+void test_wrap_to_start() {
+  static SpscRing<1024> ring;
+  uint32_t expected = 0, bad = 0;
+  uint32_t seq = 0;
+  for (int round = 0; round < 50; round++) {
+    TEST_ASSERT_TRUE(produce(ring, seq++));
+    TEST_ASSERT_TRUE(consume(ring, &expected, &bad));
+  }
+  TEST_ASSERT_EQUAL(seq, expected);
+  TEST_ASSERT_EQUAL(0, bad);
+  TEST_ASSERT_EQUAL(0, ring.dropCount());
+}
+
+// A full ring refuses the claim and counts it, and takes records again
+// once the consumer has emptied it
+void test_full_ring_drops() {
+  static SpscRing<1024> ring;
+  uint32_t seq = 0;
+  while (produce(ring, seq)) {
+    seq++;
+  }
+  TEST_ASSERT_EQUAL(1, ring.dropCount());
+  TEST_ASSERT_LESS_OR_EQUAL(1024, ring.highWaterBytes());
+  TEST_ASSERT_NULL(ring.claim(SPSC_WRAP_MARKER));
+  TEST_ASSERT_EQUAL(2, ring.dropCount());
+
+  uint32_t expected = 0, bad = 0;
+  while (consume(ring, &expected, &bad)) {
+  }
+  TEST_ASSERT_EQUAL(seq, expected);
+  TEST_ASSERT_TRUE(produce(ring, seq));
+  TEST_ASSERT_TRUE(consume(ring, &expected, &bad));
+  TEST_ASSERT_EQUAL(0, bad);
+  TEST_ASSERT_TRUE(ring.empty());
+}
+
+// hasRoom() answers as claim() would, padding for the wrap included,
+// and never counts a drop
+void test_has_room() {
+  static SpscRing<64> ring;
+  uint8_t type, flags;
+  size_t len;
+  TEST_ASSERT_TRUE(ring.hasRoom(60));
+  TEST_ASSERT_FALSE(ring.hasRoom(61));
+
+  ring.claim(28);
+  ring.commit(28, 0, 0);
+  TEST_ASSERT_TRUE(ring.hasRoom(28));
+  TEST_ASSERT_FALSE(ring.hasRoom(29));
+
+  // Empty again, but a record past the end has to start over at 0
+  TEST_ASSERT_NOT_NULL(ring.peek(&len, &type, &flags));
+  ring.release();
+  TEST_ASSERT_FALSE(ring.hasRoom(60));
+  TEST_ASSERT_TRUE(ring.hasRoom(28));
+  TEST_ASSERT_EQUAL(0, ring.dropCount());
+
+  // Room for 28 bytes is room for two records of 12
+  TEST_ASSERT_NOT_NULL(ring.claim(12));
+  ring.commit(12, 0, 0);
+  TEST_ASSERT_NOT_NULL(ring.claim(12));
+  ring.commit(12, 0, 0);
+  TEST_ASSERT_EQUAL(0, ring.dropCount());
+}
+
+// Two threads in the roles of the radio and phone tasks, each feeding
+// one ring and draining the other as fast as it can. Every record must
+// arrive once, whole and in order, however the two interleave.
+struct StressSide {
+  SpscRing<STRESS_RING>* out;
+  SpscRing<STRESS_RING>* in;
+  uint32_t received;
+  uint32_t bad;
+};
+
+static void stressSide(StressSide* side) {
+  uint32_t sent = 0;
+  while (sent < STRESS_RECORDS || side->received < STRESS_RECORDS) {
+    bool progress = false;
+    if (sent < STRESS_RECORDS && produce(*side->out, sent)) {
+      sent++;
+      progress = true;
+    }
+    while (consume(*side->in, &side->received, &side->bad)) {
+      progress = true;
+    }
+    if (!progress) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void test_cross_thread_stress() {
+  static SpscRing<STRESS_RING> toPhone;
+  static SpscRing<STRESS_RING> toRadio;
+  StressSide radio = { &toPhone, &toRadio, 0, 0 };
+  StressSide phone = { &toRadio, &toPhone, 0, 0 };
+  std::thread radioThread(stressSide, &radio);
+  std::thread phoneThread(stressSide, &phone);
+  radioThread.join();
+  phoneThread.join();
+
+  TEST_ASSERT_EQUAL(STRESS_RECORDS, radio.received);
+  TEST_ASSERT_EQUAL(STRESS_RECORDS, phone.received);
+  TEST_ASSERT_EQUAL(0, radio.bad);
+  TEST_ASSERT_EQUAL(0, phone.bad);
+  TEST_ASSERT_TRUE(toPhone.empty());
+  TEST_ASSERT_TRUE(toRadio.empty());
+  TEST_ASSERT_LESS_OR_EQUAL(STRESS_RING, toPhone.highWaterBytes());
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_records_in_order);
+  RUN_TEST(test_wrap_to_start);
+  RUN_TEST(test_full_ring_drops);
+  RUN_TEST(test_has_room);
+  RUN_TEST(test_cross_thread_stress);
+  return UNITY_END();
+}
@@ -0,0 +1,125 @@
+#include <unity.h>
+#include <string.h>
+#include "station_status.h"
+
+void setUp() {}
+void tearDown() {}
+
+#define STATION_ID    7
+#define UPTIME_MS     0x12345678u
+#define COUNTERS_AT   STATUS_HEADER_SIZE
+#define STAGES_AT     (COUNTERS_AT + 4 * STATUS_CTR_COUNT)
+
+// Offset of field (0 count, 1 max, 2 average, 3.. buckets) of a stage
+static size_t stageField(uint8_t stage, uint8_t field) {
+  return STAGES_AT + stage * STATUS_STAGE_SIZE + 4 * field;
+}
+
+static uint32_t getU32(const uint8_t* p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static size_t build(uint8_t* out, size_t cap) {
+  uint32_t counters[STATUS_CTR_COUNT];
+  for (uint8_t i = 0; i < STATUS_CTR_COUNT; i++) {
+    counters[i] = 0xC0000000u | (uint32_t)i << 16 | (uint32_t)(i + 1);
+  }
+  return statusBuildSnapshot(out, cap, STATION_ID, UPTIME_MS, counters);
+}
+
+void test_snapshot_size() {
+  TEST_ASSERT_EQUAL(12 + 4 * 12, STATUS_STAGE_SIZE);
+  TEST_ASSERT_EQUAL(10 + 4 * 18 + 6 * 60, STATUS_SNAPSHOT_SIZE);
+
+  uint8_t out[STATUS_SNAPSHOT_SIZE + 16];
+  TEST_ASSERT_EQUAL(STATUS_SNAPSHOT_SIZE, build(out, sizeof(out)));
+  TEST_ASSERT_EQUAL(STATUS_SNAPSHOT_SIZE, build(out, STATUS_SNAPSHOT_SIZE));
+}
+
+void test_too_small_writes_nothing() {
+  uint8_t out[STATUS_SNAPSHOT_SIZE];
+  memset(out, 0xEE, sizeof(out));
+  TEST_ASSERT_EQUAL(0, build(out, STATUS_SNAPSHOT_SIZE - 1));
+  for (size_t i = 0; i < sizeof(out); i++) {
+    TEST_ASSERT_EQUAL_HEX8(0xEE, out[i]);
+  }
+}
+
+void test_header() {
+  uint8_t out[STATUS_SNAPSHOT_SIZE];
+  build(out, sizeof(out));
+
+  TEST_ASSERT_EQUAL_HEX8(STATUS_FORMAT_VERSION, out[0]);
+  TEST_ASSERT_EQUAL_HEX8(STATION_ID, out[1]);
+  TEST_ASSERT_EQUAL(STATUS_STAGE_COUNT, out[2]);
+  TEST_ASSERT_EQUAL(LATENCY_BUCKETS, out[3]);
+  TEST_ASSERT_EQUAL(STATUS_CTR_COUNT, out[4]);
+  TEST_ASSERT_EQUAL_HEX8(0, out[5]);
+  // Little endian
+  TEST_ASSERT_EQUAL_HEX8(0x78, out[6]);
+  TEST_ASSERT_EQUAL_HEX8(0x56, out[7]);
+  TEST_ASSERT_EQUAL_HEX8(0x34, out[8]);
+  TEST_ASSERT_EQUAL_HEX8(0x12, out[9]);
+}
+
+void test_counters_in_order() {
+  uint8_t out[STATUS_SNAPSHOT_SIZE];
+  build(out, sizeof(out));
+
+  for (uint8_t i = 0; i < STATUS_CTR_COUNT; i++) {
+    TEST_ASSERT_EQUAL_UINT32(0xC0000000u | (uint32_t)i << 16 | (uint32_t)(i + 1),
+                             getU32(out + COUNTERS_AT + 4 * i));
+  }
+  // The phone reads counters by position: the first and last must not move
+  TEST_ASSERT_EQUAL_UINT32(0xC0000001u, getU32(out + 10));
+  TEST_ASSERT_EQUAL_UINT32(0xC0110012u, getU32(out + 10 + 4 * STATUS_CTR_POOL_HIGH_WATER));
+}
+
+void test_stage_histograms() {
+  // One sample into each of buckets 0, 1, 5 and the open last bucket,
+  // and a second into bucket 1
+  statusRecord(STATUS_STAGE_AIRTIME, 50);
+  statusRecord(STATUS_STAGE_AIRTIME, 150);
+  statusRecord(STATUS_STAGE_AIRTIME, 249);
+  statusRecord(STATUS_STAGE_AIRTIME, 3000);
+  statusRecord(STATUS_STAGE_AIRTIME, 250000);
+  // A sample on a bound belongs to the bucket above it
+  statusRecord(STATUS_STAGE_RX_TOTAL, 100);
+
+  uint8_t out[STATUS_SNAPSHOT_SIZE];
+  TEST_ASSERT_EQUAL(STATUS_SNAPSHOT_SIZE, build(out, sizeof(out)));
+
+  const uint32_t airBuckets[LATENCY_BUCKETS] = { 1, 2, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1 };
+  TEST_ASSERT_EQUAL_UINT32(5, getU32(out + stageField(STATUS_STAGE_AIRTIME, 0)));
+  TEST_ASSERT_EQUAL_UINT32(250000, getU32(out + stageField(STATUS_STAGE_AIRTIME, 1)));
+  TEST_ASSERT_EQUAL_UINT32((50 + 150 + 249 + 3000 + 250000) / 5,
+                           getU32(out + stageField(STATUS_STAGE_AIRTIME, 2)));
+  for (uint8_t b = 0; b < LATENCY_BUCKETS; b++) {
+    TEST_ASSERT_EQUAL_UINT32(airBuckets[b], getU32(out + stageField(STATUS_STAGE_AIRTIME, 3 + b)));
+  }
+
+  TEST_ASSERT_EQUAL_UINT32(1, getU32(out + stageField(STATUS_STAGE_RX_TOTAL, 0)));
+  TEST_ASSERT_EQUAL_UINT32(100, getU32(out + stageField(STATUS_STAGE_RX_TOTAL, 1)));
+  TEST_ASSERT_EQUAL_UINT32(100, getU32(out + stageField(STATUS_STAGE_RX_TOTAL, 2)));
+  TEST_ASSERT_EQUAL_UINT32(1, getU32(out + stageField(STATUS_STAGE_RX_TOTAL, 3 + 1)));
+  // The last stage ends the snapshot
+  TEST_ASSERT_EQUAL(STATUS_SNAPSHOT_SIZE, stageField(STATUS_STAGE_RX_TOTAL, 3 + LATENCY_BUCKETS));
+
+  // Stages without samples are all zero
+  for (uint8_t f = 0; f < 3 + LATENCY_BUCKETS; f++) {
+    TEST_ASSERT_EQUAL_UINT32(0, getU32(out + stageField(STATUS_STAGE_BLE_INGEST, f)));
+    TEST_ASSERT_EQUAL_UINT32(0, getU32(out + stageField(STATUS_STAGE_RX_DELIVER, f)));
+  }
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_snapshot_size);
+  RUN_TEST(test_too_small_writes_nothing);
+  RUN_TEST(test_header);
+  RUN_TEST(test_counters_in_order);
+  RUN_TEST(test_stage_histograms);
+  return UNITY_END();
+}